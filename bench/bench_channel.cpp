@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "benchmark/benchmark.h"
+
+#include "luchess/core/channel.h"
+#include "luchess/core/fen.h"
+
+namespace luchess{
+
+// Round trips between this process and a forked echo process. Items are
+// round trips; the counters are latency percentiles in nanoseconds.
+
+static ChannelMessage echoMessage()
+{
+	return ChannelMessage::encodeBoard(*parseFen(
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"));
+}
+
+template<typename RoundTrip>
+static void timeRoundTrips(benchmark::State& bmState, RoundTrip roundTrip)
+{
+	using Clock = std::chrono::steady_clock;
+	std::vector<uint64_t> latencies;
+	for (auto _ : bmState)
+	{
+		auto start = Clock::now();
+		roundTrip();
+		latencies.push_back(uint64_t(std::chrono::nanoseconds(Clock::now() - start).count()));
+	}
+	bmState.SetItemsProcessed(bmState.iterations());
+	std::sort(latencies.begin(), latencies.end());
+	for (auto [counter, fraction] : {std::pair{"p50_ns", .5}, {"p99_ns", .99}, {"p999_ns", .999}})
+		bmState.counters[counter] = double(latencies[std::size_t(fraction * (latencies.size() - 1))]);
+}
+
+// ========================ShmChannel=================================
+
+// Arg: spins before sleeping on the futex, on both ends
+static void BM_ShmChannel_echo(benchmark::State& bmState)
+{
+	uint spins = uint(bmState.range(0));
+	std::string name = "luchess_bench_" + std::to_string(getpid());
+	ShmChannel channel = ShmChannel::create(name);
+	channel.spins = spins;
+	pid_t child = fork();
+	if (child == 0)
+	{
+		{
+			ShmChannel peer = ShmChannel::open(name);
+			peer.spins = spins;
+			ChannelMessage message;
+			while (peer.receive(message) && peer.send(message)) {}
+		}
+		_exit(0);
+	}
+
+	ChannelMessage message = echoMessage();
+	timeRoundTrips(bmState, [&]
+	{
+		channel.send(message);
+		channel.receive(message);
+	});
+	channel.close();
+	waitpid(child, nullptr, 0);
+}
+BENCHMARK(BM_ShmChannel_echo)->Arg(2000)->Arg(0);
+
+// ========================Pipes======================================
+
+// The same message through a pair of pipes, for comparison
+static void BM_Pipe_echo(benchmark::State& bmState)
+{
+	int request[2], reply[2];
+	if (pipe(request) || pipe(reply))
+	{
+		bmState.SkipWithError("no pipes");
+		return;
+	}
+	auto transfer = [](int from, int to, ChannelMessage& message)
+	{
+		auto bytes = reinterpret_cast<char*>(&message);
+		for (std::size_t done = 0; done < sizeof(message);)
+		{
+			ssize_t count = read(from, bytes + done, sizeof(message) - done);
+			if (count <= 0)
+				return false;
+			done += std::size_t(count);
+		}
+		return to < 0 || write(to, bytes, sizeof(message)) == ssize_t(sizeof(message));
+	};
+	pid_t child = fork();
+	if (child == 0)
+	{
+		::close(request[1]);
+		::close(reply[0]);
+		ChannelMessage message;
+		while (transfer(request[0], reply[1], message)) {}
+		_exit(0);
+	}
+	::close(request[0]);
+	::close(reply[1]);
+
+	ChannelMessage message = echoMessage();
+	timeRoundTrips(bmState, [&]
+	{
+		benchmark::DoNotOptimize(write(request[1], &message, sizeof(message)));
+		transfer(reply[0], -1, message);
+	});
+	::close(request[1]);
+	::close(reply[0]);
+	waitpid(child, nullptr, 0);
+}
+BENCHMARK(BM_Pipe_echo);
+
+}
@@ -0,0 +1,266 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "luchess/core/chess.h"
+#include "luchess/core/dedup.h"
+#include "luchess/core/format.h"
+#include "luchess/core/movegen.h"
+
+#include "fixtures.h"
+
+namespace luchess{
+
+static ChessBoard defaultBoardSetup()
+{
+	ChessBoard board;
+	populateDefaultLayout(board);
+	return board;
+}
+
+// Default layout with the a, d and e pawns lifted so every piece
+// type has an open line out of its starting square.
+static ChessBoard openLinesSetup()
+{
+	ChessBoard board = defaultBoardSetup();
+	board.getAt({0, 1}) = EMPTY_SQUARE;
+	board.getAt({3, 1}) = EMPTY_SQUARE;
+	board.getAt({4, 1}) = EMPTY_SQUARE;
+	board.getAt({4, 3}) = Piece(Pawn, White);
+	board.indexPieces();
+	return board;
+}
+
+
+// ========================ChessBoard=================================
+
+static void BM_ChessBoard_getAt(benchmark::State& bmState)
+{
+	ChessBoard board = defaultBoardSetup();
+	for (auto _ : bmState)
+	{
+		for (uint row = kMinRow; row <= kMaxRow; row++)
+			for (uint col = kMinColumn; col <= kMaxColumn; col++)
+				benchmark::DoNotOptimize(board.getAt({int(col), int(row)}));
+	}
+	bmState.SetItemsProcessed(bmState.iterations() * ChessBoard::boardSize);
+}
+BENCHMARK(BM_ChessBoard_getAt);
+
+static void BM_ChessBoard_doesLineCollide(
+	benchmark::State& bmState, BoardMove move)
+{
+	ChessBoard board = defaultBoardSetup();
+	for (auto _ : bmState)
+	{
+		benchmark::DoNotOptimize(
+			board.doesLineCollide(move.originPos, move.targetPos));
+	}
+}
+// Clear file up to the far pawn rank
+BENCHMARK_CAPTURE(BM_ChessBoard_doesLineCollide, clear,
+	BoardMove{{0, 2}, {0, 6}});
+// Long diagonal, blocked straight away
+BENCHMARK_CAPTURE(BM_ChessBoard_doesLineCollide, blocked,
+	BoardMove{{0, 0}, {7, 7}});
+
+// Executes the same move every iteration, taking it back afterwards so
+// each run starts from the same position.
+static void BM_ChessBoard_executeMove(
+	benchmark::State& bmState, BoardMove move)
+{
+	ChessBoard board = openLinesSetup();
+	ChessBoard::UndoRecord undo;
+	for (auto _ : bmState)
+	{
+		benchmark::DoNotOptimize(board.executeMove(move, &undo));
+		board.unmakeMove(move, undo);
+	}
+}
+BENCHMARK_CAPTURE(BM_ChessBoard_executeMove, Pawn,
+	BoardMove{{7, 1}, {7, 3}});
+BENCHMARK_CAPTURE(BM_ChessBoard_executeMove, Bishop,
+	BoardMove{{2, 0}, {6, 4}});
+BENCHMARK_CAPTURE(BM_ChessBoard_executeMove, Knight,
+	BoardMove{{6, 0}, {5, 2}});
+BENCHMARK_CAPTURE(BM_ChessBoard_executeMove, Rook,
+	BoardMove{{0, 0}, {0, 5}});
+BENCHMARK_CAPTURE(BM_ChessBoard_executeMove, Queen,
+	BoardMove{{3, 0}, {3, 5}});
+BENCHMARK_CAPTURE(BM_ChessBoard_executeMove, King,
+	BoardMove{{4, 0}, {4, 1}});
+
+// What a client pays to ask where one piece can go: 64 speculative
+// executeMoves, or a lookup in the position's LegalTargets
+static void BM_targetsFromSquare(benchmark::State& bmState, bool cached)
+{
+	ChessBoard board = openLinesSetup();
+	BoardPosition from{3, 0};
+	LegalTargets targets(board);
+	for (auto _ : bmState)
+	{
+		Bitboard found = 0;
+		if (cached)
+			found = targets.targets(from);
+		else
+		{
+			for (uint to = 0; to < ChessBoard::boardSize; to++)
+			{
+				// executeMove throws on a move onto a king
+				if (board.layout[to] && board.layout[to]->type == King)
+					continue;
+				BoardMove move{from, {int(to % 8), int(to / 8)}};
+				ChessBoard::UndoRecord undo;
+				if (board.executeMove(move, &undo).validMove)
+				{
+					found |= squareBit(to);
+					board.unmakeMove(move, undo);
+				}
+			}
+		}
+		benchmark::DoNotOptimize(found);
+	}
+}
+BENCHMARK_CAPTURE(BM_targetsFromSquare, speculative, false);
+BENCHMARK_CAPTURE(BM_targetsFromSquare, cached, true);
+
+// Paid once per position
+static void BM_LegalTargets(benchmark::State& bmState)
+{
+	ChessBoard board = openLinesSetup();
+	for (auto _ : bmState)
+		benchmark::DoNotOptimize(LegalTargets(board));
+}
+BENCHMARK(BM_LegalTargets);
+
+static void BM_populateDefaultLayout(benchmark::State& bmState)
+{
+	ChessBoard board;
+	for (auto _ : bmState)
+	{
+		populateDefaultLayout(board);
+		benchmark::DoNotOptimize(board.layout.data());
+		benchmark::ClobberMemory();
+	}
+}
+BENCHMARK(BM_populateDefaultLayout);
+
+
+// ========================Notation===================================
+
+static void BM_isNotationValid(benchmark::State& bmState)
+{
+	std::string move = "Nxa8 Qxc4";
+	for (auto _ : bmState)
+	{
+		benchmark::DoNotOptimize(isNotationValid(move));
+	}
+}
+BENCHMARK(BM_isNotationValid);
+
+static void BM_decryptPosition(benchmark::State& bmState)
+{
+	std::array<std::string_view, 4> positions = {"a1", "e4", "d5", "h8"};
+	for (auto _ : bmState)
+	{
+		for (auto position : positions)
+			benchmark::DoNotOptimize(decryptPosition(position));
+	}
+	bmState.SetItemsProcessed(bmState.iterations() * positions.size());
+}
+BENCHMARK(BM_decryptPosition);
+
+static void BM_encryptPosition(benchmark::State& bmState)
+{
+	for (auto _ : bmState)
+	{
+		for (uint index = 0; index < ChessBoard::boardSize; index++)
+			benchmark::DoNotOptimize(encryptPosition(index));
+	}
+	bmState.SetItemsProcessed(bmState.iterations() * ChessBoard::boardSize);
+}
+BENCHMARK(BM_encryptPosition);
+
+static void BM_formatSquare(benchmark::State& bmState)
+{
+	char buffer[kMaxSquareChars];
+	for (auto _ : bmState)
+	{
+		for (uint index = 0; index < ChessBoard::boardSize; index++)
+		{
+			benchmark::DoNotOptimize(formatSquare(buffer, index));
+			benchmark::ClobberMemory();
+		}
+	}
+	bmState.SetItemsProcessed(bmState.iterations() * ChessBoard::boardSize);
+}
+BENCHMARK(BM_formatSquare);
+
+static void BM_formatSan(benchmark::State& bmState)
+{
+	ChessBoard board = openLinesSetup();
+	BoardMove move{{2, 0}, {6, 4}};
+	char buffer[kMaxSanChars];
+	for (auto _ : bmState)
+	{
+		benchmark::DoNotOptimize(formatSan(buffer, board, move));
+		benchmark::ClobberMemory();
+	}
+}
+BENCHMARK(BM_formatSan);
+
+static void BM_formatDiagram(benchmark::State& bmState)
+{
+	ChessBoard board = defaultBoardSetup();
+	char buffer[kDiagramChars];
+	for (auto _ : bmState)
+	{
+		benchmark::DoNotOptimize(formatDiagram(buffer, board));
+		benchmark::ClobberMemory();
+	}
+}
+BENCHMARK(BM_formatDiagram);
+
+// Validates the notation of every move pair in the Kasparov game without
+// playing them, see bench_replay.cpp for the full replay.
+static void BM_kasparovGameNotation(benchmark::State& bmState)
+{
+	auto lines = loadKasparovGame();
+	if (lines.empty())
+	{
+		bmState.SkipWithError("could not load kasparov game resource");
+		return;
+	}
+	for (auto _ : bmState)
+	{
+		for (auto const& line : lines)
+			benchmark::DoNotOptimize(isNotationValid(line));
+	}
+	bmState.SetItemsProcessed(bmState.iterations() * lines.size());
+}
+BENCHMARK(BM_kasparovGameNotation);
+
+// ========================Dedup======================================
+
+// A fresh set per iteration fed a million keys, half of them repeats
+static void BM_PositionSet_insert(benchmark::State& bmState)
+{
+	std::mt19937_64 random(1);
+	std::vector<uint64_t> keys(1 << 20);
+	for (std::size_t i = 0; i < keys.size(); i++)
+		keys[i] = i % 2 && i > 1 ? keys[random() % i] : random();
+	DedupOptions options;
+	options.expectedPositions = keys.size();
+	for (auto _ : bmState)
+	{
+		PositionSet set(options);
+		for (uint64_t key : keys)
+			benchmark::DoNotOptimize(set.insert(key));
+	}
+	bmState.SetItemsProcessed(bmState.iterations() * keys.size());
+}
+BENCHMARK(BM_PositionSet_insert)->Unit(benchmark::kMillisecond);
+
+}
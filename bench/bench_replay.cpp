@@ -0,0 +1,98 @@
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "luchess/core/chess.h"
+#include "luchess/core/history.h"
+#include "luchess/core/movegen.h"
+#include "luchess/core/notation.h"
+#include "luchess/core/replay.h"
+
+#include "fixtures.h"
+
+namespace luchess{
+
+// ========================Replay=====================================
+
+static void BM_GameReplayer_kasparov(benchmark::State& bmState)
+{
+	std::string moves = loadKasparovMoves();
+	if (moves.empty())
+	{
+		bmState.SkipWithError("could not load kasparov game resource");
+		return;
+	}
+	GameReplayer replayer;
+	for (auto _ : bmState)
+		benchmark::DoNotOptimize(replayer.replay(moves));
+	bmState.SetItemsProcessed(bmState.iterations());
+	bmState.SetLabel("games");
+}
+BENCHMARK(BM_GameReplayer_kasparov);
+
+// The Kasparov game replayed as a batch of 64 games, Arg is the number
+// of worker threads.
+static void BM_replayGames_batch(benchmark::State& bmState)
+{
+	std::string moves = loadKasparovMoves();
+	if (moves.empty())
+	{
+		bmState.SkipWithError("could not load kasparov game resource");
+		return;
+	}
+	std::vector<std::string_view> games(64, moves);
+	for (auto _ : bmState)
+		benchmark::DoNotOptimize(replayGames(games, bmState.range(0)));
+	bmState.SetItemsProcessed(bmState.iterations() * games.size());
+	bmState.SetLabel("games");
+}
+BENCHMARK(BM_replayGames_batch)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+
+// ========================History==================================
+
+// Scrubbing through the Kasparov game, each seek jumps across the game
+static void BM_GameHistory_seek(benchmark::State& bmState)
+{
+	auto lines = loadKasparovGame();
+	GameHistory history;
+	for (auto const& line : lines)
+	{
+		std::size_t split = line.find(' ');
+		for (auto token : {line.substr(0, split), line.substr(split + 1)})
+		{
+			if (auto move = decryptMove(history.board, token))
+				history.play(*move);
+		}
+	}
+	if (history.plies() == 0)
+	{
+		bmState.SkipWithError("could not load kasparov game resource");
+		return;
+	}
+	uint ply = 0;
+	for (auto _ : bmState)
+	{
+		ply = (ply + 53) % (history.plies() + 1);
+		history.seek(ply);
+		benchmark::DoNotOptimize(history.board.state);
+	}
+	bmState.SetItemsProcessed(bmState.iterations());
+}
+BENCHMARK(BM_GameHistory_seek);
+
+// ========================Move generation============================
+
+static void BM_perft_startPosition(benchmark::State& bmState)
+{
+	ChessBoard board;
+	populateDefaultLayout(board);
+	uint64_t nodes = 0;
+	for (auto _ : bmState)
+		nodes += perft(board, bmState.range(0));
+	bmState.SetItemsProcessed(nodes);
+}
+BENCHMARK(BM_perft_startPosition)->DenseRange(1, 3);
+
+}
@@ -0,0 +1,305 @@
+#include <cctype>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+#include "benchmark/benchmark.h"
+
+#include "luchess/core/analysis.h"
+#include "luchess/core/batch.h"
+#include "luchess/core/chess.h"
+#include "luchess/core/eval.h"
+#include "luchess/core/fen.h"
+#include "luchess/core/movegen.h"
+#include "luchess/core/search.h"
+#include "luchess/core/see.h"
+#include "luchess/core/transposition.h"
+#include "luchess/core/zobrist.h"
+
+namespace luchess{
+
+static ChessBoard startPosition()
+{
+	ChessBoard board;
+	populateDefaultLayout(board);
+	return board;
+}
+
+// ========================Search=====================================
+
+static void BM_evaluate(benchmark::State& bmState)
+{
+	ChessBoard board = startPosition();
+	for (auto _ : bmState)
+		benchmark::DoNotOptimize(evaluate(board));
+}
+BENCHMARK(BM_evaluate);
+
+// Rook endgame, eight pieces: evaluation and move generation walk the
+// piece lists instead of the 64 squares
+static void BM_endgame(benchmark::State& bmState)
+{
+	ChessBoard board = *parseFen("8/2p5/3p4/KP5r/1R3p1k/8/8/8 w - - 0 1");
+	MoveList moves;
+	for (auto _ : bmState)
+	{
+		moves.clear();
+		generatePseudoLegalMoves(board, moves);
+		benchmark::DoNotOptimize(evaluate(board));
+		benchmark::DoNotOptimize(moves.size());
+	}
+}
+BENCHMARK(BM_endgame);
+
+// "Kiwipete", busy middlegame with captures for every piece type
+static ChessBoard kiwipetePosition()
+{
+	ChessBoard board;
+	std::array<const char*, 8> ranks = {
+		"r...k..r",
+		"p.ppqpb.",
+		"bn..pnp.",
+		"...PN...",
+		".p..P...",
+		"..N..Q.p",
+		"PPPBBPPP",
+		"R...K..R"};
+	std::string_view letters = "pbnrqk";
+	for (int rank = 0; rank < 8; rank++)
+	{
+		for (int col = 0; col < 8; col++)
+		{
+			char letter = ranks[rank][col];
+			if (letter == '.')
+				continue;
+			PieceColor color = std::isupper(letter) ? White : Black;
+			auto type = static_cast<PieceType>(letters.find(std::tolower(letter)));
+			board.getAt({col, 7 - rank}) = Piece(type, color);
+		}
+	}
+	board.indexPieces();
+	board.state.setCastleRights(0b1111);
+	return board;
+}
+
+// Every Kiwipete capture against bitboards built once, as the move
+// picker does. Items are SEE calls.
+static void BM_see_kiwipete(benchmark::State& bmState)
+{
+	ChessBoard board = kiwipetePosition();
+	MoveList captures;
+	generatePseudoLegalMoves(board, captures, MoveKind::Captures);
+	BoardBitboards bitboards(board);
+	for (auto _ : bmState)
+	{
+		for (auto const& move : captures)
+			benchmark::DoNotOptimize(see(board, bitboards, move));
+	}
+	bmState.SetItemsProcessed(bmState.iterations() * captures.size());
+}
+BENCHMARK(BM_see_kiwipete);
+
+// Every position of the tree three plies deep from kiwipete, in the
+// order a search visits them, with its pawn key
+static std::vector<std::pair<ChessBoard, uint64_t>> evaluationTree()
+{
+	std::vector<std::pair<ChessBoard, uint64_t>> positions;
+	auto walk = [&](auto& self, ChessBoard& board, uint64_t key, uint depth) -> void
+	{
+		positions.emplace_back(board, key);
+		if (depth == 0)
+			return;
+		MoveList moves;
+		generateLegalMoves(board, moves);
+		for (BoardMove const& move : moves)
+		{
+			auto undo = board.makeMove(move);
+			self(self, board, updatePawnKey(key, board, move, undo), depth - 1);
+			board.unmakeMove(move, undo);
+		}
+	};
+	ChessBoard board = kiwipetePosition();
+	walk(walk, board, pawnKey(board), 3);
+	return positions;
+}
+
+// Items are evaluations, ns_per_eval the time of one; the cached run
+// also reports the pawn cache hit rate
+static void BM_evaluate_tree(benchmark::State& bmState, bool cached)
+{
+	auto positions = evaluationTree();
+	PawnCache cache;
+	uint64_t evaluations = 0;
+	for (auto _ : bmState)
+	{
+		for (auto const& [board, key] : positions)
+			benchmark::DoNotOptimize(cached ? evaluate(board, cache, key) : evaluate(board));
+		evaluations += positions.size();
+	}
+	bmState.SetItemsProcessed(int64_t(evaluations));
+	bmState.counters["ns_per_eval"] = benchmark::Counter(double(evaluations),
+		benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+	if (cached)
+		bmState.counters["pawn_hit_rate"] = double(cache.hits) / double(cache.probes);
+}
+BENCHMARK_CAPTURE(BM_evaluate_tree, uncached, false);
+BENCHMARK_CAPTURE(BM_evaluate_tree, cached, true);
+
+static void BM_BoardBitboards(benchmark::State& bmState)
+{
+	ChessBoard board = kiwipetePosition();
+	for (auto _ : bmState)
+		benchmark::DoNotOptimize(BoardBitboards(board));
+}
+BENCHMARK(BM_BoardBitboards);
+
+// 64 boards from random games out of kiwipete, built once
+static std::vector<BoardBitboards> attackBoards()
+{
+	std::vector<BoardBitboards> boards;
+	std::mt19937_64 random(5);
+	while (boards.size() < 64)
+	{
+		ChessBoard board = kiwipetePosition();
+		for (int ply = 0; ply < 16 && boards.size() < 64; ply++)
+		{
+			MoveList moves;
+			generateLegalMoves(board, moves);
+			if (moves.empty())
+				break;
+			board.makeMove(moves[random() % moves.size()]);
+			boards.emplace_back(board);
+		}
+	}
+	return boards;
+}
+
+// Items are boards: attacked squares, mobility and check for both sides
+static void BM_summarizeAttacks(benchmark::State& bmState)
+{
+	std::vector<BoardBitboards> boards = attackBoards();
+	for (auto _ : bmState)
+	{
+		for (BoardBitboards const& board : boards)
+			benchmark::DoNotOptimize(summarizeAttacks(board));
+	}
+	bmState.SetItemsProcessed(bmState.iterations() * boards.size());
+}
+BENCHMARK(BM_summarizeAttacks);
+
+static void BM_computeAttacks(benchmark::State& bmState, BatchKernel kernel)
+{
+	if (!isBatchKernelAvailable(kernel))
+	{
+		bmState.SkipWithError("kernel not available in this build or on this CPU");
+		return;
+	}
+	std::vector<BoardBitboards> boards = attackBoards();
+	std::vector<BoardBatch> batches(boards.size() / kBatchBoards);
+	for (std::size_t i = 0; i < boards.size(); i++)
+		batches[i / kBatchBoards].set(uint(i % kBatchBoards), boards[i]);
+	BatchAttacks attacks;
+	for (auto _ : bmState)
+	{
+		for (BoardBatch const& batch : batches)
+		{
+			computeAttacks(batch, attacks, kernel);
+			benchmark::DoNotOptimize(attacks);
+		}
+	}
+	bmState.SetItemsProcessed(bmState.iterations() * boards.size());
+}
+BENCHMARK_CAPTURE(BM_computeAttacks, Scalar, BatchKernel::Scalar);
+BENCHMARK_CAPTURE(BM_computeAttacks, Avx2, BatchKernel::Avx2);
+
+// Arg is the depth. Items are nodes, nodes_to_depth is the size of the
+// tree, which is what move ordering shrinks.
+static void searchToDepth(benchmark::State& bmState, ChessBoard const& board)
+{
+	uint64_t nodes = 0;
+	for (auto _ : bmState)
+		nodes += search(board, {uint(bmState.range(0))}).nodes;
+	bmState.SetItemsProcessed(nodes);
+	bmState.counters["nodes_to_depth"] = double(nodes) / bmState.iterations();
+}
+
+static void BM_search_startPosition(benchmark::State& bmState)
+{
+	searchToDepth(bmState, startPosition());
+}
+BENCHMARK(BM_search_startPosition)->DenseRange(2, 5);
+
+static void BM_search_kiwipete(benchmark::State& bmState)
+{
+	searchToDepth(bmState, kiwipetePosition());
+}
+BENCHMARK(BM_search_kiwipete)->DenseRange(2, 5);
+
+static std::vector<ChessBoard> tableSuite()
+{
+	std::vector<ChessBoard> suite = {startPosition(), kiwipetePosition()};
+	for (std::string_view fen : {
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+		"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+		"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+		"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10"})
+		suite.push_back(*parseFen(fen));
+	return suite;
+}
+
+// Arg is the depth. Time to reach it on every position of a fixed suite,
+// one 16 MB table shared through the suite. Cold starts each round from
+// an empty table, warm loads the table a cold round saved, the load
+// counted in the time.
+static void BM_timeToDepth(benchmark::State& bmState, bool warm)
+{
+	std::vector<ChessBoard> suite = tableSuite();
+	SearchLimits limits{uint(bmState.range(0))};
+	// Per process, so benchmark runs side by side do not share the file
+	std::string path = (std::filesystem::temp_directory_path() /
+		("luchess_bench_table_" + std::to_string(getpid()) + ".bin")).string();
+	if (warm)
+	{
+		TranspositionTable table(16);
+		for (ChessBoard const& board : suite)
+			search(board, limits, &table);
+		table.save(path);
+	}
+	uint64_t nodes = 0;
+	for (auto _ : bmState)
+	{
+		TranspositionTable table = warm ? TranspositionTable::load(path) : TranspositionTable(16);
+		for (ChessBoard const& board : suite)
+			nodes += search(board, limits, &table).nodes;
+	}
+	std::filesystem::remove(path);
+	bmState.SetItemsProcessed(nodes);
+	bmState.counters["nodes_to_depth"] = double(nodes) / bmState.iterations();
+}
+BENCHMARK_CAPTURE(BM_timeToDepth, cold, false)->Arg(5)->Arg(6)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_timeToDepth, warm, true)->Arg(5)->Arg(6)->Unit(benchmark::kMillisecond);
+
+// 100 depth 3 analyses interleaved on one thread, Arg is the slice size.
+// Against BM_search_startPosition/3 this is the cost of slicing.
+static void BM_AnalysisScheduler_interleaved(benchmark::State& bmState)
+{
+	ChessBoard board = startPosition();
+	uint64_t nodes = 0;
+	for (auto _ : bmState)
+	{
+		AnalysisScheduler scheduler;
+		for (uint i = 0; i < 100; i++)
+			scheduler.add(board, {3, 0, uint64_t(bmState.range(0))});
+		scheduler.run();
+		for (auto const& analysis : scheduler.analyses)
+			nodes += analysis.nodes();
+	}
+	bmState.SetItemsProcessed(nodes);
+}
+BENCHMARK(BM_AnalysisScheduler_interleaved)->Arg(64)->Arg(1024);
+
+}
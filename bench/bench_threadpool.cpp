@@ -0,0 +1,93 @@
+#include <functional>
+#include <thread>
+
+#include "benchmark/benchmark.h"
+
+#include "luchess/core/chess.h"
+#include "luchess/core/movegen.h"
+#include "luchess/core/threadpool.h"
+
+namespace luchess{
+
+// Scheduling overhead. Arg is the worker count; items are tasks, and
+// ns_per_task is wall time over tasks, the cost of a task doing nothing.
+
+static void reportTasks(benchmark::State& bmState, uint64_t tasks)
+{
+	bmState.SetItemsProcessed(int64_t(tasks));
+	bmState.counters["ns_per_task"] = benchmark::Counter(double(tasks),
+		benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+// 1000 empty tasks submitted from outside the pool, then waited for
+static void BM_ThreadPool_submit(benchmark::State& bmState)
+{
+	ThreadPool pool(ThreadPoolOptions{.threads = uint(bmState.range(0))});
+	uint64_t tasks = 0;
+	for (auto _ : bmState)
+	{
+		TaskGroup group(pool);
+		for (uint i = 0; i < 1000; i++)
+			group.run([] {});
+		group.wait();
+		tasks += 1000;
+	}
+	reportTasks(bmState, tasks);
+	bmState.counters["steals"] = double(pool.stats().steals);
+}
+BENCHMARK(BM_ThreadPool_submit)->Arg(1)->Arg(4)->UseRealTime();
+
+// A binary tree of 4095 tasks, each forking two and waiting on them, as
+// a parallel search or perft would
+static void BM_ThreadPool_forkJoin(benchmark::State& bmState)
+{
+	ThreadPool pool(ThreadPoolOptions{.threads = uint(bmState.range(0))});
+	std::function<void(uint)> fork = [&](uint depth)
+	{
+		if (depth == 0)
+			return;
+		TaskGroup group(pool);
+		group.run([&, depth] { fork(depth - 1); });
+		group.run([&, depth] { fork(depth - 1); });
+		group.wait();
+	};
+	uint64_t tasks = 0;
+	for (auto _ : bmState)
+	{
+		fork(12);
+		tasks += (1 << 12) - 2;
+	}
+	reportTasks(bmState, tasks);
+}
+BENCHMARK(BM_ThreadPool_forkJoin)->Arg(1)->Arg(4)->UseRealTime();
+
+// What the pool saves over a thread per task
+static void BM_jthread_perTask(benchmark::State& bmState)
+{
+	uint64_t tasks = 0;
+	for (auto _ : bmState)
+	{
+		std::jthread thread([] {});
+		thread.join();
+		tasks++;
+	}
+	reportTasks(bmState, tasks);
+}
+BENCHMARK(BM_jthread_perTask)->UseRealTime();
+
+// Arg is the worker count, against BM_perft_startPosition
+static void BM_perft_pool(benchmark::State& bmState)
+{
+	ThreadPool pool(ThreadPoolOptions{.threads = uint(bmState.range(0))});
+	ChessBoard board;
+	populateDefaultLayout(board);
+	uint64_t nodes = 0;
+	for (auto _ : bmState)
+		nodes += perft(board, 4, pool);
+	bmState.SetItemsProcessed(int64_t(nodes));
+	ThreadPoolStats stats = pool.stats();
+	bmState.counters["utilisation"] = stats.utilisation;
+}
+BENCHMARK(BM_perft_pool)->Arg(1)->Arg(4)->UseRealTime();
+
+}
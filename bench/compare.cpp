@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+
+#include "allocations.h"
+#include "compare.h"
+
+namespace luchess::bench{
+
+void AllocationManager::Start()
+{
+	AllocationCounts counts = processAllocations();
+	_allocations = counts.allocations;
+	_bytes = counts.bytes;
+}
+
+void AllocationManager::Stop(Result& result)
+{
+	AllocationCounts counts = processAllocations();
+	result.num_allocs = int64_t(counts.allocations - _allocations);
+	result.total_allocated_bytes = int64_t(counts.bytes - _bytes);
+}
+
+void RecordingReporter::ReportRuns(const std::vector<Run>& reports)
+{
+	std::vector<Run> shown = reports;
+	for (auto& run : shown)
+	{
+		if (run.memory_result)
+			run.counters["allocs_per_iter"] = run.allocs_per_iter;
+		if (run.run_type != Run::RT_Iteration)
+			continue;
+		results.push_back({
+			run.benchmark_name(),
+			run.GetAdjustedCPUTime(),
+			benchmark::GetTimeUnitString(run.time_unit)});
+	}
+	benchmark::ConsoleReporter::ReportRuns(shown);
+}
+
+std::vector<BenchResult> loadBaseline(std::string const& path)
+{
+	std::ifstream file(path);
+	if (!file)
+		throw std::invalid_argument(
+			"loadBaseline invalid argument: could not open '" + path + "'.");
+	std::stringstream contents;
+	contents << file.rdbuf();
+	std::string json = contents.str();
+
+	auto benchmarksBegin = json.find("\"benchmarks\"");
+	if (benchmarksBegin == std::string::npos)
+		throw std::invalid_argument(
+			"loadBaseline invalid argument: '" + path +
+			"' is not a google benchmark json file.");
+
+	// Every benchmark entry is a flat object, so scanning brace pairs
+	// is enough without pulling in a json library.
+	static const std::regex nameRegex("\"name\"\\s*:\\s*\"([^\"]*)\"");
+	static const std::regex runTypeRegex("\"run_type\"\\s*:\\s*\"([^\"]*)\"");
+	static const std::regex cpuTimeRegex("\"cpu_time\"\\s*:\\s*([-+0-9.eE]+)");
+	static const std::regex timeUnitRegex("\"time_unit\"\\s*:\\s*\"([^\"]*)\"");
+
+	std::vector<BenchResult> results;
+	std::size_t pos = benchmarksBegin;
+	while ((pos = json.find('{', pos)) != std::string::npos)
+	{
+		auto end = json.find('}', pos);
+		if (end == std::string::npos)
+			break;
+		std::string entry = json.substr(pos, end - pos);
+		pos = end;
+
+		std::smatch name, runType, cpuTime, timeUnit;
+		if (!std::regex_search(entry, name, nameRegex) ||
+			!std::regex_search(entry, cpuTime, cpuTimeRegex))
+			continue;
+		if (std::regex_search(entry, runType, runTypeRegex) &&
+			runType[1] != "iteration")
+			continue;
+		results.push_back({
+			name[1],
+			std::stod(cpuTime[1]),
+			std::regex_search(entry, timeUnit, timeUnitRegex) ?
+				std::string(timeUnit[1]) : std::string("ns")});
+	}
+	return results;
+}
+
+int compareResults(
+	std::vector<BenchResult> const& baseline,
+	std::vector<BenchResult> const& current,
+	double threshold,
+	std::ostream& os)
+{
+	int regressions = 0;
+	os << std::left << std::setw(48) << "Benchmark"
+	   << std::right << std::setw(17) << "Baseline"
+	   << std::setw(17) << "Current"
+	   << std::setw(10) << "Change" << "\n";
+	for (auto const& result : current)
+	{
+		auto base = std::find_if(baseline.begin(), baseline.end(),
+			[&](BenchResult const& b){ return b.name == result.name; });
+		os << std::left << std::setw(48) << result.name << std::right;
+		if (base == baseline.end())
+		{
+			os << std::setw(17) << "-"
+			   << std::setw(14) << result.cpuTime << " " << result.timeUnit
+			   << "  (new)\n";
+			continue;
+		}
+		if (base->timeUnit != result.timeUnit || base->cpuTime <= 0.)
+		{
+			os << "  (time unit changed, skipped)\n";
+			continue;
+		}
+		double change = (result.cpuTime - base->cpuTime) / base->cpuTime;
+		bool regressed = change > threshold;
+		regressions += regressed;
+		os << std::fixed << std::setprecision(2)
+		   << std::setw(14) << base->cpuTime << " " << base->timeUnit
+		   << std::setw(14) << result.cpuTime << " " << result.timeUnit
+		   << std::showpos << std::setw(9) << change * 100. << "%"
+		   << std::noshowpos << std::defaultfloat
+		   << (regressed ? "  REGRESSION" : "") << "\n";
+	}
+	os << regressions << " regression(s) beyond "
+	   << threshold * 100. << "% threshold\n";
+	return regressions;
+}
+
+}
@@ -0,0 +1,60 @@
+#ifndef LUCHESS_BENCH_COMPARE_H_
+#define LUCHESS_BENCH_COMPARE_H_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace luchess::bench{
+
+struct BenchResult
+{
+	std::string name;
+	double cpuTime;
+	std::string timeUnit;
+};
+
+// Counts the allocations of the whole process during the extra run
+// google benchmark makes of each benchmark once it is registered with
+// benchmark::RegisterMemoryManager. Needs test/allocations.cpp.
+class AllocationManager : public benchmark::MemoryManager
+{
+public:
+	void Start() override;
+	void Stop(Result& result) override;
+	void Stop(Result* result) override { Stop(*result); }
+
+	uint64_t _allocations = 0;
+	uint64_t _bytes = 0;
+};
+
+// Console reporter that also keeps every iteration run it prints,
+// so the results can be checked against a baseline afterwards. With an
+// AllocationManager registered every run shows its allocations per
+// iteration as the allocs_per_iter counter.
+class RecordingReporter : public benchmark::ConsoleReporter
+{
+public:
+	void ReportRuns(const std::vector<Run>& reports) override;
+
+	std::vector<BenchResult> results;
+};
+
+// Reads the per benchmark cpu_time entries from a file written with
+// --benchmark_out=<file> --benchmark_out_format=json.
+std::vector<BenchResult> loadBaseline(std::string const& path);
+
+// Prints a comparison table and returns the number of benchmarks that
+// are more than 'threshold' (a fraction, 0.05 = 5%) slower than baseline.
+int compareResults(
+	std::vector<BenchResult> const& baseline,
+	std::vector<BenchResult> const& current,
+	double threshold,
+	std::ostream& os);
+
+}
+
+#endif // LUCHESS_BENCH_COMPARE_H_
@@ -0,0 +1,39 @@
+#ifndef LUCHESS_BENCH_FIXTURES_H_
+#define LUCHESS_BENCH_FIXTURES_H_
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace luchess{
+
+static constexpr const char* kasparovGamePath =
+	LUCHESS_RESOURCES_DIR "/kasparov-vs-the-world-chessnotations.txt";
+
+// One "white black" move pair per line
+inline std::vector<std::string> loadKasparovGame()
+{
+	std::ifstream file(kasparovGamePath);
+	std::vector<std::string> lines;
+	for (std::string line; std::getline(file, line);)
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		if (!line.empty())
+			lines.push_back(line);
+	}
+	return lines;
+}
+
+// The whole game as a single move stream for GameReplayer
+inline std::string loadKasparovMoves()
+{
+	std::ifstream file(kasparovGamePath);
+	return std::string(std::istreambuf_iterator<char>(file),
+		std::istreambuf_iterator<char>());
+}
+
+}
+
+#endif // LUCHESS_BENCH_FIXTURES_H_
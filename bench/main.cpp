@@ -0,0 +1,78 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "compare.h"
+
+/**
+
+Usage:
+	luchess_bench [google benchmark flags]
+		[--compare=<baseline.json>] [--threshold=<percent>] [--allocations]
+
+Store a baseline with
+	luchess_bench --benchmark_out=baseline.json --benchmark_out_format=json
+
+With --compare the run is checked against that file and the process
+exits non zero when any benchmark got slower than the threshold
+(5% by default).
+
+With --allocations every benchmark also reports the heap allocations
+it makes per iteration (allocs_per_iter), counted over one extra run
+of at most 16 iterations. Google benchmark allocates about 5 times
+itself during that run, so a figure under 1 is its own.
+
+**/
+
+int main(int argc, char **argv)
+{
+	std::string baselinePath;
+	double threshold = 0.05;
+	bool allocations = false;
+
+	// Pull our own flags out before google benchmark sees argv
+	std::vector<char*> benchmarkArgs;
+	for (int i = 0; i < argc; i++)
+	{
+		if (std::strncmp(argv[i], "--compare=", 10) == 0)
+			baselinePath = argv[i] + 10;
+		else if (std::strncmp(argv[i], "--threshold=", 12) == 0)
+			threshold = std::stod(argv[i] + 12) / 100.;
+		else if (std::strcmp(argv[i], "--allocations") == 0)
+			allocations = true;
+		else
+			benchmarkArgs.push_back(argv[i]);
+	}
+	int benchmarkArgc = static_cast<int>(benchmarkArgs.size());
+
+	benchmark::Initialize(&benchmarkArgc, benchmarkArgs.data());
+	if (benchmark::ReportUnrecognizedArguments(benchmarkArgc, benchmarkArgs.data()))
+		return 1;
+
+	luchess::bench::AllocationManager allocationManager;
+	if (allocations)
+		benchmark::RegisterMemoryManager(&allocationManager);
+
+	luchess::bench::RecordingReporter reporter;
+	if (baselinePath.empty())
+	{
+		if (allocations)
+			benchmark::RunSpecifiedBenchmarks(&reporter);
+		else
+			benchmark::RunSpecifiedBenchmarks();
+		benchmark::Shutdown();
+		return 0;
+	}
+
+	auto baseline = luchess::bench::loadBaseline(baselinePath);
+	benchmark::RunSpecifiedBenchmarks(&reporter);
+	benchmark::Shutdown();
+
+	std::cout << "\nComparing against " << baselinePath << "\n";
+	int regressions = luchess::bench::compareResults(
+		baseline, reporter.results, threshold, std::cout);
+	return regressions == 0 ? 0 : 2;
+}
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <charconv>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+#include "commands.h"
+#include "luchess/core/chess.h"
+#include "luchess/core/fen.h"
+#include "luchess/core/movegen.h"
+#include "luchess/core/search.h"
+
+namespace luchess::app{
+
+static constexpr uint kBenchDepth = 6;
+
+// The start position comes from populateDefaultLayout, these follow it
+static constexpr std::array<std::string_view, 8> benchPositions = {
+	// Middlegames, every castling right still open
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+	// Promotions on both sides and a black castle
+	"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+	"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+	// En passant capture available
+	"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+	// Endgames
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+	"8/4P3/8/8/8/2k5/8/4K3 w - - 0 1",
+	"8/8/1p6/8/2k5/8/5PPP/6K1 b - - 0 1",
+};
+
+int runBench(std::span<char* const> args)
+{
+	uint depth = kBenchDepth;
+	for (std::string_view arg : args)
+	{
+		std::string_view value;
+		if (!flagValue(arg, "depth", value) ||
+			std::from_chars(value.data(), value.data() + value.size(), depth).ec != std::errc() ||
+			depth == 0)
+		{
+			std::cerr << "bench: bad argument " << arg << "\n";
+			return 1;
+		}
+	}
+
+	std::vector<ChessBoard> boards(1);
+	populateDefaultLayout(boards[0]);
+	for (std::string_view fen : benchPositions)
+		boards.push_back(*parseFen(fen));
+
+	using Clock = std::chrono::steady_clock;
+	auto start = Clock::now();
+	uint64_t total = 0;
+	for (std::size_t i = 0; i < boards.size(); i++)
+	{
+		// Every legal root move through executeMove as well, so a change
+		// in move validation shows in the signature too
+		uint64_t nodes = 0;
+		MoveList moves;
+		generateLegalMoves(boards[i], moves);
+		for (BoardMove const& move : moves)
+		{
+			ChessBoard board = boards[i];
+			nodes += board.executeMove(move).validMove;
+		}
+		nodes += search(boards[i], {depth}).nodes;
+		total += nodes;
+		std::cerr << "position " << i + 1 << "/" << boards.size() << " nodes " << nodes << "\n";
+	}
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start);
+
+	std::cerr << "\n===========================\n";
+	std::cout << "Total time (ms) : " << elapsed.count() << "\n"
+		<< "Nodes searched  : " << total << "\n"
+		<< "Nodes/second    : " << total * 1000 / std::max<int64_t>(elapsed.count(), 1) << "\n";
+	return 0;
+}
+
+}
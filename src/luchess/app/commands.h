@@ -0,0 +1,60 @@
+#ifndef LUCHESS_APP_COMMANDS_H_
+#define LUCHESS_APP_COMMANDS_H_
+
+#include <charconv>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "luchess/core/fen.h"
+
+/**
+
+Subcommands of the luchess executable. Each gets the arguments after
+its name and returns the process exit code.
+
+**/
+
+namespace luchess::app{
+
+int runEpd(std::span<char* const> args);
+
+int runBench(std::span<char* const> args);
+
+int runSelfPlay(std::span<char* const> args);
+
+int runTournament(std::span<char* const> args);
+
+int runDedup(std::span<char* const> args);
+
+int runGameLog(std::span<char* const> args);
+
+// Every position of an EPD or FEN file, one per line. Blank lines and
+// lines starting with '#' are skipped, bad positions are reported and
+// skipped, nullopt when the file cannot be read.
+std::optional<std::vector<EpdRecord>> readEpdFile(std::string const& path,
+	std::string_view command);
+
+// Value of "--<name>=value" when 'arg' is that flag
+inline bool flagValue(std::string_view arg, std::string_view name, std::string_view& value)
+{
+	if (!arg.starts_with("--") || arg.substr(2, name.size()) != name ||
+		arg.size() < name.size() + 3 || arg[name.size() + 2] != '=')
+		return false;
+	value = arg.substr(name.size() + 3);
+	return true;
+}
+
+// Whole of 'text' as a number
+template<typename T>
+bool parseFlag(std::string_view text, T& value)
+{
+	auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+	return error == std::errc() && end == text.data() + text.size();
+}
+
+}
+
+#endif // LUCHESS_APP_COMMANDS_H_
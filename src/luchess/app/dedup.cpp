@@ -0,0 +1,72 @@
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include "commands.h"
+#include "luchess/core/dedup.h"
+#include "luchess/core/selfplay.h"
+
+namespace luchess::app{
+
+int runDedup(std::span<char* const> args)
+{
+	std::string inPath, outPath;
+	DedupOptions options;
+	uint threads = 0;
+	std::size_t memoryMb = 0;
+	for (std::string_view arg : args)
+	{
+		std::string_view value;
+		bool valid = true;
+		if (flagValue(arg, "threads", value))
+			valid = parseFlag(value, threads);
+		else if (flagValue(arg, "memory", value))
+			valid = parseFlag(value, memoryMb);
+		else if (flagValue(arg, "spill", value))
+			options.spillDirectory = std::string(value);
+		else if (!arg.starts_with("--") && inPath.empty())
+			inPath = arg;
+		else if (!arg.starts_with("--") && outPath.empty())
+			outPath = arg;
+		else
+			valid = false;
+		if (!valid)
+		{
+			std::cerr << "dedup: bad argument " << arg << "\n";
+			return 1;
+		}
+	}
+	if (inPath.empty() || outPath.empty())
+	{
+		std::cerr << "dedup: an input and an output file are required\n";
+		return 1;
+	}
+	options.memoryLimit = memoryMb << 20;
+	// At most every record is new
+	std::error_code error;
+	options.expectedPositions = std::filesystem::file_size(inPath, error) / sizeof(TrainingRecord);
+
+	DedupSummary summary;
+	try
+	{
+		summary = dedupTrainingRecords(inPath, outPath, options, threads);
+	}
+	catch (std::exception const& failure)
+	{
+		std::cerr << failure.what() << "\n";
+		return 1;
+	}
+
+	std::cerr << "positions " << summary.total << " unique " << summary.unique
+		<< " spilled " << summary.spilled
+		<< " memory " << (summary.memoryBytes >> 20) << " MB";
+	if (summary.unique)
+		std::cerr << " (" << double(summary.memoryBytes) / summary.unique << " bytes a position)";
+	std::cerr << " time " << summary.elapsed.count() / 1000 << " ms"
+		<< " positions/s " << uint64_t(summary.positionsPerSecond()) << "\n";
+	return 0;
+}
+
+}
@@ -0,0 +1,118 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "commands.h"
+#include "luchess/core/fen.h"
+#include "luchess/core/suite.h"
+
+namespace luchess::app{
+
+std::optional<std::vector<EpdRecord>> readEpdFile(std::string const& path,
+	std::string_view command)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		std::cerr << command << ": cannot open " << path << "\n";
+		return std::nullopt;
+	}
+	std::vector<EpdRecord> positions;
+	std::string line;
+	for (uint lineNumber = 1; std::getline(file, line); lineNumber++)
+	{
+		if (line.find_first_not_of(" \t\r") == std::string::npos || line[0] == '#')
+			continue;
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		auto record = parseEpd(line);
+		if (!record)
+		{
+			std::cerr << command << ": " << path << ":" << lineNumber << ": bad position\n";
+			continue;
+		}
+		positions.push_back(std::move(*record));
+	}
+	return positions;
+}
+
+int runEpd(std::span<char* const> args)
+{
+	std::string suitePath, outPath, checkpointPath;
+	SuiteOptions options;
+	options.limits.depth = kMaxPly - 1;
+	uint depth = 0;
+	uint64_t timeMs = 0;
+	for (std::string_view arg : args)
+	{
+		std::string_view value;
+		bool valid = true;
+		if (flagValue(arg, "depth", value))
+			valid = parseFlag(value, depth);
+		else if (flagValue(arg, "nodes", value))
+			valid = parseFlag(value, options.limits.nodes);
+		else if (flagValue(arg, "time", value))
+			valid = parseFlag(value, timeMs);
+		else if (flagValue(arg, "multipv", value))
+			valid = parseFlag(value, options.lines);
+		else if (flagValue(arg, "threads", value))
+			valid = parseFlag(value, options.threads);
+		else if (flagValue(arg, "out", value))
+			outPath = value;
+		else if (flagValue(arg, "checkpoint", value))
+			checkpointPath = value;
+		else if (!arg.starts_with("--") && suitePath.empty())
+			suitePath = arg;
+		else
+			valid = false;
+		if (!valid)
+		{
+			std::cerr << "epd: bad argument " << arg << "\n";
+			return 1;
+		}
+	}
+	if (suitePath.empty())
+	{
+		std::cerr << "epd: no position file given\n";
+		return 1;
+	}
+	options.limits.time = std::chrono::milliseconds(timeMs);
+	// Without any budget a search would never end
+	if (depth)
+		options.limits.depth = depth;
+	else if (!options.limits.nodes && !timeMs)
+		options.limits.depth = SearchLimits{}.depth;
+
+	// Indices count parsed positions, so they stay put between runs
+	auto positions = readEpdFile(suitePath, "epd");
+	if (!positions)
+		return 1;
+
+	std::vector<bool> finished;
+	std::ofstream checkpoint;
+	if (!checkpointPath.empty())
+	{
+		std::ifstream previous(checkpointPath);
+		finished = readCheckpoint(previous, positions->size());
+		checkpoint.open(checkpointPath, std::ios::app);
+	}
+	std::ofstream outFile;
+	if (!outPath.empty())
+		outFile.open(outPath, std::ios::app);
+	std::ostream& results = outPath.empty() ? std::cout : outFile;
+
+	SuiteSummary summary = runSuite(*positions, options, results,
+		checkpointPath.empty() ? nullptr : &checkpoint, finished);
+
+	std::cerr << "positions " << summary.searched << " (" << summary.skipped << " skipped)"
+		<< " nodes " << summary.nodes
+		<< " time " << summary.elapsed.count() / 1000 << " ms"
+		<< " nps " << uint64_t(summary.nodesPerSecond())
+		<< " positions/s " << summary.positionsPerSecond() << "\n"
+		<< "latency us p50 " << summary.p50.count() << " p90 " << summary.p90.count()
+		<< " p99 " << summary.p99.count() << " max " << summary.max.count() << "\n";
+	return 0;
+}
+
+}
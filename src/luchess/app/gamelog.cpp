@@ -0,0 +1,180 @@
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "commands.h"
+#include "luchess/core/chess.h"
+#include "luchess/core/gamelog.h"
+#include "luchess/core/movegen.h"
+
+namespace luchess::app{
+
+struct LoadOptions
+{
+	uint games = 100000;
+	uint plies = 16;
+	uint threads = 0;
+	// Games a thread plays side by side, each round of moves is synced once
+	uint window = 256;
+};
+
+// Plays random games with every accepted move logged, a thread's games
+// a window at a time. Returns the moves made.
+static uint64_t playLoad(GameLog& log, LoadOptions const& options)
+{
+	std::atomic<uint64_t> moves = 0;
+	std::atomic<bool> failed = false;
+	auto worker = [&](uint index)
+	{
+		try
+		{
+			std::mt19937_64 random(index);
+			std::vector<ChessBoard> boards;
+			std::vector<uint32_t> games;
+			MoveList legal;
+			for (uint first = index * options.window; first < options.games;
+				 first += options.threads * options.window)
+			{
+				games.clear();
+				boards.clear();
+				uint64_t sequence = 0;
+				for (uint game = first; game < std::min(options.games, first + options.window); game++)
+				{
+					games.push_back(game);
+					populateDefaultLayout(boards.emplace_back());
+					sequence = log.startGame(game, boards.back());
+				}
+				log.sync(sequence);
+				for (uint ply = 1; ply <= options.plies && !games.empty(); ply++)
+				{
+					for (std::size_t i = 0; i < games.size();)
+					{
+						legal.clear();
+						generateLegalMoves(boards[i], legal);
+						bool finished = legal.empty();
+						if (!finished)
+						{
+							BoardMove move =
+								legal[std::uniform_int_distribution<std::size_t>(0, legal.size() - 1)(random)];
+							finished = boards[i].executeMove(move).finished;
+							sequence = log.logMove(games[i], ply, move, boards[i]);
+							moves.fetch_add(1, std::memory_order_relaxed);
+						}
+						if (!finished)
+						{
+							i++;
+							continue;
+						}
+						sequence = log.finishGame(games[i], ply);
+						games[i] = games.back();
+						games.pop_back();
+						boards[i] = std::move(boards.back());
+						boards.pop_back();
+					}
+					// The round's moves are acknowledged once durable
+					log.sync(sequence);
+				}
+			}
+		}
+		catch (std::system_error const&)
+		{
+			// The other threads fail their next sync as well
+			failed = true;
+		}
+	};
+	{
+		std::vector<std::jthread> workers;
+		for (uint i = 1; i < options.threads; i++)
+			workers.emplace_back(worker, i);
+		worker(0);
+	}
+	if (failed)
+		throw std::runtime_error("gamelog: cannot write the log");
+	return moves;
+}
+
+int runGameLog(std::span<char* const> args)
+{
+	std::string path;
+	LoadOptions load;
+	GameLogOptions options;
+	uint sync = 1;
+	for (std::string_view arg : args)
+	{
+		std::string_view value;
+		bool valid = true;
+		if (flagValue(arg, "games", value))
+			valid = parseFlag(value, load.games);
+		else if (flagValue(arg, "plies", value))
+			valid = parseFlag(value, load.plies);
+		else if (flagValue(arg, "threads", value))
+			valid = parseFlag(value, load.threads);
+		else if (flagValue(arg, "window", value))
+			valid = parseFlag(value, load.window) && load.window;
+		else if (flagValue(arg, "checkpoint", value))
+			valid = parseFlag(value, options.checkpointPlies);
+		else if (flagValue(arg, "sync", value))
+			valid = parseFlag(value, sync) && sync <= 1;
+		else if (!arg.starts_with("--") && path.empty())
+			path = arg;
+		else
+			valid = false;
+		if (!valid)
+		{
+			std::cerr << "gamelog: bad argument " << arg << "\n";
+			return 1;
+		}
+	}
+	if (path.empty())
+	{
+		std::cerr << "gamelog: a log file is required\n";
+		return 1;
+	}
+	options.sync = sync;
+	if (load.threads == 0)
+		load.threads = std::max(1u, std::thread::hardware_concurrency());
+
+	using Clock = std::chrono::steady_clock;
+	try
+	{
+		if (load.games)
+		{
+			auto start = Clock::now();
+			uint64_t moves, records, syncs;
+			{
+				GameLog log(path, options);
+				moves = playLoad(log, load);
+				records = log.records();
+				syncs = log.syncs();
+			}
+			double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			std::cerr << "games " << load.games << " moves " << moves
+				<< " records " << records << " syncs " << syncs
+				<< " time " << uint64_t(seconds * 1000) << " ms"
+				<< " durable moves/s " << uint64_t(moves / seconds) << "\n";
+		}
+
+		GameLogRecovery recovery = recoverGameLog(path);
+		std::error_code error;
+		std::cerr << "recovered " << recovery.games.size() << " live games from "
+			<< recovery.records << " records ("
+			<< (std::filesystem::file_size(path, error) >> 20) << " MB), replaying "
+			<< recovery.replayed << " moves, in "
+			<< recovery.elapsed.count() / 1000 << " ms\n";
+	}
+	catch (std::exception const& failure)
+	{
+		std::cerr << failure.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
+
+}
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <span>
+#include <string_view>
+
+#include "commands.h"
+
+/**
+
+Usage:
+	luchess epd <file> [--depth=<plies>] [--nodes=<n>] [--time=<ms>]
+		[--multipv=<lines>] [--threads=<n>] [--out=<file>]
+		[--checkpoint=<file>]
+	luchess bench [--depth=<plies>]
+	luchess selfplay <file> --games=<n> [--nodes=<n>] [--opening=<plies>]
+		[--maxplies=<plies>] [--seed=<n>] [--threads=<n>]
+	luchess tournament <openings> [--pairs=<n>] [--threads=<n>]
+		[--maxplies=<plies>] [--elo0=<elo>] [--elo1=<elo>] [--alpha=<p>]
+		[--beta=<p>] [--[a-|b-]depth=<plies>] [--[a-|b-]nodes=<n>]
+		[--[a-|b-]time=<ms>] [--[a-|b-]quiescence=<0|1>]
+	luchess dedup <in> <out> [--threads=<n>] [--memory=<MB>] [--spill=<dir>]
+	luchess gamelog <file> [--games=<n>] [--plies=<n>] [--threads=<n>]
+		[--window=<games>] [--checkpoint=<plies>] [--sync=<0|1>]
+
+epd searches every position of an EPD or FEN file, one per line, and
+writes a JSON line per position (see luchess/core/suite.h) to stdout or
+appends it to --out. With --checkpoint finished positions are recorded
+and skipped when the same command is run again. The budget flags are
+per position, throughput and latency percentiles go to stderr.
+
+bench searches a fixed set of built in positions to a fixed depth (6
+by default) on one thread and prints the total node count and nodes per
+second. The node count is a signature: it only changes when move
+validation, move generation, evaluation or search behave differently,
+so compare it before and after a change that should not alter play.
+
+selfplay plays games 0 to n - 1 engine against engine, searching every
+move with --nodes nodes (5000 by default) after --opening random plies
+(8), and appends the positions as TrainingRecords (see
+luchess/core/selfplay.h) to the file. Ctrl-C stops it keeping every
+finished game; the same command then resumes with the games still
+missing. Progress and positions per second go to stderr.
+
+tournament plays engine a against engine b in game pairs with colours
+swapped, cycling through the openings of an EPD or FEN file (see
+luchess/core/tournament.h). Budget flags set both engines, the a- and
+b- forms one of them; each searches 5000 nodes a move by default. Up
+to --pairs pairs (1000) are played, stopping once the SPRT of elo0
+(0) against elo1 (5) for engine a decides. Elo, error bars, LLR and
+games per minute go to stderr.
+
+dedup appends one record of every distinct position (by zobrist key) of
+a selfplay file to another (see luchess/core/dedup.h). With --memory
+the hash tables spill to sorted run files in --spill (the temporary
+directory) past that many megabytes. Counts, memory and positions per
+second go to stderr.
+
+gamelog appends --games random games (100000) of up to --plies plies
+(16) to a write ahead log (see luchess/core/gamelog.h), each thread
+playing --window games (256) side by side and syncing once per round
+of their moves, then recovers every live game from the log. Durable
+moves per second and the recovery time go to stderr. --games=0 only
+recovers.
+
+**/
+
+int main(int argc, char **argv)
+{
+	std::span<char* const> args(argv, argc);
+	std::string_view command = argc > 1 ? argv[1] : "";
+	if (command == "epd")
+		return luchess::app::runEpd(args.subspan(2));
+	if (command == "bench")
+		return luchess::app::runBench(args.subspan(2));
+	if (command == "selfplay")
+		return luchess::app::runSelfPlay(args.subspan(2));
+	if (command == "tournament")
+		return luchess::app::runTournament(args.subspan(2));
+	if (command == "dedup")
+		return luchess::app::runDedup(args.subspan(2));
+	if (command == "gamelog")
+		return luchess::app::runGameLog(args.subspan(2));
+
+	std::cerr << "usage: luchess epd <file> [options] | luchess bench [--depth=<plies>]"
+		" | luchess selfplay <file> --games=<n> [options]"
+		" | luchess tournament <openings> [options]"
+		" | luchess dedup <in> <out> [options]"
+		" | luchess gamelog <file> [options]\n";
+	return 1;
+}
@@ -0,0 +1,99 @@
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "commands.h"
+#include "luchess/core/selfplay.h"
+
+namespace luchess::app{
+
+// Lock free, so the signal handler may set it
+static std::atomic<bool> stopRequested = false;
+
+static void requestStop(int)
+{
+	stopRequested = true;
+}
+
+int runSelfPlay(std::span<char* const> args)
+{
+	std::string path;
+	SelfPlayOptions options;
+	for (std::string_view arg : args)
+	{
+		std::string_view value;
+		bool valid = true;
+		if (flagValue(arg, "games", value))
+			valid = parseFlag(value, options.games);
+		else if (flagValue(arg, "nodes", value))
+			valid = parseFlag(value, options.nodes) && options.nodes;
+		else if (flagValue(arg, "opening", value))
+			valid = parseFlag(value, options.openingPlies);
+		else if (flagValue(arg, "maxplies", value))
+			valid = parseFlag(value, options.maxPlies);
+		else if (flagValue(arg, "seed", value))
+			valid = parseFlag(value, options.seed);
+		else if (flagValue(arg, "threads", value))
+			valid = parseFlag(value, options.threads);
+		else if (!arg.starts_with("--") && path.empty())
+			path = arg;
+		else
+			valid = false;
+		if (!valid)
+		{
+			std::cerr << "selfplay: bad argument " << arg << "\n";
+			return 1;
+		}
+	}
+	if (path.empty() || !options.games)
+	{
+		std::cerr << "selfplay: an output file and --games are required\n";
+		return 1;
+	}
+
+	std::signal(SIGINT, requestStop);
+	std::signal(SIGTERM, requestStop);
+
+	using Clock = std::chrono::steady_clock;
+	auto start = Clock::now();
+	SelfPlayProgress progress;
+	std::jthread reporter([&](std::stop_token token)
+	{
+		auto nextReport = start + std::chrono::seconds(10);
+		while (!token.stop_requested())
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			if (Clock::now() < nextReport)
+				continue;
+			nextReport += std::chrono::seconds(10);
+			double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			uint64_t positions = progress.positions;
+			std::cerr << "games " << progress.games << " positions " << positions
+				<< " positions/s " << uint64_t(positions / seconds) << "\n";
+		}
+	});
+
+	SelfPlaySummary summary;
+	try
+	{
+		summary = runSelfPlay(path, options, stopRequested, &progress);
+	}
+	catch (std::exception const& error)
+	{
+		std::cerr << error.what() << "\n";
+		return 1;
+	}
+	reporter.request_stop();
+
+	std::cerr << (stopRequested ? "stopped, " : "") << "games " << summary.games
+		<< " (" << summary.skipped << " already in file)"
+		<< " positions " << summary.positions
+		<< " time " << summary.elapsed.count() / 1000 << " ms"
+		<< " positions/s " << uint64_t(summary.positionsPerSecond()) << "\n";
+	return 0;
+}
+
+}
@@ -0,0 +1,152 @@
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "commands.h"
+#include "luchess/core/tournament.h"
+
+namespace luchess::app{
+
+static std::atomic<bool> stopRequested = false;
+
+static void requestStop(int)
+{
+	stopRequested = true;
+}
+
+// Whether a search budget flag is well formed, nullopt for other flags
+static std::optional<bool> parseEngineFlag(std::string_view arg, SearchLimits& limits)
+{
+	std::string_view value;
+	uint64_t number = 0;
+	if (flagValue(arg, "depth", value))
+		return parseFlag(value, limits.depth) && limits.depth;
+	if (flagValue(arg, "nodes", value))
+		return parseFlag(value, limits.nodes);
+	if (flagValue(arg, "time", value))
+	{
+		if (!parseFlag(value, number))
+			return false;
+		limits.time = std::chrono::milliseconds(number);
+		return true;
+	}
+	if (flagValue(arg, "quiescence", value))
+	{
+		if (!parseFlag(value, number) || number > 1)
+			return false;
+		limits.quiescence = number;
+		return true;
+	}
+	return std::nullopt;
+}
+
+static char const* decisionName(SprtDecision decision)
+{
+	switch (decision)
+	{
+		case SprtDecision::AcceptH0: return "H0 accepted";
+		case SprtDecision::AcceptH1: return "H1 accepted";
+		default: return "no decision";
+	}
+}
+
+static void printStats(TournamentStats const& stats, SprtBounds const& bounds)
+{
+	char line[160];
+	std::snprintf(line, sizeof(line),
+		"games %llu W-L-D %llu-%llu-%llu elo %.1f +- %.1f LLR %.2f [%.2f, %.2f]\n",
+		static_cast<unsigned long long>(stats.games()),
+		static_cast<unsigned long long>(stats.wins),
+		static_cast<unsigned long long>(stats.losses),
+		static_cast<unsigned long long>(stats.draws),
+		stats.elo(), stats.eloError(), stats.llr(bounds), bounds.lower(), bounds.upper());
+	std::cerr << line;
+}
+
+int runTournament(std::span<char* const> args)
+{
+	std::string openingsPath;
+	std::array<SearchLimits, 2> engines;
+	engines.fill({kMaxPly - 1, 5000});
+	TournamentOptions options;
+	options.pairs = 1000;
+	for (std::string_view arg : args)
+	{
+		std::string_view value;
+		bool valid = true;
+		// --a-<flag> and --b-<flag> set one engine's budget, --<flag> both
+		if (arg.starts_with("--a-") || arg.starts_with("--b-"))
+		{
+			std::string flag = "--" + std::string(arg.substr(4));
+			valid = parseEngineFlag(flag, engines[arg[2] == 'b']).value_or(false);
+		}
+		else if (auto parsed = parseEngineFlag(arg, engines[0]))
+			valid = *parsed && *parseEngineFlag(arg, engines[1]);
+		else if (flagValue(arg, "pairs", value))
+			valid = parseFlag(value, options.pairs);
+		else if (flagValue(arg, "maxplies", value))
+			valid = parseFlag(value, options.maxPlies);
+		else if (flagValue(arg, "threads", value))
+			valid = parseFlag(value, options.threads);
+		else if (flagValue(arg, "elo0", value))
+			valid = parseFlag(value, options.sprt.elo0);
+		else if (flagValue(arg, "elo1", value))
+			valid = parseFlag(value, options.sprt.elo1);
+		else if (flagValue(arg, "alpha", value))
+			valid = parseFlag(value, options.sprt.alpha);
+		else if (flagValue(arg, "beta", value))
+			valid = parseFlag(value, options.sprt.beta);
+		else if (!arg.starts_with("--") && openingsPath.empty())
+			openingsPath = arg;
+		else
+			valid = false;
+		if (!valid)
+		{
+			std::cerr << "tournament: bad argument " << arg << "\n";
+			return 1;
+		}
+	}
+	if (openingsPath.empty())
+	{
+		std::cerr << "tournament: no openings file given\n";
+		return 1;
+	}
+	auto records = readEpdFile(openingsPath, "tournament");
+	if (!records)
+		return 1;
+	std::vector<ChessBoard> openings;
+	for (EpdRecord const& record : *records)
+		openings.push_back(record.board);
+	if (openings.empty())
+	{
+		std::cerr << "tournament: " << openingsPath << " has no positions\n";
+		return 1;
+	}
+
+	std::signal(SIGINT, requestStop);
+	std::signal(SIGTERM, requestStop);
+
+	using Clock = std::chrono::steady_clock;
+	auto nextReport = Clock::now();
+	TournamentSummary summary = runTournament(engines, openings, options, stopRequested,
+		[&](TournamentStats const& stats)
+		{
+			if (Clock::now() < nextReport)
+				return;
+			nextReport = Clock::now() + std::chrono::seconds(5);
+			printStats(stats, options.sprt);
+		});
+
+	printStats(summary.stats, options.sprt);
+	std::cerr << (stopRequested ? "stopped, " : "") << decisionName(summary.decision)
+		<< " after " << summary.stats.pairs() << " pairs"
+		<< " time " << summary.elapsed.count() / 1000 << " ms"
+		<< " games/min " << uint64_t(summary.gamesPerMinute()) << "\n";
+	return 0;
+}
+
+}
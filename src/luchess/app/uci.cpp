@@ -0,0 +1,461 @@
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+#include "uci.h"
+#include "luchess/core/chess.h"
+#include "luchess/core/fen.h"
+#include "luchess/core/format.h"
+#include "luchess/core/notation.h"
+#include "luchess/core/zobrist.h"
+
+namespace luchess::app{
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr int64_t kNoDeadline = std::numeric_limits<int64_t>::max();
+
+static std::string_view nextToken(std::string_view& text)
+{
+	std::size_t start = text.find_first_not_of(" \t\r");
+	if (start == std::string_view::npos)
+	{
+		text = {};
+		return {};
+	}
+	text.remove_prefix(start);
+	std::size_t end = std::min(text.find_first_of(" \t\r"), text.size());
+	std::string_view token = text.substr(0, end);
+	text.remove_prefix(end);
+	return token;
+}
+
+template<typename T>
+static T parseNumber(std::string_view text)
+{
+	T value{};
+	std::from_chars(text.data(), text.data() + text.size(), value);
+	return value;
+}
+
+// ========================Output=====================================
+
+UciOutput::UciOutput(std::ostream& _out) :
+	out(_out),
+	writer([this]()
+	{
+		std::unique_lock lock(mutex);
+		while (true)
+		{
+			queued.wait(lock, [this]{ return closing || !lines.empty(); });
+			if (lines.empty())
+				return;
+			std::deque<std::string> batch;
+			batch.swap(lines);
+			lock.unlock();
+			for (auto const& line : batch)
+				out << line << '\n';
+			out << std::flush;
+			lock.lock();
+		}
+	})
+{}
+
+UciOutput::~UciOutput()
+{
+	{
+		std::lock_guard lock(mutex);
+		closing = true;
+	}
+	queued.notify_one();
+	writer.join();
+}
+
+void UciOutput::send(std::string line)
+{
+	{
+		std::lock_guard lock(mutex);
+		lines.push_back(std::move(line));
+	}
+	queued.notify_one();
+}
+
+// ========================Engine=====================================
+
+UciEngine::UciEngine(std::ostream& out) :
+	output(out),
+	deadline(kNoDeadline)
+{
+	_position("startpos");
+}
+
+UciEngine::~UciEngine()
+{
+	_stopSearch();
+}
+
+void UciEngine::run(std::istream& in)
+{
+	std::jthread reader([this, &in]
+	{
+		// Nothing is read past quit, so this thread never outlives run
+		std::string line;
+		while (std::getline(in, line))
+		{
+			std::string_view rest = line;
+			bool quit = nextToken(rest) == "quit";
+			_receive(std::move(line));
+			if (quit)
+				break;
+		}
+		std::lock_guard lock(inputMutex);
+		inputClosed = true;
+		inputQueued.notify_one();
+	});
+
+	while (true)
+	{
+		std::string line;
+		{
+			std::unique_lock lock(inputMutex);
+			inputQueued.wait(lock, [this]{ return inputClosed || !commands.empty(); });
+			if (commands.empty())
+				return;
+			line = std::move(commands.front());
+			commands.pop_front();
+		}
+		bool more = handle(line);
+		std::lock_guard lock(inputMutex);
+		unhandled--;
+		if (!more)
+			return;
+	}
+}
+
+void UciEngine::_receive(std::string line)
+{
+	std::string_view rest = line;
+	std::string_view command = nextToken(rest);
+	std::lock_guard lock(inputMutex);
+	// With nothing ahead of them these are for the search running now.
+	// Otherwise they wait their turn, so they reach the search a queued
+	// go starts rather than the one before it. handle never runs on both
+	// threads at once: the caller's thread is idle while nothing is
+	// unhandled, and holding the lock keeps it so.
+	if (!unhandled && (command == "stop" || command == "ponderhit"))
+	{
+		handle(line);
+		return;
+	}
+	commands.push_back(std::move(line));
+	unhandled++;
+	inputQueued.notify_one();
+}
+
+bool UciEngine::handle(std::string_view line)
+{
+	std::string_view command = nextToken(line);
+	if (command == "uci")
+	{
+		output.send("id name LuChess");
+		output.send("id author LuChess developers");
+		output.send("option name Hash type spin default " + std::to_string(kDefaultHashMb) +
+			" min 1 max 4096");
+		output.send("option name Threads type spin default 1 min 1 max 1");
+		output.send("option name Ponder type check default false");
+		output.send("uciok");
+	}
+	else if (command == "isready")
+		output.send("readyok");
+	else if (command == "ucinewgame")
+	{
+		finish();
+		table.clear();
+		_position("startpos");
+	}
+	else if (command == "position")
+		_position(line);
+	else if (command == "go")
+		_go(line);
+	else if (command == "stop")
+	{
+		std::lock_guard lock(holdMutex);
+		stopRequested = true;
+		released.notify_all();
+	}
+	else if (command == "ponderhit")
+	{
+		std::lock_guard lock(holdMutex);
+		if (ponderBudget.count())
+			deadline = (Clock::now() + ponderBudget).time_since_epoch().count();
+		pondering = false;
+		released.notify_all();
+	}
+	else if (command == "setoption")
+		_setOption(line);
+	else if (command == "quit")
+	{
+		_stopSearch();
+		return false;
+	}
+	else if (!command.empty())
+		output.send("info string unknown command " + std::string(command));
+	return true;
+}
+
+void UciEngine::finish()
+{
+	if (searchThread.joinable() && (infinite || pondering))
+		_stopSearch();
+	if (searchThread.joinable())
+		searchThread.join();
+}
+
+void UciEngine::loadTable(std::string const& path)
+{
+	finish();
+	try
+	{
+		table = TranspositionTable::load(path);
+		hashMb = uint(table.bytes() >> 20);
+		output.send("info string loaded " + std::to_string(hashMb) + " MB hash from " + path);
+	}
+	catch (std::runtime_error const& failure)
+	{
+		output.send(std::string("info string ") + failure.what());
+	}
+}
+
+void UciEngine::saveTable(std::string const& path)
+{
+	finish();
+	try
+	{
+		table.save(path);
+	}
+	catch (std::runtime_error const& failure)
+	{
+		output.send(std::string("info string ") + failure.what());
+	}
+}
+
+void UciEngine::_stopSearch()
+{
+	if (!searchThread.joinable())
+		return;
+	{
+		std::lock_guard lock(holdMutex);
+		stopRequested = true;
+		pondering = false;
+		released.notify_all();
+	}
+	searchThread.join();
+}
+
+void UciEngine::_position(std::string_view args)
+{
+	std::string_view kind = nextToken(args);
+	std::optional<ChessBoard> root;
+	if (kind == "startpos")
+	{
+		root.emplace();
+		populateDefaultLayout(*root);
+	}
+	else if (kind == "fen")
+	{
+		std::size_t movesAt = args.find(" moves");
+		root = parseFen(args.substr(0, movesAt));
+		args = movesAt == std::string_view::npos ? std::string_view() : args.substr(movesAt);
+	}
+	if (!root)
+	{
+		output.send("info string bad position");
+		return;
+	}
+
+	board = std::move(*root);
+	uint64_t key = zobristKey(board);
+	repetitions.reset(key, board.state.halfmoveClock());
+	if (nextToken(args) != "moves")
+		return;
+	for (std::string_view text = nextToken(args); !text.empty(); text = nextToken(args))
+	{
+		auto move = parseUciMove(board, text);
+		if (!move)
+		{
+			output.send("info string illegal move " + std::string(text));
+			return;
+		}
+		auto undo = board.makeMove(*move);
+		key = updateZobristKey(key, board, *move, undo);
+		// Positions before the tracker's window cannot repeat any more
+		repetitions.push(key, board.state.halfmoveClock());
+	}
+}
+
+void UciEngine::_setOption(std::string_view args)
+{
+	// "name <words> value <value>", names may have spaces
+	if (nextToken(args) != "name")
+		return;
+	std::string name;
+	std::string_view token;
+	for (token = nextToken(args); !token.empty() && token != "value"; token = nextToken(args))
+	{
+		if (!name.empty())
+			name += ' ';
+		name += token;
+	}
+	std::string_view value = nextToken(args);
+	if (name == "Hash")
+	{
+		hashMb = std::clamp(parseNumber<uint>(value), 1u, 4096u);
+		// GUIs send the size every start, a loaded table of that size stays
+		if (table.clusters() != TranspositionTable::clustersFor(hashMb))
+		{
+			finish();
+			table = TranspositionTable(hashMb);
+		}
+	}
+	// The search runs on one thread, the only Threads value offered is 1
+	else if (name != "Threads" && name != "Ponder")
+		output.send("info string unknown option " + name);
+}
+
+void UciEngine::_go(std::string_view args)
+{
+	finish();
+	SearchLimits limits;
+	limits.depth = kMaxPly - 1;
+	int64_t whiteTime = -1, blackTime = -1, whiteIncrement = 0, blackIncrement = 0;
+	int64_t movesToGo = 0, moveTime = 0;
+	bool ponder = false;
+	infinite = false;
+	for (std::string_view token = nextToken(args); !token.empty(); token = nextToken(args))
+	{
+		if (token == "infinite")
+			infinite = true;
+		else if (token == "ponder")
+			ponder = true;
+		else if (token == "depth")
+			limits.depth = std::clamp(parseNumber<uint>(nextToken(args)), 1u, kMaxPly - 1);
+		else if (token == "nodes")
+			limits.nodes = parseNumber<uint64_t>(nextToken(args));
+		else if (token == "movetime")
+			moveTime = parseNumber<int64_t>(nextToken(args));
+		else if (token == "wtime")
+			whiteTime = parseNumber<int64_t>(nextToken(args));
+		else if (token == "btime")
+			blackTime = parseNumber<int64_t>(nextToken(args));
+		else if (token == "winc")
+			whiteIncrement = parseNumber<int64_t>(nextToken(args));
+		else if (token == "binc")
+			blackIncrement = parseNumber<int64_t>(nextToken(args));
+		else if (token == "movestogo")
+			movesToGo = parseNumber<int64_t>(nextToken(args));
+	}
+
+	// A share of the remaining clock plus most of the increment, never
+	// more than half of what is left
+	int64_t budget = moveTime;
+	int64_t clock = board.nextGo() == White ? whiteTime : blackTime;
+	if (!budget && clock >= 0 && !infinite)
+	{
+		int64_t increment = board.nextGo() == White ? whiteIncrement : blackIncrement;
+		budget = clock / (movesToGo ? movesToGo : 30) + increment * 3 / 4;
+		budget = std::max<int64_t>(std::min(budget, clock / 2), 1);
+	}
+	ponderBudget = std::chrono::milliseconds(budget);
+
+	// The analysis takes its own copy of the position, so a new position
+	// can be set up while it runs
+	limits.sliceNodes = kSliceNodes;
+	Analysis analysis = analyse(board, limits);
+	analysis.context().repetitions = repetitions;
+	analysis.context().table = &table;
+	table.newSearch();
+
+	stopRequested = false;
+	pondering = ponder;
+	deadline = budget && !ponder ?
+		(Clock::now() + ponderBudget).time_since_epoch().count() : kNoDeadline;
+	searchThread = std::jthread([this, analysis = std::move(analysis)]() mutable
+	{
+		_search(analysis);
+	});
+}
+
+static std::string infoLine(SearchInfo const& info, Clock::duration elapsed)
+{
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+	std::string line = "info depth " + std::to_string(info.depth) + " score ";
+	if (auto mate = mateIn(info.score))
+		line += "mate " + std::to_string(*mate);
+	else
+		line += "cp " + std::to_string(info.score);
+	line += " nodes " + std::to_string(info.nodes) +
+		" nps " + std::to_string(info.nodes * 1000 / std::max<int64_t>(ms, 1)) +
+		" time " + std::to_string(ms) + " pv ";
+	formatPv(std::back_inserter(line), std::span<BoardMove const>(info.pv));
+	return line;
+}
+
+void UciEngine::_search(Analysis& analysis)
+{
+	auto start = Clock::now();
+
+	uint reported = 0;
+	auto report = [&]()
+	{
+		SearchInfo const& info = analysis.info();
+		if (info.depth > reported)
+		{
+			reported = info.depth;
+			output.send(infoLine(info, Clock::now() - start));
+		}
+	};
+	while (analysis.step())
+	{
+		report();
+		if (stopRequested.load(std::memory_order_relaxed) ||
+			Clock::now().time_since_epoch().count() >= deadline.load(std::memory_order_relaxed))
+			analysis.cancel();
+	}
+	report();
+	_holdBestMove();
+
+	std::optional<BoardMove> best = analysis.info().bestMove();
+	if (!best)
+	{
+		// Stopped before depth 1 finished, any legal move beats none. The
+		// finished search has unwound back to the root.
+		ChessBoard root = analysis.context().board;
+		MoveList moves;
+		generateLegalMoves(root, moves);
+		if (moves.size())
+			best = moves[0];
+	}
+	std::string line = "bestmove ";
+	if (best)
+		formatUci(std::back_inserter(line), *best);
+	else
+		line += "0000";
+	if (analysis.info().pv.size() > 1)
+	{
+		line += " ponder ";
+		formatUci(std::back_inserter(line), analysis.info().pv[1]);
+	}
+	output.send(std::move(line));
+}
+
+void UciEngine::_holdBestMove()
+{
+	// UCI wants the bestmove of an infinite or pondering search only
+	// after "stop" or "ponderhit", however early the search ended
+	std::unique_lock lock(holdMutex);
+	released.wait(lock, [this]{ return stopRequested || (!infinite && !pondering); });
+}
+
+}
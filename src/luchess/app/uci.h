@@ -0,0 +1,128 @@
+#ifndef LUCHESS_APP_UCI_H_
+#define LUCHESS_APP_UCI_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "luchess/core/analysis.h"
+#include "luchess/core/board.h"
+#include "luchess/core/repetition.h"
+#include "luchess/core/search.h"
+#include "luchess/core/transposition.h"
+
+/**
+
+UCI protocol frontend.
+
+Four threads take part. UciEngine::run starts an input thread that does
+nothing but read lines. "stop" and "ponderhit" are acted on by the input
+thread as they arrive, unless commands are still queued ahead of them.
+Every other line is queued for the caller's thread, which feeds them to
+UciEngine::handle in order. Only "go", "ucinewgame" and a Hash change
+wait for a running finite search there, and even then the input thread
+keeps reading. The search thread steps an Analysis (see analysis.h)
+kSliceNodes nodes at a time and checks the stop flag and the deadline
+between slices, so a stop takes effect within a fraction of a
+millisecond. Everything printed goes through UciOutput, whose own
+thread does the writing, so a slow reader on the other end of stdout
+never stalls the search.
+
+Time control lives here rather than in the search: a deadline computed
+from movetime or the clock, armed on "go" or, when pondering, on
+"ponderhit".
+
+**/
+
+namespace luchess::app{
+
+// Queues lines for a writer thread, in order
+struct UciOutput
+{
+	explicit UciOutput(std::ostream& out);
+	// Writes everything still queued before returning
+	~UciOutput();
+
+	void send(std::string line);
+
+	std::ostream& out;
+	std::mutex mutex;
+	std::condition_variable queued;
+	std::deque<std::string> lines;
+	bool closing = false;
+	std::jthread writer;
+};
+
+struct UciEngine
+{
+	static constexpr uint64_t kSliceNodes = 256;
+	static constexpr uint kDefaultHashMb = 16;
+
+	explicit UciEngine(std::ostream& out);
+	~UciEngine();
+
+	// Reads commands from 'in' on an input thread and handles them on
+	// the calling thread, returns after "quit" or the end of the input
+	void run(std::istream& in);
+
+	// Handles one command line, false once "quit" was given
+	bool handle(std::string_view line);
+
+	// Waits for a search that ends by itself and stops an infinite or
+	// pondering one. A new search does this first, so piped scripts need
+	// no "stop" between finite searches.
+	void finish();
+
+	// A table saved before replaces the current one; failures are
+	// reported as info strings
+	void loadTable(std::string const& path);
+	void saveTable(std::string const& path);
+
+	void _position(std::string_view args);
+	void _go(std::string_view args);
+	void _setOption(std::string_view args);
+	void _stopSearch();
+	void _search(Analysis& analysis);
+	void _holdBestMove();
+	// Runs on the input thread
+	void _receive(std::string line);
+
+	UciOutput output;
+
+	ChessBoard board;
+	RepetitionTracker repetitions;
+	uint hashMb = kDefaultHashMb;
+	// Kept across searches, cleared by ucinewgame
+	TranspositionTable table{kDefaultHashMb};
+
+	std::jthread searchThread;
+	std::atomic<bool> stopRequested = false;
+	std::atomic<bool> pondering = false;
+	bool infinite = false;
+	// Steady clock ticks the search must stop at, max when there is none
+	std::atomic<int64_t> deadline;
+	// Budget armed by ponderhit
+	std::chrono::milliseconds ponderBudget{0};
+	// Wakes a finished infinite or pondering search waiting to report
+	std::mutex holdMutex;
+	std::condition_variable released;
+
+	std::mutex inputMutex;
+	std::condition_variable inputQueued;
+	std::deque<std::string> commands;
+	// Queued commands plus the one being handled
+	uint unhandled = 0;
+	bool inputClosed = false;
+};
+
+}
+
+#endif // LUCHESS_APP_UCI_H_
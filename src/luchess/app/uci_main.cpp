@@ -0,0 +1,70 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "uci.h"
+
+/**
+
+Usage:
+	luchess_uci [--hash-file=<path>] [<script>]
+
+Speaks UCI on stdin and stdout, or reads the commands from 'script'
+instead of stdin. Scripts are plain command lines, e.g.
+
+	uci
+	position startpos moves e2e4 e7e5
+	go depth 6
+	isready
+
+Commands are read ahead on their own thread while a search runs; a new
+go waits for a finite search to finish, and the end of the input does
+too.
+
+With --hash-file the transposition table is loaded from 'path' at
+startup when the file exists, and saved back to it on quit or at the
+end of the input, so the next run starts warm. A file from another
+build or a damaged one is reported and ignored.
+
+**/
+
+int main(int argc, char **argv)
+{
+	std::string hashFile;
+	char const* scriptPath = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string_view arg = argv[i];
+		if (arg.starts_with("--hash-file="))
+			hashFile = arg.substr(std::string_view("--hash-file=").size());
+		else if (!scriptPath && !arg.starts_with("--"))
+			scriptPath = argv[i];
+		else
+		{
+			std::cerr << "luchess_uci: bad argument " << arg << "\n";
+			return 1;
+		}
+	}
+	std::ifstream script;
+	if (scriptPath)
+	{
+		script.open(scriptPath);
+		if (!script)
+		{
+			std::cerr << "luchess_uci: cannot open " << scriptPath << "\n";
+			return 1;
+		}
+	}
+	std::istream& in = scriptPath ? script : std::cin;
+
+	luchess::app::UciEngine engine(std::cout);
+	if (!hashFile.empty() && std::filesystem::exists(hashFile))
+		engine.loadTable(hashFile);
+	engine.run(in);
+	engine.finish();
+	if (!hashFile.empty())
+		engine.saveTable(hashFile);
+	return 0;
+}
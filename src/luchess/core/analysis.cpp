@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "luchess/core/analysis.h"
+
+namespace luchess{
+
+// ========================Analysis===================================
+
+Analysis Analysis::promise_type::get_return_object()
+{
+	return Analysis(std::coroutine_handle<promise_type>::from_promise(*this));
+}
+
+std::coroutine_handle<> Analysis::promise_type::PublishAwaiter::await_suspend(
+	std::coroutine_handle<promise_type> handle) noexcept
+{
+	promise_type& promise = handle.promise();
+	promise.context.resumePoint = handle;
+	if (promise.waiter)
+		return std::exchange(promise.waiter, nullptr);
+	return std::noop_coroutine();
+}
+
+Analysis::promise_type::PublishAwaiter Analysis::promise_type::yield_value(
+	SearchInfo const& update)
+{
+	info = update;
+	pendingUpdate = true;
+	return {};
+}
+
+bool Analysis::UpdateAwaiter::await_ready() const noexcept
+{
+	return handle.promise().pendingUpdate || handle.done();
+}
+
+void Analysis::UpdateAwaiter::await_suspend(std::coroutine_handle<> consumer) noexcept
+{
+	handle.promise().waiter = consumer;
+}
+
+std::optional<SearchInfo> Analysis::UpdateAwaiter::await_resume()
+{
+	promise_type& promise = handle.promise();
+	if (!promise.pendingUpdate)
+		return std::nullopt;
+	promise.pendingUpdate = false;
+	return promise.info;
+}
+
+Analysis::Analysis(std::coroutine_handle<promise_type> _handle) :
+	handle(_handle)
+{}
+
+Analysis::Analysis(Analysis&& other) noexcept :
+	handle(std::exchange(other.handle, nullptr))
+{}
+
+Analysis::~Analysis()
+{
+	// Destroying the root frame destroys the suspended nodes below it
+	if (handle)
+		handle.destroy();
+}
+
+bool Analysis::step()
+{
+	if (handle.done())
+		return false;
+	SearchContext& ctx = handle.promise().context;
+	std::coroutine_handle<> next = ctx.resumePoint ? ctx.resumePoint : handle;
+	ctx.resumePoint = nullptr;
+	next.resume();
+	return !handle.done();
+}
+
+// Hands the body the context its promise was built with
+struct ContextAwaiter
+{
+	bool await_ready() const noexcept { return false; }
+	bool await_suspend(std::coroutine_handle<Analysis::promise_type> handle) noexcept
+	{
+		ctx = &handle.promise().context;
+		return false;
+	}
+	SearchContext& await_resume() const noexcept { return *ctx; }
+
+	SearchContext* ctx = nullptr;
+};
+
+// The promise copies the board and limits into its SearchContext before
+// the caller regains control, the body only reads them from there
+Analysis analyse(ChessBoard const&, SearchLimits)
+{
+	SearchContext& ctx = co_await ContextAwaiter{};
+	for (uint depth = 1; depth <= ctx.limits.depth; depth++)
+	{
+		int score = co_await negamax(ctx, depth, 0, -kInfinity, kInfinity);
+		if (ctx.stopped())
+			break;
+		co_yield _completeIteration(ctx, depth, score);
+	}
+}
+
+// ========================AnalysisScheduler==========================
+
+uint AnalysisScheduler::add(ChessBoard const& board, SearchLimits limits, int priority)
+{
+	analyses.push_back(analyse(board, limits));
+	priorities.push_back(priority);
+	return uint(analyses.size() - 1);
+}
+
+bool AnalysisScheduler::runSlice()
+{
+	int top = std::numeric_limits<int>::min();
+	bool working = false;
+	for (uint id = 0; id < analyses.size(); id++)
+	{
+		if (!analyses[id].done())
+		{
+			top = std::max(top, priorities[id]);
+			working = true;
+		}
+	}
+	if (!working)
+		return false;
+
+	for (uint id = 0; id < analyses.size(); id++)
+	{
+		if (priorities[id] == top)
+			analyses[id].step();
+	}
+	return true;
+}
+
+void AnalysisScheduler::run()
+{
+	while (runSlice())
+		;
+}
+
+}
@@ -0,0 +1,124 @@
+#ifndef LUCHESS_CORE_ANALYSIS_H_
+#define LUCHESS_CORE_ANALYSIS_H_
+
+#include <coroutine>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "luchess/core/board.h"
+#include "luchess/core/search.h"
+
+/**
+
+Cooperative analyses.
+
+An Analysis is a search running as a coroutine. Each step() runs it for
+SearchLimits::sliceNodes nodes, or until it finishes a depth, and then
+hands the thread back, so one thread can interleave any number of
+analyses. Finished depths are published as SearchInfo updates that
+other coroutines can co_await with nextUpdate().
+
+AnalysisScheduler round robins the analyses at the highest priority
+that still has work and can cancel or reprioritise them between slices.
+
+**/
+
+namespace luchess{
+
+struct Analysis
+{
+	struct promise_type
+	{
+		promise_type(ChessBoard const& board, SearchLimits limits) :
+		context(board, limits)
+		{}
+
+		// Wakes a coroutine waiting on nextUpdate, if there is one
+		struct PublishAwaiter
+		{
+			bool await_ready() noexcept { return false; }
+			std::coroutine_handle<> await_suspend(
+				std::coroutine_handle<promise_type> handle) noexcept;
+			void await_resume() noexcept {}
+		};
+
+		Analysis get_return_object();
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		PublishAwaiter final_suspend() noexcept { return {}; }
+		PublishAwaiter yield_value(SearchInfo const& update);
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+
+		SearchContext context;
+		SearchInfo info;
+		bool pendingUpdate = false;
+		std::coroutine_handle<> waiter;
+	};
+
+	struct UpdateAwaiter
+	{
+		bool await_ready() const noexcept;
+		void await_suspend(std::coroutine_handle<> consumer) noexcept;
+		// The next finished depth, nullopt once the analysis is over
+		std::optional<SearchInfo> await_resume();
+
+		std::coroutine_handle<promise_type> handle;
+	};
+
+	explicit Analysis(std::coroutine_handle<promise_type> _handle);
+	Analysis(Analysis&& other) noexcept;
+	Analysis(Analysis const&) = delete;
+	Analysis& operator=(Analysis const&) = delete;
+	~Analysis();
+
+	// Runs one slice, false once the analysis has finished
+	bool step();
+
+	bool done() const { return handle.done(); }
+
+	// Stops at the next node, the last finished depth is kept
+	void cancel() { handle.promise().context.cancelled = true; }
+
+	SearchInfo const& info() const { return handle.promise().info; }
+
+	uint64_t nodes() const { return handle.promise().context.nodes; }
+
+	// Can be adjusted before the first step(), e.g. to seed the
+	// repetitions of the game that led to the root
+	SearchContext& context() { return handle.promise().context; }
+
+	UpdateAwaiter nextUpdate() { return {handle}; }
+
+	std::coroutine_handle<promise_type> handle;
+};
+
+// Iterative deepening on a copy of 'board', nothing runs until the first
+// step(). 'board' only needs to outlive the call.
+Analysis analyse(ChessBoard const& board, SearchLimits limits);
+
+struct AnalysisScheduler
+{
+	// Returns the id of the new analysis
+	uint add(ChessBoard const& board, SearchLimits limits, int priority = 0);
+
+	Analysis& operator[](uint id) { return analyses[id]; }
+
+	void cancel(uint id) { analyses[id].cancel(); }
+
+	void setPriority(uint id, int priority) { priorities[id] = priority; }
+
+	// Steps every unfinished analysis at the highest priority with work
+	// left. False once every analysis has finished.
+	bool runSlice();
+
+	void run();
+
+	// A deque so references handed out stay valid as analyses are added
+	std::deque<Analysis> analyses;
+	std::vector<int> priorities;
+};
+
+}
+
+#endif // LUCHESS_CORE_ANALYSIS_H_
@@ -0,0 +1,137 @@
+#include "luchess/core/batch.h"
+#include "luchess/core/batch_kernel.h"
+
+namespace luchess{
+
+static_assert(sizeof(BoardBatch::pieces) == 6 * kBatchBoards * sizeof(Bitboard),
+	"the kernel reads each array of lanes as one block");
+
+void BoardBatch::set(uint lane, BoardBitboards const& board)
+{
+	for (uint type = 0; type < pieces.size(); type++)
+		pieces[type][lane] = board.pieces[type];
+	for (uint color = 0; color < colors.size(); color++)
+		colors[color][lane] = board.colors[color];
+}
+
+void BoardBatch::set(uint lane, ChessBoard const& board)
+{
+	set(lane, BoardBitboards(board));
+}
+
+AttackSummary BatchAttacks::lane(uint lane) const
+{
+	AttackSummary summary;
+	for (PieceColor color : {Black, White})
+	{
+		summary.attacked[color] = attacked[color][lane];
+		summary.mobility[color] = uint(mobility[color][lane]);
+		summary.inCheck[color] = inCheck[color] >> lane & 1;
+	}
+	return summary;
+}
+
+AttackSummary summarizeAttacks(BoardBitboards const& board)
+{
+	AttackSummary summary;
+	Bitboard occupied = board.occupied();
+	for (PieceColor color : {Black, White})
+	{
+		Bitboard attacked = 0;
+		for (PieceType type : {Pawn, Bishop, Knight, Rook, Queen, King})
+		{
+			for (Bitboard pieces = board.of(type, color); pieces; pieces &= pieces - 1)
+			{
+				uint square = firstSquare(pieces);
+				switch (type)
+				{
+					case Pawn: attacked |= pawnAttacks(color, square); break;
+					case Knight: attacked |= knightAttacks(square); break;
+					case Bishop: attacked |= bishopAttacks(square, occupied); break;
+					case Rook: attacked |= rookAttacks(square, occupied); break;
+					case Queen:
+						attacked |= bishopAttacks(square, occupied) | rookAttacks(square, occupied);
+						break;
+					case King: attacked |= kingAttacks(square); break;
+				}
+			}
+		}
+		summary.attacked[color] = attacked;
+		summary.mobility[color] = uint(std::popcount(attacked & ~board.colors[color]));
+	}
+	for (PieceColor color : {Black, White})
+	{
+		summary.inCheck[color] =
+			(summary.attacked[!color] & board.of(King, color)) != 0;
+	}
+	return summary;
+}
+
+// ========================Dispatch===================================
+
+namespace{
+
+// A lane at a time
+struct ScalarLanes
+{
+	static constexpr uint width = 1;
+
+	explicit ScalarLanes(Bitboard _value) : value(_value) {}
+
+	static ScalarLanes load(Bitboard const* from) { return ScalarLanes(*from); }
+	void store(Bitboard* to) const { *to = value; }
+
+	ScalarLanes popcounts() const { return ScalarLanes(Bitboard(std::popcount(value))); }
+	uint nonZeroMask() const { return value != 0; }
+
+	ScalarLanes operator&(ScalarLanes other) const { return ScalarLanes(value & other.value); }
+	ScalarLanes operator|(ScalarLanes other) const { return ScalarLanes(value | other.value); }
+	ScalarLanes operator~() const { return ScalarLanes(~value); }
+	ScalarLanes operator<<(int shift) const { return ScalarLanes(value << shift); }
+	ScalarLanes operator>>(int shift) const { return ScalarLanes(value >> shift); }
+
+	Bitboard value;
+};
+
+}
+
+bool isBatchKernelAvailable(BatchKernel kernel)
+{
+	switch (kernel)
+	{
+		case BatchKernel::Scalar:
+			return true;
+		case BatchKernel::Avx2:
+#if defined(LUCHESS_AVX2_BUILD) && defined(__GNUC__)
+			return __builtin_cpu_supports("avx2");
+#else
+			return false;
+#endif
+	}
+	return false;
+}
+
+BatchKernel bestBatchKernel()
+{
+	static BatchKernel const best = isBatchKernelAvailable(BatchKernel::Avx2) ?
+		BatchKernel::Avx2 : BatchKernel::Scalar;
+	return best;
+}
+
+void computeAttacks(BoardBatch const& batch, BatchAttacks& attacks, BatchKernel kernel)
+{
+	BatchLanes lanes{
+		batch.pieces[0].data(), batch.colors[0].data(),
+		attacks.attacked[0].data(), attacks.mobility[0].data(), attacks.inCheck.data(),
+		kBatchBoards};
+#ifdef LUCHESS_AVX2_BUILD
+	if (kernel == BatchKernel::Avx2 && bestBatchKernel() == BatchKernel::Avx2)
+	{
+		_computeAttacksAvx2(lanes);
+		return;
+	}
+#endif
+	computeAttackLanes<ScalarLanes>(lanes);
+}
+
+}
@@ -0,0 +1,90 @@
+#ifndef LUCHESS_CORE_BATCH_H_
+#define LUCHESS_CORE_BATCH_H_
+
+#include <array>
+#include <cstdint>
+
+#include "luchess/core/bitboard.h"
+#include "luchess/core/board.h"
+#include "luchess/core/types.h"
+
+/**
+
+Attack maps for many boards at once.
+
+A BoardBatch holds the bitboards of up to kBatchBoards independent
+boards as structure of arrays, one array per piece type and colour with
+a lane per board. computeAttacks finds, for every lane and colour, the
+squares attacked, the mobility (attacked squares not holding a piece of
+that colour) and whether that colour's king is attacked.
+
+Sliders are filled set-wise with Kogge-Stone occluded fills: every
+bishop, rook and queen of a colour moves at once, eight directions of
+three shift steps each, so the work is the same whatever the board
+holds. The kernel is written once over a lane type: the scalar one
+runs a lane at a time, the AVX2 one four lanes in a 256 bit register.
+The AVX2 kernel is compiled in with the LUCHESS_AVX2 cmake option (on
+by default for x86-64 with GCC or Clang) and used when the CPU has
+AVX2.
+
+Every kernel gives exactly what summarizeAttacks, the single board
+path over the per square attack tables, gives for each board.
+
+**/
+
+namespace luchess{
+
+static constexpr uint kBatchBoards = 8;
+
+struct BoardBatch
+{
+	// Lanes never set hold empty boards
+	void set(uint lane, BoardBitboards const& board);
+	void set(uint lane, ChessBoard const& board);
+
+	// Indexed by PieceType or PieceColor, then lane
+	alignas(32) std::array<std::array<Bitboard, kBatchBoards>, 6> pieces{};
+	alignas(32) std::array<std::array<Bitboard, kBatchBoards>, 2> colors{};
+};
+
+// What computeAttacks finds for one board, per PieceColor
+struct AttackSummary
+{
+	bool operator==(AttackSummary const&) const = default;
+
+	std::array<Bitboard, 2> attacked{};
+	std::array<uint, 2> mobility{};
+	std::array<bool, 2> inCheck{};
+};
+
+// Indexed by PieceColor, then lane
+struct BatchAttacks
+{
+	AttackSummary lane(uint lane) const;
+
+	alignas(32) std::array<std::array<Bitboard, kBatchBoards>, 2> attacked{};
+	alignas(32) std::array<std::array<uint64_t, kBatchBoards>, 2> mobility{};
+	// Bit i set when lane i's king is attacked
+	std::array<uint, 2> inCheck{};
+};
+
+enum class BatchKernel : uint
+{
+	Scalar,
+	Avx2,
+};
+
+// Whether this build and CPU can run 'kernel'
+bool isBatchKernelAvailable(BatchKernel kernel);
+BatchKernel bestBatchKernel();
+
+// Falls back to the scalar kernel when 'kernel' is not available
+void computeAttacks(BoardBatch const& batch, BatchAttacks& attacks,
+	BatchKernel kernel = bestBatchKernel());
+
+// The single board path, one piece at a time through the attack tables
+AttackSummary summarizeAttacks(BoardBitboards const& board);
+
+}
+
+#endif // LUCHESS_CORE_BATCH_H_
@@ -0,0 +1,67 @@
+#include <immintrin.h>
+
+#include "luchess/core/batch_kernel.h"
+
+// Compiled for AVX2 and only called when the CPU has it, see batch.cpp
+
+namespace luchess{
+
+namespace{
+
+// Four lanes in a 256 bit register
+struct Avx2Lanes
+{
+	static constexpr uint width = 4;
+
+	explicit Avx2Lanes(__m256i _value) : value(_value) {}
+	explicit Avx2Lanes(uint64_t broadcast) : value(_mm256_set1_epi64x(int64_t(broadcast))) {}
+
+	// Lanes start on 32 byte boundaries
+	static Avx2Lanes load(uint64_t const* from)
+	{
+		return Avx2Lanes(_mm256_load_si256(reinterpret_cast<__m256i const*>(from)));
+	}
+	void store(uint64_t* to) const
+	{
+		_mm256_store_si256(reinterpret_cast<__m256i*>(to), value);
+	}
+
+	// Nibble lookup, then byte sums per lane
+	Avx2Lanes popcounts() const
+	{
+		__m256i const table = _mm256_setr_epi8(
+			0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+			0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+		__m256i const nibble = _mm256_set1_epi8(0x0f);
+		__m256i low = _mm256_and_si256(value, nibble);
+		__m256i high = _mm256_and_si256(_mm256_srli_epi16(value, 4), nibble);
+		__m256i counts = _mm256_add_epi8(
+			_mm256_shuffle_epi8(table, low), _mm256_shuffle_epi8(table, high));
+		return Avx2Lanes(_mm256_sad_epu8(counts, _mm256_setzero_si256()));
+	}
+	uint nonZeroMask() const
+	{
+		__m256i zero = _mm256_cmpeq_epi64(value, _mm256_setzero_si256());
+		return ~uint(_mm256_movemask_pd(_mm256_castsi256_pd(zero))) & 0xf;
+	}
+
+	Avx2Lanes operator&(Avx2Lanes other) const { return Avx2Lanes(_mm256_and_si256(value, other.value)); }
+	Avx2Lanes operator|(Avx2Lanes other) const { return Avx2Lanes(_mm256_or_si256(value, other.value)); }
+	Avx2Lanes operator~() const
+	{
+		return Avx2Lanes(_mm256_xor_si256(value, _mm256_set1_epi64x(-1)));
+	}
+	Avx2Lanes operator<<(int shift) const { return Avx2Lanes(_mm256_slli_epi64(value, shift)); }
+	Avx2Lanes operator>>(int shift) const { return Avx2Lanes(_mm256_srli_epi64(value, shift)); }
+
+	__m256i value;
+};
+
+}
+
+void _computeAttacksAvx2(BatchLanes const& batch)
+{
+	computeAttackLanes<Avx2Lanes>(batch);
+}
+
+}
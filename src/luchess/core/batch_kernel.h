@@ -0,0 +1,155 @@
+#ifndef LUCHESS_CORE_BATCH_KERNEL_H_
+#define LUCHESS_CORE_BATCH_KERNEL_H_
+
+#include <bit>
+#include <cstdint>
+
+#include "luchess/core/pieces.h"
+#include "luchess/core/types.h"
+
+/**
+
+Set-wise attack kernel behind computeAttacks, see batch.h. Only for
+the translation units that instantiate it.
+
+The AVX2 instance lives in a translation unit compiled for AVX2, so
+this header sees plain arrays and nothing with inline functions: an
+out of line copy of one compiled there could be linked in for every
+caller, AVX2 or not.
+
+Lanes is a type holding Lanes::width bitboards with the bitwise
+operators, shifts by a constant, a constructor broadcasting one
+bitboard, load/store of width consecutive bitboards, per lane
+popcounts and nonZeroMask (bit i set when lane i is not 0).
+
+**/
+
+namespace luchess{
+
+// The arrays of a BoardBatch and its BatchAttacks, 'boards' lanes per row
+struct BatchLanes
+{
+	// [PieceType * boards + lane]
+	uint64_t const* pieces;
+	// [PieceColor * boards + lane]
+	uint64_t const* colors;
+	uint64_t* attacked;
+	uint64_t* mobility;
+	// One lane mask per PieceColor
+	uint* inCheck;
+	uint boards;
+};
+
+static constexpr uint64_t kNotFileA = 0xfefefefefefefefeull;
+static constexpr uint64_t kNotFileH = 0x7f7f7f7f7f7f7f7full;
+static constexpr uint64_t kNotFilesAB = 0xfcfcfcfcfcfcfcfcull;
+static constexpr uint64_t kNotFilesGH = 0x3f3f3f3f3f3f3f3full;
+
+template<int Shift, typename Lanes>
+Lanes shiftLanes(Lanes lanes)
+{
+	if constexpr (Shift > 0)
+		return lanes << Shift;
+	else
+		return lanes >> -Shift;
+}
+
+// One step towards Shift, dropping what wraps round to the other side
+// of the board
+template<int Shift, typename Lanes>
+Lanes stepLanes(Lanes lanes)
+{
+	constexpr int fileStep = ((Shift % 8) + 8) % 8;
+	if constexpr (fileStep == 1)
+		return shiftLanes<Shift>(lanes) & Lanes(kNotFileA);
+	else if constexpr (fileStep == 7)
+		return shiftLanes<Shift>(lanes) & Lanes(kNotFileH);
+	else
+		return shiftLanes<Shift>(lanes);
+}
+
+// Kogge-Stone occluded fill from 'sliders' through 'empty', then the
+// step onto the first blocker
+template<int Shift, typename Lanes>
+Lanes slideLanes(Lanes sliders, Lanes empty)
+{
+	constexpr int fileStep = ((Shift % 8) + 8) % 8;
+	Lanes pro = empty;
+	if constexpr (fileStep == 1)
+		pro = pro & Lanes(kNotFileA);
+	else if constexpr (fileStep == 7)
+		pro = pro & Lanes(kNotFileH);
+	Lanes gen = sliders;
+	gen = gen | (pro & shiftLanes<Shift>(gen));
+	pro = pro & shiftLanes<Shift>(pro);
+	gen = gen | (pro & shiftLanes<2 * Shift>(gen));
+	pro = pro & shiftLanes<2 * Shift>(pro);
+	gen = gen | (pro & shiftLanes<4 * Shift>(gen));
+	return stepLanes<Shift>(gen);
+}
+
+template<typename Lanes>
+Lanes attackedLanes(BatchLanes const& batch, PieceColor color, uint lane, Lanes occupied)
+{
+	Lanes own = Lanes::load(batch.colors + color * batch.boards + lane);
+	auto load = [&](PieceType type)
+	{
+		return Lanes::load(batch.pieces + type * batch.boards + lane) & own;
+	};
+
+	Lanes pawns = load(Pawn);
+	Lanes attacks = color == White ?
+		stepLanes<7>(pawns) | stepLanes<9>(pawns) :
+		stepLanes<-9>(pawns) | stepLanes<-7>(pawns);
+
+	Lanes knights = load(Knight);
+	Lanes oneFile = ((knights >> 1) & Lanes(kNotFileH)) | ((knights << 1) & Lanes(kNotFileA));
+	Lanes twoFiles = ((knights >> 2) & Lanes(kNotFilesGH)) | ((knights << 2) & Lanes(kNotFilesAB));
+	attacks = attacks | (oneFile << 16) | (oneFile >> 16) | (twoFiles << 8) | (twoFiles >> 8);
+
+	Lanes kings = load(King);
+	Lanes sideways = stepLanes<1>(kings) | stepLanes<-1>(kings);
+	Lanes row = kings | sideways;
+	attacks = attacks | sideways | (row << 8) | (row >> 8);
+
+	Lanes empty = ~occupied;
+	Lanes queens = load(Queen);
+	Lanes diagonal = load(Bishop) | queens;
+	Lanes straight = load(Rook) | queens;
+	return attacks |
+		slideLanes<8>(straight, empty) | slideLanes<-8>(straight, empty) |
+		slideLanes<1>(straight, empty) | slideLanes<-1>(straight, empty) |
+		slideLanes<9>(diagonal, empty) | slideLanes<-9>(diagonal, empty) |
+		slideLanes<7>(diagonal, empty) | slideLanes<-7>(diagonal, empty);
+}
+
+template<typename Lanes>
+void computeAttackLanes(BatchLanes const& batch)
+{
+	batch.inCheck[Black] = batch.inCheck[White] = 0;
+	for (uint lane = 0; lane < batch.boards; lane += Lanes::width)
+	{
+		Lanes occupied = Lanes::load(batch.colors + Black * batch.boards + lane) |
+			Lanes::load(batch.colors + White * batch.boards + lane);
+		Lanes attacked[2] = {
+			attackedLanes<Lanes>(batch, Black, lane, occupied),
+			attackedLanes<Lanes>(batch, White, lane, occupied)};
+		for (uint side = 0; side < 2; side++)
+		{
+			PieceColor color = static_cast<PieceColor>(side);
+			uint row = color * batch.boards + lane;
+			Lanes own = Lanes::load(batch.colors + row);
+			Lanes king = Lanes::load(batch.pieces + King * batch.boards + lane) & own;
+			attacked[color].store(batch.attacked + row);
+			(attacked[color] & ~own).popcounts().store(batch.mobility + row);
+			batch.inCheck[color] |= (attacked[!color] & king).nonZeroMask() << lane;
+		}
+	}
+}
+
+// batch_avx2.cpp, four lanes at a time
+void _computeAttacksAvx2(BatchLanes const& batch);
+
+}
+
+#endif // LUCHESS_CORE_BATCH_KERNEL_H_
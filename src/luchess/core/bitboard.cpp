@@ -0,0 +1,133 @@
+#include "luchess/core/bitboard.h"
+
+namespace luchess{
+
+struct AttackTables
+{
+	std::array<std::array<Bitboard, ChessBoard::boardSize>, 2> pawn{};
+	std::array<Bitboard, ChessBoard::boardSize> knight{};
+	std::array<Bitboard, ChessBoard::boardSize> king{};
+	// One ray per kingSteps direction
+	std::array<std::array<Bitboard, ChessBoard::boardSize>, 8> rays{};
+};
+
+static constexpr bool onBoard(int column, int row)
+{
+	return column >= 0 && column <= 7 && row >= 0 && row <= 7;
+}
+
+static constexpr Bitboard stepTargets(uint square, BoardPosition const* steps, uint count)
+{
+	Bitboard targets = 0;
+	int column = int(square % 8);
+	int row = int(square / 8);
+	for (uint i = 0; i < count; i++)
+	{
+		if (onBoard(column + steps[i].column, row + steps[i].row))
+			targets |= squareBit(uint((row + steps[i].row) * 8 + column + steps[i].column));
+	}
+	return targets;
+}
+
+static constexpr AttackTables makeAttackTables()
+{
+	constexpr BoardPosition whitePawnSteps[] = {{-1, 1}, {1, 1}};
+	constexpr BoardPosition blackPawnSteps[] = {{-1, -1}, {1, -1}};
+
+	AttackTables tables{};
+	for (uint square = 0; square < ChessBoard::boardSize; square++)
+	{
+		tables.knight[square] = stepTargets(square, knightSteps.data(), 8);
+		tables.king[square] = stepTargets(square, kingSteps.data(), 8);
+		tables.pawn[White][square] = stepTargets(square, whitePawnSteps, 2);
+		tables.pawn[Black][square] = stepTargets(square, blackPawnSteps, 2);
+
+		for (uint dir = 0; dir < 8; dir++)
+		{
+			int column = int(square % 8) + kingSteps[dir].column;
+			int row = int(square / 8) + kingSteps[dir].row;
+			for (; onBoard(column, row); column += kingSteps[dir].column, row += kingSteps[dir].row)
+				tables.rays[dir][square] |= squareBit(uint(row * 8 + column));
+		}
+	}
+	return tables;
+}
+
+static constexpr AttackTables attackTables = makeAttackTables();
+
+// Rays running up the board index find their nearest blocker with the
+// lowest bit, the others with the highest
+static constexpr bool rayAscends(uint dir)
+{
+	return kingSteps[dir].row > 0 || (kingSteps[dir].row == 0 && kingSteps[dir].column > 0);
+}
+
+static Bitboard rayAttacks(uint dir, uint square, Bitboard occupied)
+{
+	Bitboard ray = attackTables.rays[dir][square];
+	Bitboard blockers = ray & occupied;
+	if (!blockers)
+		return ray;
+	uint blocker = rayAscends(dir) ?
+		uint(std::countr_zero(blockers)) : 63 - uint(std::countl_zero(blockers));
+	return ray ^ attackTables.rays[dir][blocker];
+}
+
+BoardBitboards::BoardBitboards(ChessBoard const& board)
+{
+	for (PieceColor color : {White, Black})
+	{
+		for (uint type = Pawn; type <= King; type++)
+		{
+			for (uint8_t index : board.pieces.squares(color, PieceType(type)))
+			{
+				pieces[type] |= squareBit(index);
+				colors[color] |= squareBit(index);
+			}
+		}
+	}
+}
+
+Bitboard pawnAttacks(PieceColor color, uint square)
+{
+	return attackTables.pawn[color][square];
+}
+
+Bitboard knightAttacks(uint square)
+{
+	return attackTables.knight[square];
+}
+
+Bitboard kingAttacks(uint square)
+{
+	return attackTables.king[square];
+}
+
+Bitboard bishopAttacks(uint square, Bitboard occupied)
+{
+	return rayAttacks(4, square, occupied) | rayAttacks(5, square, occupied) |
+		rayAttacks(6, square, occupied) | rayAttacks(7, square, occupied);
+}
+
+Bitboard rookAttacks(uint square, Bitboard occupied)
+{
+	return rayAttacks(0, square, occupied) | rayAttacks(1, square, occupied) |
+		rayAttacks(2, square, occupied) | rayAttacks(3, square, occupied);
+}
+
+Bitboard attackersTo(BoardBitboards const& bitboards, uint square, Bitboard occupied)
+{
+	auto const& pieces = bitboards.pieces;
+	Bitboard diagonal = pieces[Bishop] | pieces[Queen];
+	Bitboard straight = pieces[Rook] | pieces[Queen];
+	// A pawn of one color attacks the squares a pawn of the other color
+	// standing on 'square' would attack
+	return ((pawnAttacks(Black, square) & bitboards.of(Pawn, White)) |
+		(pawnAttacks(White, square) & bitboards.of(Pawn, Black)) |
+		(knightAttacks(square) & pieces[Knight]) |
+		(kingAttacks(square) & pieces[King]) |
+		(bishopAttacks(square, occupied) & diagonal) |
+		(rookAttacks(square, occupied) & straight)) & occupied;
+}
+
+}
@@ -0,0 +1,66 @@
+#ifndef LUCHESS_CORE_BITBOARD_H_
+#define LUCHESS_CORE_BITBOARD_H_
+
+#include <array>
+#include <bit>
+#include <cstdint>
+
+#include "luchess/core/board.h"
+#include "luchess/core/types.h"
+
+/**
+
+Bitboards.
+
+Bit i is board index i (a1 = 0, h8 = 63). The board itself stays a
+mailbox; BoardBitboards is built from it where set operations pay off,
+like static exchange evaluation. Slider attacks walk precomputed rays
+and stop at the first blocker found with a bit scan.
+
+**/
+
+namespace luchess{
+
+using Bitboard = uint64_t;
+
+constexpr Bitboard squareBit(uint index)
+{
+	return Bitboard(1) << index;
+}
+
+// Lowest set square, the board must not be empty
+constexpr uint firstSquare(Bitboard board)
+{
+	return uint(std::countr_zero(board));
+}
+
+struct BoardBitboards
+{
+	BoardBitboards() = default;
+	explicit BoardBitboards(ChessBoard const& board);
+
+	Bitboard occupied() const { return colors[0] | colors[1]; }
+
+	Bitboard of(PieceType type, PieceColor color) const
+	{
+		return pieces[type] & colors[color];
+	}
+
+	// Indexed by PieceType and PieceColor
+	std::array<Bitboard, 6> pieces{};
+	std::array<Bitboard, 2> colors{};
+};
+
+Bitboard pawnAttacks(PieceColor color, uint square);
+Bitboard knightAttacks(uint square);
+Bitboard kingAttacks(uint square);
+Bitboard bishopAttacks(uint square, Bitboard occupied);
+Bitboard rookAttacks(uint square, Bitboard occupied);
+
+// Pieces of both colors attacking 'square' with 'occupied' as the
+// blockers, so removing pieces from it uncovers x-ray attackers
+Bitboard attackersTo(BoardBitboards const& bitboards, uint square, Bitboard occupied);
+
+}
+
+#endif // LUCHESS_CORE_BITBOARD_H_
@@ -1,5 +1,8 @@
 #include "luchess/core/board.h"
+#include <cassert>
 #include <stdexcept>
+#include "luchess/core/movegen.h"
+#include "luchess/core/stats.h"
 #include "util.h"
 #include "board.h"
 
@@ -40,12 +43,73 @@ BoardPosition& BoardPosition::operator-=(BoardPosition const& other)
 ChessBoard::ChessBoard(std::optional<Piece> _default)
 {
 	this->layout.fill(_default);
+	indexPieces();
+}
+
+void ChessBoard::indexPieces()
+{
+	pieces.clear();
+	for (uint index = 0; index < boardSize; index++)
+	{
+		BoardSquare const& square = layout[index];
+		if (square == EMPTY_SQUARE)
+			continue;
+		if (pieces.count(square->color, square->type) == PieceLists::kCapacity)
+			throw std::invalid_argument(
+				"ChessBoard::indexPieces invalid layout: more pieces of "
+				"one kind than PieceLists::kCapacity.");
+		pieces.add(*square, index);
+	}
+}
+
+bool ChessBoard::_piecesMatchLayout() const
+{
+	uint listed = 0;
+	for (uint color = 0; color < 2; color++)
+	{
+		for (uint type = Pawn; type <= King; type++)
+		{
+			Piece const piece{PieceType(type), PieceColor(color)};
+			std::span<uint8_t const> squares = pieces.squares(piece.color, piece.type);
+			for (uint slot = 0; slot < squares.size(); slot++)
+			{
+				if (layout[squares[slot]] != piece || pieces._slots[squares[slot]] != slot)
+					return false;
+			}
+			listed += uint(squares.size());
+		}
+	}
+	uint occupied = 0;
+	for (BoardSquare const& square : layout)
+		occupied += square != EMPTY_SQUARE;
+	return listed == occupied;
+}
+
+uint16_t packMove(BoardMove const& move)
+{
+	uint promotion = move.promotion ? *move.promotion + 1 : 0;
+	return uint16_t(ChessBoard::getIndex(move.originPos) |
+		ChessBoard::getIndex(move.targetPos) << 6 |
+		promotion << 12);
+}
+
+BoardMove unpackMove(uint16_t packed)
+{
+	uint origin = packed & 0x3f;
+	uint target = (packed >> 6) & 0x3f;
+	uint promotion = packed >> 12;
+	BoardMove move{
+		{int(origin % 8), int(origin / 8)},
+		{int(target % 8), int(target / 8)}};
+	if (promotion)
+		move.promotion = static_cast<PieceType>(promotion - 1);
+	return move;
 }
 
 bool ChessBoard::isValidPosition(BoardPosition const& pos)
 {
-	return (pos.column >= 0 || pos.column <= 7) &&
-		(pos.row >= 0 || pos.row <= 7);
+	return (pos.column >= 0 && pos.column <= 7) &&
+		(pos.row >= 0 && pos.row <= 7);
 }
 
 uint ChessBoard::getIndex(BoardPosition const& pos)
@@ -64,21 +128,50 @@ BoardSquare& ChessBoard::getAt(BoardPosition const& pos)
 
 BoardSquare const& ChessBoard::getAt(BoardPosition const& pos) const
 {
-	return this->getAt(pos);
+	if(!this->isValidPosition(pos))
+		throw std::invalid_argument(
+			"ChessBoard::getAt invalid argument: 'pos' must "
+			"satisfy ChessBoard::isValidPosition.");
+	return this->layout[getIndex(pos)];
+}
+
+PieceColor ChessBoard::nextGo() const
+{
+	return this->state.sideToMove();
 }
 
+void ChessBoard::setNextGo(PieceColor color)
+{
+	this->state.setSideToMove(color);
+}
+
+PawnDoubleStepedState ChessBoard::pawnDoubleSteped()
+{
+	return {this->state};
+}
+
+RookCastleState ChessBoard::rookCastleable()
+{
+	return {this->state};
+}
+
+bool ChessBoard::whiteKingInCheck() const
+{
+	return this->state.kingInCheck(White);
+}
+
+bool ChessBoard::blackKingInCheck() const
+{
+	return this->state.kingInCheck(Black);
+}
 
-static const uint kMinRow = 0;
-static const uint kMaxRow = 7;
-static const uint kMinColumn = 0;
-static const uint kMaxColumn = 7;
 
 bool ChessBoard::doesLineCollide(
 	BoardPosition const& originPos,
 	BoardPosition const& targetPos
-)
+) const
 {
-	ChessBoard& board = *this;
+	ChessBoard const& board = *this;
 	auto posDiff = targetPos - originPos;
 	if (abs(posDiff.column) == abs(posDiff.row) ||  // Diagonal move
 		posDiff.column != 0 && posDiff.row == 0 ||  // Vertical move
@@ -90,15 +183,20 @@ bool ChessBoard::doesLineCollide(
 							   rowUnit);
 		DEBUG("unitMove:");
 		DEBUG(unitMove);
+		LUCHESS_COUNT(CollisionChecks);
+		uint squares = 0;
 		for (BoardPosition colliderPos = originPos + unitMove;
 			 colliderPos != targetPos;
 			 colliderPos += unitMove)
 		{
+			squares++;
 			if (board.getAt(colliderPos) != EMPTY_SQUARE)
 			{
+				LUCHESS_HISTOGRAM(CollisionSquares, squares);
 				return true;
 			}
 		}
+		LUCHESS_HISTOGRAM(CollisionSquares, squares);
 	}
 	return false;
 }
@@ -107,9 +205,9 @@ bool ChessBoard::doesLineCollide(
 	BoardPosition const& originPos,
 	BoardPosition const& targetPos,
 	BoardPosition& collisionPos
-)
+) const
 {
-	ChessBoard& board = *this;
+	ChessBoard const& board = *this;
 	auto posDiff = targetPos - originPos;
 	if (abs(posDiff.column) == abs(posDiff.row) ||  // Diagonal move
 		posDiff.column != 0 && posDiff.row == 0 ||  // Vertical move
@@ -121,16 +219,21 @@ bool ChessBoard::doesLineCollide(
 							   rowUnit);
 		DEBUG("unitMove:");
 		DEBUG(unitMove);
+		LUCHESS_COUNT(CollisionChecks);
+		uint squares = 0;
 		for (BoardPosition colliderPos = originPos + unitMove;
 			 colliderPos != targetPos;
 			 colliderPos += unitMove)
 		{
+			squares++;
 			if (board.getAt(colliderPos) != EMPTY_SQUARE)
 			{
+				LUCHESS_HISTOGRAM(CollisionSquares, squares);
 				collisionPos = colliderPos;
 				return true;
 			}
 		}
+		LUCHESS_HISTOGRAM(CollisionSquares, squares);
 	}
 	return false;
 }
@@ -161,55 +264,104 @@ bool positionsInRangeOfPos(BoardPosition const& pos, std::vector<BoardPosition>&
 {
 }
 
-bool ChessBoard::_isSquareExposed(BoardPosition const& pos, PieceColor opponent)
+bool ChessBoard::_doesPieceAttack(BoardPosition const& from, BoardPosition const& to) const
 {
-	ChessBoard& board = *this;
+	BoardSquare const& square = this->layout[getIndex(from)];
+	if (square == EMPTY_SQUARE || from == to)
+		return false;
+
+	auto posDiff = to - from;
+	bool diagonal = abs(posDiff.column) == abs(posDiff.row);
+	bool straight = (posDiff.column == 0) != (posDiff.row == 0);
+	switch(square->type)
+	{
+		case Pawn:
+			return abs(posDiff.column) == 1 &&
+				posDiff.row == (square->color == White ? 1 : -1);
+		case Knight:
+			return (abs(posDiff.row) == 1 && abs(posDiff.column) == 2) ||
+				(abs(posDiff.row) == 2 && abs(posDiff.column) == 1);
+		case Bishop:
+			return diagonal && !doesLineCollide(from, to);
+		case Rook:
+			return straight && !doesLineCollide(from, to);
+		case Queen:
+			return (diagonal || straight) && !doesLineCollide(from, to);
+		case King:
+			return abs(posDiff.column) <= 1 && abs(posDiff.row) <= 1;
+	}
+	return false;
+}
 
+bool ChessBoard::_isSquareExposed(BoardPosition const& pos, PieceColor opponent) const
+{
+	ChessBoard const& board = *this;
 
+	auto isOpponent = [&](BoardPosition const& at, PieceType type)
+	{
+		return isValidPosition(at) &&
+			board.layout[getIndex(at)] == Piece(type, opponent);
+	};
 
-	for (uint col=-1; col<2; col++)
+	for (auto const& step : knightSteps)
+	{
+		if (isOpponent(pos + step, Knight))
+			return true;
+	}
+	for (auto const& step : kingSteps)
+	{
+		if (isOpponent(pos + step, King))
+			return true;
+	}
+	// Pawns attack towards the side they move to
+	int pawnRow = pos.row - (opponent == White ? 1 : -1);
+	if (isOpponent({pos.column - 1, pawnRow}, Pawn) ||
+		isOpponent({pos.column + 1, pawnRow}, Pawn))
 	{
-		for (uint row=-1; row<2; row++)
+		return true;
+	}
+	// Walk each line out to the first piece
+	for (uint dir = 0; dir < kingSteps.size(); dir++)
+	{
+		BoardPosition const& step = kingSteps[dir];
+		bool diagonal = step.column != 0 && step.row != 0;
+		for (BoardPosition at = pos + step; isValidPosition(at); at += step)
 		{
-			BoardPosition collisionPos;
-			BoardPosition originPos(pos);
-			BoardPosition targetPos(originPos.column + col * 8, originPos.row + row * 8);
-			auto lineCollides = board.doesLineCollide(pos, targetPos, collisionPos);
-			if (lineCollides)
+			BoardSquare const& square = board.layout[getIndex(at)];
+			if (square == EMPTY_SQUARE)
+				continue;
+			if (square->color == opponent &&
+				(square->type == Queen ||
+				 square->type == (diagonal ? Bishop : Rook)))
 			{
-				auto collisionSquare = board.getAt(pos);
-				if (
-					(collisionSquare->color == opponent) && collisionSquare->type 
-				)
-				{
-
-				}
+				return true;
 			}
+			break;
 		}
 	}
-	// board.doesLineCollide(pos, BoardPosition(8, pos.row), collisionPos);
-
-	for (auto& boardSquare: layout)
-	{
-	}
+	return false;
 }
 
 
-ChessBoard::MoveResult ChessBoard::executeMove(BoardMove const& move)
+ChessBoard::MoveResult ChessBoard::executeMove(BoardMove const& move, UndoRecord* undo)
 {
 	ChessBoard& board = *this;
 
-	#define INVALID_MOVE MoveResult(false, board.nextGo, false, std::nullopt)
+	#define INVALID_MOVE MoveResult(false, board.nextGo(), false, std::nullopt)
+
+	LUCHESS_COUNT(MovesValidated);
 
 	// Check we're on the board
 	if (!board.isValidPosition(move.originPos))
 	{
 		DEBUG("Origin postion not valid");
+		LUCHESS_COUNT(RejectedOffBoard);
 		return INVALID_MOVE;
 	}
 	if (!board.isValidPosition(move.targetPos))
 	{
 		DEBUG("Target postion not valid");
+		LUCHESS_COUNT(RejectedOffBoard);
 		return INVALID_MOVE;
 	}
 
@@ -217,6 +369,7 @@ ChessBoard::MoveResult ChessBoard::executeMove(BoardMove const& move)
 	BoardSquare& originSquare = board.getAt(move.originPos);
 	if (originSquare == EMPTY_SQUARE){
 		DEBUG("originSquare empty");
+		LUCHESS_COUNT(RejectedEmptyOrigin);
 		return INVALID_MOVE;
 	}
 	Piece& originPiece = *originSquare;
@@ -224,16 +377,14 @@ ChessBoard::MoveResult ChessBoard::executeMove(BoardMove const& move)
 	DEBUG(originPiece.color);
 	DEBUG(originPiece.type);
 	// Check it's our go
-	if (originPiece.color != board.nextGo)
+	if (originPiece.color != board.nextGo())
 	{
 		DEBUG("Wrong color's go.");
+		LUCHESS_COUNT(RejectedWrongSide);
 		return INVALID_MOVE;
 	}
 
 	BoardSquare& targetSquare = board.getAt(move.targetPos);
-	DEBUG("targetPiece: ");
-	DEBUG(targetPiece.color);
-	DEBUG(targetPiece.type);
 	// Check we're not trying to eat one of our own
 	bool targetIsTeamPiece;
 	if (targetSquare == EMPTY_SQUARE)
@@ -243,10 +394,14 @@ ChessBoard::MoveResult ChessBoard::executeMove(BoardMove const& move)
 	else
 	{
 		Piece& targetPiece = *targetSquare;
+		DEBUG("targetPiece: ");
+		DEBUG(targetPiece.color);
+		DEBUG(targetPiece.type);
 		targetIsTeamPiece = (originPiece.color == targetPiece.color);
 
 		if (targetIsTeamPiece)
 		{
+			LUCHESS_COUNT(RejectedOwnPiece);
 			return INVALID_MOVE;
 		}
 
@@ -256,8 +411,6 @@ ChessBoard::MoveResult ChessBoard::executeMove(BoardMove const& move)
 			throw std::runtime_error("invalid state; execute move should not be called if enemy king in check");
 		}
 	}
-	// TODO: Check if move exposes king
-
 	auto posDiff = move.targetPos - move.originPos;
 	DEBUG(posDiff);
 	uint backRow = originPiece.color == White ? kMinRow : kMaxRow;
@@ -285,8 +438,15 @@ ChessBoard::MoveResult ChessBoard::executeMove(BoardMove const& move)
 		}
 		case Rook:
 		{
-			if (bool(posDiff.row) != bool(posDiff.column) &&
-				!doesLineCollide(move.originPos, move.targetPos))
+			if (bool(posDiff.row) == bool(posDiff.column))
+			{
+				LUCHESS_COUNT(RejectedBadGeometry);
+			}
+			else if (doesLineCollide(move.originPos, move.targetPos))
+			{
+				LUCHESS_COUNT(RejectedBlockedLine);
+			}
+			else
 			{
 				if (targetIsTeamPiece)
 				{
@@ -306,22 +466,35 @@ ChessBoard::MoveResult ChessBoard::executeMove(BoardMove const& move)
 		}
 		case Queen:
 		{
-			if(targetIsTeamPiece)
+			if (!(abs(posDiff.row) == abs(posDiff.column) ||
+				bool(posDiff.row) != bool(posDiff.column)))
 			{
-				validMove = false;
-				break;
+				LUCHESS_COUNT(RejectedBadGeometry);
+			}
+			else if (doesLineCollide(move.originPos, move.targetPos))
+			{
+				LUCHESS_COUNT(RejectedBlockedLine);
+			}
+			else
+			{
+				validMove = true;
 			}
-
 			break;
 		}
 		case King:
 		{
-			if(targetIsTeamPiece)
+			if (abs(posDiff.row) <= 1 && abs(posDiff.column) <= 1)
 			{
-				validMove = false;
-				break;
+				validMove = true;
+			}
+			else if (posDiff.row == 0 && abs(posDiff.column) == 2)
+			{
+				validMove = _isValidCastle(move, originPiece.color, backRow);
+			}
+			else
+			{
+				LUCHESS_COUNT(RejectedBadGeometry);
 			}
-
 			break;
 		}
 		default:
@@ -331,35 +504,234 @@ ChessBoard::MoveResult ChessBoard::executeMove(BoardMove const& move)
 		}
 	}
 
-	if (validMove)
+	if (!validMove)
+	{
+		DEBUG("Invalid move.");
+		return INVALID_MOVE;
+	}
+
+	PieceColor mover = originPiece.color;
+	UndoRecord moveUndo = board.makeMove(move);
+	if (board._isKingExposed(mover))
+	{
+		DEBUG("Move exposes king.");
+		LUCHESS_COUNT(RejectedKingExposed);
+		board.unmakeMove(move, moveUndo);
+		return INVALID_MOVE;
+	}
+	if (undo)
+	{
+		*undo = moveUndo;
+	}
+	LUCHESS_COUNT(MovesAccepted);
+
+	PieceColor opponent = static_cast<PieceColor>(!mover);
+	bool givesCheck = board._isKingExposed(opponent);
+	board.state.setKingInCheck(mover, false);
+	board.state.setKingInCheck(opponent, givesCheck);
+
+	// No reply means checkmate, or stalemate when not in check
+	bool finished = !hasLegalMove(board);
+	std::optional<bool> winner = std::nullopt;
+	if (finished && givesCheck)
+	{
+		winner = mover;
+	}
+	return MoveResult(true, board.nextGo(), finished, winner);
+}
+
+ChessBoard::UndoRecord ChessBoard::makeMove(BoardMove const& move)
+{
+	ChessBoard& board = *this;
+
+	BoardSquare& originSquare = board.layout[getIndex(move.originPos)];
+	BoardSquare& targetSquare = board.layout[getIndex(move.targetPos)];
+	UndoRecord undo{originSquare, targetSquare, board.state};
+	Piece piece = *originSquare;
+	auto posDiff = move.targetPos - move.originPos;
+
+	// Build the next state word locally and store it once
+	GameState nextState = board.state;
+	nextState.clearEnPassant();
+	nextState.incrementHalfmoveClock();
+
+	if (piece.type == Pawn)
+	{
+		nextState.setHalfmoveClock(0);
+		if (abs(posDiff.row) == 2)
+		{
+			nextState.setEnPassantFile(move.originPos.column);
+		}
+		else if (posDiff.column != 0 && targetSquare == EMPTY_SQUARE)
+		{
+			// Taking en passant, remove the pawn we passed
+			uint passedIndex = getIndex({move.targetPos.column, move.originPos.row});
+			BoardSquare& passedSquare = board.layout[passedIndex];
+			undo.captured = passedSquare;
+			board.pieces.remove(*passedSquare, passedIndex);
+			passedSquare = EMPTY_SQUARE;
+		}
+		if (move.targetPos.row == int(kMinRow) || move.targetPos.row == int(kMaxRow))
+		{
+			piece.type = move.promotion.value_or(Queen);
+		}
+	}
+	else if (piece.type == King && abs(posDiff.column) == 2)
+	{
+		// Castling, the rook jumps to the square the king crossed
+		int rookColumn = posDiff.column > 0 ? kMaxColumn : kMinColumn;
+		uint rookIndex = getIndex({rookColumn, move.originPos.row});
+		uint crossedIndex = getIndex(
+			{move.originPos.column + sgn(posDiff.column), move.originPos.row});
+		BoardSquare& rookSquare = board.layout[rookIndex];
+		board.pieces.move(*rookSquare, rookIndex, crossedIndex);
+		board.layout[crossedIndex] = rookSquare;
+		rookSquare = EMPTY_SQUARE;
+	}
+	if (undo.captured != EMPTY_SQUARE)
+	{
+		nextState.setHalfmoveClock(0);
+	}
+
+	uint lostCastleRights = _castleRightsAt(move.originPos) |
+		_castleRightsAt(move.targetPos);
+	if (piece.type == King)
 	{
-		targetPiece = originPiece;
-		originPiece.type = originReplacementSquare.value_or();
-		board.nextGo = static_cast<PieceColor>(
-			!board.nextGo);
+		lostCastleRights |= piece.color == White ? 0b0101 : 0b1010;
 	}
+	nextState.setCastleRights(nextState.castleRights() & ~lostCastleRights);
+	nextState.flipSideToMove();
+
+	uint originIndex = getIndex(move.originPos);
+	uint targetIndex = getIndex(move.targetPos);
+	if (targetSquare != EMPTY_SQUARE)
+		board.pieces.remove(*targetSquare, targetIndex);
+	if (piece == *undo.moved)
+		board.pieces.move(piece, originIndex, targetIndex);
 	else
 	{
-		DEBUG("Invalid move.");
+		board.pieces.remove(*undo.moved, originIndex);
+		board.pieces.add(piece, targetIndex);
 	}
-	return validMove;
+
+	targetSquare = piece;
+	originSquare = EMPTY_SQUARE;
+	board.state = nextState;
+	assert(board._piecesMatchLayout());
+	return undo;
 }
 
-bool ChessBoard::_isValidBishopMove(bool targetIsTeamPiece, bool &validMove, luchess::BoardPosition &posDiff, const luchess::BoardMove &move)
+void ChessBoard::unmakeMove(BoardMove const& move, UndoRecord const& undo)
 {
-	if (targetSquare == EMPTY_SQUARE)
+	ChessBoard& board = *this;
+
+	Piece piece = *undo.moved;
+	auto posDiff = move.targetPos - move.originPos;
+	uint originIndex = getIndex(move.originPos);
+	uint targetIndex = getIndex(move.targetPos);
+	BoardSquare& targetSquare = board.layout[targetIndex];
+	if (*targetSquare == piece)
+		board.pieces.move(piece, targetIndex, originIndex);
+	else
 	{
-		return true;
+		board.pieces.remove(*targetSquare, targetIndex);
+		board.pieces.add(piece, originIndex);
+	}
+	board.layout[originIndex] = undo.moved;
+
+	int enPassantRow = piece.color == White ? 5 : 2;
+	uint capturedIndex = targetIndex;
+	if (piece.type == Pawn && posDiff.column != 0 &&
+		move.targetPos.row == enPassantRow &&
+		undo.state.enPassantFile() == move.targetPos.column)
+	{
+		targetSquare = EMPTY_SQUARE;
+		capturedIndex = getIndex({move.targetPos.column, move.originPos.row});
+	}
+	board.layout[capturedIndex] = undo.captured;
+	if (undo.captured != EMPTY_SQUARE)
+		board.pieces.add(*undo.captured, capturedIndex);
+
+	if (piece.type == King && abs(posDiff.column) == 2)
+	{
+		int rookColumn = posDiff.column > 0 ? kMaxColumn : kMinColumn;
+		uint rookIndex = getIndex({rookColumn, move.originPos.row});
+		uint crossedIndex = getIndex(
+			{move.originPos.column + sgn(posDiff.column), move.originPos.row});
+		BoardSquare& crossedSquare = board.layout[crossedIndex];
+		board.pieces.move(*crossedSquare, crossedIndex, rookIndex);
+		board.layout[rookIndex] = crossedSquare;
+		crossedSquare = EMPTY_SQUARE;
+	}
+	board.state = undo.state;
+	assert(board._piecesMatchLayout());
+}
+
+bool ChessBoard::_isValidCastle(BoardMove const& move, PieceColor color, uint backRow)
+{
+	ChessBoard& board = *this;
+
+	auto posDiff = move.targetPos - move.originPos;
+	BoardPosition rookPos(posDiff.column > 0 ? kMaxColumn : kMinColumn, backRow);
+	if (move.originPos != BoardPosition(4, backRow) ||
+		!(board.state.castleRights() & _castleRightsAt(rookPos)) ||
+		board.layout[getIndex(rookPos)] != Piece(Rook, color))
+	{
+		LUCHESS_COUNT(RejectedBadGeometry);
+		return false;
+	}
+	if (doesLineCollide(move.originPos, rookPos))
+	{
+		LUCHESS_COUNT(RejectedBlockedLine);
+		return false;
+	}
+	// Can't castle out of or through check, landing in check is
+	// caught like any other move
+	PieceColor opponent = static_cast<PieceColor>(!color);
+	BoardPosition crossedPos(move.originPos.column + sgn(posDiff.column), backRow);
+	if (_isSquareExposed(move.originPos, opponent) ||
+		_isSquareExposed(crossedPos, opponent))
+	{
+		LUCHESS_COUNT(RejectedKingExposed);
+		return false;
 	}
+	return true;
+}
+
+bool ChessBoard::_isKingExposed(PieceColor color) const
+{
+	std::span<uint8_t const> kings = this->pieces.squares(color, King);
+	if (kings.empty())
+		return false;
+	return _isSquareExposed({int(kings[0] % 8), int(kings[0] / 8)},
+		static_cast<PieceColor>(!color));
+}
+
+uint ChessBoard::_castleRightsAt(BoardPosition const& pos)
+{
+	if (!RookCastleState::isValidPosition(pos))
+		return 0;
+	return 1u << RookCastleState::getIndex(pos);
+}
+
+bool ChessBoard::_isValidBishopMove(bool targetIsTeamPiece, bool &validMove, luchess::BoardPosition &posDiff, const luchess::BoardMove &move)
+{
     if (!targetIsTeamPiece)
     {
     	// Bishop moves diagonally
-    	if (abs(posDiff.row) == abs(posDiff.column) &&
-    	    !doesLineCollide(move.originPos, move.targetPos))
+    	if (abs(posDiff.row) != abs(posDiff.column))
     	{
-    	    return true;
+    	    LUCHESS_COUNT(RejectedBadGeometry);
+    	    return false;
     	}
+    	if (doesLineCollide(move.originPos, move.targetPos))
+    	{
+    	    LUCHESS_COUNT(RejectedBlockedLine);
+    	    return false;
+    	}
+    	return true;
     }
+    return false;
 }
 
 bool ChessBoard::_isValidKnightMove(bool targetIsTeamPiece, bool &validMove, luchess::BoardPosition &posDiff, const luchess::BoardMove &move)
@@ -373,7 +745,9 @@ bool ChessBoard::_isValidKnightMove(bool targetIsTeamPiece, bool &validMove, luc
 		{
 			return true;
 		}
+		LUCHESS_COUNT(RejectedBadGeometry);
 	}
+	return false;
 }
 
 bool ChessBoard::_isValidPawnMove(const luchess::BoardMove &move, luchess::Piece &originPiece, luchess::BoardPosition &posDiff, luchess::BoardSquare &targetSquare, uint backRow)
@@ -388,9 +762,10 @@ bool ChessBoard::_isValidPawnMove(const luchess::BoardMove &move, luchess::Piece
     {
         if (targetSquare == EMPTY_SQUARE)
         {
-            board.pawnDoubleSteped.setAt(move.originPos, false);
             return true;
         }
+        LUCHESS_COUNT(RejectedBlockedLine);
+        return false;
     }
     // Try to directly take or take en passant
     else if ((posDiff.column == -1 ||
@@ -400,16 +775,16 @@ bool ChessBoard::_isValidPawnMove(const luchess::BoardMove &move, luchess::Piece
         // Pawn takes en passant
         if (targetSquare == EMPTY_SQUARE)
         {
-            BoardSquare enPassantTargetSquare = board.getAt(
-                move.targetPos - BoardPosition(0, direction));
+            BoardSquare const& enPassantTargetSquare = board.layout[getIndex(
+                move.targetPos - BoardPosition(0, direction))];
 
             if (enPassantTargetSquare != std::nullopt)
             {
                 const Piece &enPassantTargetPiece = *enPassantTargetSquare;
 	
                 bool differentColors = enPassantTargetPiece.color != originPiece.color;
-                bool onEnPassantRow = (move.targetPos.row == 4 || move.targetPos.row == 5); // Rows 4 and 5
-                bool pawnDoubleSteped = board.pawnDoubleSteped.getAt(move.targetPos - BoardPosition(0, direction));
+                bool onEnPassantRow = move.targetPos.row == (originPiece.color == White ? 5 : 2);
+                bool pawnDoubleSteped = board.state.enPassantFile() == move.targetPos.column;
 		
                 if (differentColors && onEnPassantRow && pawnDoubleSteped)
                 {
@@ -426,11 +801,14 @@ bool ChessBoard::_isValidPawnMove(const luchess::BoardMove &move, luchess::Piece
             	return true;
             }
         }
+        // Nothing to take
+        LUCHESS_COUNT(RejectedBadGeometry);
+        return false;
     }
     // Move 2 steps in pawn direction
     else if (posDiff.column == 0 &&
              (posDiff.row == 2 * direction) &&
-             board.pawnDoubleSteped.isValidPosition(move.originPos))
+             PawnDoubleStepedState::isValidPosition(move.originPos))
     {
         DEBUG("	Pawn moving two tiles.");
         // Check it's first move
@@ -450,13 +828,16 @@ bool ChessBoard::_isValidPawnMove(const luchess::BoardMove &move, luchess::Piece
             DEBUG(moveCollides);
             if (onBackRow && !moveCollides)
             {
-                DEBUG("move.originPos: ");
-                DEBUG(move.originPos);
-                board.pawnDoubleSteped.setAt(move.originPos, true);
             	return true;
             }
         }
+        if (onBackRow)
+        {
+            LUCHESS_COUNT(RejectedBlockedLine);
+            return false;
+        }
     }
+	LUCHESS_COUNT(RejectedBadGeometry);
 	return false;
 }
 
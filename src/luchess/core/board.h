@@ -2,9 +2,12 @@
 #define LUCHESS_CORE_BOARD_H_
 
 #include <bitset>
+#include <cassert>
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <optional>
+#include <span>
 #include <vector>
 #include <stdexcept>
 
@@ -12,6 +15,7 @@
 #include "luchess/core/pieces.h"
 #include "luchess/core/types.h"
 #include "luchess/core/static.h"
+#include "luchess/core/state.h"
 
 /**
 
@@ -42,6 +46,11 @@ namespace luchess{
 using BoardSquare = std::optional<Piece>;
 #define EMPTY_SQUARE std::nullopt
 
+static const uint kMinRow = 0;
+static const uint kMaxRow = 7;
+static const uint kMinColumn = 0;
+static const uint kMaxColumn = 7;
+
 
 struct BoardPosition
 {
@@ -60,33 +69,65 @@ struct BoardPosition
 };
 
 
+// Straight steps first, then diagonals
+static constexpr std::array<BoardPosition, 8> kingSteps = {{
+	{1, 0}, {-1, 0}, {0, 1}, {0, -1},
+	{1, 1}, {1, -1}, {-1, 1}, {-1, -1},
+}};
+
+static constexpr std::array<BoardPosition, 8> knightSteps = {{
+	{1, 2}, {2, 1}, {2, -1}, {1, -2},
+	{-1, -2}, {-2, -1}, {-2, 1}, {-1, 2},
+}};
+
+
 struct BoardMove
 {
 	BoardPosition originPos;
 	BoardPosition targetPos;
+	// Piece a pawn reaching the last row becomes, queen when unset
+	std::optional<PieceType> promotion = std::nullopt;
+
+	bool operator==(BoardMove const&) const = default;
 };
 
+// A move packed into 16 bits: origin index, target index << 6 and
+// promotion type + 1 << 12
+uint16_t packMove(BoardMove const& move);
+BoardMove unpackMove(uint16_t packed);
+
 // or another floating-point type
 typedef bool (*PositionValidator)(BoardPosition const&);
 typedef uint (*Indexer)(BoardPosition const&);
+typedef bool (*StateGetter)(GameState const&, uint);
+typedef void (*StateSetter)(GameState&, uint, bool);
 
+/**
+	View over part of a board's packed GameState, keeping the per
+	position getAt/setAt interface. Validation only happens here, the
+	move execution path reads and writes GameState directly.
+**/
 template<std::size_t _nStateElems,
 		 PositionValidator _isValidPosition,
-		 Indexer _getIndex>
+		 Indexer _getIndex,
+		 StateGetter _getState,
+		 StateSetter _setState>
 struct SpecialMoveState
 {
 	
 	static constexpr std::size_t nStateElems = _nStateElems;
 	static constexpr PositionValidator isValidPosition = _isValidPosition;
 	static constexpr Indexer getIndex = _getIndex;
+	static constexpr StateGetter getState = _getState;
+	static constexpr StateSetter setState = _setState;
 
-	bool getAt(BoardPosition const& pos)
+	bool getAt(BoardPosition const& pos) const
 	{
 		if(!this->isValidPosition(pos))
 			throw std::invalid_argument(
 				"SpecialMoveState::getAt invalid argument: 'pos' must "
 				"satisfy SpecialMoveState::isValidPosition.");
-		return stateData[getIndex(pos)];
+		return getState(state, getIndex(pos));
 	}
 
 	void setAt(BoardPosition const& pos, bool val)
@@ -95,44 +136,144 @@ struct SpecialMoveState
 			throw std::invalid_argument(
 				"SpecialMoveState::setAt invalid argument: 'pos' must "
 				"satisfy SpecialMoveState::isValidPosition.");
-		stateData[getIndex(pos)] = val;
+		setState(state, getIndex(pos), val);
 	}
 
-	std::bitset<nStateElems> stateData = EMPTY_STATE;
+	GameState& state;
 };
 
+// Lambdas would give these aliases a distinct type in every
+// translation unit, so the state accessors are named functions.
+inline bool _isRookCastlePosition(BoardPosition const& pos)
+{
+	return (pos.column == 0 || pos.column == 7) &&
+		(pos.row == 0 || pos.row == 7);
+}
+
+inline uint _rookCastleIndex(BoardPosition const& pos)
+{
+	// Use bitwise operations to get unique
+	// index for each position combination
+	uint index = 0;
+	if (pos.row == 0)
+		index |= 0;
+	else if(pos.row == 7)
+		index |= 1;
+	if (pos.column == 0)
+		index |= 0;
+	else if(pos.column == 7)
+		index |= 2;
+	return index;
+}
+
+inline bool _getRookCastleState(GameState const& state, uint index)
+{
+	return state.castleRight(index);
+}
+
+inline void _setRookCastleState(GameState& state, uint index, bool val)
+{
+	state.setCastleRight(index, val);
+}
+
 using RookCastleState = SpecialMoveState<
 	4, //_nStateElems
-	[](BoardPosition const& pos){
-		return (pos.column == 0 || pos.column == 7) &&
-			(pos.row == 0 || pos.row == 7);
-	}, // isValidPosition
-	[](BoardPosition const& pos){
-		// Use bitwise operations to get unique
-		// index for each position combination
-		uint index = 0;
-		if (pos.row == 0)
-			index |= 0;
-		else if(pos.row == 7)
-			index |= 1;
-		if (pos.column == 0)
-			index |= 0;
-		else if(pos.column == 7)
-			index |= 2;
-		return index;
-	} // getIndex
+	_isRookCastlePosition,
+	_rookCastleIndex,
+	_getRookCastleState,
+	_setRookCastleState
 >;
 
-using PawnDoubleStepedState = SpecialMoveState<16, //_nStateElems
-	[](BoardPosition const& pos){
-		return pos.row == 1 || pos.row == 6;
-	}, // isValidPosition
-	[](BoardPosition const& pos){
-		return static_cast<uint>(
-			(pos.row == 1 ? 0 : 7) + pos.column);
-	}// getIndex
+// Only the latest double step can be taken en passant, so the state
+// word keeps a single file. Indices 0-7 are white's pawns (row 1) and
+// 8-15 black's (row 6); the pawn that double steped is always the one
+// belonging to the side that is not to move.
+inline bool _isPawnDoubleStepPosition(BoardPosition const& pos)
+{
+	return pos.row == 1 || pos.row == 6;
+}
+
+inline uint _pawnDoubleStepIndex(BoardPosition const& pos)
+{
+	return static_cast<uint>(
+		(pos.row == 1 ? 0 : 8) + pos.column);
+}
+
+inline bool _getPawnDoubleStepState(GameState const& state, uint index)
+{
+	PieceColor pawnColor = index < 8 ? White : Black;
+	return pawnColor != state.sideToMove() &&
+		state.enPassantFile() == static_cast<int>(index % 8);
+}
+
+inline void _setPawnDoubleStepState(GameState& state, uint index, bool val)
+{
+	if (val)
+		state.setEnPassantFile(index % 8);
+	else if (state.enPassantFile() == static_cast<int>(index % 8))
+		state.clearEnPassant();
+}
+
+using PawnDoubleStepedState = SpecialMoveState<
+	16, //_nStateElems
+	_isPawnDoubleStepPosition,
+	_pawnDoubleStepIndex,
+	_getPawnDoubleStepState,
+	_setPawnDoubleStepState
 >;
 
+// Squares of the pieces on a board, one list per colour and type in no
+// particular order. 'slots' maps a square to its place in its list, so
+// adding, removing and moving a piece are all O(1).
+struct PieceLists
+{
+	// No legal position has more of one kind: 8 pawns, 9 queens or 10
+	// of the other pieces with promotions
+	static constexpr uint kCapacity = 10;
+
+	std::span<uint8_t const> squares(PieceColor color, PieceType type) const
+	{
+		return {_squares[color][type].data(), _counts[color][type]};
+	}
+
+	uint count(PieceColor color, PieceType type) const
+	{
+		return _counts[color][type];
+	}
+
+	void clear()
+	{
+		_counts = {};
+	}
+
+	void add(Piece piece, uint square)
+	{
+		uint8_t& count = _counts[piece.color][piece.type];
+		assert(count < kCapacity);
+		_squares[piece.color][piece.type][count] = uint8_t(square);
+		_slots[square] = count++;
+	}
+
+	// The last square of the list fills the gap
+	void remove(Piece piece, uint square)
+	{
+		auto& squares = _squares[piece.color][piece.type];
+		uint8_t last = squares[--_counts[piece.color][piece.type]];
+		squares[_slots[square]] = last;
+		_slots[last] = _slots[square];
+	}
+
+	void move(Piece piece, uint from, uint to)
+	{
+		_squares[piece.color][piece.type][_slots[from]] = uint8_t(to);
+		_slots[to] = _slots[from];
+	}
+
+	std::array<std::array<std::array<uint8_t, kCapacity>, 6>, 2> _squares;
+	std::array<std::array<uint8_t, 6>, 2> _counts{};
+	std::array<uint8_t, 64> _slots;
+};
+
 struct ChessBoard
 {
 	static const std::size_t boardSize = 64;
@@ -140,10 +281,13 @@ struct ChessBoard
 	ChessBoard(BoardSquare _default=EMPTY_SQUARE);
 	ChessBoard(std::array<BoardSquare, boardSize> _default);
 	ChessBoard(ChessBoard&&) = default;
+	ChessBoard(ChessBoard const&) = default;
+	ChessBoard& operator=(ChessBoard&&) = default;
+	ChessBoard& operator=(ChessBoard const&) = default;
 
-	bool isValidPosition(BoardPosition const& pos);
+	static bool isValidPosition(BoardPosition const& pos);
 
-	uint getIndex(BoardPosition const& pos);
+	static uint getIndex(BoardPosition const& pos);
 
 	BoardSquare& getAt(BoardPosition const& pos);
 
@@ -156,7 +300,23 @@ struct ChessBoard
 		bool finished;
 		std::optional<bool> winner;
 	};
-	MoveResult executeMove(BoardMove const& move);
+	// What a move changed, enough to take it back
+	struct UndoRecord
+	{
+		BoardSquare moved;
+		BoardSquare captured;
+		GameState state;
+	};
+
+	// Validates and plays a move. When 'undo' is set it receives what
+	// is needed to take a valid move back with unmakeMove.
+	MoveResult executeMove(BoardMove const& move, UndoRecord* undo = nullptr);
+
+	// Plays a move without validating it, the move must be at least
+	// pseudo legal (see movegen.h)
+	UndoRecord makeMove(BoardMove const& move);
+
+	void unmakeMove(BoardMove const& move, UndoRecord const& undo);
 
     bool _isValidBishopMove(bool targetIsTeamPiece, bool &validMove, luchess::BoardPosition &posDiff, const luchess::BoardMove &move);
 
@@ -164,24 +324,48 @@ struct ChessBoard
 
     bool _isValidPawnMove(const luchess::BoardMove &move, luchess::Piece &originPiece, luchess::BoardPosition &posDiff, luchess::BoardSquare &targetSquare, uint backRow);
 
-    bool doesLineCollide(BoardPosition const &originPos, BoardPosition const &targetPos);
-    bool doesLineCollide(BoardPosition const &originPos, BoardPosition const &targetPos, BoardPosition &collisionPos);
+    bool doesLineCollide(BoardPosition const &originPos, BoardPosition const &targetPos) const;
+    bool doesLineCollide(BoardPosition const &originPos, BoardPosition const &targetPos, BoardPosition &collisionPos) const;
 
-    bool _isSquareExposed(BoardPosition const &pos, PieceColor opponent);
+    static uint _castleRightsAt(BoardPosition const &pos);
+
+    // Whether the piece on 'from' attacks 'to', ignoring pins
+    bool _doesPieceAttack(BoardPosition const &from, BoardPosition const &to) const;
+
+    bool _isSquareExposed(BoardPosition const &pos, PieceColor opponent) const;
+
+    bool _isKingExposed(PieceColor color) const;
+
+    bool _isValidCastle(BoardMove const &move, PieceColor color, uint backRow);
     std::vector<BoardPosition> _positionsInRangeOfRook(BoardPosition const &pos);
 
+    // Rebuilds the piece lists from the layout, needed after writing to
+    // the layout directly. Throws std::invalid_argument when a kind of
+    // piece overflows its list.
+    void indexPieces();
+    // Whether the piece lists hold exactly the pieces of the layout
+    bool _piecesMatchLayout() const;
+
     // State
-	PieceColor nextGo = PieceColor::White;
+	PieceColor nextGo() const;
+
+	void setNextGo(PieceColor color);
 
-	PawnDoubleStepedState pawnDoubleSteped;
+	PawnDoubleStepedState pawnDoubleSteped();
 
-	RookCastleState rookCastleable;
+	RookCastleState rookCastleable();
 
-	bool whiteKingInCheck;
+	bool whiteKingInCheck() const;
 
-	bool blackKingInCheck;
+	bool blackKingInCheck() const;
+
+	GameState state;
 
 	std::array<BoardSquare, boardSize> layout;
+
+	// Kept in step with the layout by makeMove and unmakeMove, see
+	// indexPieces
+	PieceLists pieces;
 };
 
 }
@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <climits>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "luchess/core/channel.h"
+
+namespace luchess{
+
+// ========================Messages===================================
+
+ChannelMessage ChannelMessage::encodeMove(BoardMove const& move)
+{
+	ChannelMessage message{};
+	message.kind = ChannelMessageKind::Move;
+	message.move = packMove(move);
+	return message;
+}
+
+ChannelMessage ChannelMessage::encodeResult(ChessBoard::MoveResult const& result)
+{
+	ChannelMessage message{};
+	message.kind = ChannelMessageKind::MoveResult;
+	message.result = {
+		result.validMove, result.nextPlayerColour, result.finished,
+		uint8_t(result.winner ? *result.winner + 1 : 0)};
+	return message;
+}
+
+ChannelMessage ChannelMessage::encodeBoard(ChessBoard const& board)
+{
+	ChannelMessage message{};
+	message.kind = ChannelMessageKind::Board;
+	message.board = {packLayout(board.layout), board.state.word};
+	return message;
+}
+
+ChannelMessage ChannelMessage::encodeAnalysis(SearchInfo const& info)
+{
+	ChannelMessage message{};
+	message.kind = ChannelMessageKind::Analysis;
+	message.count = uint16_t(std::min<std::size_t>(info.pv.size(), kChannelPvMoves));
+	message.analysis.depth = info.depth;
+	message.analysis.score = info.score;
+	message.analysis.nodes = info.nodes;
+	for (uint i = 0; i < message.count; i++)
+		message.analysis.pv[i] = packMove(info.pv[i]);
+	return message;
+}
+
+BoardMove ChannelMessage::decodeMove() const
+{
+	return unpackMove(move);
+}
+
+ChessBoard::MoveResult ChannelMessage::decodeResult() const
+{
+	ChessBoard::MoveResult decoded{
+		result.validMove != 0, result.nextPlayerColour != 0, result.finished != 0,
+		std::nullopt};
+	if (result.winner)
+		decoded.winner = result.winner - 1 == White;
+	return decoded;
+}
+
+void ChannelMessage::decodeBoard(ChessBoard& decoded) const
+{
+	unpackLayout(board.layout, decoded.layout);
+	decoded.indexPieces();
+	decoded.state.word = board.state;
+}
+
+SearchInfo ChannelMessage::decodeAnalysis() const
+{
+	SearchInfo info;
+	info.depth = analysis.depth;
+	info.score = analysis.score;
+	info.nodes = analysis.nodes;
+	for (uint i = 0; i < count; i++)
+		info.pv.push_back(unpackMove(analysis.pv[i]));
+	return info;
+}
+
+// ========================Segment====================================
+
+static constexpr uint32_t kChannelMagic = 0x4c434831; // "LCH1"
+
+// A position in a ring, counting messages since creation. Only one side
+// advances it; the other sleeps on 'signal' when it has to wait for it.
+struct alignas(64) ChannelCursor
+{
+	std::atomic<uint32_t> position;
+	std::atomic<uint32_t> waiting;
+	std::atomic<uint32_t> signal;
+};
+
+struct ChannelRing
+{
+	ChannelCursor written;
+	ChannelCursor read;
+};
+
+// Followed by the slots of rings[0] and then those of rings[1]
+struct ChannelSegment
+{
+	std::atomic<uint32_t> magic;
+	uint32_t capacity;
+	// Indexed by end, the server's first
+	std::array<std::atomic<uint32_t>, 2> closed;
+	// rings[0] carries messages from the server to the client
+	std::array<ChannelRing, 2> rings;
+};
+static_assert(sizeof(ChannelSegment) % alignof(ChannelMessage) == 0);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+static std::size_t segmentBytes(uint capacity)
+{
+	return sizeof(ChannelSegment) + 2 * std::size_t(capacity) * sizeof(ChannelMessage);
+}
+
+static ChannelMessage* slots(ChannelSegment* segment, uint ring)
+{
+	return reinterpret_cast<ChannelMessage*>(segment + 1) + ring * segment->capacity;
+}
+
+static std::string segmentName(std::string name)
+{
+	return name.starts_with('/') ? name : '/' + name;
+}
+
+// Shared (not process private) futexes, the peer is another process
+static void futexWait(std::atomic<uint32_t>& word, uint32_t seen)
+{
+#ifdef __linux__
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, seen,
+		nullptr, nullptr, 0);
+#else
+	if (word.load() == seen)
+		std::this_thread::yield();
+#endif
+}
+
+static void futexWakeAll(std::atomic<uint32_t>& word)
+{
+#ifdef __linux__
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX,
+		nullptr, nullptr, 0);
+#else
+	(void)word;
+#endif
+}
+
+// The waiter raises 'waiting' before its last look at the cursor and
+// the advancing side stores the cursor before looking at 'waiting'
+// (both sequentially consistent), so at least one of them sees the
+// other. A stale 'signal' makes the futex wait return at once.
+static void advance(ChannelCursor& cursor, uint32_t position)
+{
+	cursor.position.store(position);
+	if (cursor.waiting.load())
+	{
+		cursor.signal.fetch_add(1);
+		futexWakeAll(cursor.signal);
+	}
+}
+
+template<typename Ready>
+static void await(ChannelCursor& cursor, uint spins, Ready ready)
+{
+	for (uint i = 0; i < spins; i++)
+	{
+		if (ready())
+			return;
+	}
+	while (true)
+	{
+		cursor.waiting.store(1);
+		uint32_t seen = cursor.signal.load();
+		if (ready())
+			break;
+		futexWait(cursor.signal, seen);
+	}
+	cursor.waiting.store(0, std::memory_order_relaxed);
+}
+
+// ========================Channel====================================
+
+ShmChannel::ShmChannel(std::string name, ChannelSegment* segment, std::size_t bytes, bool server) :
+	spins(std::thread::hardware_concurrency() > 1 ? 2000 : 0),
+	_name(std::move(name)),
+	_segment(segment),
+	_bytes(bytes),
+	_server(server)
+{
+}
+
+ShmChannel::ShmChannel(ShmChannel&& other) noexcept :
+	spins(other.spins),
+	_name(std::move(other._name)),
+	_segment(std::exchange(other._segment, nullptr)),
+	_bytes(other._bytes),
+	_server(other._server)
+{
+}
+
+ShmChannel& ShmChannel::operator=(ShmChannel&& other) noexcept
+{
+	if (this != &other)
+	{
+		_release();
+		spins = other.spins;
+		_name = std::move(other._name);
+		_segment = std::exchange(other._segment, nullptr);
+		_bytes = other._bytes;
+		_server = other._server;
+	}
+	return *this;
+}
+
+ShmChannel::~ShmChannel()
+{
+	_release();
+}
+
+void ShmChannel::_release()
+{
+	if (!_segment)
+		return;
+	close();
+	munmap(_segment, _bytes);
+	if (_server)
+		shm_unlink(_name.c_str());
+	_segment = nullptr;
+}
+
+ShmChannel ShmChannel::create(std::string name, uint capacity)
+{
+	name = segmentName(std::move(name));
+	capacity = std::bit_ceil(std::max(capacity, 1u));
+	std::size_t bytes = segmentBytes(capacity);
+
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0)
+		throw std::system_error(errno, std::generic_category(), "channel: cannot create " + name);
+	// errno is taken straight after the call that failed, close may set it
+	void* mapping = MAP_FAILED;
+	int error = 0;
+	if (ftruncate(fd, off_t(bytes)) != 0)
+		error = errno;
+	else if ((mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) ==
+		MAP_FAILED)
+		error = errno;
+	::close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		shm_unlink(name.c_str());
+		throw std::system_error(error, std::generic_category(), "channel: cannot map " + name);
+	}
+
+	// The new segment reads as zeros: empty rings, nobody waiting
+	ChannelSegment* segment = new (mapping) ChannelSegment();
+	segment->capacity = capacity;
+	segment->magic.store(kChannelMagic, std::memory_order_release);
+	return ShmChannel(std::move(name), segment, bytes, true);
+}
+
+ShmChannel ShmChannel::open(std::string name)
+{
+	name = segmentName(std::move(name));
+	int fd = shm_open(name.c_str(), O_RDWR, 0);
+	if (fd < 0)
+		throw std::system_error(errno, std::generic_category(), "channel: cannot open " + name);
+	struct stat status;
+	if (fstat(fd, &status) != 0)
+	{
+		int error = errno;
+		::close(fd);
+		throw std::system_error(error, std::generic_category(), "channel: cannot open " + name);
+	}
+	if (std::size_t(status.st_size) < sizeof(ChannelSegment))
+	{
+		::close(fd);
+		throw std::runtime_error("channel: " + name + " is not a channel");
+	}
+	void* mapping = mmap(nullptr, std::size_t(status.st_size), PROT_READ | PROT_WRITE,
+		MAP_SHARED, fd, 0);
+	int error = errno;
+	::close(fd);
+	if (mapping == MAP_FAILED)
+		throw std::system_error(error, std::generic_category(), "channel: cannot map " + name);
+
+	auto segment = static_cast<ChannelSegment*>(mapping);
+	if (segment->magic.load(std::memory_order_acquire) != kChannelMagic ||
+		segmentBytes(segment->capacity) != std::size_t(status.st_size))
+	{
+		munmap(mapping, std::size_t(status.st_size));
+		throw std::runtime_error("channel: " + name + " is not a channel");
+	}
+	return ShmChannel(std::move(name), segment, std::size_t(status.st_size), false);
+}
+
+uint ShmChannel::capacity() const
+{
+	return _segment->capacity;
+}
+
+void ShmChannel::close()
+{
+	if (!_segment || _segment->closed[!_server].exchange(1))
+		return;
+	for (ChannelRing& ring : _segment->rings)
+	{
+		for (ChannelCursor* cursor : {&ring.written, &ring.read})
+		{
+			cursor->signal.fetch_add(1);
+			futexWakeAll(cursor->signal);
+		}
+	}
+}
+
+bool ShmChannel::trySend(ChannelMessage const& message)
+{
+	ChannelRing& ring = _segment->rings[!_server];
+	uint32_t written = ring.written.position.load(std::memory_order_relaxed);
+	if (_segment->closed[0].load() || _segment->closed[1].load() ||
+		written - ring.read.position.load() >= _segment->capacity)
+	{
+		return false;
+	}
+	slots(_segment, !_server)[written & (_segment->capacity - 1)] = message;
+	advance(ring.written, written + 1);
+	return true;
+}
+
+bool ShmChannel::send(ChannelMessage const& message)
+{
+	ChannelRing& ring = _segment->rings[!_server];
+	uint32_t written = ring.written.position.load(std::memory_order_relaxed);
+	await(ring.read, spins, [&]
+	{
+		return _segment->closed[0].load() || _segment->closed[1].load() ||
+			written - ring.read.position.load() < _segment->capacity;
+	});
+	return trySend(message);
+}
+
+bool ShmChannel::tryReceive(ChannelMessage& message)
+{
+	ChannelRing& ring = _segment->rings[_server];
+	uint32_t read = ring.read.position.load(std::memory_order_relaxed);
+	if (ring.written.position.load() == read)
+		return false;
+	message = slots(_segment, _server)[read & (_segment->capacity - 1)];
+	advance(ring.read, read + 1);
+	return true;
+}
+
+bool ShmChannel::receive(ChannelMessage& message)
+{
+	ChannelRing& ring = _segment->rings[_server];
+	uint32_t read = ring.read.position.load(std::memory_order_relaxed);
+	// The peer closes after its last send, so once it is seen closed
+	// the write cursor is final
+	await(ring.written, spins, [&]
+	{
+		return ring.written.position.load() != read || _segment->closed[_server].load();
+	});
+	return tryReceive(message);
+}
+
+}
@@ -0,0 +1,157 @@
+#ifndef LUCHESS_CORE_CHANNEL_H_
+#define LUCHESS_CORE_CHANNEL_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "luchess/core/board.h"
+#include "luchess/core/history.h"
+#include "luchess/core/search.h"
+#include "luchess/core/state.h"
+#include "luchess/core/types.h"
+
+/**
+
+Shared memory channel between a backend and a frontend process on one
+host.
+
+A ShmChannel is a POSIX shared memory segment holding two single
+producer single consumer rings of fixed size ChannelMessages, one per
+direction. The process that creates the segment is the server end and
+owns its name; the other one opens it as the client end. Messages are
+copied straight into the ring slot, so nothing is serialised and no
+system call is made while the peer keeps up.
+
+Each ring has a write cursor, advanced by the producer, and a read
+cursor, advanced by the consumer. A side that finds the ring empty (or
+full) spins for a while and then sleeps on a futex. It raises the
+cursor's waiter flag first, and the side advancing the cursor only
+makes the wake system call when it sees that flag.
+
+Closing either end wakes the peer: receive drains what is left and
+then fails, send fails straight away.
+
+**/
+
+namespace luchess{
+
+static constexpr uint kChannelCapacity = 256;
+// Longest principal variation an Analysis message carries
+static constexpr uint kChannelPvMoves = 52;
+
+enum class ChannelMessageKind : uint16_t
+{
+	Move,
+	MoveResult,
+	Board,
+	Analysis,
+};
+
+struct ChannelMessage
+{
+	static ChannelMessage encodeMove(BoardMove const& move);
+	static ChannelMessage encodeResult(ChessBoard::MoveResult const& result);
+	static ChannelMessage encodeBoard(ChessBoard const& board);
+	// The pv is cut to kChannelPvMoves moves
+	static ChannelMessage encodeAnalysis(SearchInfo const& info);
+
+	BoardMove decodeMove() const;
+	ChessBoard::MoveResult decodeResult() const;
+	// Sets 'board' to the sent position
+	void decodeBoard(ChessBoard& board) const;
+	SearchInfo decodeAnalysis() const;
+
+	struct Result
+	{
+		uint8_t validMove;
+		uint8_t nextPlayerColour;
+		uint8_t finished;
+		// 0 without a winner, PieceColor + 1 otherwise
+		uint8_t winner;
+	};
+
+	struct Board
+	{
+		PackedLayout layout;
+		// GameState::word, a GameState would give the union a constructor
+		GameState::Word state;
+	};
+
+	struct Analysis
+	{
+		uint32_t depth;
+		int32_t score;
+		uint64_t nodes;
+		// See packMove
+		std::array<uint16_t, kChannelPvMoves> pv;
+	};
+
+	ChannelMessageKind kind;
+	// Moves in an Analysis pv
+	uint16_t count;
+	// Free for the caller, e.g. to pair replies with requests
+	uint32_t sequence;
+	union
+	{
+		uint16_t move;
+		Result result;
+		Board board;
+		Analysis analysis;
+	};
+};
+static_assert(sizeof(ChannelMessage) == 128);
+static_assert(std::is_trivially_copyable_v<ChannelMessage>);
+
+// Defined in channel.cpp, lives in the shared segment
+struct ChannelSegment;
+
+struct ShmChannel
+{
+	// Creates the segment 'name' (a leading '/' is added when missing)
+	// with room for 'capacity' messages each way, rounded up to a power
+	// of two. Throws std::system_error when it exists already or cannot
+	// be mapped.
+	static ShmChannel create(std::string name, uint capacity = kChannelCapacity);
+	// The client end of a segment made by create
+	static ShmChannel open(std::string name);
+
+	ShmChannel(ShmChannel&& other) noexcept;
+	ShmChannel& operator=(ShmChannel&& other) noexcept;
+	ShmChannel(ShmChannel const&) = delete;
+	ShmChannel& operator=(ShmChannel const&) = delete;
+	// Closes this end. The server end also removes the name.
+	~ShmChannel();
+
+	// Block while the ring is full, false once either end is closed
+	bool send(ChannelMessage const& message);
+	bool trySend(ChannelMessage const& message);
+	// Block while the ring is empty, false once the peer is closed and
+	// everything it sent has been received
+	bool receive(ChannelMessage& message);
+	bool tryReceive(ChannelMessage& message);
+
+	// Wakes the peer, later sends fail
+	void close();
+
+	std::string const& name() const { return _name; }
+	uint capacity() const;
+
+	// Checks of the cursor before sleeping on it, none on a single core
+	// where the peer cannot move it meanwhile
+	uint spins;
+
+	ShmChannel(std::string name, ChannelSegment* segment, std::size_t bytes, bool server);
+	void _release();
+
+	std::string _name;
+	ChannelSegment* _segment = nullptr;
+	std::size_t _bytes = 0;
+	bool _server = false;
+};
+
+}
+
+#endif // LUCHESS_CORE_CHANNEL_H_
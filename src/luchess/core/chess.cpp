@@ -14,7 +14,7 @@ static constexpr auto R = PieceType::Rook;
 static constexpr auto Q = PieceType::Queen;
 static constexpr auto K = PieceType::King;
 
-constexpr const BoardSquare const sp(PieceType t, PieceColor c) {
+constexpr const BoardSquare sp(PieceType t, PieceColor c) {
 	return BoardSquare(Piece(t, c));
 }
 
@@ -33,7 +33,10 @@ static constexpr const std::array<BoardSquare, 64> defaultBoard = {
 
 void populateDefaultLayout(ChessBoard& board)
 {
-	memcpy(&board.layout[0], &defaultBoard[0], 64 * sizeof(BoardSquare));
+	board.layout = defaultBoard;
+	board.indexPieces();
+	board.state = GameState{};
+	board.state.setCastleRights(0b1111);
 }
 
 bool doesMoveCollide(ChessBoard& board, BoardMove const& move)
@@ -15,6 +15,7 @@
 
 
 #include "luchess/core/types.h"
+#include "luchess/core/notation.h"
 #include "util.h"
 
 
@@ -31,6 +32,8 @@ namespace luchess{
 
 void populateDefaultLayout(ChessBoard& board);
 
+bool doesMoveCollide(ChessBoard& board, BoardMove const& move);
+
 
 struct MoveState
 {
@@ -0,0 +1,396 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include "luchess/core/dedup.h"
+#include "luchess/core/selfplay.h"
+#include "luchess/core/threadpool.h"
+#include "luchess/core/zobrist.h"
+
+namespace luchess{
+
+// ========================Bloom filter===============================
+
+// One multiplier per word of a block picks the key's bit in that word
+static constexpr std::array<uint32_t, 8> bloomSalts = {
+	0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+	0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u};
+
+BloomFilter::BloomFilter(std::size_t keys, uint bitsPerKey) :
+	_blocks(std::max<std::size_t>(1, keys * bitsPerKey / (8 * sizeof(Block))))
+{
+}
+
+// Shards index by the key's top bits and tables by its low 32 bits, so
+// the filter works from a rehash of the whole key: the block from its
+// high half, the bits from its low half
+static uint64_t bloomHash(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdull;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ull;
+	return key ^ (key >> 33);
+}
+
+static std::size_t bloomBlock(uint64_t hash, std::size_t blocks)
+{
+	return std::size_t(((hash >> 32) * blocks) >> 32);
+}
+
+bool BloomFilter::mayContain(uint64_t key) const
+{
+	uint64_t hash = bloomHash(key);
+	Block const& block = _blocks[bloomBlock(hash, _blocks.size())];
+	for (uint i = 0; i < block.words.size(); i++)
+	{
+		uint64_t bit = uint64_t(1) << ((uint32_t(hash) * bloomSalts[i]) >> 26);
+		if (!(block.words[i].load(std::memory_order_relaxed) & bit))
+			return false;
+	}
+	return true;
+}
+
+bool BloomFilter::add(uint64_t key)
+{
+	uint64_t hash = bloomHash(key);
+	Block& block = _blocks[bloomBlock(hash, _blocks.size())];
+	bool present = true;
+	for (uint i = 0; i < block.words.size(); i++)
+	{
+		uint64_t bit = uint64_t(1) << ((uint32_t(hash) * bloomSalts[i]) >> 26);
+		// Reading first keeps the line shared while the bits are already set
+		if (block.words[i].load(std::memory_order_relaxed) & bit)
+			continue;
+		present = false;
+		block.words[i].fetch_or(bit, std::memory_order_relaxed);
+	}
+	return present;
+}
+
+// ========================Position set===============================
+
+static constexpr std::size_t kInitialSlots = 1024;
+// Load factor that triggers growth, in percent
+static constexpr std::size_t kMaxLoad = 85;
+// Keys read or written at a time while merging a run
+static constexpr std::size_t kSpillChunk = 4096;
+// Keys of a run behind each entry of its in memory index, 4 KB
+static constexpr std::size_t kRunPageKeys = 512;
+
+PositionSet::PositionSet(DedupOptions const& _options) :
+	options(_options),
+	bloom(_options.expectedPositions, 8),
+	_shardCount(std::bit_ceil(std::max(_options.shards, 1u))),
+	_shardShift(64 - uint(std::countr_zero(_shardCount))),
+	_spillTag(std::random_device{}())
+{
+	_shards = std::make_unique<Shard[]>(_shardCount);
+	for (uint i = 0; i < _shardCount; i++)
+		_shards[i].slots.resize(kInitialSlots);
+	_tableBytes = _shardCount * kInitialSlots * sizeof(uint64_t);
+}
+
+PositionSet::~PositionSet()
+{
+	for (uint i = 0; i < _shardCount; i++)
+	{
+		Shard& shard = _shards[i];
+		shard.run.reset();
+		if (!shard.runPath.empty())
+		{
+			std::error_code error;
+			std::filesystem::remove(shard.runPath, error);
+		}
+	}
+}
+
+std::size_t PositionSet::memoryBytes() const
+{
+	return bloom.bytes() + _tableBytes.load(std::memory_order_relaxed);
+}
+
+PositionSet::Shard& PositionSet::_shardOf(uint64_t key)
+{
+	// A shift by 64 would be undefined with a single shard
+	return _shards[_shardCount == 1 ? 0 : key >> _shardShift];
+}
+
+static std::size_t homeSlot(uint64_t key, std::size_t slots)
+{
+	return std::size_t((uint64_t(uint32_t(key)) * slots) >> 32);
+}
+
+bool PositionSet::_tableContains(Shard const& shard, uint64_t key) const
+{
+	if (key == 0)
+		return shard.hasZero;
+	std::size_t size = shard.slots.size();
+	for (std::size_t slot = homeSlot(key, size);; slot = slot + 1 == size ? 0 : slot + 1)
+	{
+		if (shard.slots[slot] == key)
+			return true;
+		if (shard.slots[slot] == 0)
+			return false;
+	}
+}
+
+void PositionSet::_grow(Shard& shard)
+{
+	std::vector<uint64_t> slots(shard.slots.size() * 3 / 2);
+	for (uint64_t key : shard.slots)
+	{
+		if (key == 0)
+			continue;
+		std::size_t slot = homeSlot(key, slots.size());
+		while (slots[slot])
+			slot = slot + 1 == slots.size() ? 0 : slot + 1;
+		slots[slot] = key;
+	}
+	_tableBytes += (slots.size() - shard.slots.size()) * sizeof(uint64_t);
+	shard.slots = std::move(slots);
+}
+
+void PositionSet::_tableInsert(Shard& shard, uint64_t key)
+{
+	if (key == 0)
+	{
+		shard.hasZero = true;
+		return;
+	}
+	if ((shard.count + 1) * 100 > shard.slots.size() * kMaxLoad)
+		_grow(shard);
+	std::size_t size = shard.slots.size();
+	std::size_t slot = homeSlot(key, size);
+	while (shard.slots[slot])
+		slot = slot + 1 == size ? 0 : slot + 1;
+	shard.slots[slot] = key;
+	shard.count++;
+}
+
+bool PositionSet::_runContains(Shard const& shard, uint64_t key) const
+{
+	// Only the last page starting at or below the key can hold it, so a
+	// lookup reads one page
+	auto after = std::ranges::upper_bound(shard.runIndex, key);
+	if (after == shard.runIndex.begin())
+		return false;
+	uint64_t first = uint64_t(after - shard.runIndex.begin() - 1) * kRunPageKeys;
+	std::size_t count = std::size_t(std::min<uint64_t>(kRunPageKeys, shard.runKeys - first));
+	std::array<uint64_t, kRunPageKeys> page;
+	if (std::fseek(shard.run.get(), long(first * sizeof(uint64_t)), SEEK_SET) != 0 ||
+		std::fread(page.data(), sizeof(uint64_t), count, shard.run.get()) != count)
+		throw std::runtime_error("dedup: cannot read " + shard.runPath.string());
+	return std::binary_search(page.begin(), page.begin() + count, key);
+}
+
+void PositionSet::_spill(Shard& shard, uint index)
+{
+	std::vector<uint64_t> keys;
+	keys.reserve(shard.count + 1);
+	if (shard.hasZero)
+		keys.push_back(0);
+	for (uint64_t key : shard.slots)
+	{
+		if (key)
+			keys.push_back(key);
+	}
+	std::ranges::sort(keys);
+
+	// Merges the run on disk with the table into a new run
+	std::filesystem::path runPath = options.spillDirectory /
+		("luchess-dedup-" + std::to_string(_spillTag) + "-" + std::to_string(index) + ".run");
+	std::filesystem::path mergedPath = runPath;
+	mergedPath += ".tmp";
+	std::vector<uint64_t> runIndex;
+	{
+		std::unique_ptr<std::FILE, int (*)(std::FILE*)> merged(
+			std::fopen(mergedPath.string().c_str(), "wb"), &std::fclose);
+		if (!merged)
+			throw std::runtime_error("dedup: cannot write " + mergedPath.string());
+		bool written = true;
+		std::vector<uint64_t> out;
+		out.reserve(kSpillChunk);
+		uint64_t emitted = 0;
+		auto emit = [&](uint64_t key)
+		{
+			if (emitted++ % kRunPageKeys == 0)
+				runIndex.push_back(key);
+			out.push_back(key);
+			if (out.size() < kSpillChunk)
+				return;
+			written &= std::fwrite(out.data(), sizeof(uint64_t), out.size(), merged.get()) ==
+				out.size();
+			out.clear();
+		};
+
+		auto next = keys.begin();
+		if (shard.run)
+		{
+			std::rewind(shard.run.get());
+			std::vector<uint64_t> chunk(kSpillChunk);
+			for (uint64_t left = shard.runKeys; left;)
+			{
+				std::size_t count = std::min<uint64_t>(left, chunk.size());
+				if (std::fread(chunk.data(), sizeof(uint64_t), count, shard.run.get()) != count)
+					throw std::runtime_error("dedup: cannot read " + shard.runPath.string());
+				left -= count;
+				for (std::size_t i = 0; i < count; i++)
+				{
+					for (; next != keys.end() && *next < chunk[i]; ++next)
+						emit(*next);
+					emit(chunk[i]);
+				}
+			}
+		}
+		for (; next != keys.end(); ++next)
+			emit(*next);
+		written &= std::fwrite(out.data(), sizeof(uint64_t), out.size(), merged.get()) ==
+			out.size();
+		if (!written || std::fflush(merged.get()) != 0)
+			throw std::runtime_error("dedup: cannot write " + mergedPath.string());
+	}
+	shard.run.reset();
+	std::filesystem::rename(mergedPath, runPath);
+	shard.runPath = runPath;
+	shard.run.reset(std::fopen(runPath.string().c_str(), "rb"));
+	if (!shard.run)
+		throw std::runtime_error("dedup: cannot read " + runPath.string());
+	// Lookups read whole pages, a stdio buffer would only copy them twice
+	std::setvbuf(shard.run.get(), nullptr, _IONBF, 0);
+	shard.runIndex = std::move(runIndex);
+	shard.runKeys += keys.size();
+	_spilled += keys.size();
+
+	_tableBytes -= (shard.slots.size() - kInitialSlots) * sizeof(uint64_t);
+	std::vector<uint64_t>(kInitialSlots).swap(shard.slots);
+	shard.count = 0;
+	shard.hasZero = false;
+}
+
+bool PositionSet::insert(uint64_t key)
+{
+	_total.fetch_add(1, std::memory_order_relaxed);
+	Shard& shard = _shardOf(key);
+	std::lock_guard lock(shard.mutex);
+	// Filled under the shard's lock, so it never lags behind the runs
+	bool maybeSeen = bloom.add(key);
+	if (maybeSeen && (_tableContains(shard, key) || (shard.run && _runContains(shard, key))))
+		return false;
+	_tableInsert(shard, key);
+	_unique.fetch_add(1, std::memory_order_relaxed);
+
+	// Only shards that grew to at least half their share spill, or a small
+	// one could be written out over and over
+	std::size_t shardBytes = shard.slots.size() * sizeof(uint64_t);
+	if (options.memoryLimit && _tableBytes.load(std::memory_order_relaxed) > options.memoryLimit &&
+		shard.slots.size() > kInitialSlots && shardBytes * _shardCount * 2 >= options.memoryLimit)
+		_spill(shard, uint(&shard - _shards.get()));
+	return true;
+}
+
+bool PositionSet::insert(ChessBoard const& board)
+{
+	return insert(zobristKey(board));
+}
+
+bool PositionSet::contains(uint64_t key)
+{
+	Shard& shard = _shardOf(key);
+	std::lock_guard lock(shard.mutex);
+	if (!bloom.mayContain(key))
+		return false;
+	return _tableContains(shard, key) || (shard.run && _runContains(shard, key));
+}
+
+// ========================Training files=============================
+
+double DedupSummary::positionsPerSecond() const
+{
+	return elapsed.count() ? total * 1e6 / elapsed.count() : 0.;
+}
+
+DedupSummary dedupTrainingRecords(std::string const& in, std::string const& out,
+	DedupOptions const& options, uint threads)
+{
+	using Clock = std::chrono::steady_clock;
+	auto start = Clock::now();
+	using FilePtr = std::unique_ptr<std::FILE, int (*)(std::FILE*)>;
+
+	std::error_code error;
+	uint64_t records = std::filesystem::file_size(in, error) / sizeof(TrainingRecord);
+	if (error)
+		throw std::runtime_error("dedup: cannot read " + in);
+	uint64_t chunks = (records + kSpillChunk - 1) / kSpillChunk;
+	if (threads == 0)
+		threads = sharedThreadPool().size();
+	threads = uint(std::min<uint64_t>(threads, std::max<uint64_t>(chunks, 1)));
+
+	PositionSet set(options);
+	std::atomic<uint64_t> next = 0;
+	std::atomic<bool> failed = false;
+	auto worker = [&](uint)
+	{
+		FilePtr input(std::fopen(in.c_str(), "rb"), &std::fclose);
+		FilePtr output(std::fopen(out.c_str(), "ab"), &std::fclose);
+		if (!input || !output)
+		{
+			failed = true;
+			return;
+		}
+		std::setvbuf(output.get(), nullptr, _IONBF, 0);
+		std::vector<TrainingRecord> chunk(kSpillChunk);
+		std::vector<TrainingRecord> fresh;
+		fresh.reserve(kSpillChunk);
+		ChessBoard board;
+		try
+		{
+			for (uint64_t index = next.fetch_add(1, std::memory_order_relaxed);
+				 index < chunks && !failed;
+				 index = next.fetch_add(1, std::memory_order_relaxed))
+			{
+				std::size_t count = std::min<uint64_t>(kSpillChunk, records - index * kSpillChunk);
+				if (std::fseek(input.get(), long(index * kSpillChunk * sizeof(TrainingRecord)),
+						SEEK_SET) != 0 ||
+					std::fread(chunk.data(), sizeof(TrainingRecord), count, input.get()) != count)
+				{
+					failed = true;
+					break;
+				}
+				fresh.clear();
+				for (std::size_t i = 0; i < count; i++)
+				{
+					chunk[i].decode(board);
+					if (set.insert(board))
+						fresh.push_back(chunk[i]);
+				}
+				if (std::fwrite(fresh.data(), sizeof(TrainingRecord), fresh.size(), output.get()) !=
+					fresh.size())
+					failed = true;
+			}
+		}
+		catch (std::runtime_error const&)
+		{
+			failed = true;
+		}
+	};
+
+	runTasks(sharedThreadPool(), threads, worker);
+	if (failed)
+		throw std::runtime_error("dedup: cannot copy " + in + " to " + out);
+
+	DedupSummary summary;
+	summary.total = set.total();
+	summary.unique = set.unique();
+	summary.spilled = set.spilled();
+	summary.memoryBytes = set.memoryBytes();
+	summary.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+		Clock::now() - start);
+	return summary;
+}
+
+}
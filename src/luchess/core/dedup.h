@@ -0,0 +1,160 @@
+#ifndef LUCHESS_CORE_DEDUP_H_
+#define LUCHESS_CORE_DEDUP_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "luchess/core/board.h"
+#include "luchess/core/types.h"
+
+/**
+
+Position deduplication for large corpora.
+
+Positions are compared by zobrist key alone; two positions only collide
+by chance, with odds of about n^2 / 2^65 over n positions.
+
+A PositionSet spreads keys over shards by their top bits. Each shard is
+an open addressing table (linear probing, grown by half once 85% full)
+behind its own lock, so ingest threads only meet when they hit the same
+shard. The tables hold the keys and nothing else: between 8 / 0.85 and
+8 / 0.57 bytes a position.
+
+With a memory limit, a shard that pushes the tables over it is sorted
+and merged into its run file on disk, then emptied. The shard keeps the
+first key of every 4 KB page of its run in memory, so looking a key up
+in a run reads one page. A blocked Bloom filter over every key inserted
+(about one byte a position) is asked first: a key it has never seen
+cannot be in any run. A block is one cache line and all eight bits of a
+key fall in it, so a check touches one line. Block and bits come from a
+rehash of the key, so they do not follow the bits that pick the shard
+and the table slot.
+
+Run files are removed with the set.
+
+dedupTrainingRecords runs a training file (see selfplay.h) through a
+set in several ingest tasks on the shared pool, each reading its own
+chunks of records and appending the new ones with its own writes.
+
+**/
+
+namespace luchess{
+
+struct BloomFilter
+{
+	// About 'bitsPerKey' bits for each of 'keys' keys
+	BloomFilter(std::size_t keys, uint bitsPerKey);
+
+	// False when the key was certainly never added
+	bool mayContain(uint64_t key) const;
+	// Same as mayContain before adding. Safe to call from any thread.
+	bool add(uint64_t key);
+
+	std::size_t bytes() const { return _blocks.size() * sizeof(Block); }
+
+	struct alignas(64) Block
+	{
+		std::array<std::atomic<uint64_t>, 8> words;
+	};
+	std::vector<Block> _blocks;
+};
+
+struct DedupOptions
+{
+	// Sizes the Bloom filter, more positions only raise its false
+	// positive rate
+	std::size_t expectedPositions = 1 << 20;
+	// Table bytes allowed before shards spill to disk, 0 for no limit
+	std::size_t memoryLimit = 0;
+	std::filesystem::path spillDirectory = std::filesystem::temp_directory_path();
+	// Rounded up to a power of two
+	uint shards = 64;
+};
+
+struct PositionSet
+{
+	explicit PositionSet(DedupOptions const& options = {});
+	~PositionSet();
+
+	PositionSet(PositionSet const&) = delete;
+	PositionSet& operator=(PositionSet const&) = delete;
+
+	// True when the key was not in the set, safe to call from any thread
+	bool insert(uint64_t key);
+	bool insert(ChessBoard const& board);
+
+	bool contains(uint64_t key);
+
+	uint64_t unique() const { return _unique.load(std::memory_order_relaxed); }
+	uint64_t total() const { return _total.load(std::memory_order_relaxed); }
+	// Filter and tables, not the runs on disk
+	std::size_t memoryBytes() const;
+	// Positions moved to run files so far
+	uint64_t spilled() const { return _spilled.load(std::memory_order_relaxed); }
+
+	struct alignas(64) Shard
+	{
+		std::mutex mutex;
+		// 0 marks an empty slot, the key 0 is kept in hasZero instead
+		std::vector<uint64_t> slots;
+		std::size_t count = 0;
+		bool hasZero = false;
+		// Sorted keys moved out of the table
+		std::filesystem::path runPath;
+		std::unique_ptr<std::FILE, int (*)(std::FILE*)> run{nullptr, &std::fclose};
+		// First key of each page of the run
+		std::vector<uint64_t> runIndex;
+		uint64_t runKeys = 0;
+	};
+
+	Shard& _shardOf(uint64_t key);
+	bool _tableContains(Shard const& shard, uint64_t key) const;
+	// Adds a key the table does not hold
+	void _tableInsert(Shard& shard, uint64_t key);
+	void _grow(Shard& shard);
+	bool _runContains(Shard const& shard, uint64_t key) const;
+	void _spill(Shard& shard, uint index);
+
+	DedupOptions options;
+	BloomFilter bloom;
+	std::unique_ptr<Shard[]> _shards;
+	uint _shardCount;
+	uint _shardShift;
+	std::atomic<std::size_t> _tableBytes = 0;
+	std::atomic<uint64_t> _unique = 0;
+	std::atomic<uint64_t> _total = 0;
+	std::atomic<uint64_t> _spilled = 0;
+	// Tells the run files of sets living side by side apart
+	uint64_t _spillTag;
+};
+
+struct DedupSummary
+{
+	double positionsPerSecond() const;
+
+	uint64_t total = 0;
+	uint64_t unique = 0;
+	uint64_t spilled = 0;
+	std::size_t memoryBytes = 0;
+	std::chrono::microseconds elapsed{0};
+};
+
+// Appends one record of every distinct position in 'in' to 'out', in no
+// particular order, in 'threads' tasks on sharedThreadPool() (its size
+// when 0).
+// Throws std::runtime_error when a file cannot be read or written.
+DedupSummary dedupTrainingRecords(std::string const& in, std::string const& out,
+	DedupOptions const& options, uint threads = 0);
+
+}
+
+#endif // LUCHESS_CORE_DEDUP_H_
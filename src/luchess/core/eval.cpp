@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+
+#include "luchess/core/eval.h"
+
+namespace luchess{
+
+using SquareTable = std::array<int, ChessBoard::boardSize>;
+
+// Tables are laid out from white's side, a1 first, and mirrored for black
+static constexpr SquareTable pawnTable = {
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 5, 10, 10,-20,-20, 10, 10,  5,
+	 5, -5,-10,  0,  0,-10, -5,  5,
+	 0,  0,  0, 20, 20,  0,  0,  0,
+	 5,  5, 10, 25, 25, 10,  5,  5,
+	10, 10, 20, 30, 30, 20, 10, 10,
+	50, 50, 50, 50, 50, 50, 50, 50,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+};
+
+static constexpr SquareTable bishopTable = {
+	-20,-10,-10,-10,-10,-10,-10,-20,
+	-10,  5,  0,  0,  0,  0,  5,-10,
+	-10, 10, 10, 10, 10, 10, 10,-10,
+	-10,  0, 10, 10, 10, 10,  0,-10,
+	-10,  5,  5, 10, 10,  5,  5,-10,
+	-10,  0,  5, 10, 10,  5,  0,-10,
+	-10,  0,  0,  0,  0,  0,  0,-10,
+	-20,-10,-10,-10,-10,-10,-10,-20,
+};
+
+static constexpr SquareTable knightTable = {
+	-50,-40,-30,-30,-30,-30,-40,-50,
+	-40,-20,  0,  5,  5,  0,-20,-40,
+	-30,  5, 10, 15, 15, 10,  5,-30,
+	-30,  0, 15, 20, 20, 15,  0,-30,
+	-30,  5, 15, 20, 20, 15,  5,-30,
+	-30,  0, 10, 15, 15, 10,  0,-30,
+	-40,-20,  0,  0,  0,  0,-20,-40,
+	-50,-40,-30,-30,-30,-30,-40,-50,
+};
+
+static constexpr SquareTable rookTable = {
+	 0,  0,  0,  5,  5,  0,  0,  0,
+	-5,  0,  0,  0,  0,  0,  0, -5,
+	-5,  0,  0,  0,  0,  0,  0, -5,
+	-5,  0,  0,  0,  0,  0,  0, -5,
+	-5,  0,  0,  0,  0,  0,  0, -5,
+	-5,  0,  0,  0,  0,  0,  0, -5,
+	 5, 10, 10, 10, 10, 10, 10,  5,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+};
+
+static constexpr SquareTable queenTable = {
+	-20,-10,-10, -5, -5,-10,-10,-20,
+	-10,  0,  5,  0,  0,  0,  0,-10,
+	-10,  5,  5,  5,  5,  5,  0,-10,
+	  0,  0,  5,  5,  5,  5,  0, -5,
+	 -5,  0,  5,  5,  5,  5,  0, -5,
+	-10,  0,  5,  5,  5,  5,  0,-10,
+	-10,  0,  0,  0,  0,  0,  0,-10,
+	-20,-10,-10, -5, -5,-10,-10,-20,
+};
+
+static constexpr SquareTable kingTable = {
+	 20, 30, 10,  0,  0, 10, 30, 20,
+	 20, 20,  0,  0,  0,  0, 20, 20,
+	-10,-20,-20,-20,-20,-20,-20,-10,
+	-20,-30,-30,-40,-40,-30,-30,-20,
+	-30,-40,-40,-50,-50,-40,-40,-30,
+	-30,-40,-40,-50,-50,-40,-40,-30,
+	-30,-40,-40,-50,-50,-40,-40,-30,
+	-30,-40,-40,-50,-50,-40,-40,-30,
+};
+
+static constexpr std::array<SquareTable const*, 6> squareTables = {
+	&pawnTable, &bishopTable, &knightTable, &rookTable, &queenTable, &kingTable};
+
+// ========================Pawns======================================
+
+static constexpr Bitboard kFileA = 0x0101010101010101ull;
+
+static constexpr int kDoubledPawn = -12;
+static constexpr int kIsolatedPawn = -15;
+static constexpr int kBackwardPawn = -8;
+// By row counted from the pawn's own side
+static constexpr std::array<int, 8> passedPawnBonus = {0, 5, 10, 20, 35, 60, 100, 0};
+// Per pawn in front of a castled king
+static constexpr int kShieldPawn = 10;
+// Per square the enemy king is further than our own from a passed pawn's
+// stop square, by the pawn's row counted from its own side
+static constexpr std::array<int, 8> passedKingBonus = {0, 0, 0, 2, 5, 8, 12, 0};
+
+struct PawnMasks
+{
+	// Adjacent files
+	std::array<Bitboard, 8> neighbours;
+	// By PieceColor and square: squares ahead on the pawn's own and the
+	// adjacent files, and on the adjacent files level with or behind it
+	std::array<std::array<Bitboard, ChessBoard::boardSize>, 2> passedSpan;
+	std::array<std::array<Bitboard, ChessBoard::boardSize>, 2> supportSpan;
+};
+
+static constexpr PawnMasks makePawnMasks()
+{
+	PawnMasks masks{};
+	for (int column = 0; column < 8; column++)
+	{
+		if (column > 0)
+			masks.neighbours[column] |= kFileA << (column - 1);
+		if (column < 7)
+			masks.neighbours[column] |= kFileA << (column + 1);
+	}
+	for (int square = 0; square < 64; square++)
+	{
+		int column = square % 8, row = square / 8;
+		for (int other = 0; other < 64; other++)
+		{
+			int otherColumn = other % 8, otherRow = other / 8;
+			int distance = otherColumn - column;
+			if (distance < -1 || distance > 1)
+				continue;
+			Bitboard bit = Bitboard(1) << other;
+			if (otherRow > row)
+				masks.passedSpan[White][square] |= bit;
+			if (otherRow < row)
+				masks.passedSpan[Black][square] |= bit;
+			if (distance != 0 && otherRow <= row)
+				masks.supportSpan[White][square] |= bit;
+			if (distance != 0 && otherRow >= row)
+				masks.supportSpan[Black][square] |= bit;
+		}
+	}
+	return masks;
+}
+
+static constexpr PawnMasks pawnMasks = makePawnMasks();
+
+// Squares attacked by the pawns of one color
+static Bitboard pawnCover(Bitboard pawns, PieceColor color)
+{
+	Bitboard west = pawns & ~kFileA, east = pawns & ~(kFileA << 7);
+	return color == White ? (west << 7) | (east << 9) : (west >> 9) | (east >> 7);
+}
+
+PawnEntry evaluatePawns(Bitboard whitePawns, Bitboard blackPawns)
+{
+	PawnEntry entry;
+	entry.filled = true;
+	std::array<Bitboard, 2> pawns;
+	pawns[White] = whitePawns;
+	pawns[Black] = blackPawns;
+	for (PieceColor color : {White, Black})
+	{
+		PieceColor other = static_cast<PieceColor>(!color);
+		Bitboard own = pawns[color];
+		Bitboard enemyCover = pawnCover(pawns[other], other);
+		int score = 0;
+		for (int column = 0; column < 8; column++)
+		{
+			int onFile = std::popcount(own & (kFileA << column));
+			if (onFile > 1)
+				score += kDoubledPawn * (onFile - 1);
+		}
+		for (Bitboard rest = own; rest; rest &= rest - 1)
+		{
+			uint square = firstSquare(rest);
+			uint column = square % 8, row = square / 8;
+			bool isolated = !(own & pawnMasks.neighbours[column]);
+			if (isolated)
+				score += kIsolatedPawn;
+			// No neighbour can come up beside it, and it cannot advance safely
+			uint stop = color == White ? square + 8 : square - 8;
+			if (!isolated && !(own & pawnMasks.supportSpan[color][square]) &&
+				(enemyCover & squareBit(stop)))
+				score += kBackwardPawn;
+			if (!(pawns[other] & pawnMasks.passedSpan[color][square]))
+			{
+				entry.passed[color] |= squareBit(square);
+				score += passedPawnBonus[color == White ? row : 7 - row];
+			}
+		}
+		entry.score += color == White ? score : -score;
+	}
+	return entry;
+}
+
+PawnEntry const& PawnCache::probe(uint64_t key, Bitboard whitePawns, Bitboard blackPawns)
+{
+	PawnEntry& entry = entries[key & (kEntries - 1)];
+	probes++;
+	if (entry.filled && entry.key == key)
+	{
+		hits++;
+		return entry;
+	}
+	entry = evaluatePawns(whitePawns, blackPawns);
+	entry.key = key;
+	return entry;
+}
+
+PawnCache& threadPawnCache()
+{
+	thread_local PawnCache cache;
+	return cache;
+}
+
+// Pawns on the three files around a king that has gone to a wing, on
+// the two rows in front of it
+static int kingShield(uint king, PieceColor color, Bitboard pawns)
+{
+	uint column = king % 8, row = king / 8;
+	uint homeRow = color == White ? row : 7 - row;
+	if (homeRow > 1 || (column > 2 && column < 5))
+		return 0;
+	Bitboard files = pawnMasks.neighbours[column] | (kFileA << column);
+	Bitboard rows = Bitboard(0xffff) << (color == White ? 8 * (row + 1) : 8 * (row - 2));
+	return kShieldPawn * std::popcount(pawns & files & rows);
+}
+
+static int kingDistance(uint from, uint to)
+{
+	return std::max(std::abs(int(from % 8) - int(to % 8)), std::abs(int(from / 8) - int(to / 8)));
+}
+
+// Passed pawns are worth more the further the enemy king is from their
+// path and the closer their own king
+static int passedPawnKings(PawnEntry const& entry, std::array<uint, 2> const& kings)
+{
+	int score = 0;
+	for (PieceColor color : {White, Black})
+	{
+		PieceColor other = static_cast<PieceColor>(!color);
+		int own = 0;
+		for (Bitboard rest = entry.passed[color]; rest; rest &= rest - 1)
+		{
+			uint square = firstSquare(rest);
+			uint stop = color == White ? square + 8 : square - 8;
+			uint row = color == White ? square / 8 : 7 - square / 8;
+			own += passedKingBonus[row] *
+				(kingDistance(kings[other], stop) - kingDistance(kings[color], stop));
+		}
+		score += color == White ? own : -own;
+	}
+	return score;
+}
+
+// ========================Evaluation=================================
+
+template <typename PawnProbe>
+static int evaluateWith(ChessBoard const& board, PawnProbe const& pawnProbe)
+{
+	int score = 0;
+	std::array<Bitboard, 2> pawns{};
+	std::array<uint, 2> kings{};
+	for (PieceColor color : {White, Black})
+	{
+		for (uint type = Pawn; type <= King; type++)
+		{
+			for (uint8_t index : board.pieces.squares(color, PieceType(type)))
+			{
+				if (type == Pawn)
+					pawns[color] |= squareBit(index);
+				else if (type == King)
+					kings[color] = index;
+				// Flip the row for black
+				uint tableIndex = color == White ? index : index ^ 56;
+				int value = pieceValues[type] + (*squareTables[type])[tableIndex];
+				score += color == White ? value : -value;
+			}
+		}
+	}
+	PawnEntry const& pawnEntry = pawnProbe(pawns[White], pawns[Black]);
+	score += pawnEntry.score + passedPawnKings(pawnEntry, kings);
+	score += kingShield(kings[White], White, pawns[White]) -
+		kingShield(kings[Black], Black, pawns[Black]);
+	return board.nextGo() == White ? score : -score;
+}
+
+int evaluate(ChessBoard const& board)
+{
+	return evaluateWith(board, [](Bitboard whitePawns, Bitboard blackPawns)
+	{
+		return evaluatePawns(whitePawns, blackPawns);
+	});
+}
+
+int evaluate(ChessBoard const& board, PawnCache& cache, uint64_t pawnKey)
+{
+	return evaluateWith(board, [&](Bitboard whitePawns, Bitboard blackPawns)
+		-> PawnEntry const&
+	{
+		return cache.probe(pawnKey, whitePawns, blackPawns);
+	});
+}
+
+}
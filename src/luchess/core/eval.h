@@ -0,0 +1,78 @@
+#ifndef LUCHESS_CORE_EVAL_H_
+#define LUCHESS_CORE_EVAL_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "luchess/core/bitboard.h"
+#include "luchess/core/board.h"
+
+/**
+
+Static evaluation.
+
+Material plus piece square tables, pawn structure, king pawn shields
+and king distance to passed pawns, in centipawns from the point of view
+of the side to move.
+
+The pawn structure terms (doubled, isolated, backward and passed pawns)
+depend on the pawns alone, so a search keeps them in a PawnCache
+indexed by the pawn key (see zobrist.h) it updates move by move. Pawn
+layouts repeat across most of a tree, and a hit leaves the pawn work to
+the terms that also depend on where the kings stand. Each thread keeps
+one cache for its lifetime, so searches do not pay for a fresh one.
+
+**/
+
+namespace luchess{
+
+static constexpr std::array<int, 6> pieceValues = {
+	100, // Pawn
+	330, // Bishop
+	320, // Knight
+	500, // Rook
+	900, // Queen
+	0,   // King
+};
+
+// Pawn structure of a layout, scores from white's side
+struct PawnEntry
+{
+	uint64_t key = 0;
+	// Passed pawns by PieceColor
+	std::array<Bitboard, 2> passed{};
+	int score = 0;
+	bool filled = false;
+};
+
+PawnEntry evaluatePawns(Bitboard whitePawns, Bitboard blackPawns);
+
+// Direct mapped by pawn key, used by one thread at a time
+struct PawnCache
+{
+	static constexpr std::size_t kEntries = 4096;
+
+	PawnCache() : entries(kEntries) {}
+
+	// Computes and keeps the entry on a miss
+	PawnEntry const& probe(uint64_t key, Bitboard whitePawns, Bitboard blackPawns);
+
+	std::vector<PawnEntry> entries;
+	uint64_t probes = 0;
+	uint64_t hits = 0;
+};
+
+// The calling thread's cache, built on first use and kept until the
+// thread exits
+PawnCache& threadPawnCache();
+
+int evaluate(ChessBoard const& board);
+// The same score with the pawn structure from 'cache', 'pawnKey' being
+// the board's pawn key
+int evaluate(ChessBoard const& board, PawnCache& cache, uint64_t pawnKey);
+
+}
+
+#endif // LUCHESS_CORE_EVAL_H_
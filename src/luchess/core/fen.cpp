@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+#include "luchess/core/fen.h"
+#include "luchess/core/format.h"
+#include "luchess/core/notation.h"
+
+namespace luchess{
+
+// Splits off the next space separated field
+static std::string_view nextField(std::string_view& text)
+{
+	std::size_t start = text.find_first_not_of(' ');
+	if (start == std::string_view::npos)
+	{
+		text = {};
+		return {};
+	}
+	text.remove_prefix(start);
+	std::size_t end = std::min(text.find(' '), text.size());
+	std::string_view field = text.substr(0, end);
+	text.remove_prefix(end);
+	return field;
+}
+
+static bool parseNumber(std::string_view field, uint& value)
+{
+	auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+	return error == std::errc() && end == field.data() + field.size();
+}
+
+// One king, at most 8 pawns, and no more pieces beyond the starting set
+// than there are missing pawns to have promoted
+static bool isReachableMaterial(std::array<uint, 6> const& counts)
+{
+	auto beyond = [&](PieceType type, uint start)
+	{
+		return counts[type] > start ? counts[type] - start : 0;
+	};
+	uint promoted = beyond(Queen, 1) + beyond(Rook, 2) + beyond(Bishop, 2) +
+		beyond(Knight, 2);
+	return counts[King] == 1 && counts[Pawn] <= 8 && promoted <= 8 - counts[Pawn];
+}
+
+// Placement, side to move, castling and en passant, the fields FEN and
+// EPD share
+static std::optional<ChessBoard> parsePosition(std::string_view& text)
+{
+	std::string_view placement = nextField(text);
+	std::string_view side = nextField(text);
+	std::string_view castling = nextField(text);
+	std::string_view enPassant = nextField(text);
+	if (enPassant.empty())
+		return std::nullopt;
+
+	ChessBoard board;
+	int row = kMaxRow;
+	int column = 0;
+	std::array<std::array<uint, 6>, 2> counts{};
+	for (char letter : placement)
+	{
+		if (letter == '/')
+		{
+			if (column != 8 || row == 0)
+				return std::nullopt;
+			row--;
+			column = 0;
+		}
+		else if (letter >= '1' && letter <= '8')
+			column += letter - '0';
+		else
+		{
+			std::size_t type = pieceLettersLower.find(char(std::tolower(letter)));
+			if (type == std::string_view::npos || column > 7)
+				return std::nullopt;
+			PieceColor color = std::isupper(letter) ? White : Black;
+			// A pawn on the first or last rank has nowhere to go
+			if (type == Pawn && (row == int(kMinRow) || row == int(kMaxRow)))
+				return std::nullopt;
+			board.getAt({column++, row}) = Piece(PieceType(type), color);
+			counts[color][type]++;
+		}
+		if (column > 8)
+			return std::nullopt;
+	}
+	if (row != 0 || column != 8 || !isReachableMaterial(counts[White]) ||
+		!isReachableMaterial(counts[Black]))
+		return std::nullopt;
+	board.indexPieces();
+
+	if (side != "w" && side != "b")
+		return std::nullopt;
+	board.state.setSideToMove(side == "w" ? White : Black);
+
+	if (castling != "-")
+	{
+		for (char right : castling)
+		{
+			// Corner rook of each right, as RookCastleState indexes them
+			std::size_t corner = std::string_view("KQkq").find(right);
+			if (corner == std::string_view::npos)
+				return std::nullopt;
+			constexpr std::array<BoardPosition, 4> rooks = {{{7, 0}, {0, 0}, {7, 7}, {0, 7}}};
+			board.state.setCastleRight(_rookCastleIndex(rooks[corner]), true);
+		}
+	}
+
+	if (enPassant != "-")
+	{
+		int passedRow = board.nextGo() == White ? 5 : 2;
+		if (enPassant.size() != 2 || enPassant[0] < 'a' || enPassant[0] > 'h' ||
+			enPassant[1] != '1' + passedRow)
+			return std::nullopt;
+		// Only kept when a double step could have just been played: the
+		// pawn that made it stands behind the passed square, and the passed
+		// and starting squares are empty. Some writers set the square
+		// after any double step, so anything else is dropped, not rejected.
+		int column = enPassant[0] - 'a';
+		int step = board.nextGo() == White ? 1 : -1;
+		Piece const passer{Pawn, PieceColor(!board.nextGo())};
+		if (board.getAt({column, passedRow - step}) == passer &&
+			board.getAt({column, passedRow}) == EMPTY_SQUARE &&
+			board.getAt({column, passedRow + step}) == EMPTY_SQUARE)
+			board.state.setEnPassantFile(column);
+	}
+
+	PieceColor mover = board.nextGo();
+	board.state.setKingInCheck(mover, board._isKingExposed(mover));
+	// The side that just moved cannot be left in check
+	if (board._isKingExposed(PieceColor(!mover)))
+		return std::nullopt;
+	return board;
+}
+
+std::optional<ChessBoard> parseFen(std::string_view fen)
+{
+	auto board = parsePosition(fen);
+	if (!board)
+		return std::nullopt;
+	// The counters are optional, shortened FEN is common
+	uint halfmoveClock = 0;
+	uint fullmoveNumber = 1;
+	std::string_view halfmove = nextField(fen);
+	std::string_view fullmove = nextField(fen);
+	if ((!halfmove.empty() && !parseNumber(halfmove, halfmoveClock)) ||
+		(!fullmove.empty() && !parseNumber(fullmove, fullmoveNumber)) ||
+		!nextField(fen).empty())
+		return std::nullopt;
+	board->state.setHalfmoveClock(halfmoveClock);
+	return board;
+}
+
+std::optional<EpdRecord> parseEpd(std::string_view line)
+{
+	auto board = parsePosition(line);
+	if (!board)
+		return std::nullopt;
+	EpdRecord record{std::move(*board), {}, {}, {}};
+
+	// FEN counters in place of operations
+	std::string_view rest = line;
+	uint halfmoveClock;
+	if (parseNumber(nextField(rest), halfmoveClock))
+	{
+		record.board.state.setHalfmoveClock(halfmoveClock);
+		nextField(rest);
+		line = rest;
+	}
+
+	while (true)
+	{
+		std::size_t end = line.find(';');
+		std::string_view operation = line.substr(0, end);
+		std::string_view opcode = nextField(operation);
+		if (opcode.empty())
+			break;
+		if (opcode == "id")
+		{
+			std::size_t open = operation.find('"');
+			std::size_t close = operation.rfind('"');
+			record.id = open < close ?
+				operation.substr(open + 1, close - open - 1) : nextField(operation);
+		}
+		else if (opcode == "bm" || opcode == "am")
+		{
+			auto& moves = opcode == "bm" ? record.bestMoves : record.avoidMoves;
+			for (std::string_view san = nextField(operation); !san.empty();
+				 san = nextField(operation))
+			{
+				auto move = decryptMove(record.board, san);
+				if (!move)
+					return std::nullopt;
+				moves.push_back(*move);
+			}
+		}
+		if (end == std::string_view::npos)
+			break;
+		line.remove_prefix(end + 1);
+	}
+	return record;
+}
+
+}
@@ -0,0 +1,49 @@
+#ifndef LUCHESS_CORE_FEN_H_
+#define LUCHESS_CORE_FEN_H_
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "luchess/core/board.h"
+
+/**
+
+Position text.
+
+FEN carries the piece placement, side to move, castling rights, en
+passant square and the two move counters. EPD is the same without the
+counters, followed by ';' terminated operations; of those only the
+"id", "bm" (best moves) and "am" (moves to avoid) opcodes are read,
+the rest are skipped. Lines with full FEN counters are accepted as EPD
+too, so one loader reads both kinds of file.
+
+The fullmove number is not kept by the board, formatFen (format.h)
+always writes 1.
+
+**/
+
+namespace luchess{
+
+static constexpr std::string_view kStartFen =
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Nullopt when 'fen' is malformed or a side does not have exactly one king
+std::optional<ChessBoard> parseFen(std::string_view fen);
+
+struct EpdRecord
+{
+	ChessBoard board;
+	std::string id;
+	std::vector<BoardMove> bestMoves;
+	std::vector<BoardMove> avoidMoves;
+};
+
+// Nullopt when the position is malformed or a bm/am move does not
+// resolve on it
+std::optional<EpdRecord> parseEpd(std::string_view line);
+
+}
+
+#endif // LUCHESS_CORE_FEN_H_
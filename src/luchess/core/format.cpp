@@ -0,0 +1,77 @@
+#include "luchess/core/format.h"
+#include "luchess/core/movegen.h"
+#include "luchess/core/util.h"
+
+namespace luchess{
+
+std::size_t _formatSan(
+	std::span<char, kMaxSanChars> buffer,
+	ChessBoard const& board,
+	BoardMove const& move)
+{
+	char* out = buffer.data();
+	BoardSquare const& originSquare = board.layout[ChessBoard::getIndex(move.originPos)];
+	if (originSquare == EMPTY_SQUARE)
+		return 0;
+	Piece const piece = *originSquare;
+	auto posDiff = move.targetPos - move.originPos;
+
+	if (piece.type == King && abs(posDiff.column) == 2)
+	{
+		out = _copyChars(out, posDiff.column > 0 ? "O-O" : "O-O-O");
+	}
+	else
+	{
+		bool isCapture =
+			board.layout[ChessBoard::getIndex(move.targetPos)] != EMPTY_SQUARE ||
+			(piece.type == Pawn && posDiff.column != 0);
+
+		if (piece.type == Pawn)
+		{
+			if (isCapture)
+				*out++ = squareNames[ChessBoard::getIndex(move.originPos)][0];
+		}
+		else
+		{
+			*out++ = pieceLetters[piece.type];
+
+			// Other pieces of the same kind that could also reach the target
+			bool ambiguous = false, sharesColumn = false, sharesRow = false;
+			for (uint index = 0; index < ChessBoard::boardSize; index++)
+			{
+				BoardPosition pos{int(index % 8), int(index / 8)};
+				if (pos == move.originPos || board.layout[index] != piece ||
+					!board._doesPieceAttack(pos, move.targetPos))
+					continue;
+				ambiguous = true;
+				sharesColumn |= pos.column == move.originPos.column;
+				sharesRow |= pos.row == move.originPos.row;
+			}
+			if (ambiguous && (!sharesColumn || sharesRow))
+				*out++ = squareNames[ChessBoard::getIndex(move.originPos)][0];
+			if (ambiguous && sharesColumn)
+				*out++ = squareNames[ChessBoard::getIndex(move.originPos)][1];
+		}
+
+		if (isCapture)
+			*out++ = 'x';
+		out = formatSquare(out, move.targetPos);
+
+		if (piece.type == Pawn &&
+			(move.targetPos.row == int(kMinRow) || move.targetPos.row == int(kMaxRow)))
+		{
+			*out++ = '=';
+			*out++ = pieceLetters[move.promotion.value_or(Queen)];
+		}
+	}
+
+	// Play the move on a scratch board to see if it gives check or mate
+	ChessBoard after = board;
+	after.makeMove(move);
+	PieceColor const opponent = static_cast<PieceColor>(!piece.color);
+	if (after._isKingExposed(opponent))
+		*out++ = hasLegalMove(after) ? '+' : '#';
+	return out - buffer.data();
+}
+
+}
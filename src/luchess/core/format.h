@@ -0,0 +1,244 @@
+#ifndef LUCHESS_CORE_FORMAT_H_
+#define LUCHESS_CORE_FORMAT_H_
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <utility>
+
+#include "luchess/core/board.h"
+#include "luchess/core/pieces.h"
+#include "luchess/core/types.h"
+
+/**
+
+Allocation free formatters.
+
+Every formatter writes through an output iterator and returns the
+iterator past the last char written, so they work with a caller
+provided buffer:
+
+	char buffer[kMaxUciChars];
+	char* end = formatUci(buffer, move);
+
+or appended to an existing string with std::back_inserter. Buffers of
+the kMax*Chars sizes are always large enough.
+
+Square names match encryptPosition, piece and position text matches
+the operator<< overloads in util.h.
+
+**/
+
+namespace luchess{
+
+static constexpr std::size_t kMaxSquareChars = 2;
+static constexpr std::size_t kMaxUciChars = 5;
+// e.g. "Qh4xe1+" or "exd8=Q+"
+static constexpr std::size_t kMaxSanChars = 8;
+// 8 ranks and the file footer, 18 chars each including the newline
+static constexpr std::size_t kDiagramChars = 9 * 18;
+// Full placement, "w", "KQkq", "e3", a 3 digit clock and "1"
+static constexpr std::size_t kMaxFenChars = 71 + 1 + 1 + 1 + 4 + 1 + 2 + 1 + 3 + 1 + 1;
+
+static constexpr std::array<std::array<char, 2>, 64> squareNames = []{
+	std::array<std::array<char, 2>, 64> names{};
+	for (uint index = 0; index < 64; index++)
+	{
+		names[index] = {
+			static_cast<char>('a' + index % 8),
+			static_cast<char>('1' + index / 8)};
+	}
+	return names;
+}();
+
+// Indexed by PieceType
+static constexpr std::string_view pieceLetters = "PBNRQK";
+static constexpr std::string_view pieceLettersLower = "pbnrqk";
+static constexpr std::array<std::string_view, 6> pieceTypeNames = {
+	"Pawn", "Bishop", "Knight", "Rook", "Queen", "King"};
+static constexpr std::array<std::string_view, 2> pieceColorNames = {
+	"Black", "White"};
+
+template<typename OutputIt>
+OutputIt _copyChars(OutputIt out, std::string_view chars)
+{
+	for (char c : chars)
+		*out++ = c;
+	return out;
+}
+
+template<typename OutputIt>
+OutputIt formatSquare(OutputIt out, uint index)
+{
+	*out++ = squareNames[index][0];
+	*out++ = squareNames[index][1];
+	return out;
+}
+
+template<typename OutputIt>
+OutputIt formatSquare(OutputIt out, BoardPosition const& pos)
+{
+	return formatSquare(out, ChessBoard::getIndex(pos));
+}
+
+template<typename OutputIt>
+OutputIt formatPieceType(OutputIt out, PieceType type)
+{
+	return _copyChars(out, pieceTypeNames[type]);
+}
+
+template<typename OutputIt>
+OutputIt formatPieceColor(OutputIt out, PieceColor color)
+{
+	return _copyChars(out, pieceColorNames[color]);
+}
+
+// "{ c:<column>, r:<row> }"
+template<typename OutputIt>
+OutputIt formatBoardPosition(OutputIt out, BoardPosition const& pos)
+{
+	char digits[12];
+	out = _copyChars(out, "{ c:");
+	out = _copyChars(out, {digits, std::to_chars(
+		digits, digits + sizeof(digits), pos.column).ptr});
+	out = _copyChars(out, ", r:");
+	out = _copyChars(out, {digits, std::to_chars(
+		digits, digits + sizeof(digits), pos.row).ptr});
+	return _copyChars(out, " }");
+}
+
+// Long algebraic move as used by UCI, e.g. "e2e4" or "e7e8q". The
+// promotion letter is only written when the move sets one.
+template<typename OutputIt>
+OutputIt formatUci(OutputIt out, BoardMove const& move)
+{
+	out = formatSquare(out, move.originPos);
+	out = formatSquare(out, move.targetPos);
+	if (move.promotion)
+		*out++ = pieceLettersLower[*move.promotion];
+	return out;
+}
+
+// Space separated UCI moves
+template<typename OutputIt>
+OutputIt formatPv(OutputIt out, std::span<BoardMove const> moves)
+{
+	for (std::size_t i = 0; i < moves.size(); i++)
+	{
+		if (i)
+			*out++ = ' ';
+		out = formatUci(out, moves[i]);
+	}
+	return out;
+}
+
+// Writes the SAN of 'move' played from 'board' into 'buffer' and
+// returns the number of chars written.
+std::size_t _formatSan(
+	std::span<char, kMaxSanChars> buffer,
+	ChessBoard const& board,
+	BoardMove const& move);
+
+// Standard algebraic notation, e.g. "Nxa8", "Bb5+", "Ra8#", "b1=Q" or "O-O".
+// Disambiguation ignores pins.
+template<typename OutputIt>
+OutputIt formatSan(OutputIt out, ChessBoard const& board, BoardMove const& move)
+{
+	std::array<char, kMaxSanChars> buffer;
+	std::size_t length = _formatSan(buffer, board, move);
+	return _copyChars(out, {buffer.data(), length});
+}
+
+// Board diagram with rank 8 at the top, white pieces upper case,
+// black pieces lower case and '.' for empty squares:
+//
+//	8 r n b q k b n r
+//	...
+//	1 R N B Q K B N R
+//	  a b c d e f g h
+template<typename OutputIt>
+OutputIt formatDiagram(OutputIt out, ChessBoard const& board)
+{
+	for (int row = kMaxRow; row >= int(kMinRow); row--)
+	{
+		*out++ = static_cast<char>('1' + row);
+		for (int col = kMinColumn; col <= int(kMaxColumn); col++)
+		{
+			BoardSquare const& square = board.layout[col + 8 * row];
+			*out++ = ' ';
+			if (square == EMPTY_SQUARE)
+				*out++ = '.';
+			else if (square->color == White)
+				*out++ = pieceLetters[square->type];
+			else
+				*out++ = pieceLettersLower[square->type];
+		}
+		*out++ = '\n';
+	}
+	return _copyChars(out, "  a b c d e f g h\n");
+}
+
+// FEN of 'board' (see fen.h), the fullmove number is always 1
+template<typename OutputIt>
+OutputIt formatFen(OutputIt out, ChessBoard const& board)
+{
+	for (int row = kMaxRow; row >= int(kMinRow); row--)
+	{
+		int empty = 0;
+		for (int col = kMinColumn; col <= int(kMaxColumn); col++)
+		{
+			BoardSquare const& square = board.layout[col + 8 * row];
+			if (square == EMPTY_SQUARE)
+			{
+				empty++;
+				continue;
+			}
+			if (empty)
+				*out++ = static_cast<char>('0' + empty);
+			empty = 0;
+			*out++ = square->color == White ?
+				pieceLetters[square->type] : pieceLettersLower[square->type];
+		}
+		if (empty)
+			*out++ = static_cast<char>('0' + empty);
+		if (row)
+			*out++ = '/';
+	}
+
+	GameState const& state = board.state;
+	out = _copyChars(out, state.sideToMove() == White ? " w " : " b ");
+	// Rights in KQkq order, as RookCastleState indexes the corners
+	constexpr std::array<std::pair<uint, char>, 4> rights = {{
+		{2, 'K'}, {0, 'Q'}, {3, 'k'}, {1, 'q'}}};
+	bool anyRight = false;
+	for (auto [index, letter] : rights)
+	{
+		if (state.castleRight(index))
+		{
+			*out++ = letter;
+			anyRight = true;
+		}
+	}
+	if (!anyRight)
+		*out++ = '-';
+	*out++ = ' ';
+	if (state.enPassantFile() == GameState::kNoEnPassant)
+		*out++ = '-';
+	else
+	{
+		*out++ = static_cast<char>('a' + state.enPassantFile());
+		*out++ = state.sideToMove() == White ? '6' : '3';
+	}
+
+	char digits[4];
+	*out++ = ' ';
+	out = _copyChars(out, {digits, std::to_chars(
+		digits, digits + sizeof(digits), state.halfmoveClock()).ptr});
+	return _copyChars(out, " 1");
+}
+
+}
+
+#endif // LUCHESS_CORE_FORMAT_H_
@@ -0,0 +1,395 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "luchess/core/gamelog.h"
+#include "luchess/core/history.h"
+#include "luchess/core/threadpool.h"
+
+namespace luchess{
+
+// ========================Records====================================
+
+// Mixes the 12 bytes before the checksum; an all zero record, as a
+// crash can leave behind, does not check out
+static uint32_t recordChecksum(LogRecord const& record)
+{
+	uint64_t head;
+	std::memcpy(&head, &record, sizeof(head));
+	uint64_t hash = (head ^ 0x9E3779B97F4A7C15ull) * 0xff51afd7ed558ccdull;
+	hash = (hash ^ (hash >> 29) ^ record.data) * 0xc4ceb9fe1a85ec53ull;
+	return uint32_t(hash >> 32);
+}
+
+LogRecord LogRecord::make(LogRecordKind kind, uint32_t game, uint ply, uint32_t data, uint part)
+{
+	LogRecord record{game, uint16_t(ply), kind, uint8_t(part), data, 0};
+	record.checksum = recordChecksum(record);
+	return record;
+}
+
+bool LogRecord::valid() const
+{
+	return checksum == recordChecksum(*this) && kind <= LogRecordKind::Finish;
+}
+
+static constexpr uint kCheckpointRecords = 9;
+
+// Eight Layout records, then the Snapshot that completes them
+static void checkpointRecords(LogRecord* out, uint32_t game, uint ply, ChessBoard const& board)
+{
+	PackedLayout packed = packLayout(board.layout);
+	for (uint part = 0; part < 8; part++)
+	{
+		uint32_t data;
+		std::memcpy(&data, packed.data() + 4 * part, sizeof(data));
+		out[part] = LogRecord::make(LogRecordKind::Layout, game, ply, data, part);
+	}
+	out[8] = LogRecord::make(LogRecordKind::Snapshot, game, ply, board.state.word);
+}
+
+// ========================Writer=====================================
+
+GameLog::GameLog(std::string path, GameLogOptions const& _options) :
+	options(_options)
+{
+	_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (_fd < 0)
+		throw std::system_error(errno, std::generic_category(), "gamelog: cannot open " + path);
+	struct stat status;
+	if (fstat(_fd, &status) == 0 && status.st_size > 0)
+	{
+		std::size_t bytes = std::size_t(status.st_size);
+		void* mapping = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, _fd, 0);
+		if (mapping == MAP_FAILED)
+		{
+			int error = errno;
+			::close(_fd);
+			throw std::system_error(error, std::generic_category(), "gamelog: cannot map " + path);
+		}
+		uint64_t valid = validLogRecords(
+			{static_cast<LogRecord const*>(mapping), bytes / sizeof(LogRecord)});
+		munmap(mapping, bytes);
+		if (valid * sizeof(LogRecord) != bytes &&
+			ftruncate(_fd, off_t(valid * sizeof(LogRecord))) != 0)
+		{
+			int error = errno;
+			::close(_fd);
+			throw std::system_error(error, std::generic_category(), "gamelog: cannot cut " + path);
+		}
+	}
+	lseek(_fd, 0, SEEK_END);
+}
+
+GameLog::~GameLog()
+{
+	try
+	{
+		sync(records());
+	}
+	catch (std::system_error const&)
+	{
+	}
+	::close(_fd);
+}
+
+uint64_t GameLog::_append(std::span<LogRecord const> records)
+{
+	std::lock_guard lock(_mutex);
+	_pending.insert(_pending.end(), records.begin(), records.end());
+	return _appended += records.size();
+}
+
+uint64_t GameLog::startGame(uint32_t game, ChessBoard const& board, uint ply)
+{
+	std::array<LogRecord, kCheckpointRecords> records;
+	checkpointRecords(records.data(), game, ply, board);
+	return _append(records);
+}
+
+uint64_t GameLog::logMove(uint32_t game, uint ply, BoardMove const& move, ChessBoard const& after)
+{
+	std::array<LogRecord, 1 + kCheckpointRecords> records;
+	records[0] = LogRecord::make(LogRecordKind::Move, game, ply, packMove(move));
+	std::size_t count = 1;
+	if (options.checkpointPlies && ply % options.checkpointPlies == 0)
+	{
+		checkpointRecords(records.data() + 1, game, ply, after);
+		count += kCheckpointRecords;
+	}
+	return _append(std::span(records).first(count));
+}
+
+uint64_t GameLog::finishGame(uint32_t game, uint ply)
+{
+	LogRecord record = LogRecord::make(LogRecordKind::Finish, game, ply, 0);
+	return _append({&record, 1});
+}
+
+// 0 or the errno of the failure
+static int writeRecords(int fd, std::vector<LogRecord> const& records, bool sync)
+{
+	auto bytes = reinterpret_cast<char const*>(records.data());
+	std::size_t size = records.size() * sizeof(LogRecord);
+	while (size)
+	{
+		ssize_t written = ::write(fd, bytes, size);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return written < 0 ? errno : EIO;
+		bytes += written;
+		size -= std::size_t(written);
+	}
+	if (sync && fdatasync(fd) != 0)
+		return errno;
+	return 0;
+}
+
+void GameLog::sync(uint64_t sequence)
+{
+	while (_durable.load() < sequence)
+	{
+		if (int error = _error.load())
+			throw std::system_error(error, std::generic_category(), "gamelog: cannot write");
+		// Finished writes are counted after _durable and _flushing are
+		// set, so a write ending after this load ends the wait at once
+		uint32_t flushes = _flushes.load();
+		if (_flushing.exchange(true))
+		{
+			if (_durable.load() < sequence)
+				_flushes.wait(flushes);
+			continue;
+		}
+		// Lead: write whatever every thread has appended so far
+		uint64_t end;
+		{
+			std::lock_guard lock(_mutex);
+			_writing.swap(_pending);
+			end = _appended;
+		}
+		int error = writeRecords(_fd, _writing, options.sync);
+		_writing.clear();
+		if (error)
+			_error = error;
+		else
+		{
+			_durable = end;
+			_syncs++;
+		}
+		_flushing = false;
+		_flushes++;
+		_flushes.notify_all();
+	}
+}
+
+uint64_t GameLog::records() const
+{
+	std::lock_guard lock(_mutex);
+	return _appended;
+}
+
+uint64_t GameLog::syncs() const
+{
+	return _syncs;
+}
+
+// ========================Recovery===================================
+
+uint64_t validLogRecords(std::span<LogRecord const> records, uint threads)
+{
+	if (threads == 0)
+		threads = sharedThreadPool().size();
+	threads = uint(std::clamp<std::size_t>(records.size() >> 16, 1, threads));
+	std::size_t stretch = (records.size() + threads - 1) / threads;
+	std::vector<std::size_t> firstInvalid(threads);
+	auto worker = [&](uint index)
+	{
+		std::size_t end = std::min(records.size(), (index + 1) * stretch);
+		std::size_t i = std::min(end, index * stretch);
+		while (i < end && records[i].valid())
+			i++;
+		firstInvalid[index] = i;
+	};
+	runTasks(sharedThreadPool(), threads, worker);
+	return *std::min_element(firstInvalid.begin(), firstInvalid.end());
+}
+
+namespace{
+
+// What recovery keeps of a game while reading the log
+struct PendingGame
+{
+	// Last complete checkpoint
+	PackedLayout layout{};
+	GameState::Word state = 0;
+	uint16_t ply = 0;
+	// Layout records of a checkpoint not completed yet
+	PackedLayout building{};
+	uint16_t buildingPly = 0;
+	uint8_t buildingParts = 0;
+	bool started = false;
+	bool finished = false;
+	// Packed moves played since the checkpoint
+	std::vector<uint16_t> moves;
+};
+
+void applyRecord(PendingGame& game, LogRecord const& record)
+{
+	switch (record.kind)
+	{
+		case LogRecordKind::Move:
+			if (game.started && !game.finished && record.ply == game.ply + game.moves.size() + 1)
+				game.moves.push_back(uint16_t(record.data));
+			break;
+		case LogRecordKind::Layout:
+			if (record.ply != game.buildingPly || record.part >= 8)
+			{
+				game.buildingPly = record.ply;
+				game.buildingParts = 0;
+			}
+			if (record.part < 8)
+			{
+				std::memcpy(game.building.data() + 4 * record.part, &record.data, sizeof(record.data));
+				game.buildingParts |= uint8_t(1u << record.part);
+			}
+			break;
+		case LogRecordKind::Snapshot:
+			if (record.ply == game.buildingPly && game.buildingParts == 0xff)
+			{
+				game.layout = game.building;
+				game.state = record.data;
+				game.ply = record.ply;
+				game.started = true;
+				game.finished = false;
+				game.moves.clear();
+			}
+			game.buildingParts = 0;
+			break;
+		case LogRecordKind::Finish:
+			game.finished = true;
+			game.moves.clear();
+			break;
+	}
+}
+
+// Plays a move the log accepted, setting the check bits as executeMove
+// would without validating it again. False when it cannot be the mover's.
+bool replayMove(ChessBoard& board, BoardMove const& move)
+{
+	PieceColor mover = board.nextGo();
+	BoardSquare const& origin = board.getAt(move.originPos);
+	if (!origin || origin->color != mover)
+		return false;
+	board.makeMove(move);
+	PieceColor opponent = static_cast<PieceColor>(!mover);
+	board.state.setKingInCheck(mover, false);
+	board.state.setKingInCheck(opponent, board._isKingExposed(opponent));
+	return true;
+}
+
+}
+
+GameLogRecovery recoverGameLog(std::string const& path, uint threads)
+{
+	using Clock = std::chrono::steady_clock;
+	auto start = Clock::now();
+	GameLogRecovery recovery;
+
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0 && errno == ENOENT)
+		return recovery;
+	struct stat status;
+	if (fd < 0 || fstat(fd, &status) != 0)
+	{
+		int error = errno;
+		if (fd >= 0)
+			::close(fd);
+		throw std::system_error(error, std::generic_category(), "gamelog: cannot open " + path);
+	}
+	std::size_t bytes = std::size_t(status.st_size);
+	void* mapping = bytes ? mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+	int error = errno;
+	::close(fd);
+	if (mapping == MAP_FAILED)
+		throw std::system_error(error, std::generic_category(), "gamelog: cannot map " + path);
+	if (!bytes)
+		return recovery;
+	madvise(mapping, bytes, MADV_SEQUENTIAL);
+
+	std::span<LogRecord const> records(static_cast<LogRecord const*>(mapping),
+		bytes / sizeof(LogRecord));
+	if (threads == 0)
+		threads = sharedThreadPool().size();
+	recovery.records = validLogRecords(records, threads);
+	records = records.first(recovery.records);
+
+	// Each thread routes the records of its stretch of the prefix to the
+	// threads their games hash to. Each thread then applies its records
+	// stretch by stretch, which keeps every game's records in log order.
+	std::size_t stretch = (records.size() + threads - 1) / threads;
+	std::vector<std::vector<std::vector<LogRecord>>> routed(threads,
+		std::vector<std::vector<LogRecord>>(threads));
+	auto route = [&](uint index)
+	{
+		std::size_t end = std::min(records.size(), (index + 1) * stretch);
+		std::size_t begin = std::min(end, index * stretch);
+		for (std::vector<LogRecord>& out : routed[index])
+			out.reserve((end - begin) / threads + 1);
+		for (LogRecord const& record : records.subspan(begin, end - begin))
+			routed[index][(uint64_t(record.game * 0x9E3779B1u) * threads) >> 32].push_back(record);
+	};
+	runTasks(sharedThreadPool(), threads, route);
+	munmap(mapping, bytes);
+
+	std::vector<std::vector<RecoveredGame>> recovered(threads);
+	std::vector<uint64_t> replayed(threads);
+	auto worker = [&](uint index)
+	{
+		std::unordered_map<uint32_t, PendingGame> games;
+		for (uint source = 0; source < threads; source++)
+		{
+			for (LogRecord const& record : routed[source][index])
+				applyRecord(games[record.game], record);
+			std::vector<LogRecord>().swap(routed[source][index]);
+		}
+		for (auto& [number, game] : games)
+		{
+			if (!game.started || game.finished)
+				continue;
+			RecoveredGame& out = recovered[index].emplace_back(RecoveredGame{number, game.ply, {}});
+			unpackLayout(game.layout, out.board.layout);
+			out.board.indexPieces();
+			out.board.state.word = game.state;
+			for (uint16_t move : game.moves)
+			{
+				if (!replayMove(out.board, unpackMove(move)))
+					break;
+				out.ply++;
+				replayed[index]++;
+			}
+		}
+	};
+	runTasks(sharedThreadPool(), threads, worker);
+
+	for (uint i = 0; i < threads; i++)
+	{
+		recovery.replayed += replayed[i];
+		std::move(recovered[i].begin(), recovered[i].end(), std::back_inserter(recovery.games));
+	}
+	std::sort(recovery.games.begin(), recovery.games.end(),
+		[](RecoveredGame const& a, RecoveredGame const& b) { return a.game < b.game; });
+	recovery.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+	return recovery;
+}
+
+}
@@ -0,0 +1,157 @@
+#ifndef LUCHESS_CORE_GAMELOG_H_
+#define LUCHESS_CORE_GAMELOG_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "luchess/core/board.h"
+#include "luchess/core/types.h"
+
+/**
+
+Write ahead log of accepted moves, for a server running many games.
+
+The log is a file of 16 byte LogRecords, each with its game, ply and a
+checksum of its own. A move is one record. Every
+GameLogOptions::checkpointPlies plies of a game, and when it starts, the
+position is checkpointed as eight Layout records carrying the packed
+layout four bytes at a time, then a Snapshot record with the state
+word that completes them. A Finish record ends a game.
+
+Appending only copies records into a buffer and returns their sequence
+number. sync waits until the log holds them on disk, with group commit:
+the first waiter to find no write in flight takes the whole buffer,
+writes it and syncs the file once while the others wait, so games on
+any number of threads share each sync. A server acknowledges a move
+once sync returns.
+
+Recovery maps the file and finds its valid prefix, the records before
+the first one failing its checksum, with each pool task checking a
+stretch. Each task then sorts its stretch by the task its games hash
+to, so the prefix is read once. Every task takes its games'
+records in log order, keeps only the last complete checkpoint of each
+game and the moves after it, and replays those moves. A torn tail is dropped,
+along with the unsynced moves in it.
+
+**/
+
+namespace luchess{
+
+enum class LogRecordKind : uint8_t
+{
+	Move,
+	Layout,
+	Snapshot,
+	Finish,
+};
+
+struct LogRecord
+{
+	static LogRecord make(LogRecordKind kind, uint32_t game, uint ply, uint32_t data,
+		uint part = 0);
+
+	bool valid() const;
+
+	uint32_t game;
+	// Plies played in the game, including the move of a Move record
+	uint16_t ply;
+	LogRecordKind kind;
+	// Which four bytes of the layout a Layout record holds
+	uint8_t part;
+	// Move: see packMove. Layout: four bytes of the PackedLayout.
+	// Snapshot: GameState::word.
+	uint32_t data;
+	uint32_t checksum;
+};
+static_assert(sizeof(LogRecord) == 16);
+static_assert(std::is_trivially_copyable_v<LogRecord>);
+
+struct GameLogOptions
+{
+	uint checkpointPlies = 32;
+	// Off only where durability does not matter, e.g. tests
+	bool sync = true;
+};
+
+struct GameLog
+{
+	// Appends to 'path', first cutting off a torn tail left by a crash.
+	// Throws std::system_error when the file cannot be opened.
+	explicit GameLog(std::string path, GameLogOptions const& options = {});
+	GameLog(GameLog const&) = delete;
+	GameLog& operator=(GameLog const&) = delete;
+	// Syncs everything appended
+	~GameLog();
+
+	// Each returns the sequence number to sync on. Safe to call from any
+	// thread, but the records of one game must be appended in order.
+	// 'board' is the game's position at 'ply'.
+	uint64_t startGame(uint32_t game, ChessBoard const& board, uint ply = 0);
+	// 'ply' counts 'move', 'after' is the position it led to
+	uint64_t logMove(uint32_t game, uint ply, BoardMove const& move, ChessBoard const& after);
+	uint64_t finishGame(uint32_t game, uint ply);
+
+	// Returns once every record up to 'sequence' is on disk. Throws
+	// std::system_error when the log cannot be written.
+	void sync(uint64_t sequence);
+
+	// Records appended and syncs of the file made through this log
+	uint64_t records() const;
+	uint64_t syncs() const;
+
+	uint64_t _append(std::span<LogRecord const> records);
+
+	GameLogOptions options;
+	int _fd = -1;
+	// Guards _pending and _appended
+	mutable std::mutex _mutex;
+	std::vector<LogRecord> _pending;
+	std::vector<LogRecord> _writing;
+	uint64_t _appended = 0;
+	std::atomic<uint64_t> _durable = 0;
+	std::atomic<uint64_t> _syncs = 0;
+	// Set by the thread writing _writing
+	std::atomic<bool> _flushing = false;
+	// Counts finished writes, waiters sleep on it
+	std::atomic<uint32_t> _flushes = 0;
+	// errno of a failed write, every later sync throws it
+	std::atomic<int> _error = 0;
+};
+
+struct RecoveredGame
+{
+	uint32_t game;
+	uint ply;
+	ChessBoard board;
+};
+
+struct GameLogRecovery
+{
+	// Games started and not finished, by game number
+	std::vector<RecoveredGame> games;
+	// Records in the valid prefix
+	uint64_t records = 0;
+	// Moves replayed after the checkpoints
+	uint64_t replayed = 0;
+	std::chrono::microseconds elapsed{0};
+};
+
+// Records before the first one failing its checksum, checked in
+// 'threads' tasks on sharedThreadPool() (its size when 0)
+uint64_t validLogRecords(std::span<LogRecord const> records, uint threads = 0);
+
+// Every live game of the log at 'path', see above. An empty recovery
+// when the file does not exist; throws std::system_error when it
+// cannot be mapped.
+GameLogRecovery recoverGameLog(std::string const& path, uint threads = 0);
+
+}
+
+#endif // LUCHESS_CORE_GAMELOG_H_
@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <utility>
+
+#include "luchess/core/history.h"
+#include "luchess/core/chess.h"
+#include "luchess/core/zobrist.h"
+
+namespace luchess{
+
+uint8_t packSquare(BoardSquare const& square)
+{
+	if (square == EMPTY_SQUARE)
+		return 0;
+	return uint8_t(1 + square->type * 2 + square->color);
+}
+
+BoardSquare unpackSquare(uint8_t packed)
+{
+	if (packed == 0)
+		return EMPTY_SQUARE;
+	packed--;
+	return Piece(static_cast<PieceType>(packed / 2), static_cast<PieceColor>(packed % 2));
+}
+
+PackedLayout packLayout(std::array<BoardSquare, ChessBoard::boardSize> const& layout)
+{
+	PackedLayout packed;
+	for (uint i = 0; i < packed.size(); i++)
+		packed[i] = uint8_t(packSquare(layout[2 * i]) | packSquare(layout[2 * i + 1]) << 4);
+	return packed;
+}
+
+void unpackLayout(PackedLayout const& packed,
+	std::array<BoardSquare, ChessBoard::boardSize>& layout)
+{
+	for (uint i = 0; i < packed.size(); i++)
+	{
+		layout[2 * i] = unpackSquare(packed[i] & 0xf);
+		layout[2 * i + 1] = unpackSquare(packed[i] >> 4);
+	}
+}
+
+PlyDelta PlyDelta::encode(BoardMove const& move, ChessBoard::UndoRecord const& undo)
+{
+	return PlyDelta{
+		packMove(move),
+		packSquare(undo.moved),
+		packSquare(undo.captured),
+		undo.state};
+}
+
+BoardMove PlyDelta::move() const
+{
+	return unpackMove(packedMove);
+}
+
+ChessBoard::UndoRecord PlyDelta::undo() const
+{
+	return {unpackSquare(moved), unpackSquare(captured), before};
+}
+
+static void restoreSegment(HistorySegment const& segment, ChessBoard& board)
+{
+	unpackLayout(segment.layout, board.layout);
+	board.indexPieces();
+	board.state = segment.state;
+}
+
+// Replays a recorded ply, leaving the check flags as executeMove does
+static void applyForward(PlyDelta const& delta, ChessBoard& board)
+{
+	PieceColor mover = board.nextGo();
+	board.makeMove(delta.move());
+	PieceColor opponent = static_cast<PieceColor>(!mover);
+	board.state.setKingInCheck(mover, false);
+	board.state.setKingInCheck(opponent, board._isKingExposed(opponent));
+}
+
+// ========================HistorySnapshot============================
+
+BoardMove HistorySnapshot::moveAt(uint ply) const
+{
+	return _segments[ply / kHistorySnapshotPlies]->deltas[ply % kHistorySnapshotPlies].move();
+}
+
+void HistorySnapshot::positionAt(uint ply, ChessBoard& board) const
+{
+	ply = std::min(ply, _plies);
+	HistorySegment const& segment = *_segments[ply / kHistorySnapshotPlies];
+	restoreSegment(segment, board);
+	for (uint i = 0; i < ply % kHistorySnapshotPlies; i++)
+		applyForward(segment.deltas[i], board);
+}
+
+// ========================GameHistory================================
+
+GameHistory::GameHistory()
+{
+	populateDefaultLayout(board);
+	_pushSegment();
+	_keys.push_back(zobristKey(board));
+	repetitions.reset(_keys.back(), board.state.halfmoveClock());
+}
+
+GameHistory::GameHistory(ChessBoard start) :
+	board(std::move(start))
+{
+	_pushSegment();
+	_keys.push_back(zobristKey(board));
+	repetitions.reset(_keys.back(), board.state.halfmoveClock());
+}
+
+ChessBoard::MoveResult GameHistory::play(BoardMove const& move)
+{
+	if (_targetsCurrent() && !_targets.isLegal(move))
+		return {false, board.nextGo(), false, std::nullopt};
+	ChessBoard::UndoRecord undo;
+	auto result = board.executeMove(move, &undo);
+	if (!result.validMove)
+		return result;
+
+	// Branching off an earlier ply drops the plies after it
+	if (_cursor < _plies)
+	{
+		_segments.resize(_cursor / kHistorySnapshotPlies + 1);
+		_writableTail().deltas.resize(_cursor % kHistorySnapshotPlies);
+		_keys.resize(_cursor + 1);
+		_plies = _cursor;
+	}
+
+	_writableTail().deltas.push_back(PlyDelta::encode(move, undo));
+	_keys.push_back(updateZobristKey(_keys.back(), board, move, undo));
+	repetitions.push(_keys.back(), board.state.halfmoveClock());
+	_cursor = ++_plies;
+	if (_plies % kHistorySnapshotPlies == 0)
+		_pushSegment();
+	if (repetitions.isDraw())
+		result.finished = true;
+	return result;
+}
+
+bool GameHistory::undo()
+{
+	if (_cursor == 0)
+		return false;
+	PlyDelta const& delta = _deltaAt(--_cursor);
+	board.unmakeMove(delta.move(), delta.undo());
+	if (!repetitions.pop())
+		_rebuildRepetitions();
+	return true;
+}
+
+bool GameHistory::redo()
+{
+	if (_cursor == _plies)
+		return false;
+	applyForward(_deltaAt(_cursor++), board);
+	repetitions.push(_keys[_cursor], board.state.halfmoveClock());
+	return true;
+}
+
+void GameHistory::seek(uint ply)
+{
+	ply = std::min(ply, _plies);
+	uint segmentStart = ply - ply % kHistorySnapshotPlies;
+	uint stepsFromCursor = ply > _cursor ? ply - _cursor : _cursor - ply;
+	if (stepsFromCursor > ply - segmentStart)
+	{
+		restoreSegment(*_segments[ply / kHistorySnapshotPlies], board);
+		for (_cursor = segmentStart; _cursor < ply;)
+			applyForward(_deltaAt(_cursor++), board);
+		_rebuildRepetitions();
+		return;
+	}
+	while (_cursor < ply)
+		redo();
+	while (_cursor > ply)
+		undo();
+}
+
+LegalTargets const& GameHistory::legalTargets()
+{
+	if (!_targetsCurrent())
+	{
+		_targets = LegalTargets(board);
+		_targetsKey = _keys[_cursor];
+		_targetsPly = _cursor;
+	}
+	return _targets;
+}
+
+bool GameHistory::_targetsCurrent() const
+{
+	return _targetsKey == _keys[_cursor] && _targetsPly == _cursor;
+}
+
+HistorySnapshot GameHistory::snapshot() const
+{
+	HistorySnapshot result;
+	result._segments.assign(_segments.begin(), _segments.end());
+	result._plies = _plies;
+	return result;
+}
+
+PlyDelta const& GameHistory::_deltaAt(uint ply) const
+{
+	return _segments[ply / kHistorySnapshotPlies]->deltas[ply % kHistorySnapshotPlies];
+}
+
+HistorySegment& GameHistory::_writableTail()
+{
+	// Copy on write, a snapshot may still be reading the segment
+	auto& tail = _segments.back();
+	if (tail.use_count() > 1)
+		tail = std::make_shared<HistorySegment>(*tail);
+	return *tail;
+}
+
+// Refills the tracker from the recorded keys, only the plies back to the
+// last capture or pawn move matter
+void GameHistory::_rebuildRepetitions()
+{
+	uint clock = board.state.halfmoveClock();
+	uint start = _cursor - std::min({clock, _cursor, kRepetitionPlies - 1});
+	repetitions.reset(_keys[start], clock - (_cursor - start));
+	for (uint ply = start + 1; ply <= _cursor; ply++)
+		repetitions.push(_keys[ply], clock - (_cursor - ply));
+}
+
+void GameHistory::_pushSegment()
+{
+	auto segment = std::make_shared<HistorySegment>();
+	segment->layout = packLayout(board.layout);
+	segment->state = board.state;
+	segment->deltas.reserve(kHistorySnapshotPlies);
+	_segments.push_back(std::move(segment));
+}
+
+}
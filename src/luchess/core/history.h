@@ -0,0 +1,147 @@
+#ifndef LUCHESS_CORE_HISTORY_H_
+#define LUCHESS_CORE_HISTORY_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "luchess/core/board.h"
+#include "luchess/core/movegen.h"
+#include "luchess/core/repetition.h"
+#include "luchess/core/state.h"
+#include "luchess/core/types.h"
+
+/**
+
+Game history for undo/redo and seeking.
+
+Every ply is stored as an 8 byte delta (the move, the piece that moved,
+the piece it took and the state word before it). Every
+kHistorySnapshotPlies plies the position is also stored, packed to a
+nibble per square, so reaching any ply takes at most
+kHistorySnapshotPlies - 1 delta applications.
+
+Plies are grouped in segments that start at a stored position. Segments
+are shared between a GameHistory and the HistorySnapshots taken from it;
+the history only copies its last segment when it changes one a snapshot
+still holds.
+
+legalTargets() works out the legal moves of the current position on
+first use and keeps them until the position changes, recognised by its
+ply and zobrist key, so play, undo, redo and seek need not clear
+anything. Like the transposition table it trusts the key: two positions
+at the same ply with the same 64 bit key would share targets, and play
+would reject a move that is legal in one of them.
+
+**/
+
+namespace luchess{
+
+static constexpr uint kHistorySnapshotPlies = 32;
+
+// A square packed into 4 bits, 0 when empty
+uint8_t packSquare(BoardSquare const& square);
+BoardSquare unpackSquare(uint8_t packed);
+
+// A layout packed two squares to a byte, the lower index in the low nibble
+using PackedLayout = std::array<uint8_t, ChessBoard::boardSize / 2>;
+PackedLayout packLayout(std::array<BoardSquare, ChessBoard::boardSize> const& layout);
+void unpackLayout(PackedLayout const& packed,
+	std::array<BoardSquare, ChessBoard::boardSize>& layout);
+
+struct PlyDelta
+{
+	static PlyDelta encode(BoardMove const& move, ChessBoard::UndoRecord const& undo);
+
+	BoardMove move() const;
+	ChessBoard::UndoRecord undo() const;
+
+	// See packMove
+	uint16_t packedMove;
+	uint8_t moved;
+	uint8_t captured;
+	GameState before;
+};
+static_assert(sizeof(PlyDelta) == 8);
+
+struct HistorySegment
+{
+	// Position before the segment's first ply
+	PackedLayout layout;
+	GameState state;
+	std::vector<PlyDelta> deltas;
+};
+
+// Read only view of a history at the time it was taken. Cheap to copy
+// and safe to read from any thread while the history moves on.
+struct HistorySnapshot
+{
+	uint plies() const { return _plies; }
+
+	BoardMove moveAt(uint ply) const;
+
+	// Sets 'board' to the position after 'ply' plies
+	void positionAt(uint ply, ChessBoard& board) const;
+
+	std::vector<std::shared_ptr<const HistorySegment>> _segments;
+	uint _plies = 0;
+};
+
+struct GameHistory
+{
+	// Starts from the default layout
+	GameHistory();
+	explicit GameHistory(ChessBoard start);
+
+	// Validates and plays a move at the current ply, dropping any plies
+	// that could have been redone. A threefold repetition or fifty move
+	// draw finishes the game with no winner. Once legalTargets() has run
+	// for the position a move it rules out is rejected without a try.
+	ChessBoard::MoveResult play(BoardMove const& move);
+
+	// Legal moves of the board at the cursor, see above. Writing to the
+	// board other than through this history leaves them stale.
+	LegalTargets const& legalTargets();
+
+	bool undo();
+	bool redo();
+
+	// Moves to any recorded ply, past the end clamps to the last one
+	void seek(uint ply);
+
+	// Ply the board is at
+	uint ply() const { return _cursor; }
+	// Plies recorded, the cursor may be behind after an undo
+	uint plies() const { return _plies; }
+
+	HistorySnapshot snapshot() const;
+
+	ChessBoard board;
+	// Follows the board through play, undo, redo and seek
+	RepetitionTracker repetitions;
+
+	PlyDelta const& _deltaAt(uint ply) const;
+	HistorySegment& _writableTail();
+	void _pushSegment();
+	void _rebuildRepetitions();
+
+	std::vector<std::shared_ptr<HistorySegment>> _segments;
+	// Zobrist key after each ply, the starting position first
+	std::vector<uint64_t> _keys;
+	uint _cursor = 0;
+	uint _plies = 0;
+	// Whether _targets belongs to the board at the cursor
+	bool _targetsCurrent() const;
+
+	LegalTargets _targets;
+	// Zobrist key and ply of the position _targets belongs to
+	std::optional<uint64_t> _targetsKey;
+	uint _targetsPly = 0;
+};
+
+}
+
+#endif // LUCHESS_CORE_HISTORY_H_
@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <vector>
+
+#include "luchess/core/movegen.h"
+#include "luchess/core/threadpool.h"
+#include "luchess/core/util.h"
+
+namespace luchess{
+
+static constexpr std::array<PieceType, 4> promotionTypes = {
+	Queen, Rook, Bishop, Knight};
+
+template <MoveKind kind>
+static void addPawnMove(MoveList& moves, BoardPosition const& from,
+	BoardPosition const& to, bool capture)
+{
+	// Promotions count as noisy along with captures
+	bool promotion = to.row == int(kMinRow) || to.row == int(kMaxRow);
+	if constexpr (kind == MoveKind::Captures)
+	{
+		if (!capture && !promotion)
+			return;
+	}
+	else if constexpr (kind == MoveKind::Quiets)
+	{
+		if (capture || promotion)
+			return;
+	}
+	if (promotion)
+	{
+		for (PieceType type : promotionTypes)
+			moves.push({from, to, type});
+	}
+	else
+	{
+		moves.push({from, to});
+	}
+}
+
+template <MoveKind kind>
+static void generatePawnMoves(ChessBoard const& board, MoveList& moves,
+	BoardPosition const& from, PieceColor color)
+{
+	int direction = color == White ? 1 : -1;
+	int startRow = color == White ? 1 : 6;
+	int enPassantRow = color == White ? 5 : 2;
+
+	BoardPosition oneStep(from.column, from.row + direction);
+	if (board.layout[ChessBoard::getIndex(oneStep)] == EMPTY_SQUARE)
+	{
+		addPawnMove<kind>(moves, from, oneStep, false);
+		BoardPosition twoStep(from.column, from.row + 2 * direction);
+		if (kind != MoveKind::Captures && from.row == startRow &&
+			board.layout[ChessBoard::getIndex(twoStep)] == EMPTY_SQUARE)
+		{
+			moves.push({from, twoStep});
+		}
+	}
+
+	if constexpr (kind == MoveKind::Quiets)
+		return;
+	for (int side : {-1, 1})
+	{
+		BoardPosition to(from.column + side, from.row + direction);
+		if (!ChessBoard::isValidPosition(to))
+			continue;
+		BoardSquare const& target = board.layout[ChessBoard::getIndex(to)];
+		if (target != EMPTY_SQUARE ?
+			target->color != color :
+			to.row == enPassantRow && board.state.enPassantFile() == to.column)
+		{
+			addPawnMove<kind>(moves, from, to, true);
+		}
+	}
+}
+
+template <MoveKind kind>
+static void addPieceMove(MoveList& moves, BoardPosition const& from,
+	BoardPosition const& to, bool capture)
+{
+	if (kind == MoveKind::All || capture == (kind == MoveKind::Captures))
+		moves.push({from, to});
+}
+
+template <MoveKind kind>
+static void generateStepMoves(ChessBoard const& board, MoveList& moves,
+	BoardPosition const& from, PieceColor color,
+	std::array<BoardPosition, 8> const& steps)
+{
+	for (auto const& step : steps)
+	{
+		BoardPosition to = from + step;
+		if (!ChessBoard::isValidPosition(to))
+			continue;
+		BoardSquare const& target = board.layout[ChessBoard::getIndex(to)];
+		if (target == EMPTY_SQUARE)
+			addPieceMove<kind>(moves, from, to, false);
+		else if (target->color != color)
+			addPieceMove<kind>(moves, from, to, true);
+	}
+}
+
+template <MoveKind kind>
+static void generateSlidingMoves(ChessBoard const& board, MoveList& moves,
+	BoardPosition const& from, PieceColor color,
+	uint firstStep, uint lastStep)
+{
+	for (uint dir = firstStep; dir < lastStep; dir++)
+	{
+		BoardPosition const& step = kingSteps[dir];
+		for (BoardPosition to = from + step;
+			 ChessBoard::isValidPosition(to);
+			 to += step)
+		{
+			BoardSquare const& target = board.layout[ChessBoard::getIndex(to)];
+			if (target == EMPTY_SQUARE)
+			{
+				addPieceMove<kind>(moves, from, to, false);
+				continue;
+			}
+			if (target->color != color)
+				addPieceMove<kind>(moves, from, to, true);
+			break;
+		}
+	}
+}
+
+static void generateCastlingMoves(ChessBoard const& board, MoveList& moves,
+	BoardPosition const& from, PieceColor color)
+{
+	int backRow = color == White ? kMinRow : kMaxRow;
+	PieceColor opponent = static_cast<PieceColor>(!color);
+	if (from != BoardPosition(4, backRow) ||
+		board._isSquareExposed(from, opponent))
+		return;
+
+	for (int side : {-1, 1})
+	{
+		BoardPosition rookPos(side > 0 ? kMaxColumn : kMinColumn, backRow);
+		if (!(board.state.castleRights() & ChessBoard::_castleRightsAt(rookPos)) ||
+			board.layout[ChessBoard::getIndex(rookPos)] != Piece(Rook, color))
+			continue;
+		// Squares between king and rook must be empty. Checked here rather
+		// than with doesLineCollide, which counts towards the move
+		// validation stats.
+		bool blocked = false;
+		for (int column = from.column + side; column != rookPos.column; column += side)
+			blocked |= board.layout[ChessBoard::getIndex({column, backRow})] != EMPTY_SQUARE;
+		if (blocked || board._isSquareExposed({from.column + side, backRow}, opponent))
+			continue;
+		moves.push({from, {from.column + 2 * side, backRow}});
+	}
+}
+
+template <MoveKind kind>
+static void generatePieceMoves(ChessBoard const& board, MoveList& moves,
+	BoardPosition const& from, Piece piece)
+{
+	switch (piece.type)
+	{
+		case Pawn:
+			generatePawnMoves<kind>(board, moves, from, piece.color);
+			break;
+		case Knight:
+			generateStepMoves<kind>(board, moves, from, piece.color, knightSteps);
+			break;
+		case Bishop:
+			generateSlidingMoves<kind>(board, moves, from, piece.color, 4, 8);
+			break;
+		case Rook:
+			generateSlidingMoves<kind>(board, moves, from, piece.color, 0, 4);
+			break;
+		case Queen:
+			generateSlidingMoves<kind>(board, moves, from, piece.color, 0, 8);
+			break;
+		case King:
+			generateStepMoves<kind>(board, moves, from, piece.color, kingSteps);
+			if constexpr (kind != MoveKind::Captures)
+				generateCastlingMoves(board, moves, from, piece.color);
+			break;
+	}
+}
+
+template <MoveKind kind>
+static void generateMoves(ChessBoard const& board, MoveList& moves)
+{
+	PieceColor color = board.nextGo();
+	for (uint type = Pawn; type <= King; type++)
+	{
+		Piece const piece(PieceType(type), color);
+		for (uint8_t index : board.pieces.squares(color, piece.type))
+		{
+			generatePieceMoves<kind>(board, moves,
+				BoardPosition(int(index % 8), int(index / 8)), piece);
+		}
+	}
+}
+
+void generatePseudoLegalMoves(ChessBoard const& board, MoveList& moves, MoveKind kind)
+{
+	switch (kind)
+	{
+		case MoveKind::All:
+			generateMoves<MoveKind::All>(board, moves);
+			break;
+		case MoveKind::Captures:
+			generateMoves<MoveKind::Captures>(board, moves);
+			break;
+		case MoveKind::Quiets:
+			generateMoves<MoveKind::Quiets>(board, moves);
+			break;
+	}
+}
+
+bool isPseudoLegalMove(ChessBoard const& board, BoardMove const& move)
+{
+	if (!ChessBoard::isValidPosition(move.originPos) ||
+		!ChessBoard::isValidPosition(move.targetPos))
+		return false;
+	BoardSquare const& square = board.layout[ChessBoard::getIndex(move.originPos)];
+	if (square == EMPTY_SQUARE || square->color != board.nextGo())
+		return false;
+	MoveList moves;
+	generatePieceMoves<MoveKind::All>(board, moves, move.originPos, *square);
+	return std::find(moves.begin(), moves.end(), move) != moves.end();
+}
+
+bool isNoisyMove(ChessBoard const& board, BoardMove const& move)
+{
+	if (board.layout[ChessBoard::getIndex(move.targetPos)] != EMPTY_SQUARE)
+		return true;
+	BoardSquare const& square = board.layout[ChessBoard::getIndex(move.originPos)];
+	if (square == EMPTY_SQUARE || square->type != Pawn)
+		return false;
+	// Promotion or en passant
+	return move.targetPos.row == int(kMinRow) || move.targetPos.row == int(kMaxRow) ||
+		move.targetPos.column != move.originPos.column;
+}
+
+void generateLegalMoves(ChessBoard& board, MoveList& moves)
+{
+	MoveList pseudoLegal;
+	generatePseudoLegalMoves(board, pseudoLegal);
+	PieceColor color = board.nextGo();
+	for (auto const& move : pseudoLegal)
+	{
+		auto undo = board.makeMove(move);
+		if (!board._isKingExposed(color))
+			moves.push(move);
+		board.unmakeMove(move, undo);
+	}
+}
+
+bool hasLegalMove(ChessBoard& board)
+{
+	MoveList pseudoLegal;
+	generatePseudoLegalMoves(board, pseudoLegal);
+	PieceColor color = board.nextGo();
+	for (auto const& move : pseudoLegal)
+	{
+		auto undo = board.makeMove(move);
+		bool legal = !board._isKingExposed(color);
+		board.unmakeMove(move, undo);
+		if (legal)
+			return true;
+	}
+	return false;
+}
+
+LegalTargets::LegalTargets(ChessBoard& board)
+{
+	MoveList moves;
+	generateLegalMoves(board, moves);
+	for (auto const& move : moves)
+	{
+		uint from = ChessBoard::getIndex(move.originPos);
+		uint to = ChessBoard::getIndex(move.targetPos);
+		// The four promotions of a pawn share one target bit
+		if (!(_targets[from] & squareBit(to)))
+			_moves++;
+		_targets[from] |= squareBit(to);
+		_origins |= squareBit(from);
+		if (move.promotion)
+			_promotions |= squareBit(from);
+		else if (abs(move.targetPos.column - move.originPos.column) == 2 &&
+			board.layout[from]->type == King)
+			_castles |= squareBit(from) | squareBit(to);
+	}
+}
+
+bool LegalTargets::isLegal(BoardMove const& move) const
+{
+	if (!ChessBoard::isValidPosition(move.targetPos) ||
+		!(targets(move.originPos) & squareBit(ChessBoard::getIndex(move.targetPos))))
+		return false;
+	if (move.promotion && promotes(move.originPos))
+		return std::find(promotionTypes.begin(), promotionTypes.end(), *move.promotion) !=
+			promotionTypes.end();
+	return true;
+}
+
+bool LegalTargets::castles(BoardMove const& move) const
+{
+	return isLegal(move) &&
+		_castles & squareBit(ChessBoard::getIndex(move.originPos)) &&
+		_castles & squareBit(ChessBoard::getIndex(move.targetPos));
+}
+
+uint64_t perft(ChessBoard& board, uint depth)
+{
+	if (depth == 0)
+		return 1;
+
+	MoveList moves;
+	generateLegalMoves(board, moves);
+	if (depth == 1)
+		return moves.size();
+
+	uint64_t nodes = 0;
+	for (auto const& move : moves)
+	{
+		auto undo = board.makeMove(move);
+		nodes += perft(board, depth - 1);
+		board.unmakeMove(move, undo);
+	}
+	return nodes;
+}
+
+uint64_t perft(ChessBoard const& board, uint depth, ThreadPool& pool)
+{
+	ChessBoard root = board;
+	if (depth <= 2)
+		return perft(root, depth);
+
+	MoveList moves;
+	generateLegalMoves(root, moves);
+	std::vector<uint64_t> nodes(moves.size());
+	{
+		TaskGroup group(pool);
+		for (std::size_t i = 0; i < moves.size(); i++)
+		{
+			group.run([&, i]
+			{
+				ChessBoard child = root;
+				child.makeMove(moves[i]);
+				nodes[i] = perft(child, depth - 1);
+			});
+		}
+		group.wait();
+	}
+	uint64_t total = 0;
+	for (uint64_t count : nodes)
+		total += count;
+	return total;
+}
+
+}
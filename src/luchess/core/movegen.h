@@ -0,0 +1,124 @@
+#ifndef LUCHESS_CORE_MOVEGEN_H_
+#define LUCHESS_CORE_MOVEGEN_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "luchess/core/bitboard.h"
+#include "luchess/core/board.h"
+#include "luchess/core/types.h"
+
+namespace luchess{
+
+struct ThreadPool;
+
+// No legal chess position has more than 218 moves
+static constexpr std::size_t kMaxMoves = 256;
+
+// Fixed capacity move list, lives on the stack
+struct MoveList
+{
+	void push(BoardMove const& move)
+	{
+		moves[count++] = move;
+	}
+
+	BoardMove* begin() { return moves.data(); }
+	BoardMove* end() { return moves.data() + count; }
+	BoardMove const* begin() const { return moves.data(); }
+	BoardMove const* end() const { return moves.data() + count; }
+
+	std::size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	void clear() { count = 0; }
+
+	BoardMove& operator[](std::size_t i) { return moves[i]; }
+	BoardMove const& operator[](std::size_t i) const { return moves[i]; }
+
+	std::array<BoardMove, kMaxMoves> moves;
+	uint count = 0;
+};
+
+enum class MoveKind : uint
+{
+	All,
+	// Captures, en passant and promotions
+	Captures,
+	// Everything else, castling included
+	Quiets,
+};
+
+// Every move of 'kind' the side to move can make ignoring whether it
+// leaves its own king in check. Castling is only generated when the king
+// does not start in or pass through check.
+void generatePseudoLegalMoves(ChessBoard const& board, MoveList& moves,
+	MoveKind kind = MoveKind::All);
+
+// Whether 'move' is one generatePseudoLegalMoves would produce, for moves
+// that come from somewhere other than the generator
+bool isPseudoLegalMove(ChessBoard const& board, BoardMove const& move);
+
+// Whether a pseudo legal move is in MoveKind::Captures
+bool isNoisyMove(ChessBoard const& board, BoardMove const& move);
+
+// Pseudo legal moves filtered with makeMove/unmakeMove, the board is
+// left as it was.
+void generateLegalMoves(ChessBoard& board, MoveList& moves);
+
+// Stops at the first legal move found
+bool hasLegalMove(ChessBoard& board);
+
+// Legal moves of a position as a mask of target squares per origin
+// square, for clients that ask about single moves: highlighting where a
+// piece can go or checking a dragged move costs a lookup instead of a
+// speculative executeMove.
+struct LegalTargets
+{
+	LegalTargets() = default;
+	// The board is left as it was
+	explicit LegalTargets(ChessBoard& board);
+
+	Bitboard targets(BoardPosition const& from) const
+	{
+		return ChessBoard::isValidPosition(from) ? _targets[ChessBoard::getIndex(from)] : 0;
+	}
+
+	// Squares holding a piece that can move
+	Bitboard origins() const { return _origins; }
+
+	// Whether executeMove would accept 'move'. A promotion, when set on
+	// a move that promotes, must be a queen, rook, bishop or knight.
+	bool isLegal(BoardMove const& move) const;
+
+	// Whether the moves from 'from' are promotions and need a piece
+	bool promotes(BoardPosition const& from) const
+	{
+		return ChessBoard::isValidPosition(from) &&
+			_promotions & squareBit(ChessBoard::getIndex(from));
+	}
+
+	// Whether a legal 'move' castles
+	bool castles(BoardMove const& move) const;
+
+	// Origin and target pairs, the four promotions of a pawn move count
+	// once
+	uint size() const { return _moves; }
+
+	std::array<Bitboard, ChessBoard::boardSize> _targets{};
+	Bitboard _origins = 0;
+	// Origins whose moves promote
+	Bitboard _promotions = 0;
+	// King origin and targets of the castling moves
+	Bitboard _castles = 0;
+	uint _moves = 0;
+};
+
+// Counts the leaf nodes of the legal move tree 'depth' plies deep
+uint64_t perft(ChessBoard& board, uint depth);
+// The same count with the subtree of each root move a task on 'pool'
+uint64_t perft(ChessBoard const& board, uint depth, ThreadPool& pool);
+
+}
+
+#endif // LUCHESS_CORE_MOVEGEN_H_
@@ -0,0 +1,172 @@
+#include <utility>
+
+#include "luchess/core/movepick.h"
+#include "luchess/core/eval.h"
+#include "luchess/core/see.h"
+
+namespace luchess{
+
+// Keeps scores well inside int, halving every entry ages old cut-offs
+static constexpr int kMaxHistory = 1 << 20;
+
+void HistoryTable::reward(Piece piece, BoardPosition const& to, uint depth)
+{
+	int& entry = table[piece.type * 2 + piece.color][ChessBoard::getIndex(to)];
+	entry += int(depth * depth);
+	if (entry < kMaxHistory)
+		return;
+	for (auto& squares : table)
+		for (int& score : squares)
+			score /= 2;
+}
+
+MovePicker::MovePicker(ChessBoard const& _board, std::optional<BoardMove> _hashMove,
+	KillerMoves _killers, HistoryTable const& _history) :
+	board(_board),
+	hashMove(_hashMove),
+	killers(_killers),
+	history(_history),
+	stage(Stage::HashMove)
+{
+	if (hashMove && !isPseudoLegalMove(board, *hashMove))
+		hashMove = std::nullopt;
+}
+
+static constexpr HistoryTable noHistory{};
+
+MovePicker::MovePicker(ChessBoard const& _board) :
+	board(_board),
+	history(noHistory),
+	capturesOnly(true),
+	stage(Stage::GenerateCaptures)
+{
+}
+
+bool MovePicker::_losesMaterial(BoardMove const& move) const
+{
+	// Taking something worth at least the capturing piece never loses
+	BoardSquare const& victim = board.layout[ChessBoard::getIndex(move.targetPos)];
+	Piece attacker = *board.layout[ChessBoard::getIndex(move.originPos)];
+	if (victim != EMPTY_SQUARE && pieceValues[victim->type] >= pieceValues[attacker.type] &&
+		attacker.type != King)
+		return false;
+	return see(board, bitboards, move) < 0;
+}
+
+BoardMove const& MovePicker::_selectBest()
+{
+	uint best = picked;
+	for (uint i = picked + 1; i < moves.size(); i++)
+	{
+		if (scores[i] > scores[best])
+			best = i;
+	}
+	std::swap(moves[picked], moves[best]);
+	std::swap(scores[picked], scores[best]);
+	return moves[picked++];
+}
+
+std::optional<BoardMove> MovePicker::next()
+{
+	switch (stage)
+	{
+		case Stage::HashMove:
+			stage = Stage::GenerateCaptures;
+			if (hashMove)
+				return hashMove;
+			[[fallthrough]];
+
+		case Stage::GenerateCaptures:
+			moves.clear();
+			picked = 0;
+			bitboards = BoardBitboards(board);
+			generatePseudoLegalMoves(board, moves, MoveKind::Captures);
+			for (uint i = 0; i < moves.size(); i++)
+			{
+				// Most valuable victim first, least valuable attacker breaks ties
+				BoardMove const& move = moves[i];
+				BoardSquare const& victim = board.layout[ChessBoard::getIndex(move.targetPos)];
+				int gain = victim == EMPTY_SQUARE ?
+					(move.promotion ? 0 : pieceValues[Pawn]) : pieceValues[victim->type];
+				if (move.promotion)
+					gain += pieceValues[*move.promotion] - pieceValues[Pawn];
+				Piece attacker = *board.layout[ChessBoard::getIndex(move.originPos)];
+				scores[i] = gain * 16 - pieceValues[attacker.type] / 10;
+			}
+			stage = Stage::Captures;
+			[[fallthrough]];
+
+		case Stage::Captures:
+			while (picked < moves.size())
+			{
+				BoardMove const& move = _selectBest();
+				if (move == hashMove)
+					continue;
+				if (!_losesMaterial(move))
+					return move;
+				badCaptures[badCaptureCount++] = packMove(move);
+			}
+			if (capturesOnly)
+			{
+				stage = Stage::Done;
+				break;
+			}
+			stage = Stage::Killers;
+			picked = 0;
+			[[fallthrough]];
+
+		case Stage::Killers:
+			// Killers come from sibling nodes, so only those that are
+			// quiet moves of this position are tried
+			while (picked < killers.size())
+			{
+				uint16_t packed = killers[picked++];
+				if (!packed)
+					continue;
+				BoardMove move = unpackMove(packed);
+				if (move != hashMove && isPseudoLegalMove(board, move) &&
+					!isNoisyMove(board, move))
+					return move;
+			}
+			stage = Stage::GenerateQuiets;
+			[[fallthrough]];
+
+		case Stage::GenerateQuiets:
+			moves.clear();
+			picked = 0;
+			generatePseudoLegalMoves(board, moves, MoveKind::Quiets);
+			for (uint i = 0; i < moves.size(); i++)
+			{
+				BoardMove const& move = moves[i];
+				scores[i] = history.score(*board.layout[ChessBoard::getIndex(move.originPos)],
+					move.targetPos);
+			}
+			stage = Stage::Quiets;
+			[[fallthrough]];
+
+		case Stage::Quiets:
+			while (picked < moves.size())
+			{
+				// Killers in the list were handed out by their own stage
+				BoardMove const& move = _selectBest();
+				uint16_t packed = packMove(move);
+				if (move != hashMove && packed != killers[0] && packed != killers[1])
+					return move;
+			}
+			stage = Stage::BadCaptures;
+			picked = 0;
+			[[fallthrough]];
+
+		case Stage::BadCaptures:
+			if (picked < badCaptureCount)
+				return unpackMove(badCaptures[picked++]);
+			stage = Stage::Done;
+			[[fallthrough]];
+
+		case Stage::Done:
+			break;
+	}
+	return std::nullopt;
+}
+
+}
@@ -0,0 +1,123 @@
+#ifndef LUCHESS_CORE_MOVEPICK_H_
+#define LUCHESS_CORE_MOVEPICK_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+
+#include "luchess/core/bitboard.h"
+#include "luchess/core/board.h"
+#include "luchess/core/movegen.h"
+#include "luchess/core/types.h"
+
+/**
+
+Staged move ordering for search.
+
+MovePicker hands out pseudo legal moves one at a time: the hash move,
+then captures and promotions by MVV-LVA, then the killer moves that are
+quiet and playable here, then the remaining quiet moves by history
+score, and last the captures static exchange evaluation says lose
+material. Each stage is only generated once the previous one runs dry,
+so a node that cuts off on the hash move, a capture or a killer never
+generates its quiet moves. Moves are picked by
+selection as they are asked for and nothing is allocated.
+
+Quiescence search uses the captures only picker, which drops losing
+captures altogether.
+
+**/
+
+namespace luchess{
+
+// Two quiet moves per ply that recently caused a cut-off, packed, zero
+// when unset
+using KillerMoves = std::array<uint16_t, 2>;
+
+// Quiet move scores by piece and target square, raised whenever the
+// move causes a cut-off
+struct HistoryTable
+{
+	int score(Piece piece, BoardPosition const& to) const
+	{
+		return table[piece.type * 2 + piece.color][ChessBoard::getIndex(to)];
+	}
+
+	void reward(Piece piece, BoardPosition const& to, uint depth);
+
+	std::array<std::array<int, ChessBoard::boardSize>, 12> table{};
+};
+
+struct MovePicker
+{
+	enum class Stage : uint
+	{
+		HashMove,
+		GenerateCaptures,
+		Captures,
+		Killers,
+		GenerateQuiets,
+		Quiets,
+		BadCaptures,
+		Done,
+	};
+
+	MovePicker(ChessBoard const& board, std::optional<BoardMove> hashMove,
+		KillerMoves killers, HistoryTable const& history);
+
+	// Winning and even captures and promotions only
+	explicit MovePicker(ChessBoard const& board);
+
+	// Next pseudo legal move, nullopt once every stage is done
+	std::optional<BoardMove> next();
+
+	struct Iterator
+	{
+		using value_type = BoardMove;
+		using difference_type = std::ptrdiff_t;
+
+		BoardMove const& operator*() const { return *current; }
+		Iterator& operator++()
+		{
+			current = picker->next();
+			return *this;
+		}
+		void operator++(int) { ++*this; }
+		bool operator==(std::default_sentinel_t) const { return !current; }
+
+		MovePicker* picker;
+		std::optional<BoardMove> current;
+	};
+
+	Iterator begin() { return {this, next()}; }
+	std::default_sentinel_t end() const { return {}; }
+
+	// Swaps the best scored remaining move to the front and takes it
+	BoardMove const& _selectBest();
+
+	// Whether a capture can lose material, only then is it exchanged out
+	bool _losesMaterial(BoardMove const& move) const;
+
+	ChessBoard const& board;
+	std::optional<BoardMove> hashMove;
+	// Copied, the caller's slot is updated while the picker is in use
+	KillerMoves killers{};
+	HistoryTable const& history;
+	bool capturesOnly = false;
+
+	Stage stage;
+	MoveList moves;
+	std::array<int, kMaxMoves> scores;
+	uint picked = 0;
+	// Built when captures are generated
+	BoardBitboards bitboards;
+	// Packed losing captures held back until after the quiet moves
+	std::array<uint16_t, kMaxMoves> badCaptures;
+	uint badCaptureCount = 0;
+};
+
+}
+
+#endif // LUCHESS_CORE_MOVEPICK_H_
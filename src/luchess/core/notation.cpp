@@ -1,4 +1,6 @@
 #include "luchess/core/notation.h"
+#include "luchess/core/format.h"
+#include "luchess/core/movegen.h"
 
 namespace luchess{
 
@@ -6,10 +8,11 @@ static const int asciiLowerCaseOffset = 97;
 static const int asciiDecimalOffset = 49;
 
 const char* chessNotationRegexStr = 
-	"([KQRNB]{0,1})([a-h]|[1-8]){0,1}(x{0,1})([a-h][1-8]){0,1}"
+	"(O-O-O|O-O|([KQRNB]{0,1})([a-h]|[1-8]){0,1}(x{0,1})([a-h][1-8]){0,1}(=[QRNB]){0,1})"
 	"(\\+){0,1}"
 	"( ){0,1}"
-	"([KQRNB]{0,1})([a-h]|[1-8]){0,1}(x{0,1})([a-h][1-8]){0,1}"
+	"(1-0|0-1|1/2-1/2|"
+	"O-O-O|O-O|([KQRNB]{0,1})([a-h]|[1-8]){0,1}(x{0,1})([a-h][1-8]){0,1}(=[QRNB]){0,1})"
 	"(\\+){0,1}";
 
 
@@ -52,7 +55,7 @@ char rowToRank(const int& row)
 
 uint decryptPosition(std::string_view position)
 {
-	if(position.length() == 3) // 3 including null termination
+	if(position.length() != 2)
 		throw std::invalid_argument(
 			"decryptPosition invalid argument: 'position' must be two chars long.");
 	int column = fileToColumn(position[0]);
@@ -65,9 +68,7 @@ std::string encryptPosition(uint index)
 	if(63 < index)
 		throw std::invalid_argument(
 			"encryptPosition invalid argument: 'index' must be 64 or less.");
-	int column = index % 8; 
-	int row = std::floor<int>((float)index / 8.f);
-	return {columnToFile(column), rowToRank(row)};
+	return {squareNames[index][0], squareNames[index][1]};
 }
 
 std::smatch isNotationValid(std::string const& move)
@@ -85,4 +86,119 @@ std::smatch isNotationValid(std::string const& move)
     return match;
 }
 
+static std::optional<PieceType> letterToPieceType(char letter)
+{
+	auto index = pieceLetters.find(letter);
+	if (index == std::string_view::npos)
+		return std::nullopt;
+	return static_cast<PieceType>(index);
+}
+
+// Splits the non castling part of a SAN move into its fields
+static bool _parseSanSquares(
+	std::string_view move,
+	PieceType& type,
+	BoardPosition& targetPos,
+	std::optional<PieceType>& promotion,
+	int& originColumn,
+	int& originRow)
+{
+	if (move.size() >= 2 && move[move.size() - 2] == '=')
+	{
+		promotion = letterToPieceType(move.back());
+		if (!promotion || *promotion == Pawn || *promotion == King)
+			return false;
+		move.remove_suffix(2);
+	}
+
+	if (move.size() < 2 ||
+		move[move.size() - 2] < 'a' || 'h' < move[move.size() - 2] ||
+		move.back() < '1' || '8' < move.back())
+		return false;
+	targetPos = {
+		move[move.size() - 2] - asciiLowerCaseOffset,
+		move.back() - asciiDecimalOffset};
+	move.remove_suffix(2);
+
+	if (!move.empty() && 'A' <= move.front() && move.front() <= 'Z')
+	{
+		auto letterType = letterToPieceType(move.front());
+		if (!letterType || *letterType == Pawn)
+			return false;
+		type = *letterType;
+		move.remove_prefix(1);
+	}
+
+	// Whatever is left is disambiguation and the capture marker
+	for (char c : move)
+	{
+		if ('a' <= c && c <= 'h')
+			originColumn = c - asciiLowerCaseOffset;
+		else if ('1' <= c && c <= '8')
+			originRow = c - asciiDecimalOffset;
+		else if (c != 'x')
+			return false;
+	}
+	return true;
+}
+
+std::optional<BoardMove> decryptMove(ChessBoard& board, std::string_view move)
+{
+	while (!move.empty() && std::string_view("+#!?").find(move.back()) != std::string_view::npos)
+		move.remove_suffix(1);
+
+	PieceType type = Pawn;
+	BoardPosition targetPos;
+	std::optional<PieceType> promotion;
+	int originColumn = -1;
+	int originRow = -1;
+
+	int backRow = board.nextGo() == White ? kMinRow : kMaxRow;
+	bool kingSide = move == "O-O" || move == "0-0";
+	bool queenSide = move == "O-O-O" || move == "0-0-0";
+	if (kingSide || queenSide)
+	{
+		type = King;
+		targetPos = {kingSide ? 6 : 2, backRow};
+		originColumn = 4;
+	}
+	else if (!_parseSanSquares(move, type, targetPos, promotion, originColumn, originRow))
+	{
+		return std::nullopt;
+	}
+
+	MoveList legalMoves;
+	generateLegalMoves(board, legalMoves);
+	std::optional<BoardMove> match;
+	for (auto const& legalMove : legalMoves)
+	{
+		if (legalMove.targetPos != targetPos ||
+			board.layout[ChessBoard::getIndex(legalMove.originPos)]->type != type ||
+			(originColumn >= 0 && legalMove.originPos.column != originColumn) ||
+			(originRow >= 0 && legalMove.originPos.row != originRow) ||
+			(legalMove.promotion && legalMove.promotion != promotion.value_or(Queen)) ||
+			// A promotion suffix only fits a pawn reaching the last rank
+			(promotion && !legalMove.promotion))
+			continue;
+		if (match)
+			return std::nullopt;
+		match = legalMove;
+	}
+	return match;
+}
+
+std::optional<BoardMove> parseUciMove(ChessBoard& board, std::string_view move)
+{
+	MoveList legalMoves;
+	generateLegalMoves(board, legalMoves);
+	for (auto const& legalMove : legalMoves)
+	{
+		std::array<char, kMaxUciChars> text;
+		char* end = formatUci(text.data(), legalMove);
+		if (std::string_view(text.data(), end) == move)
+			return legalMove;
+	}
+	return std::nullopt;
+}
+
 }
@@ -1,22 +1,18 @@
 #ifndef LUCHESS_CORE_NOTATION_H_
 #define LUCHESS_CORE_NOTATION_H_
 
+#include <optional>
 #include <stdexcept>
 #include <regex>
+#include <string>
+#include <string_view>
 
+#include "luchess/core/board.h"
 #include "luchess/core/types.h"
 
 namespace luchess{
 
-static const int asciiLowerCaseOffset = 97;
-static const int asciiDecimalOffset = 49;
-
-const char* chessNotationRegexStr = 
-	"([KQRNB]{0,1})([a-h]|[1-8]){0,1}(x{0,1})([a-h][1-8]){0,1}"
-	"(\\+){0,1}"
-	"( ){0,1}"
-	"([KQRNB]{0,1})([a-h]|[1-8]){0,1}(x{0,1})([a-h][1-8]){0,1}"
-	"(\\+){0,1}";
+extern const char* chessNotationRegexStr;
 
 
 int fileToColumn(const char& file);
@@ -34,6 +30,15 @@ std::string encryptPosition(uint index);
 
 std::smatch isNotationValid(std::string const& move);
 
+// Resolves a single SAN move ("e4", "Nde2", "bxa1=N+", "O-O") against
+// the legal moves of 'board'. Returns nullopt when the move is
+// malformed, illegal or ambiguous.
+std::optional<BoardMove> decryptMove(ChessBoard& board, std::string_view move);
+
+// Resolves a long algebraic UCI move ("e2e4", "e1g1", "e7e8q") against
+// the legal moves of 'board', nullopt when it is not one of them
+std::optional<BoardMove> parseUciMove(ChessBoard& board, std::string_view move);
+
 }
 
 #endif // LUCHESS_CORE_NOTATION_H_
\ No newline at end of file
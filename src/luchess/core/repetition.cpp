@@ -0,0 +1,83 @@
+#include "luchess/core/repetition.h"
+
+namespace luchess{
+
+static constexpr uint kCountMask = 2 * kRepetitionPlies - 1;
+
+static uint countSlot(uint64_t key, uint windowStart)
+{
+	return uint(key ^ (key >> 32) ^ (windowStart * 0x9e3779b9u)) & kCountMask;
+}
+
+void RepetitionTracker::reset(uint64_t key, uint halfmoveClock)
+{
+	_counts.fill({});
+	_ply = 0;
+	_size = 1;
+	_ring[0] = {key, 0, halfmoveClock, _add(key, 0)};
+}
+
+void RepetitionTracker::push(uint64_t key, uint halfmoveClock)
+{
+	uint windowStart = halfmoveClock == 0 ?
+		_ply + 1 : _ring[_ply % kRepetitionPlies].windowStart;
+	_ply++;
+
+	_Entry& entry = _ring[_ply % kRepetitionPlies];
+	if (_size == kRepetitionPlies)
+		_remove(entry.key, entry.windowStart);
+	else
+		_size++;
+	entry = {key, windowStart, halfmoveClock, _add(key, windowStart)};
+}
+
+bool RepetitionTracker::pop()
+{
+	if (_size <= 1)
+		return false;
+	_Entry const& entry = _ring[_ply % kRepetitionPlies];
+	_remove(entry.key, entry.windowStart);
+	_ply--;
+	_size--;
+	return true;
+}
+
+uint RepetitionTracker::_find(uint64_t key, uint windowStart) const
+{
+	uint slot = countSlot(key, windowStart);
+	while (_counts[slot].count &&
+		(_counts[slot].key != key || _counts[slot].windowStart != windowStart))
+	{
+		slot = (slot + 1) & kCountMask;
+	}
+	return slot;
+}
+
+uint RepetitionTracker::_add(uint64_t key, uint windowStart)
+{
+	_Count& slot = _counts[_find(key, windowStart)];
+	slot.key = key;
+	slot.windowStart = windowStart;
+	return ++slot.count;
+}
+
+void RepetitionTracker::_remove(uint64_t key, uint windowStart)
+{
+	uint slot = _find(key, windowStart);
+	if (!_counts[slot].count || --_counts[slot].count)
+		return;
+
+	// Backward shift so probe chains stay unbroken without tombstones
+	for (uint next = (slot + 1) & kCountMask; _counts[next].count; next = (next + 1) & kCountMask)
+	{
+		uint home = countSlot(_counts[next].key, _counts[next].windowStart);
+		if (((next - home) & kCountMask) >= ((next - slot) & kCountMask))
+		{
+			_counts[slot] = _counts[next];
+			_counts[next].count = 0;
+			slot = next;
+		}
+	}
+}
+
+}
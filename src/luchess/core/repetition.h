@@ -0,0 +1,77 @@
+#ifndef LUCHESS_CORE_REPETITION_H_
+#define LUCHESS_CORE_REPETITION_H_
+
+#include <array>
+#include <cstdint>
+
+#include "luchess/core/types.h"
+
+/**
+
+Threefold repetition and fifty move rule.
+
+A position can only repeat back to the last capture or pawn move, so the
+tracker keeps a ring of the latest keys tagged with the ply that window
+started at, plus a small open addressing table counting each (key,
+window) pair. push and pop are constant time and so is asking whether
+the current position is drawn, which makes it usable from search as
+well as for live games.
+
+The ring holds kRepetitionPlies plies. Older positions are more than
+kFiftyMovePlies back, so by then the fifty move rule has already drawn
+the game.
+
+**/
+
+namespace luchess{
+
+static constexpr uint kFiftyMovePlies = 100;
+static constexpr uint kRepetitionPlies = 128;
+
+struct RepetitionTracker
+{
+	// Starts a game at the position 'key'
+	void reset(uint64_t key, uint halfmoveClock = 0);
+
+	// Adds the position reached by a move, a zero clock starts a window
+	void push(uint64_t key, uint halfmoveClock);
+
+	// Takes back the last push. False when the ring no longer holds the
+	// position before it, the tracker must then be reset.
+	bool pop();
+
+	// Times the current position has occurred, itself included
+	uint repetitions() const { return _ring[_ply % kRepetitionPlies].repetitions; }
+
+	bool isThreefold() const { return repetitions() >= 3; }
+	bool isFiftyMoveDraw() const { return _ring[_ply % kRepetitionPlies].halfmoveClock >= kFiftyMovePlies; }
+	bool isDraw() const { return isThreefold() || isFiftyMoveDraw(); }
+
+	struct _Entry
+	{
+		uint64_t key;
+		uint windowStart;
+		uint halfmoveClock;
+		uint repetitions;
+	};
+
+	struct _Count
+	{
+		uint64_t key;
+		uint windowStart;
+		uint count;
+	};
+
+	uint _add(uint64_t key, uint windowStart);
+	void _remove(uint64_t key, uint windowStart);
+	uint _find(uint64_t key, uint windowStart) const;
+
+	std::array<_Entry, kRepetitionPlies> _ring{};
+	std::array<_Count, 2 * kRepetitionPlies> _counts{};
+	uint _ply = 0;
+	uint _size = 0;
+};
+
+}
+
+#endif // LUCHESS_CORE_REPETITION_H_
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <optional>
+
+#include "luchess/core/replay.h"
+#include "luchess/core/chess.h"
+#include "luchess/core/movegen.h"
+#include "luchess/core/notation.h"
+#include "luchess/core/threadpool.h"
+#include "luchess/core/zobrist.h"
+
+namespace luchess{
+
+static std::optional<GameResult> resultToken(std::string_view token)
+{
+	if (token == "1-0")
+		return GameResult::WhiteWins;
+	if (token == "0-1")
+		return GameResult::BlackWins;
+	if (token == "1/2-1/2")
+		return GameResult::Draw;
+	if (token == "*")
+		return GameResult::Unknown;
+	return std::nullopt;
+}
+
+// Strips a leading move number, "12.e4" -> "e4" and "12..." -> ""
+static std::string_view stripMoveNumber(std::string_view token)
+{
+	std::size_t digits = 0;
+	while (digits < token.size() && '0' <= token[digits] && token[digits] <= '9')
+		digits++;
+	if (digits == 0 || digits == token.size() || token[digits] != '.')
+		return token;
+	token.remove_prefix(digits);
+	while (!token.empty() && token.front() == '.')
+		token.remove_prefix(1);
+	return token;
+}
+
+ReplayResult GameReplayer::replay(std::string_view moves)
+{
+	ChessBoard& board = this->board;
+	populateDefaultLayout(board);
+
+	ReplayResult result;
+	std::optional<GameResult> declared;
+	uint64_t key = zobristKey(board);
+	repetitions.reset(key);
+
+	std::size_t pos = 0;
+	while (pos < moves.size())
+	{
+		pos = moves.find_first_not_of(" \t\r\n", pos);
+		if (pos == std::string_view::npos)
+			break;
+		std::size_t end = moves.find_first_of(" \t\r\n", pos);
+		if (end == std::string_view::npos)
+			end = moves.size();
+		std::string_view token = moves.substr(pos, end - pos);
+		pos = end;
+
+		if ((declared = resultToken(token)))
+			break;
+		token = stripMoveNumber(token);
+		if (token.empty())
+			continue;
+
+		auto move = decryptMove(board, token);
+		if (!move)
+		{
+			result.illegalPly = result.plies;
+			break;
+		}
+		auto undo = board.makeMove(*move);
+		key = updateZobristKey(key, board, *move, undo);
+		repetitions.push(key, board.state.halfmoveClock());
+		result.plies++;
+	}
+
+	PieceColor side = board.nextGo();
+	bool inCheck = board._isKingExposed(side);
+	board.state.setKingInCheck(side, inCheck);
+	if (declared)
+	{
+		result.result = *declared;
+	}
+	else if (!result.illegalPly && !hasLegalMove(board))
+	{
+		result.result = !inCheck ? GameResult::Draw :
+			side == White ? GameResult::BlackWins : GameResult::WhiteWins;
+	}
+	else if (!result.illegalPly && repetitions.isDraw())
+	{
+		result.result = GameResult::Draw;
+	}
+	result.finalState = board.state;
+	result.finalLayout = board.layout;
+	return result;
+}
+
+std::vector<ReplayResult> replayGames(
+	std::span<std::string_view const> games, uint threads)
+{
+	std::vector<ReplayResult> results(games.size());
+	if (threads == 1 || games.size() <= 1)
+	{
+		GameReplayer replayer;
+		for (std::size_t game = 0; game < games.size(); game++)
+			results[game] = replayer.replay(games[game]);
+		return results;
+	}
+
+	std::optional<ThreadPool> local;
+	if (threads)
+		local.emplace(ThreadPoolOptions{.threads = threads});
+	ThreadPool& pool = local ? *local : sharedThreadPool();
+	// Stretches of games short enough to balance, long enough that one
+	// GameReplayer serves many
+	std::size_t stretch = std::clamp<std::size_t>(games.size() / (8 * pool.size()), 1, 256);
+	TaskGroup group(pool);
+	for (std::size_t first = 0; first < games.size(); first += stretch)
+	{
+		group.run([&, first]
+		{
+			GameReplayer replayer;
+			for (std::size_t game = first; game < std::min(games.size(), first + stretch); game++)
+				results[game] = replayer.replay(games[game]);
+		});
+	}
+	group.wait();
+	return results;
+}
+
+}
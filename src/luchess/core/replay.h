@@ -0,0 +1,66 @@
+#ifndef LUCHESS_CORE_REPLAY_H_
+#define LUCHESS_CORE_REPLAY_H_
+
+#include <array>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "luchess/core/board.h"
+#include "luchess/core/repetition.h"
+#include "luchess/core/state.h"
+#include "luchess/core/types.h"
+
+/**
+
+Whole game replay.
+
+A move stream is SAN moves separated by whitespace, like the files in
+resources/. Move numbers ("12." or "12...") are skipped and a result
+token ("1-0", "0-1", "1/2-1/2", "*") ends the game.
+
+**/
+
+namespace luchess{
+
+enum class GameResult : uint
+{
+	Unknown,
+	WhiteWins,
+	BlackWins,
+	Draw,
+};
+
+struct ReplayResult
+{
+	// The result token if the stream has one, otherwise checkmate,
+	// stalemate, threefold repetition or the fifty move rule on the
+	// final position
+	GameResult result = GameResult::Unknown;
+	uint plies = 0;
+	// First ply (0 based) that is malformed or illegal
+	std::optional<uint> illegalPly = std::nullopt;
+	GameState finalState;
+	std::array<BoardSquare, ChessBoard::boardSize> finalLayout;
+};
+
+// Drives one board through whole games. The board is reused between
+// games and nothing is allocated per move.
+struct GameReplayer
+{
+	ReplayResult replay(std::string_view moves);
+
+	ChessBoard board;
+	RepetitionTracker repetitions;
+};
+
+// Replays every game in stretches run as tasks on a pool of 'threads'
+// workers, or on sharedThreadPool() when 0, each stretch with its own
+// GameReplayer. Results are in the order of 'games'.
+std::vector<ReplayResult> replayGames(
+	std::span<std::string_view const> games, uint threads = 0);
+
+}
+
+#endif // LUCHESS_CORE_REPLAY_H_
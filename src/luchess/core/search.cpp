@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <utility>
+
+#include "luchess/core/search.h"
+#include "luchess/core/eval.h"
+#include "luchess/core/stats.h"
+#include "luchess/core/zobrist.h"
+
+namespace luchess{
+
+SearchContext::SearchContext(ChessBoard const& _board, SearchLimits _limits) :
+	board(_board),
+	limits(_limits),
+	key(zobristKey(_board)),
+	pawnKey(luchess::pawnKey(_board)),
+	nextSlice(_limits.sliceNodes),
+	nextTimeCheck(kTimeCheckNodes),
+	deadline(std::chrono::steady_clock::now() + _limits.time)
+{
+	limits.depth = std::min(limits.depth, kMaxPly - 1);
+	repetitions.reset(key, board.state.halfmoveClock());
+}
+
+// Hands control back to whoever resumed the search
+struct SliceAwaiter
+{
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<> handle) noexcept
+	{
+		ctx.resumePoint = handle;
+	}
+	void await_resume() const noexcept {}
+
+	SearchContext& ctx;
+};
+
+// Reading the clock every node would cost more than the search, so it is
+// read once every kTimeCheckNodes nodes, quiescence nodes included
+static void _checkTime(SearchContext& ctx)
+{
+	if (!ctx.limits.time.count() || ctx.nodes < ctx.nextTimeCheck)
+		return;
+	ctx.nextTimeCheck = ctx.nodes + kTimeCheckNodes;
+	if (std::chrono::steady_clock::now() >= ctx.deadline)
+		ctx.outOfTime = true;
+}
+
+int quiescence(SearchContext& ctx, uint ply, int alpha, int beta)
+{
+	ChessBoard& board = ctx.board;
+	ctx.pvLength[ply] = 0;
+
+	// The side to move can usually do at least as well as standing still
+	// The cache of whichever thread runs this slice, an analysis may be
+	// stepped from different threads
+	int standPat = evaluate(board, threadPawnCache(), ctx.pawnKey);
+	if (standPat >= beta || ply >= kMaxPly - 1)
+		return standPat;
+	alpha = std::max(alpha, standPat);
+
+	PieceColor mover = board.nextGo();
+	MovePicker picker(board);
+	for (BoardMove move : picker)
+	{
+		auto undo = board.makeMove(move);
+		if (board._isKingExposed(mover))
+		{
+			board.unmakeMove(move, undo);
+			continue;
+		}
+		// Counted here rather than on entry, the leaf calling in already
+		// counted itself
+		ctx.nodes++;
+		LUCHESS_COUNT(SearchNodes);
+		LUCHESS_COUNT(QuiescenceNodes);
+		_checkTime(ctx);
+		uint64_t pawnKey = ctx.pawnKey;
+		ctx.pawnKey = updatePawnKey(pawnKey, board, move, undo);
+		int score = -quiescence(ctx, ply + 1, -beta, -alpha);
+		ctx.pawnKey = pawnKey;
+		board.unmakeMove(move, undo);
+		if (ctx.stopped())
+			return 0;
+
+		if (score >= beta)
+			return score;
+		alpha = std::max(alpha, score);
+	}
+	return alpha;
+}
+
+Task<int> negamax(SearchContext& ctx, uint depth, uint ply, int alpha, int beta)
+{
+	ChessBoard& board = ctx.board;
+	ctx.pvLength[ply] = 0;
+	ctx.nodes++;
+	LUCHESS_COUNT(SearchNodes);
+
+	if (ctx.limits.sliceNodes && ctx.nodes >= ctx.nextSlice)
+	{
+		ctx.nextSlice = ctx.nodes + ctx.limits.sliceNodes;
+		co_await SliceAwaiter{ctx};
+	}
+	_checkTime(ctx);
+	if (ctx.stopped())
+		co_return 0;
+
+	// A repeat inside the tree is scored as a draw straight away
+	if (ply > 0 &&
+		(ctx.repetitions.repetitions() >= 2 || ctx.repetitions.isFiftyMoveDraw()))
+		co_return 0;
+	if (depth == 0 || ply >= kMaxPly - 1)
+		co_return ctx.limits.quiescence ? quiescence(ctx, ply, alpha, beta) :
+			evaluate(board, threadPawnCache(), ctx.pawnKey);
+
+	std::optional<TTEntry> entry;
+	if (ctx.table)
+	{
+		entry = ctx.table->probe(ctx.key, ply);
+		if (entry && ply > 0 && entry->depth >= depth)
+		{
+			TTBound bound = entry->bound();
+			if (bound == TTBound::Exact ||
+				(bound == TTBound::Lower && entry->score >= beta) ||
+				(bound == TTBound::Upper && entry->score <= alpha))
+				co_return std::clamp<int>(entry->score, alpha, beta);
+		}
+	}
+
+	// Last iteration's line comes first, then the table's move
+	std::optional<BoardMove> hashMove;
+	if (ctx.followPv && ply < ctx.previousPvLength)
+		hashMove = unpackMove(ctx.previousPv[ply]);
+	else if (entry && entry->move)
+		hashMove = unpackMove(entry->move);
+	bool followPv = ctx.followPv;
+	int originalAlpha = alpha;
+	std::optional<BoardMove> bestMove;
+
+	PieceColor mover = board.nextGo();
+	MovePicker picker(board, hashMove, ctx.killers[ply], ctx.history);
+	uint legalMoves = 0;
+	for (BoardMove move : picker)
+	{
+		if (ply == 0 && std::ranges::find(ctx.excludedRootMoves, packMove(move)) !=
+			ctx.excludedRootMoves.end())
+			continue;
+		bool noisy = isNoisyMove(board, move);
+		uint64_t key = ctx.key, pawnKey = ctx.pawnKey;
+		auto undo = board.makeMove(move);
+		if (board._isKingExposed(mover))
+		{
+			board.unmakeMove(move, undo);
+			continue;
+		}
+		legalMoves++;
+		ctx.key = updateZobristKey(key, board, move, undo);
+		ctx.pawnKey = updatePawnKey(pawnKey, board, move, undo);
+		ctx.repetitions.push(ctx.key, board.state.halfmoveClock());
+		ctx.followPv = followPv && move == picker.hashMove;
+
+		int score = -co_await negamax(ctx, depth - 1, ply + 1, -beta, -alpha);
+
+		ctx.repetitions.pop();
+		board.unmakeMove(move, undo);
+		ctx.key = key;
+		ctx.pawnKey = pawnKey;
+		followPv = ctx.followPv = false;
+		if (ctx.stopped())
+			co_return 0;
+
+		if (score > alpha)
+		{
+			alpha = score;
+			bestMove = move;
+			ctx.pv[ply][0] = packMove(move);
+			std::copy_n(ctx.pv[ply + 1].begin(), ctx.pvLength[ply + 1],
+				ctx.pv[ply].begin() + 1);
+			ctx.pvLength[ply] = ctx.pvLength[ply + 1] + 1;
+		}
+		if (alpha >= beta)
+		{
+			LUCHESS_COUNT(SearchCutoffs);
+			LUCHESS_HISTOGRAM(CutoffMoveIndex, legalMoves - 1);
+			if (!noisy)
+			{
+				KillerMoves& killers = ctx.killers[ply];
+				uint16_t packed = packMove(move);
+				if (killers[0] != packed)
+					killers = {packed, killers[0]};
+				ctx.history.reward(*undo.moved, move.targetPos, depth);
+			}
+			break;
+		}
+	}
+	if (legalMoves == 0)
+		co_return board._isKingExposed(mover) ? -kMateScore + int(ply) : 0;
+	// A root missing excluded moves is not the position's result
+	if (ctx.table && (ply > 0 || ctx.excludedRootMoves.empty()))
+	{
+		TTBound bound = alpha >= beta ? TTBound::Lower :
+			alpha > originalAlpha ? TTBound::Exact : TTBound::Upper;
+		ctx.table->store(ctx.key, depth, alpha, bound, bestMove, ply);
+	}
+	co_return alpha;
+}
+
+SearchInfo _completeIteration(SearchContext& ctx, uint depth, int score)
+{
+	SearchInfo info{depth, score, ctx.nodes, {}};
+	info.pv.reserve(ctx.pvLength[0]);
+	for (uint i = 0; i < ctx.pvLength[0]; i++)
+		info.pv.push_back(unpackMove(ctx.pv[0][i]));
+
+	ctx.previousPv = ctx.pv[0];
+	ctx.previousPvLength = ctx.pvLength[0];
+	ctx.followPv = true;
+	return info;
+}
+
+static SearchInfo iterativeDeepening(SearchContext& ctx)
+{
+	SearchInfo info;
+	for (uint depth = 1; depth <= ctx.limits.depth; depth++)
+	{
+		// Nothing suspends without slices, so one resume runs it through
+		Task<int> root = negamax(ctx, depth, 0, -kInfinity, kInfinity);
+		root.handle.resume();
+		if (ctx.stopped())
+			break;
+		info = _completeIteration(ctx, depth, root.handle.promise().value);
+	}
+	return info;
+}
+
+SearchInfo search(ChessBoard const& board, SearchLimits limits, TranspositionTable* table)
+{
+	limits.sliceNodes = 0;
+	SearchContext ctx(board, limits);
+	ctx.table = table;
+	if (table)
+		table->newSearch();
+	return iterativeDeepening(ctx);
+}
+
+std::vector<SearchInfo> searchLines(ChessBoard const& board, SearchLimits limits, uint lines)
+{
+	limits.sliceNodes = 0;
+	std::vector<SearchInfo> found;
+	std::vector<uint16_t> excluded;
+	for (uint line = 0; line < lines; line++)
+	{
+		SearchContext ctx(board, limits);
+		ctx.excludedRootMoves = excluded;
+		SearchInfo info = iterativeDeepening(ctx);
+		// Out of moves, or out of budget before the first depth finished
+		if (!info.bestMove())
+			break;
+		excluded.push_back(packMove(*info.bestMove()));
+		found.push_back(std::move(info));
+	}
+	return found;
+}
+
+}
@@ -0,0 +1,149 @@
+#ifndef LUCHESS_CORE_SEARCH_H_
+#define LUCHESS_CORE_SEARCH_H_
+
+#include <array>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "luchess/core/board.h"
+#include "luchess/core/eval.h"
+#include "luchess/core/movegen.h"
+#include "luchess/core/movepick.h"
+#include "luchess/core/repetition.h"
+#include "luchess/core/task.h"
+#include "luchess/core/transposition.h"
+#include "luchess/core/types.h"
+
+/**
+
+Alpha-beta search with iterative deepening.
+
+Leaves run a quiescence search over winning and even captures, so
+scores are not taken in the middle of an exchange. It is a plain
+function: capture sequences are short and never suspend.
+
+Every node is a Task awaiting its children, so a search can suspend
+itself every SearchLimits::sliceNodes nodes and be resumed later from
+where it stopped (see analysis.h). search() runs one to the end on the
+calling thread.
+
+Given a TranspositionTable, interior nodes probe it for a cutoff, away
+from the root, and for the best move of an earlier visit to try first,
+and store what they found. Without one the search is the same node for
+node.
+
+**/
+
+namespace luchess{
+
+static constexpr uint kMaxPly = 64;
+static constexpr int kMateScore = 30000;
+static constexpr int kInfinity = 32000;
+// Nodes searched between two reads of the clock
+static constexpr uint64_t kTimeCheckNodes = 1024;
+
+// Full moves to mate, negative when the side to move gets mated, nullopt
+// for a centipawn score
+inline std::optional<int> mateIn(int score)
+{
+	if (score > kMateScore - int(kMaxPly))
+		return (kMateScore - score + 1) / 2;
+	if (score < -kMateScore + int(kMaxPly))
+		return -(kMateScore + score) / 2;
+	return std::nullopt;
+}
+
+struct SearchLimits
+{
+	uint depth = 6;
+	// Stop after this many nodes, 0 for no limit
+	uint64_t nodes = 0;
+	// Nodes between yields back to the caller, 0 to never yield
+	uint64_t sliceNodes = 0;
+	// Off scores leaves statically, only useful to measure what it buys
+	bool quiescence = true;
+	// Wall clock budget, 0 for no limit
+	std::chrono::milliseconds time{0};
+};
+
+// Result of the deepest completed iteration
+struct SearchInfo
+{
+	std::optional<BoardMove> bestMove() const
+	{
+		if (pv.empty())
+			return std::nullopt;
+		return pv.front();
+	}
+
+	uint depth = 0;
+	// Centipawns for the side to move, mates are near kMateScore
+	int score = 0;
+	uint64_t nodes = 0;
+	std::vector<BoardMove> pv;
+};
+
+struct SearchContext
+{
+	SearchContext(ChessBoard const& board, SearchLimits limits);
+
+	bool stopped() const
+	{
+		return cancelled || outOfTime || (limits.nodes && nodes >= limits.nodes);
+	}
+
+	ChessBoard board;
+	SearchLimits limits;
+	RepetitionTracker repetitions;
+	uint64_t key;
+	uint64_t pawnKey;
+	// Root moves left out, so further lines of a multi-PV search differ
+	std::vector<uint16_t> excludedRootMoves;
+
+	uint64_t nodes = 0;
+	uint64_t nextSlice = 0;
+	uint64_t nextTimeCheck = 0;
+	bool cancelled = false;
+	std::chrono::steady_clock::time_point deadline;
+	bool outOfTime = false;
+	// Innermost suspended node, resumed to continue the search
+	std::coroutine_handle<> resumePoint;
+
+	// Triangular principal variation table of packed moves
+	std::array<std::array<uint16_t, kMaxPly>, kMaxPly> pv;
+	std::array<uint, kMaxPly> pvLength{};
+	// Last iteration's line, searched first while the path follows it
+	std::array<uint16_t, kMaxPly> previousPv;
+	uint previousPvLength = 0;
+	bool followPv = false;
+
+	std::array<KillerMoves, kMaxPly> killers{};
+	HistoryTable history;
+	// Not owned, none when null
+	TranspositionTable* table = nullptr;
+};
+
+// Stand pat or resolve captures until the position is quiet
+int quiescence(SearchContext& ctx, uint ply, int alpha, int beta);
+
+Task<int> negamax(SearchContext& ctx, uint depth, uint ply, int alpha, int beta);
+
+// Records a finished iteration and primes the next one with its line
+SearchInfo _completeIteration(SearchContext& ctx, uint depth, int score);
+
+// Runs iterative deepening to the limits on the calling thread, with
+// 'table' when given
+SearchInfo search(ChessBoard const& board, SearchLimits limits,
+	TranspositionTable* table = nullptr);
+
+// The best 'lines' lines, best first, each searched to the limits with
+// the root moves of the lines before it left out. Fewer come back when
+// the position has fewer legal moves.
+std::vector<SearchInfo> searchLines(ChessBoard const& board, SearchLimits limits, uint lines);
+
+}
+
+#endif // LUCHESS_CORE_SEARCH_H_
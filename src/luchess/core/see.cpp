@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <array>
+
+#include "luchess/core/see.h"
+#include "luchess/core/eval.h"
+
+namespace luchess{
+
+// A king can only take last, valuing it above everything else makes a
+// recapture of it never pay
+static constexpr std::array<int, 6> seeValues = {
+	pieceValues[Pawn], pieceValues[Bishop], pieceValues[Knight],
+	pieceValues[Rook], pieceValues[Queen], 20000,
+};
+
+static constexpr std::array<PieceType, 6> cheapestFirst = {
+	Pawn, Knight, Bishop, Rook, Queen, King,
+};
+
+int see(ChessBoard const& board, BoardBitboards const& bitboards, BoardMove const& move)
+{
+	uint from = ChessBoard::getIndex(move.originPos);
+	uint to = ChessBoard::getIndex(move.targetPos);
+	Piece mover = *board.layout[from];
+	BoardSquare const& victim = board.layout[to];
+	bool promotes = mover.type == Pawn && (move.targetPos.row == 0 || move.targetPos.row == 7);
+	int promotionGain = seeValues[move.promotion.value_or(Queen)] - seeValues[Pawn];
+
+	Bitboard occupied = bitboards.occupied() ^ squareBit(from);
+	// Gains along the exchange, each from the point of view of the side
+	// making that capture
+	std::array<int, 32> gain;
+	if (victim != EMPTY_SQUARE)
+		gain[0] = seeValues[victim->type];
+	else if (mover.type == Pawn && move.originPos.column != move.targetPos.column)
+	{
+		gain[0] = seeValues[Pawn];
+		occupied ^= squareBit(ChessBoard::getIndex({move.targetPos.column, move.originPos.row}));
+	}
+	else
+		gain[0] = 0;
+	int onSquare = seeValues[mover.type];
+	if (promotes)
+	{
+		gain[0] += promotionGain;
+		onSquare = seeValues[move.promotion.value_or(Queen)];
+	}
+
+	Bitboard attackers = attackersTo(bitboards, to, occupied);
+	Bitboard diagonal = bitboards.pieces[Bishop] | bitboards.pieces[Queen];
+	Bitboard straight = bitboards.pieces[Rook] | bitboards.pieces[Queen];
+	PieceColor side = PieceColor(!mover.color);
+	uint depth = 0;
+	while (depth + 1 < gain.size())
+	{
+		Bitboard own = attackers & bitboards.colors[side];
+		if (!own)
+			break;
+		PieceType type = King;
+		Bitboard piece = 0;
+		for (PieceType candidate : cheapestFirst)
+		{
+			piece = own & bitboards.pieces[candidate];
+			if (piece)
+			{
+				type = candidate;
+				break;
+			}
+		}
+		// A king cannot take into a square still covered
+		if (type == King && (attackers & bitboards.colors[!side] & occupied))
+			break;
+
+		depth++;
+		gain[depth] = onSquare - gain[depth - 1];
+		onSquare = seeValues[type];
+		if (type == Pawn && promotes)
+		{
+			gain[depth] += promotionGain;
+			onSquare = seeValues[Queen];
+		}
+		// Neither side can do better by going on
+		if (std::max(-gain[depth - 1], gain[depth]) < 0)
+			break;
+
+		occupied ^= piece & -piece;
+		if (type == Pawn || type == Bishop || type == Queen)
+			attackers |= bishopAttacks(to, occupied) & diagonal;
+		if (type == Rook || type == Queen)
+			attackers |= rookAttacks(to, occupied) & straight;
+		attackers &= occupied;
+		side = PieceColor(!side);
+	}
+	while (depth > 0)
+	{
+		gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+		depth--;
+	}
+	return gain[0];
+}
+
+int see(ChessBoard const& board, BoardMove const& move)
+{
+	return see(board, BoardBitboards(board), move);
+}
+
+}
@@ -0,0 +1,29 @@
+#ifndef LUCHESS_CORE_SEE_H_
+#define LUCHESS_CORE_SEE_H_
+
+#include "luchess/core/bitboard.h"
+#include "luchess/core/board.h"
+
+/**
+
+Static exchange evaluation.
+
+Plays out every capture on the target square of a move, each side
+always recapturing with its least valuable attacker and free to stop
+when going on would lose material. Sliders behind a capturing piece join
+in as it leaves, so batteries and x-rays are counted. Pins and checks
+are ignored.
+
+**/
+
+namespace luchess{
+
+// Material the mover wins with 'move' in centipawns, negative when the
+// exchange loses. 'bitboards' must describe 'board'
+int see(ChessBoard const& board, BoardBitboards const& bitboards, BoardMove const& move);
+
+int see(ChessBoard const& board, BoardMove const& move);
+
+}
+
+#endif // LUCHESS_CORE_SEE_H_
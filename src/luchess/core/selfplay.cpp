@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+
+#include "luchess/core/selfplay.h"
+#include "luchess/core/chess.h"
+#include "luchess/core/movegen.h"
+#include "luchess/core/repetition.h"
+#include "luchess/core/search.h"
+#include "luchess/core/threadpool.h"
+#include "luchess/core/zobrist.h"
+
+namespace luchess{
+
+TrainingRecord TrainingRecord::encode(ChessBoard const& board, int score, uint ply, uint game)
+{
+	TrainingRecord record{};
+	record.layout = packLayout(board.layout);
+	record.state = board.state;
+	record.game = game;
+	record.score = int16_t(std::clamp(score, INT16_MIN, INT16_MAX));
+	record.ply = uint16_t(ply);
+	record.result = uint8_t(GameResult::Draw);
+	return record;
+}
+
+void TrainingRecord::decode(ChessBoard& board) const
+{
+	unpackLayout(layout, board.layout);
+	board.indexPieces();
+	board.state = state;
+}
+
+double SelfPlaySummary::positionsPerSecond() const
+{
+	return elapsed.count() ? positions * 1e6 / elapsed.count() : 0.;
+}
+
+using FilePtr = std::unique_ptr<std::FILE, decltype(&std::fclose)>;
+
+static FilePtr openFile(std::string const& path, char const* mode)
+{
+	return FilePtr(std::fopen(path.c_str(), mode), &std::fclose);
+}
+
+std::vector<TrainingRecord> readTrainingRecords(std::string const& path)
+{
+	std::vector<TrainingRecord> records;
+	FilePtr file = openFile(path, "rb");
+	if (!file)
+		return records;
+	TrainingRecord record;
+	while (std::fread(&record, sizeof(record), 1, file.get()) == 1)
+		records.push_back(record);
+	return records;
+}
+
+// Cuts off everything after the last game end, a torn append, and flags
+// the games whose end the file holds
+static std::vector<bool> finishedGames(std::string const& path, uint games)
+{
+	std::vector<bool> finished(games);
+	uint64_t kept = 0;
+	{
+		FilePtr file = openFile(path, "rb");
+		if (!file)
+			return finished;
+		std::vector<TrainingRecord> chunk(4096);
+		std::size_t count;
+		uint64_t read = 0;
+		while ((count = std::fread(chunk.data(), sizeof(TrainingRecord), chunk.size(), file.get())))
+		{
+			for (std::size_t i = 0; i < count; i++)
+			{
+				if (!(chunk[i].flags & TrainingRecord::kGameEnd))
+					continue;
+				kept = read + i + 1;
+				if (chunk[i].game < games)
+					finished[chunk[i].game] = true;
+			}
+			read += count;
+		}
+	}
+	std::error_code error;
+	if (std::filesystem::file_size(path, error) != kept * sizeof(TrainingRecord) && !error)
+		std::filesystem::resize_file(path, kept * sizeof(TrainingRecord));
+	return finished;
+}
+
+// ========================Games======================================
+
+// Plays one game into 'records', leaving them empty when 'stop' cut it short
+static void playGame(uint game, SelfPlayOptions const& options,
+	std::atomic<bool> const& stop, std::vector<TrainingRecord>& records)
+{
+	records.clear();
+	std::mt19937_64 random(options.seed ^ (uint64_t(game) * 0x9E3779B97F4A7C15));
+	ChessBoard board;
+	populateDefaultLayout(board);
+	uint64_t key = zobristKey(board);
+	RepetitionTracker repetitions;
+	repetitions.reset(key);
+
+	GameResult result = GameResult::Draw;
+	MoveList moves;
+	for (uint ply = 0; ply < options.maxPlies; ply++)
+	{
+		if (stop.load(std::memory_order_relaxed))
+		{
+			records.clear();
+			return;
+		}
+		PieceColor side = board.nextGo();
+		bool inCheck = board._isKingExposed(side);
+		board.state.setKingInCheck(side, inCheck);
+		moves.clear();
+		generateLegalMoves(board, moves);
+		if (moves.empty())
+		{
+			if (inCheck)
+				result = side == White ? GameResult::BlackWins : GameResult::WhiteWins;
+			break;
+		}
+		if (repetitions.isDraw())
+			break;
+
+		BoardMove move = moves[0];
+		if (ply < options.openingPlies)
+		{
+			move = moves[std::uniform_int_distribution<std::size_t>(0, moves.size() - 1)(random)];
+		}
+		else
+		{
+			SearchInfo info = search(board, {kMaxPly - 1, options.nodes});
+			// Positions in check have one sensible reply at most, a poor
+			// label. Without a finished depth the score is no label either,
+			// the game goes on with the first legal move.
+			if (info.bestMove())
+			{
+				move = *info.bestMove();
+				if (!inCheck)
+					records.push_back(TrainingRecord::encode(board, info.score, ply, game));
+			}
+		}
+
+		board.state.setKingInCheck(side, false);
+		auto undo = board.makeMove(move);
+		key = updateZobristKey(key, board, move, undo);
+		repetitions.push(key, board.state.halfmoveClock());
+	}
+	for (TrainingRecord& record : records)
+		record.result = uint8_t(result);
+	if (!records.empty())
+		records.back().flags |= TrainingRecord::kGameEnd;
+}
+
+// ========================Runner=====================================
+
+SelfPlaySummary runSelfPlay(std::string const& path, SelfPlayOptions const& options,
+	std::atomic<bool> const& stop, SelfPlayProgress* progress)
+{
+	using Clock = std::chrono::steady_clock;
+	auto start = Clock::now();
+
+	std::vector<bool> finished = finishedGames(path, options.games);
+	std::vector<uint> pending;
+	for (uint game = 0; game < options.games; game++)
+	{
+		if (!finished[game])
+			pending.push_back(game);
+	}
+
+	uint threads = options.threads;
+	if (threads == 0)
+		threads = sharedThreadPool().size();
+	threads = std::min<std::size_t>(threads, std::max<std::size_t>(pending.size(), 1));
+
+	std::atomic<std::size_t> next = 0;
+	std::atomic<uint64_t> games = 0;
+	std::atomic<uint64_t> positions = 0;
+	std::atomic<bool> failed = false;
+	auto worker = [&](uint)
+	{
+		FilePtr file = openFile(path, "ab");
+		if (!file)
+		{
+			failed = true;
+			return;
+		}
+		// Every append is then a single write of whole records
+		std::setvbuf(file.get(), nullptr, _IONBF, 0);
+
+		std::vector<TrainingRecord> buffer;
+		buffer.reserve(options.bufferRecords + 2 * options.maxPlies);
+		std::vector<TrainingRecord> records;
+		records.reserve(options.maxPlies);
+		auto flush = [&]()
+		{
+			if (std::fwrite(buffer.data(), sizeof(TrainingRecord), buffer.size(), file.get()) !=
+				buffer.size())
+				failed = true;
+			buffer.clear();
+		};
+
+		for (std::size_t job = next.fetch_add(1, std::memory_order_relaxed);
+			 job < pending.size() && !failed;
+			 job = next.fetch_add(1, std::memory_order_relaxed))
+		{
+			playGame(pending[job], options, stop, records);
+			if (stop.load(std::memory_order_relaxed))
+				break;
+			buffer.insert(buffer.end(), records.begin(), records.end());
+			games.fetch_add(1, std::memory_order_relaxed);
+			positions.fetch_add(records.size(), std::memory_order_relaxed);
+			if (progress)
+			{
+				progress->games.fetch_add(1, std::memory_order_relaxed);
+				progress->positions.fetch_add(records.size(), std::memory_order_relaxed);
+			}
+			if (buffer.size() >= options.bufferRecords)
+				flush();
+		}
+		if (!buffer.empty())
+			flush();
+	};
+
+	runTasks(sharedThreadPool(), threads, worker);
+	if (failed)
+		throw std::runtime_error("selfplay: cannot write " + path);
+
+	SelfPlaySummary summary;
+	summary.games = games;
+	summary.positions = positions;
+	summary.skipped = options.games - pending.size();
+	summary.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+		Clock::now() - start);
+	return summary;
+}
+
+}
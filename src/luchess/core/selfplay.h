@@ -0,0 +1,119 @@
+#ifndef LUCHESS_CORE_SELFPLAY_H_
+#define LUCHESS_CORE_SELFPLAY_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "luchess/core/board.h"
+#include "luchess/core/history.h"
+#include "luchess/core/replay.h"
+#include "luchess/core/state.h"
+#include "luchess/core/types.h"
+
+/**
+
+Self-play training data.
+
+runSelfPlay plays games engine against engine on a pool of workers and
+appends every searched position to a file of TrainingRecords. A record
+is 48 bytes with no header in front, so the file can be mapped and read
+as an array of them in native byte order.
+
+A game starts with a few random legal moves picked from a generator
+seeded by the game number, then every move is searched with a fixed
+node budget. Positions are labelled with the game's result once it
+ends, so only whole games are written. Each worker gathers whole games
+in its own buffer and appends the buffer with one unbuffered write to a
+file opened for appending; workers never wait for each other.
+
+The last record of each game carries TrainingRecord::kGameEnd, and an
+append always ends on such a record. Stopping keeps every flushed game
+and drops the games in progress. Running again on the same file first
+cuts off whatever follows the last game end, which is what a crash in
+the middle of an append leaves. It then plays only the games that have
+no game end in the file, so an interrupted run resumes with the same
+games it would have played. A game that produced no records, e.g. one
+mated during its random opening, is played again and again writes
+nothing.
+
+**/
+
+namespace luchess{
+
+struct TrainingRecord
+{
+	// Set in 'flags' on the last record of a game
+	static constexpr uint8_t kGameEnd = 1;
+
+	static TrainingRecord encode(ChessBoard const& board, int score, uint ply, uint game);
+
+	// Sets 'board' to the recorded position
+	void decode(ChessBoard& board) const;
+
+	PackedLayout layout;
+	GameState state;
+	uint32_t game;
+	// Centipawns for the side to move, clamped to int16_t
+	int16_t score;
+	uint16_t ply;
+	// A GameResult, never Unknown
+	uint8_t result;
+	uint8_t flags;
+	std::array<uint8_t, 2> reserved;
+};
+static_assert(sizeof(TrainingRecord) == 48);
+static_assert(std::is_trivially_copyable_v<TrainingRecord>);
+
+struct SelfPlayOptions
+{
+	// Game numbers 0 to games - 1 are played
+	uint games = 0;
+	// Search budget per move
+	uint64_t nodes = 5000;
+	// Random plies before searching starts
+	uint openingPlies = 8;
+	// Longer games are adjudicated a draw
+	uint maxPlies = 400;
+	uint64_t seed = 0;
+	// Records a worker holds before appending them
+	std::size_t bufferRecords = 4096;
+	// Tasks on sharedThreadPool(), its size when 0
+	uint threads = 0;
+};
+
+// Updated while the run goes on, safe to read from another thread
+struct SelfPlayProgress
+{
+	std::atomic<uint64_t> games = 0;
+	std::atomic<uint64_t> positions = 0;
+};
+
+struct SelfPlaySummary
+{
+	double positionsPerSecond() const;
+
+	// This run only, not what the file held before
+	uint64_t games = 0;
+	uint64_t positions = 0;
+	uint64_t skipped = 0;
+	std::chrono::microseconds elapsed{0};
+};
+
+// Reads every whole record of a file
+std::vector<TrainingRecord> readTrainingRecords(std::string const& path);
+
+// Plays the games 'path' does not hold yet, see above. Setting 'stop'
+// ends the run early. Throws std::runtime_error when the file cannot be
+// opened or written.
+SelfPlaySummary runSelfPlay(std::string const& path, SelfPlayOptions const& options,
+	std::atomic<bool> const& stop, SelfPlayProgress* progress = nullptr);
+
+}
+
+#endif // LUCHESS_CORE_SELFPLAY_H_
@@ -0,0 +1,156 @@
+#ifndef LUCHESS_CORE_STATE_H_
+#define LUCHESS_CORE_STATE_H_
+
+#include <cstdint>
+#include <functional>
+
+#include "luchess/core/pieces.h"
+#include "luchess/core/types.h"
+#include "luchess/core/static.h"
+
+/**
+
+Packed game state word:
+
+	bit  0-3   castling rights, one bit per corner rook
+	           (indexed like RookCastleState::getIndex)
+	bit  4-7   en passant file + 1, 0 when the last move
+	           was not a pawn double step
+	bit  8     black to move
+	bit  9     white king in check
+	bit 10     black king in check
+	bit 16-23  halfmove clock (plies since last capture or pawn move)
+
+A zero word is white to move with no castling rights, no en passant
+file and a zero clock, i.e. the same defaults ChessBoard always had.
+
+**/
+
+namespace luchess{
+
+struct GameState
+{
+	using Word = uint32_t;
+
+	static constexpr Word kCastleShift = 0;
+	static constexpr Word kCastleMask = 0xFu << kCastleShift;
+	static constexpr Word kEnPassantShift = 4;
+	static constexpr Word kEnPassantMask = 0xFu << kEnPassantShift;
+	static constexpr Word kBlackToMoveBit = 1u << 8;
+	static constexpr Word kWhiteInCheckBit = 1u << 9;
+	static constexpr Word kBlackInCheckBit = 1u << 10;
+	static constexpr Word kHalfmoveShift = 16;
+	static constexpr Word kHalfmoveMask = 0xFFu << kHalfmoveShift;
+
+	static constexpr int kNoEnPassant = -1;
+
+	// Castling ===============================================================
+
+	constexpr bool castleRight(uint index) const
+	{
+		return word & (1u << (kCastleShift + index));
+	}
+
+	constexpr void setCastleRight(uint index, bool val)
+	{
+		Word bit = 1u << (kCastleShift + index);
+		word = val ? (word | bit) : (word & ~bit);
+	}
+
+	constexpr uint castleRights() const
+	{
+		return (word & kCastleMask) >> kCastleShift;
+	}
+
+	constexpr void setCastleRights(uint rights)
+	{
+		word = (word & ~kCastleMask) | ((rights << kCastleShift) & kCastleMask);
+	}
+
+	// En passant =============================================================
+
+	constexpr int enPassantFile() const
+	{
+		return static_cast<int>((word & kEnPassantMask) >> kEnPassantShift) - 1;
+	}
+
+	constexpr void setEnPassantFile(int file)
+	{
+		word = (word & ~kEnPassantMask) |
+			(static_cast<Word>(file + 1) << kEnPassantShift);
+	}
+
+	constexpr void clearEnPassant()
+	{
+		word &= ~kEnPassantMask;
+	}
+
+	// Side to move ===========================================================
+
+	constexpr PieceColor sideToMove() const
+	{
+		return static_cast<PieceColor>(!(word & kBlackToMoveBit));
+	}
+
+	constexpr void setSideToMove(PieceColor color)
+	{
+		word = color == White ? (word & ~kBlackToMoveBit) : (word | kBlackToMoveBit);
+	}
+
+	constexpr void flipSideToMove()
+	{
+		word ^= kBlackToMoveBit;
+	}
+
+	// Check flags ============================================================
+
+	constexpr bool kingInCheck(PieceColor color) const
+	{
+		return word & (color == White ? kWhiteInCheckBit : kBlackInCheckBit);
+	}
+
+	constexpr void setKingInCheck(PieceColor color, bool val)
+	{
+		Word bit = color == White ? kWhiteInCheckBit : kBlackInCheckBit;
+		word = val ? (word | bit) : (word & ~bit);
+	}
+
+	// Halfmove clock =========================================================
+
+	constexpr uint halfmoveClock() const
+	{
+		return (word & kHalfmoveMask) >> kHalfmoveShift;
+	}
+
+	constexpr void setHalfmoveClock(uint clock)
+	{
+		word = (word & ~kHalfmoveMask) |
+			((static_cast<Word>(clock) << kHalfmoveShift) & kHalfmoveMask);
+	}
+
+	// Saturates rather than wrapping so the fifty move rule stays readable.
+	constexpr void incrementHalfmoveClock()
+	{
+		if ((word & kHalfmoveMask) != kHalfmoveMask)
+			word += 1u << kHalfmoveShift;
+	}
+
+	auto operator<=>(const GameState&) const = default;
+
+	Word word = EMPTY_STATE;
+};
+
+static_assert(sizeof(GameState) == sizeof(GameState::Word));
+
+}
+
+template<>
+struct std::hash<luchess::GameState>
+{
+	std::size_t operator()(luchess::GameState const& state) const noexcept
+	{
+		return std::hash<luchess::GameState::Word>{}(state.word);
+	}
+};
+
+#endif // LUCHESS_CORE_STATE_H_
@@ -0,0 +1,92 @@
+#include "luchess/core/stats.h"
+
+namespace luchess{
+
+static std::atomic<ThreadStats*> threadStatsHead = nullptr;
+
+ThreadStats* _registerThreadStats()
+{
+	ThreadStats* stats = new ThreadStats();
+	ThreadStats* head = threadStatsHead.load(std::memory_order_relaxed);
+	do
+	{
+		stats->next = head;
+	}
+	while (!threadStatsHead.compare_exchange_weak(
+		head, stats, std::memory_order_release, std::memory_order_relaxed));
+	return stats;
+}
+
+StatsSnapshot snapshotStats()
+{
+	StatsSnapshot snapshot;
+	for (ThreadStats* stats = threadStatsHead.load(std::memory_order_acquire);
+		 stats != nullptr;
+		 stats = stats->next)
+	{
+		for (std::size_t c = 0; c < kStatCounters; c++)
+			snapshot.counters[c] +=
+				stats->counters[c].load(std::memory_order_relaxed);
+		for (std::size_t h = 0; h < kStatHistograms; h++)
+			for (std::size_t b = 0; b < kStatBuckets; b++)
+				snapshot.histograms[h][b] +=
+					stats->histograms[h][b].load(std::memory_order_relaxed);
+	}
+	return snapshot;
+}
+
+StatsSnapshot StatsSnapshot::operator-(StatsSnapshot const& other) const
+{
+	StatsSnapshot result;
+	for (std::size_t c = 0; c < kStatCounters; c++)
+		result.counters[c] = this->counters[c] - other.counters[c];
+	for (std::size_t h = 0; h < kStatHistograms; h++)
+		for (std::size_t b = 0; b < kStatBuckets; b++)
+			result.histograms[h][b] =
+				this->histograms[h][b] - other.histograms[h][b];
+	return result;
+}
+
+// Lower bound of the values that land in a histogram bucket
+static uint64_t bucketFloor(std::size_t bucket)
+{
+	return bucket == 0 ? 0 : uint64_t(1) << (bucket - 1);
+}
+
+void writeStatsText(std::ostream& os, StatsSnapshot const& snapshot)
+{
+	for (std::size_t c = 0; c < kStatCounters; c++)
+		os << statCounterNames[c] << ": " << snapshot.counters[c] << "\n";
+	for (std::size_t h = 0; h < kStatHistograms; h++)
+	{
+		os << statHistogramNames[h] << ":";
+		for (std::size_t b = 0; b < kStatBuckets; b++)
+		{
+			if (snapshot.histograms[h][b] == 0)
+				continue;
+			os << " [" << bucketFloor(b) << "+]=" << snapshot.histograms[h][b];
+		}
+		os << "\n";
+	}
+}
+
+void writeStatsJson(std::ostream& os, StatsSnapshot const& snapshot)
+{
+	os << "{\"counters\":{";
+	for (std::size_t c = 0; c < kStatCounters; c++)
+	{
+		os << (c ? "," : "") << "\"" << statCounterNames[c] << "\":"
+		   << snapshot.counters[c];
+	}
+	os << "},\"histograms\":{";
+	for (std::size_t h = 0; h < kStatHistograms; h++)
+	{
+		os << (h ? "," : "") << "\"" << statHistogramNames[h] << "\":[";
+		for (std::size_t b = 0; b < kStatBuckets; b++)
+			os << (b ? "," : "") << snapshot.histograms[h][b];
+		os << "]";
+	}
+	os << "}}";
+}
+
+}
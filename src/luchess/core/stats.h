@@ -0,0 +1,160 @@
+#ifndef LUCHESS_CORE_STATS_H_
+#define LUCHESS_CORE_STATS_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+#include "luchess/core/types.h"
+
+/**
+
+Hot path counters and histograms.
+
+Only compiled in when LUCHESS_STATS_BUILD is defined (cmake option
+LUCHESS_STATS), otherwise LUCHESS_COUNT and LUCHESS_HISTOGRAM expand to
+nothing. Each thread writes to its own cache line aligned block with
+plain relaxed stores, readers sum every block with relaxed loads, so
+there are no locks or read-modify-write instructions on the hot path.
+
+Blocks are kept after their thread exits so snapshots cover the whole
+run. Take the difference of two snapshots to measure a section.
+
+**/
+
+namespace luchess{
+
+enum class StatCounter : uint
+{
+	MovesValidated,
+	MovesAccepted,
+	RejectedOffBoard,
+	RejectedEmptyOrigin,
+	RejectedWrongSide,
+	RejectedOwnPiece,
+	RejectedBlockedLine,
+	RejectedBadGeometry,
+	RejectedKingExposed,
+	CollisionChecks,
+	SearchNodes,
+	SearchCutoffs,
+	QuiescenceNodes,
+	Count
+};
+
+enum class StatHistogram : uint
+{
+	// Squares walked by a single doesLineCollide call
+	CollisionSquares,
+	// Index of the move that caused a search cut-off
+	CutoffMoveIndex,
+	Count
+};
+
+static constexpr std::size_t kStatCounters =
+	static_cast<std::size_t>(StatCounter::Count);
+static constexpr std::size_t kStatHistograms =
+	static_cast<std::size_t>(StatHistogram::Count);
+// Bucket i holds values in [2^(i-1), 2^i), bucket 0 holds zero
+static constexpr std::size_t kStatBuckets = 16;
+
+static constexpr std::array<std::string_view, kStatCounters> statCounterNames = {
+	"moves_validated",
+	"moves_accepted",
+	"rejected_off_board",
+	"rejected_empty_origin",
+	"rejected_wrong_side",
+	"rejected_own_piece",
+	"rejected_blocked_line",
+	"rejected_bad_geometry",
+	"rejected_king_exposed",
+	"collision_checks",
+	"search_nodes",
+	"search_cutoffs",
+	"quiescence_nodes",
+};
+// A counter added without a name leaves an empty entry at the end
+static_assert(std::ranges::none_of(statCounterNames, &std::string_view::empty),
+	"every StatCounter needs a name");
+
+static constexpr std::array<std::string_view, kStatHistograms> statHistogramNames = {
+	"collision_squares",
+	"cutoff_move_index",
+};
+static_assert(std::ranges::none_of(statHistogramNames, &std::string_view::empty),
+	"every StatHistogram needs a name");
+
+struct StatsSnapshot
+{
+	uint64_t counter(StatCounter c) const
+	{
+		return counters[static_cast<std::size_t>(c)];
+	}
+
+	StatsSnapshot operator-(StatsSnapshot const& other) const;
+
+	std::array<uint64_t, kStatCounters> counters{};
+	std::array<std::array<uint64_t, kStatBuckets>, kStatHistograms> histograms{};
+};
+
+struct alignas(64) ThreadStats
+{
+	void count(StatCounter c, uint64_t n = 1)
+	{
+		auto& value = counters[static_cast<std::size_t>(c)];
+		// Single writer, so a plain load and store is enough
+		value.store(value.load(std::memory_order_relaxed) + n,
+			std::memory_order_relaxed);
+	}
+
+	void record(StatHistogram h, uint64_t sample)
+	{
+		std::size_t bucket = std::bit_width(sample);
+		if (bucket >= kStatBuckets)
+			bucket = kStatBuckets - 1;
+		auto& value = histograms[static_cast<std::size_t>(h)][bucket];
+		value.store(value.load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+	}
+
+	std::array<std::atomic<uint64_t>, kStatCounters> counters{};
+	std::array<std::array<std::atomic<uint64_t>, kStatBuckets>, kStatHistograms> histograms{};
+	ThreadStats* next = nullptr;
+};
+
+// Registers a new block for the calling thread
+ThreadStats* _registerThreadStats();
+
+inline ThreadStats& threadStats()
+{
+	thread_local ThreadStats* stats = nullptr;
+	if (!stats)
+		stats = _registerThreadStats();
+	return *stats;
+}
+
+// Sums every thread's block, safe to call while other threads count
+StatsSnapshot snapshotStats();
+
+void writeStatsText(std::ostream& os, StatsSnapshot const& snapshot);
+
+void writeStatsJson(std::ostream& os, StatsSnapshot const& snapshot);
+
+#ifdef LUCHESS_STATS_BUILD
+	#define LUCHESS_COUNT(counter) \
+		do{ ::luchess::threadStats().count(::luchess::StatCounter::counter); }while(0)
+	#define LUCHESS_HISTOGRAM(histogram, sample) \
+		do{ ::luchess::threadStats().record(::luchess::StatHistogram::histogram, (sample)); }while(0)
+#else
+	#define LUCHESS_COUNT(counter) do{}while(0)
+	#define LUCHESS_HISTOGRAM(histogram, sample) do{}while(0)
+#endif
+
+}
+
+#endif // LUCHESS_CORE_STATS_H_
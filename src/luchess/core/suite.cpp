@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <iterator>
+#include <mutex>
+#include <string>
+
+#include "luchess/core/suite.h"
+#include "luchess/core/format.h"
+#include "luchess/core/threadpool.h"
+
+namespace luchess{
+
+double SuiteSummary::positionsPerSecond() const
+{
+	return elapsed.count() ? searched * 1e6 / elapsed.count() : 0.;
+}
+
+double SuiteSummary::nodesPerSecond() const
+{
+	return elapsed.count() ? nodes * 1e6 / elapsed.count() : 0.;
+}
+
+std::vector<bool> readCheckpoint(std::istream& checkpoint, std::size_t positions)
+{
+	std::vector<bool> finished(positions);
+	std::size_t index;
+	while (checkpoint >> index)
+	{
+		if (index < positions)
+			finished[index] = true;
+	}
+	return finished;
+}
+
+// ========================JSON=======================================
+
+static void appendJsonString(std::string& out, std::string_view text)
+{
+	out += '"';
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			out += '\\';
+			out += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			char escaped[7];
+			std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			out += escaped;
+		}
+		else
+			out += c;
+	}
+	out += '"';
+}
+
+static void appendScore(std::string& out, int score)
+{
+	if (auto mate = mateIn(score))
+		out += "{\"mate\":" + std::to_string(*mate) + "}";
+	else
+		out += "{\"cp\":" + std::to_string(score) + "}";
+}
+
+static std::string resultLine(std::size_t index, EpdRecord const& record,
+	std::vector<SearchInfo> const& lines, uint64_t nodes, std::chrono::microseconds time)
+{
+	std::string out = "{\"index\":" + std::to_string(index) + ",\"id\":";
+	appendJsonString(out, record.id);
+	out += ",\"fen\":\"";
+	formatFen(std::back_inserter(out), record.board);
+
+	std::optional<BoardMove> bestMove;
+	if (!lines.empty())
+		bestMove = lines.front().bestMove();
+	out += "\",\"bestmove\":";
+	if (bestMove)
+	{
+		out += '"';
+		formatUci(std::back_inserter(out), *bestMove);
+		out += '"';
+		out += ",\"score\":";
+		appendScore(out, lines.front().score);
+		out += ",\"depth\":" + std::to_string(lines.front().depth);
+	}
+	else
+		out += "null";
+	out += ",\"nodes\":" + std::to_string(nodes);
+	out += ",\"time_us\":" + std::to_string(time.count());
+
+	if (!record.bestMoves.empty() || !record.avoidMoves.empty())
+	{
+		bool solved = bestMove &&
+			(record.bestMoves.empty() || std::ranges::count(record.bestMoves, *bestMove)) &&
+			!std::ranges::count(record.avoidMoves, *bestMove);
+		out += solved ? ",\"solved\":true" : ",\"solved\":false";
+	}
+
+	out += ",\"lines\":[";
+	for (std::size_t i = 0; i < lines.size(); i++)
+	{
+		if (i)
+			out += ',';
+		out += "{\"depth\":" + std::to_string(lines[i].depth) + ",\"score\":";
+		appendScore(out, lines[i].score);
+		out += ",\"pv\":\"";
+		formatPv(std::back_inserter(out), std::span<BoardMove const>(lines[i].pv));
+		out += "\"}";
+	}
+	out += "]}\n";
+	return out;
+}
+
+// ========================Runner=====================================
+
+SuiteSummary runSuite(std::span<EpdRecord const> positions, SuiteOptions const& options,
+	std::ostream& results, std::ostream* checkpoint, std::vector<bool> const& finished)
+{
+	using Clock = std::chrono::steady_clock;
+	auto start = Clock::now();
+
+	std::vector<std::size_t> pending;
+	for (std::size_t index = 0; index < positions.size(); index++)
+	{
+		if (index >= finished.size() || !finished[index])
+			pending.push_back(index);
+	}
+
+	uint lineCount = std::max(options.lines, 1u);
+	SearchLimits limits = options.limits;
+	limits.nodes /= lineCount;
+	limits.time /= lineCount;
+
+	uint threads = options.threads;
+	if (threads == 0)
+		threads = sharedThreadPool().size();
+	threads = std::min<std::size_t>(threads, std::max<std::size_t>(pending.size(), 1));
+
+	std::vector<std::chrono::microseconds> latencies(pending.size());
+	std::atomic<uint64_t> nodes = 0;
+	std::atomic<std::size_t> next = 0;
+	std::mutex outputMutex;
+	auto worker = [&](uint)
+	{
+		for (std::size_t job = next.fetch_add(1, std::memory_order_relaxed);
+			 job < pending.size();
+			 job = next.fetch_add(1, std::memory_order_relaxed))
+		{
+			std::size_t index = pending[job];
+			auto searchStart = Clock::now();
+			auto lines = searchLines(positions[index].board, limits, lineCount);
+			auto time = std::chrono::duration_cast<std::chrono::microseconds>(
+				Clock::now() - searchStart);
+
+			uint64_t positionNodes = 0;
+			for (auto const& line : lines)
+				positionNodes += line.nodes;
+			nodes.fetch_add(positionNodes, std::memory_order_relaxed);
+			latencies[job] = time;
+
+			std::string line = resultLine(index, positions[index], lines, positionNodes, time);
+			std::lock_guard lock(outputMutex);
+			results << line << std::flush;
+			if (checkpoint)
+				*checkpoint << index << '\n' << std::flush;
+		}
+	};
+
+	runTasks(sharedThreadPool(), threads, worker);
+
+	SuiteSummary summary;
+	summary.searched = pending.size();
+	summary.skipped = positions.size() - pending.size();
+	summary.nodes = nodes;
+	summary.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+		Clock::now() - start);
+	if (!latencies.empty())
+	{
+		std::ranges::sort(latencies);
+		auto percentile = [&](std::size_t percent)
+		{
+			return latencies[(latencies.size() - 1) * percent / 100];
+		};
+		summary.p50 = percentile(50);
+		summary.p90 = percentile(90);
+		summary.p99 = percentile(99);
+		summary.max = latencies.back();
+	}
+	return summary;
+}
+
+}
@@ -0,0 +1,77 @@
+#ifndef LUCHESS_CORE_SUITE_H_
+#define LUCHESS_CORE_SUITE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <vector>
+
+#include "luchess/core/fen.h"
+#include "luchess/core/search.h"
+#include "luchess/core/types.h"
+
+/**
+
+Position suite analysis.
+
+runSuite searches a list of positions on a pool of workers and streams
+one JSON object per line for every position as it finishes:
+
+	{"index":0,"id":"WAC.001","fen":"...","bestmove":"e2e4",
+	 "score":{"cp":35},"depth":6,"nodes":5120,"time_us":4210,
+	 "solved":true,"lines":[{"depth":6,"score":{"cp":35},"pv":"e2e4 e7e5"}]}
+
+"score" is {"mate":n} for mates, "bestmove" is null when the budget ran
+out before depth 1 finished and "solved" is only written for records
+with bm or am moves. Lines come out in finishing order, "index" is the
+position in the suite.
+
+A checkpoint stream gets the index of every position after its result
+line has been flushed. Reading it back on the next run skips those
+positions, so an interrupted run resumes without losing or, at worst,
+with one repeated result.
+
+**/
+
+namespace luchess{
+
+struct SuiteOptions
+{
+	// Per position budget, split evenly over the lines
+	SearchLimits limits;
+	// Lines per position (multi-PV)
+	uint lines = 1;
+	// Tasks on sharedThreadPool(), its size when 0
+	uint threads = 0;
+};
+
+struct SuiteSummary
+{
+	double positionsPerSecond() const;
+	double nodesPerSecond() const;
+
+	std::size_t searched = 0;
+	std::size_t skipped = 0;
+	uint64_t nodes = 0;
+	std::chrono::microseconds elapsed{0};
+	// Search time per position
+	std::chrono::microseconds p50{0};
+	std::chrono::microseconds p90{0};
+	std::chrono::microseconds p99{0};
+	std::chrono::microseconds max{0};
+};
+
+// Flags the positions a checkpoint lists as finished
+std::vector<bool> readCheckpoint(std::istream& checkpoint, std::size_t positions);
+
+// Searches every position 'finished' does not flag, writing results
+// and checkpoint entries as described above
+SuiteSummary runSuite(std::span<EpdRecord const> positions, SuiteOptions const& options,
+	std::ostream& results, std::ostream* checkpoint = nullptr,
+	std::vector<bool> const& finished = {});
+
+}
+
+#endif // LUCHESS_CORE_SUITE_H_
@@ -0,0 +1,67 @@
+#include <array>
+#include <new>
+
+#include "luchess/core/task.h"
+
+namespace luchess{
+
+// Frames are rounded up to a size class; bigger ones skip the cache
+static constexpr std::size_t kFrameGranularity = 256;
+static constexpr std::size_t kFrameClasses = 64;
+// Frames kept per class, the rest go back to the global allocator
+static constexpr std::size_t kMaxCachedFrames = 1024;
+
+struct FreeFrame
+{
+	FreeFrame* next;
+};
+
+struct FrameCache
+{
+	~FrameCache()
+	{
+		for (FreeFrame* frame : frames)
+		{
+			while (frame)
+				::operator delete(std::exchange(frame, frame->next));
+		}
+	}
+
+	std::array<FreeFrame*, kFrameClasses> frames{};
+	std::array<std::size_t, kFrameClasses> counts{};
+};
+
+static thread_local FrameCache frameCache;
+
+static std::size_t frameClass(std::size_t size)
+{
+	return (size + kFrameGranularity - 1) / kFrameGranularity;
+}
+
+void* _allocateFrame(std::size_t size)
+{
+	std::size_t sizeClass = frameClass(size);
+	if (sizeClass >= kFrameClasses)
+		return ::operator new(size);
+	if (FreeFrame* frame = frameCache.frames[sizeClass])
+	{
+		frameCache.frames[sizeClass] = frame->next;
+		frameCache.counts[sizeClass]--;
+		return frame;
+	}
+	return ::operator new(sizeClass * kFrameGranularity);
+}
+
+void _freeFrame(void* frame, std::size_t size)
+{
+	std::size_t sizeClass = frameClass(size);
+	if (sizeClass >= kFrameClasses || frameCache.counts[sizeClass] >= kMaxCachedFrames)
+	{
+		::operator delete(frame);
+		return;
+	}
+	frameCache.frames[sizeClass] = new (frame) FreeFrame{frameCache.frames[sizeClass]};
+	frameCache.counts[sizeClass]++;
+}
+
+}
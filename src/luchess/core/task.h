@@ -0,0 +1,90 @@
+#ifndef LUCHESS_CORE_TASK_H_
+#define LUCHESS_CORE_TASK_H_
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <utility>
+
+/**
+
+Lazily started coroutine task.
+
+A Task runs when it is awaited and hands control back to the awaiting
+coroutine when it finishes (symmetric transfer), so a chain of nested
+tasks can suspend as a whole from its innermost frame and be resumed
+from there later. Frames come from a per thread free list so a deep
+search does not hit the global allocator for every node.
+
+**/
+
+namespace luchess{
+
+void* _allocateFrame(std::size_t size);
+void _freeFrame(void* frame, std::size_t size);
+
+template <typename T>
+struct Task
+{
+	struct promise_type
+	{
+		struct FinalAwaiter
+		{
+			bool await_ready() noexcept { return false; }
+			std::coroutine_handle<> await_suspend(
+				std::coroutine_handle<promise_type> handle) noexcept
+			{
+				return handle.promise().continuation;
+			}
+			void await_resume() noexcept {}
+		};
+
+		Task get_return_object()
+		{
+			return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		FinalAwaiter final_suspend() noexcept { return {}; }
+		void return_value(T result) { value = std::move(result); }
+		void unhandled_exception() { std::terminate(); }
+
+		static void* operator new(std::size_t size) { return _allocateFrame(size); }
+		static void operator delete(void* frame, std::size_t size) { _freeFrame(frame, size); }
+
+		std::coroutine_handle<> continuation = std::noop_coroutine();
+		T value{};
+	};
+
+	explicit Task(std::coroutine_handle<promise_type> _handle) :
+	handle(_handle)
+	{}
+
+	Task(Task&& other) noexcept :
+	handle(std::exchange(other.handle, nullptr))
+	{}
+
+	Task(Task const&) = delete;
+	Task& operator=(Task const&) = delete;
+
+	~Task()
+	{
+		if (handle)
+			handle.destroy();
+	}
+
+	bool await_ready() const noexcept { return false; }
+
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+	{
+		handle.promise().continuation = caller;
+		return handle;
+	}
+
+	T await_resume() { return std::move(handle.promise().value); }
+
+	std::coroutine_handle<promise_type> handle;
+};
+
+}
+
+#endif // LUCHESS_CORE_TASK_H_
@@ -0,0 +1,496 @@
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "luchess/core/threadpool.h"
+
+namespace luchess{
+
+// ========================Deque======================================
+
+WorkDeque::Ring::Ring(int64_t _capacity) :
+	capacity(_capacity),
+	slots(new std::atomic<PoolTask*>[std::size_t(_capacity)])
+{
+}
+
+WorkDeque::WorkDeque()
+{
+	rings.push_back(std::make_unique<Ring>(256));
+	ring.store(rings.back().get(), std::memory_order_relaxed);
+}
+
+void WorkDeque::push(PoolTask* task)
+{
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+	Ring* current = ring.load(std::memory_order_relaxed);
+	if (b - t >= current->capacity)
+	{
+		auto grown = std::make_unique<Ring>(current->capacity * 2);
+		for (int64_t i = t; i < b; i++)
+			grown->put(i, current->get(i));
+		current = grown.get();
+		rings.push_back(std::move(grown));
+		ring.store(current, std::memory_order_release);
+	}
+	current->put(b, task);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+PoolTask* WorkDeque::pop()
+{
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	Ring* current = ring.load(std::memory_order_relaxed);
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+	if (t > b)
+	{
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	PoolTask* task = current->get(b);
+	// The last task, a thief may be taking it too
+	if (t == b)
+	{
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+				std::memory_order_relaxed))
+			task = nullptr;
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return task;
+}
+
+PoolTask* WorkDeque::steal()
+{
+	while (true)
+	{
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+		if (t >= b)
+			return nullptr;
+		PoolTask* task = ring.load(std::memory_order_acquire)->get(t);
+		if (top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+				std::memory_order_relaxed))
+			return task;
+	}
+}
+
+// ========================Placement==================================
+
+namespace{
+
+// The worker running on this thread, with its pool
+thread_local ThreadPool* currentPool = nullptr;
+thread_local PoolWorker* currentWorker = nullptr;
+
+// Steady clock reading for PoolWorker::busySince, never 0 in practice
+int64_t clockNanos()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// "0-3,8-11" style list from sysfs
+std::vector<int> parseCpuList(std::string const& list)
+{
+	std::vector<int> cpus;
+	std::size_t at = 0;
+	while (at < list.size())
+	{
+		std::size_t end = list.find(',', at);
+		if (end == std::string::npos)
+			end = list.size();
+		std::string range = list.substr(at, end - at);
+		std::size_t dash = range.find('-');
+		try
+		{
+			int first = std::stoi(range.substr(0, dash));
+			int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+			for (int cpu = first; cpu <= last; cpu++)
+				cpus.push_back(cpu);
+		}
+		catch (std::exception const&)
+		{
+		}
+		at = end + 1;
+	}
+	return cpus;
+}
+
+// The CPUs this process may run on, by NUMA node. One node holding them
+// all where sysfs has no node directory.
+std::vector<std::vector<int>> cpusByNode()
+{
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+		return {};
+	std::map<int, std::vector<int>> nodes;
+	std::vector<bool> placed(CPU_SETSIZE);
+	for (int node = 0; node < 1024; node++)
+	{
+		std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+		std::string list;
+		if (!file || !std::getline(file, list))
+			continue;
+		for (int cpu : parseCpuList(list))
+		{
+			if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed) && !placed[cpu])
+			{
+				nodes[node].push_back(cpu);
+				placed[cpu] = true;
+			}
+		}
+	}
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+	{
+		if (CPU_ISSET(cpu, &allowed) && !placed[cpu])
+			nodes[nodes.empty() ? 0 : nodes.begin()->first].push_back(cpu);
+	}
+	std::vector<std::vector<int>> byNode;
+	for (auto& [node, cpus] : nodes)
+	{
+		if (!cpus.empty())
+			byNode.push_back(std::move(cpus));
+	}
+	return byNode;
+}
+
+void spinPause()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+}
+
+// Deals the workers out over the nodes in turn, then gives each the
+// other workers to steal from, its own node's first
+void ThreadPool::_place(bool pinned)
+{
+	std::vector<std::vector<int>> nodes = pinned ? cpusByNode() : std::vector<std::vector<int>>{};
+	for (uint i = 0; i < size(); i++)
+	{
+		PoolWorker& worker = *_workers[i];
+		if (!nodes.empty())
+		{
+			worker.node = i % nodes.size();
+			std::vector<int> const& cpus = nodes[worker.node];
+			worker.cpu = cpus[(i / nodes.size()) % cpus.size()];
+		}
+	}
+	for (uint i = 0; i < size(); i++)
+	{
+		PoolWorker& worker = *_workers[i];
+		for (uint step = 1; step < size(); step++)
+			worker.victims.push_back((i + step) % size());
+		std::stable_partition(worker.victims.begin(), worker.victims.end(),
+			[&](uint victim) { return _workers[victim]->node == worker.node; });
+	}
+}
+
+// ========================Pool=======================================
+
+ThreadPool::ThreadPool(ThreadPoolOptions const& _options) :
+	options(_options),
+	_started(std::chrono::steady_clock::now())
+{
+	if (options.threads == 0)
+		options.threads = std::max(1u, std::thread::hardware_concurrency());
+	for (uint i = 0; i < options.threads; i++)
+		_workers.push_back(std::make_unique<PoolWorker>());
+	_place(options.pinned);
+	for (uint i = 0; i < options.threads; i++)
+		_threads.emplace_back([this, i] { _workerLoop(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+	_stopping = true;
+	_signal.fetch_add(1);
+	_signal.notify_all();
+	_threads.clear();
+}
+
+void ThreadPool::submit(std::move_only_function<void()> task, TaskPriority priority)
+{
+	auto queued = new PoolTask{std::move(task)};
+	uint level = uint(priority);
+	if (currentPool == this)
+		currentWorker->deques[level].push(queued);
+	else
+	{
+		std::lock_guard lock(_injectMutex);
+		_injected[level].push_back(queued);
+		_injectedCount[level].fetch_add(1, std::memory_order_relaxed);
+	}
+	_wake();
+}
+
+// Pairs with the fetch_add on _sleepers of a parking worker: either it
+// sees the task in its last look, or this sees it parking
+void ThreadPool::_wake()
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (_sleepers.load(std::memory_order_relaxed))
+	{
+		_signal.fetch_add(1);
+		_signal.notify_one();
+	}
+}
+
+PoolTask* ThreadPool::_findTask(PoolWorker* self, bool& stolen)
+{
+	stolen = false;
+	for (uint level = 0; level < kTaskPriorities; level++)
+	{
+		if (self)
+		{
+			if (PoolTask* task = self->deques[level].pop())
+				return task;
+		}
+		if (_injectedCount[level].load(std::memory_order_relaxed))
+		{
+			std::lock_guard lock(_injectMutex);
+			if (!_injected[level].empty())
+			{
+				PoolTask* task = _injected[level].front();
+				_injected[level].pop_front();
+				_injectedCount[level].fetch_sub(1, std::memory_order_relaxed);
+				return task;
+			}
+		}
+		auto tryVictim = [&](uint victim)
+		{
+			return _workers[victim]->deques[level].steal();
+		};
+		stolen = true;
+		if (self)
+		{
+			for (uint victim : self->victims)
+			{
+				if (PoolTask* task = tryVictim(victim))
+					return task;
+			}
+		}
+		else
+		{
+			for (uint victim = 0; victim < size(); victim++)
+			{
+				if (PoolTask* task = tryVictim(victim))
+					return task;
+			}
+		}
+		stolen = false;
+	}
+	return nullptr;
+}
+
+void ThreadPool::_run(PoolWorker* self, PoolTask* task, bool stolen)
+{
+	task->function();
+	delete task;
+	if (self)
+	{
+		self->executed.fetch_add(1, std::memory_order_relaxed);
+		if (stolen)
+			self->steals.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+		_helped.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool ThreadPool::_runOne()
+{
+	PoolWorker* self = currentPool == this ? currentWorker : nullptr;
+	bool stolen;
+	PoolTask* task = _findTask(self, stolen);
+	if (!task)
+		return false;
+	_run(self, task, stolen);
+	return true;
+}
+
+void ThreadPool::_workerLoop(uint index)
+{
+	PoolWorker* self = _workers[index].get();
+	currentPool = this;
+	currentWorker = self;
+	if (self->cpu >= 0)
+	{
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(self->cpu, &cpus);
+		// Not fatal, the worker just runs anywhere
+		pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	}
+
+	uint idleRounds = 0;
+	while (true)
+	{
+		bool stolen;
+		PoolTask* task = _findTask(self, stolen);
+		if (task)
+		{
+			if (!self->busySince.load(std::memory_order_relaxed))
+				self->busySince.store(clockNanos(), std::memory_order_relaxed);
+			_run(self, task, stolen);
+			idleRounds = 0;
+			continue;
+		}
+		if (int64_t since = self->busySince.exchange(0, std::memory_order_relaxed))
+			self->busyNanos.fetch_add(uint64_t(clockNanos() - since),
+				std::memory_order_relaxed);
+		// Only once nothing is left, so the destructor drains the pool
+		if (_stopping.load())
+			break;
+		if (idleRounds++ < options.spins)
+		{
+			spinPause();
+			continue;
+		}
+
+		uint32_t signal = _signal.load();
+		_sleepers.fetch_add(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		task = _findTask(self, stolen);
+		if (!task && !_stopping.load())
+		{
+			self->parks.fetch_add(1, std::memory_order_relaxed);
+			_signal.wait(signal);
+		}
+		_sleepers.fetch_sub(1);
+		if (task)
+		{
+			self->busySince.store(clockNanos(), std::memory_order_relaxed);
+			_run(self, task, stolen);
+		}
+		idleRounds = 0;
+	}
+	currentPool = nullptr;
+	currentWorker = nullptr;
+}
+
+ThreadPoolStats ThreadPool::stats() const
+{
+	ThreadPoolStats stats;
+	stats.workers = size();
+	stats.executed = _helped.load(std::memory_order_relaxed);
+	uint64_t busyNanos = 0;
+	int64_t now = clockNanos();
+	for (auto const& worker : _workers)
+	{
+		// A worker still on a long task has not credited it yet. Racing
+		// with the credit may count an interval twice, the clamp below
+		// keeps that in bounds
+		if (int64_t since = worker->busySince.load(std::memory_order_relaxed))
+			busyNanos += uint64_t(std::max<int64_t>(now - since, 0));
+		stats.executed += worker->executed.load(std::memory_order_relaxed);
+		stats.steals += worker->steals.load(std::memory_order_relaxed);
+		stats.parks += worker->parks.load(std::memory_order_relaxed);
+		busyNanos += worker->busyNanos.load(std::memory_order_relaxed);
+	}
+	double elapsed = double(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - _started).count());
+	if (elapsed > 0)
+		stats.utilisation = std::min(1.0, double(busyNanos) / (elapsed * stats.workers));
+	return stats;
+}
+
+ThreadPool& sharedThreadPool()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+// ========================Groups=====================================
+
+TaskGroup::TaskGroup(ThreadPool& _pool, TaskPriority _priority) :
+	pool(_pool),
+	priority(_priority)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+	try
+	{
+		wait();
+	}
+	catch (...)
+	{
+	}
+}
+
+void TaskGroup::run(std::move_only_function<void()> task)
+{
+	_pending.fetch_add(1, std::memory_order_relaxed);
+	pool.submit([this, task = std::move(task)]() mutable
+	{
+		try
+		{
+			task();
+		}
+		catch (...)
+		{
+			std::lock_guard lock(_errorMutex);
+			if (!_error)
+				_error = std::current_exception();
+		}
+		// The group may be gone once _pending reads 0, so the waiters
+		// sleep on the pool
+		ThreadPool& owner = pool;
+		if (_pending.fetch_sub(1) == 1)
+		{
+			owner._completions.fetch_add(1);
+			owner._completions.notify_all();
+		}
+	}, priority);
+}
+
+void TaskGroup::wait()
+{
+	uint idleRounds = 0;
+	while (_pending.load())
+	{
+		if (pool._runOne())
+		{
+			idleRounds = 0;
+			continue;
+		}
+		if (idleRounds++ < pool.options.spins)
+		{
+			spinPause();
+			continue;
+		}
+		uint32_t completions = pool._completions.load();
+		if (_pending.load())
+			pool._completions.wait(completions);
+		idleRounds = 0;
+	}
+	std::lock_guard lock(_errorMutex);
+	if (std::exception_ptr error = std::exchange(_error, nullptr))
+		std::rethrow_exception(error);
+}
+
+void runTasks(ThreadPool& pool, uint count, std::function<void(uint)> const& task)
+{
+	TaskGroup group(pool);
+	for (uint i = 1; i < count; i++)
+		group.run([&task, i] { task(i); });
+	if (count)
+		task(0);
+	group.wait();
+}
+
+}
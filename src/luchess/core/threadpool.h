@@ -0,0 +1,216 @@
+#ifndef LUCHESS_CORE_THREADPOOL_H_
+#define LUCHESS_CORE_THREADPOOL_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "luchess/core/types.h"
+
+/**
+
+Work stealing thread pool, one for every parallel job of the library.
+
+Each worker owns a Chase-Lev deque per priority: it pushes and pops
+tasks at the bottom of its own deques, and idle workers steal from the
+top of the others'. Tasks submitted from outside the pool go through a
+locked queue per priority. A worker looking for work takes Interactive
+tasks (its own, then the queue's, then stolen) before any Background
+task, so a move validation submitted while analyses run starts at the
+next task boundary. Running tasks are never interrupted.
+
+A worker out of work keeps looking for ThreadPoolOptions::spins rounds
+and then parks on a futex. Submitting a task only wakes one when some
+worker is parked.
+
+With ThreadPoolOptions::pinned every worker is bound to one CPU of the
+process's affinity mask. The CPUs are dealt out node by node, as listed
+under /sys/devices/system/node, so workers spread evenly over the NUMA
+nodes. A worker steals from workers on its own node before the others.
+
+TaskGroup runs a batch of tasks and waits for all of them. A thread
+waiting on a group runs queued tasks meanwhile, so tasks can fork and
+wait on groups of their own.
+
+**/
+
+namespace luchess{
+
+enum class TaskPriority : uint8_t
+{
+	Interactive,
+	Background,
+};
+static constexpr uint kTaskPriorities = 2;
+
+struct ThreadPoolOptions
+{
+	// Hardware concurrency when 0
+	uint threads = 0;
+	// Bind each worker to one CPU, see above
+	bool pinned = false;
+	// Rounds a worker looks for work before parking, defaults to none on
+	// a single core where nothing can turn up meanwhile
+	uint spins = std::thread::hardware_concurrency() > 1 ? 2000 : 0;
+};
+
+struct ThreadPoolStats
+{
+	uint workers = 0;
+	// Tasks run, by the workers or by threads waiting on a group
+	uint64_t executed = 0;
+	// Tasks taken from another worker's deque
+	uint64_t steals = 0;
+	uint64_t parks = 0;
+	// Share of the workers' time since the pool started spent running
+	// tasks, 0 to 1
+	double utilisation = 0;
+};
+
+struct PoolTask
+{
+	std::move_only_function<void()> function;
+};
+
+// Chase-Lev deque of tasks: push and pop by the owner at the bottom,
+// steal by anyone at the top. Grows by doubling; replaced rings are kept
+// until the deque goes, as a thief may still be reading one.
+struct WorkDeque
+{
+	struct Ring
+	{
+		explicit Ring(int64_t capacity);
+
+		PoolTask* get(int64_t index) const
+		{
+			return slots[index & (capacity - 1)].load(std::memory_order_relaxed);
+		}
+		void put(int64_t index, PoolTask* task)
+		{
+			slots[index & (capacity - 1)].store(task, std::memory_order_relaxed);
+		}
+
+		int64_t capacity;
+		std::unique_ptr<std::atomic<PoolTask*>[]> slots;
+	};
+
+	WorkDeque();
+	WorkDeque(WorkDeque const&) = delete;
+	WorkDeque& operator=(WorkDeque const&) = delete;
+
+	// Owner only
+	void push(PoolTask* task);
+	PoolTask* pop();
+	// Anyone, null when empty. Retries when it loses a race, so null
+	// means the deque was seen empty.
+	PoolTask* steal();
+
+	alignas(64) std::atomic<int64_t> top = 0;
+	alignas(64) std::atomic<int64_t> bottom = 0;
+	std::atomic<Ring*> ring;
+	// Owner only
+	std::vector<std::unique_ptr<Ring>> rings;
+};
+
+struct PoolWorker
+{
+	std::array<WorkDeque, kTaskPriorities> deques;
+	// Other workers by steal preference, same node first
+	std::vector<uint> victims;
+	// -1 when not pinned
+	int cpu = -1;
+	uint node = 0;
+	std::atomic<uint64_t> executed = 0;
+	std::atomic<uint64_t> steals = 0;
+	std::atomic<uint64_t> parks = 0;
+	std::atomic<uint64_t> busyNanos = 0;
+	// Start of the current busy interval in steady clock nanoseconds, 0
+	// while idle, so stats() also counts the time not yet in busyNanos
+	std::atomic<int64_t> busySince = 0;
+};
+
+struct ThreadPool
+{
+	explicit ThreadPool(ThreadPoolOptions const& options = {});
+	ThreadPool(ThreadPool const&) = delete;
+	ThreadPool& operator=(ThreadPool const&) = delete;
+	// Runs every task still queued, then joins the workers
+	~ThreadPool();
+
+	// Safe from any thread. A worker of this pool pushes to its own
+	// deque. An exception escaping the task terminates, see TaskGroup.
+	void submit(std::move_only_function<void()> task,
+		TaskPriority priority = TaskPriority::Background);
+
+	uint size() const { return uint(_workers.size()); }
+	// CPU and NUMA node of a worker, -1 for an unpinned one
+	int workerCpu(uint worker) const { return _workers[worker]->cpu; }
+	uint workerNode(uint worker) const { return _workers[worker]->node; }
+	ThreadPoolStats stats() const;
+
+	// Runs one queued task on the calling thread, false when none was found
+	bool _runOne();
+	PoolTask* _findTask(PoolWorker* self, bool& stolen);
+	void _run(PoolWorker* self, PoolTask* task, bool stolen);
+	void _workerLoop(uint index);
+	void _wake();
+	void _place(bool pinned);
+
+	ThreadPoolOptions options;
+	std::vector<std::unique_ptr<PoolWorker>> _workers;
+	// Tasks submitted from outside, by priority
+	std::array<std::deque<PoolTask*>, kTaskPriorities> _injected;
+	std::array<std::atomic<std::size_t>, kTaskPriorities> _injectedCount{};
+	std::mutex _injectMutex;
+	// Parked workers sleep on _signal, bumped to wake them
+	std::atomic<uint32_t> _signal = 0;
+	std::atomic<uint> _sleepers = 0;
+	// Bumped whenever a TaskGroup finishes, its waiters sleep on it
+	std::atomic<uint32_t> _completions = 0;
+	std::atomic<bool> _stopping = false;
+	// Tasks run by threads outside the pool
+	std::atomic<uint64_t> _helped = 0;
+	std::chrono::steady_clock::time_point _started;
+	std::vector<std::jthread> _threads;
+};
+
+// Tasks run on a pool and waited for together
+struct TaskGroup
+{
+	explicit TaskGroup(ThreadPool& pool, TaskPriority priority = TaskPriority::Background);
+	TaskGroup(TaskGroup const&) = delete;
+	TaskGroup& operator=(TaskGroup const&) = delete;
+	// Waits, dropping any exception
+	~TaskGroup();
+
+	void run(std::move_only_function<void()> task);
+	// Runs queued tasks until every task of the group has finished, then
+	// rethrows the first exception one of them threw
+	void wait();
+
+	ThreadPool& pool;
+	TaskPriority priority;
+	std::atomic<uint64_t> _pending = 0;
+	std::mutex _errorMutex;
+	std::exception_ptr _error;
+};
+
+// Pool of hardware concurrency workers created on first use, for
+// library code not handed one
+ThreadPool& sharedThreadPool();
+
+// Runs task(0) to task(count - 1) as one group on 'pool', task 0 on the
+// calling thread, and waits for all of them
+void runTasks(ThreadPool& pool, uint count, std::function<void(uint)> const& task);
+
+}
+
+#endif // LUCHESS_CORE_THREADPOOL_H_
@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+#include "luchess/core/tournament.h"
+#include "luchess/core/history.h"
+#include "luchess/core/movegen.h"
+#include "luchess/core/threadpool.h"
+
+namespace luchess{
+
+// ========================Statistics=================================
+
+// Expected points per game of a side that much stronger
+static double eloToScore(double elo)
+{
+	return 1. / (1. + std::pow(10., -elo / 400.));
+}
+
+static double scoreToElo(double score)
+{
+	// Keeps a clean sweep finite
+	score = std::clamp(score, 1e-6, 1. - 1e-6);
+	return -400. * std::log10(1. / score - 1.);
+}
+
+double SprtBounds::lower() const
+{
+	return std::log(beta / (1. - alpha));
+}
+
+double SprtBounds::upper() const
+{
+	return std::log((1. - beta) / alpha);
+}
+
+uint64_t TournamentStats::pairs() const
+{
+	uint64_t total = 0;
+	for (uint64_t count : pentanomial)
+		total += count;
+	return total;
+}
+
+double TournamentStats::score() const
+{
+	return games() ? (wins + draws * 0.5) / games() : 0.5;
+}
+
+double TournamentStats::elo() const
+{
+	return scoreToElo(score());
+}
+
+// Variance of the points per game of one pair
+static double pairVariance(TournamentStats const& stats)
+{
+	double mean = stats.score();
+	double variance = 0.;
+	for (uint points = 0; points < stats.pentanomial.size(); points++)
+	{
+		double deviation = points / 4. - mean;
+		variance += stats.pentanomial[points] * deviation * deviation;
+	}
+	return variance / stats.pairs();
+}
+
+double TournamentStats::eloError() const
+{
+	if (pairs() < 2)
+		return 0.;
+	double error = 1.96 * std::sqrt(pairVariance(*this) / pairs());
+	return (scoreToElo(score() + error) - scoreToElo(score() - error)) / 2.;
+}
+
+double TournamentStats::llr(SprtBounds const& bounds) const
+{
+	if (pairs() < 2)
+		return 0.;
+	double variance = pairVariance(*this);
+	if (variance <= 0.)
+		return 0.;
+	double score0 = eloToScore(bounds.elo0);
+	double score1 = eloToScore(bounds.elo1);
+	return pairs() * (score1 - score0) * (2. * score() - score0 - score1) / (2. * variance);
+}
+
+SprtDecision TournamentStats::decision(SprtBounds const& bounds) const
+{
+	double ratio = llr(bounds);
+	if (ratio >= bounds.upper())
+		return SprtDecision::AcceptH1;
+	if (ratio <= bounds.lower())
+		return SprtDecision::AcceptH0;
+	return SprtDecision::Continue;
+}
+
+// Half points the first engine scored
+static uint halfPoints(GameResult result, PieceColor firstColor)
+{
+	if (result == GameResult::Draw || result == GameResult::Unknown)
+		return 1;
+	bool whiteWon = result == GameResult::WhiteWins;
+	return whiteWon == (firstColor == White) ? 2 : 0;
+}
+
+void TournamentStats::addPair(GameResult withWhite, GameResult withBlack)
+{
+	uint points = 0;
+	for (uint half : {halfPoints(withWhite, White), halfPoints(withBlack, Black)})
+	{
+		points += half;
+		if (half == 2)
+			wins++;
+		else if (half == 0)
+			losses++;
+		else
+			draws++;
+	}
+	pentanomial[points]++;
+}
+
+double TournamentSummary::gamesPerMinute() const
+{
+	return elapsed.count() ? stats.games() * 6e7 / elapsed.count() : 0.;
+}
+
+// ========================Games======================================
+
+// Unknown when 'stopped' cut the game short
+template<typename Stopped>
+static GameResult playGame(ChessBoard const& opening, std::array<SearchLimits, 2> const& engines,
+	uint whiteEngine, uint maxPlies, Stopped const& stopped)
+{
+	GameHistory game(opening);
+	if (!hasLegalMove(game.board))
+		return game.board._isKingExposed(game.board.nextGo()) ?
+			(game.board.nextGo() == White ? GameResult::BlackWins : GameResult::WhiteWins) :
+			GameResult::Draw;
+
+	for (uint ply = 0; ply < maxPlies; ply++)
+	{
+		if (stopped())
+			return GameResult::Unknown;
+		uint engine = game.board.nextGo() == White ? whiteEngine : 1 - whiteEngine;
+		SearchInfo info = search(game.board, engines[engine]);
+		BoardMove move;
+		if (info.bestMove())
+		{
+			move = *info.bestMove();
+		}
+		else
+		{
+			// The budget ran out before depth 1 finished
+			MoveList moves;
+			generateLegalMoves(game.board, moves);
+			move = moves[0];
+		}
+
+		auto result = game.play(move);
+		if (result.finished)
+		{
+			if (!result.winner)
+				return GameResult::Draw;
+			return *result.winner ? GameResult::WhiteWins : GameResult::BlackWins;
+		}
+	}
+	return GameResult::Draw;
+}
+
+// ========================Runner=====================================
+
+TournamentSummary runTournament(std::array<SearchLimits, 2> const& engines,
+	std::span<ChessBoard const> openings, TournamentOptions const& options,
+	std::atomic<bool> const& stop,
+	std::function<void(TournamentStats const&)> const& onPair)
+{
+	using Clock = std::chrono::steady_clock;
+	auto start = Clock::now();
+
+	TournamentSummary summary;
+	uint pairs = openings.empty() ? 0 : options.pairs;
+	uint threads = options.threads;
+	if (threads == 0)
+		threads = sharedThreadPool().size();
+	threads = std::min(threads, std::max(pairs, 1u));
+
+	std::atomic<uint> next = 0;
+	std::atomic<bool> decided = false;
+	std::mutex statsMutex;
+	auto stopped = [&]()
+	{
+		return stop.load(std::memory_order_relaxed) || decided.load(std::memory_order_relaxed);
+	};
+	auto worker = [&](uint)
+	{
+		for (uint pair = next.fetch_add(1, std::memory_order_relaxed);
+			 pair < pairs && !stopped();
+			 pair = next.fetch_add(1, std::memory_order_relaxed))
+		{
+			ChessBoard const& opening = openings[pair % openings.size()];
+			GameResult withWhite = playGame(opening, engines, 0, options.maxPlies, stopped);
+			GameResult withBlack = playGame(opening, engines, 1, options.maxPlies, stopped);
+			if (withWhite == GameResult::Unknown || withBlack == GameResult::Unknown)
+				break;
+
+			std::lock_guard lock(statsMutex);
+			if (decided)
+				break;
+			summary.stats.addPair(withWhite, withBlack);
+			summary.decision = summary.stats.decision(options.sprt);
+			if (summary.decision != SprtDecision::Continue)
+				decided = true;
+			if (onPair)
+				onPair(summary.stats);
+		}
+	};
+
+	runTasks(sharedThreadPool(), threads, worker);
+
+	summary.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+		Clock::now() - start);
+	return summary;
+}
+
+}
@@ -0,0 +1,117 @@
+#ifndef LUCHESS_CORE_TOURNAMENT_H_
+#define LUCHESS_CORE_TOURNAMENT_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "luchess/core/board.h"
+#include "luchess/core/replay.h"
+#include "luchess/core/search.h"
+#include "luchess/core/types.h"
+
+/**
+
+Engine against engine matches.
+
+runTournament plays game pairs between two search configurations on a
+pool of workers. Both games of a pair start from the same opening with
+the colours swapped, so an unbalanced opening favours neither side.
+Every game has its own GameHistory, whose board and repetition tracker
+end it on mate, stalemate, threefold repetition or the fifty move rule.
+Node and depth budgets make the search deterministic, so an opening
+used twice plays the same pair twice; give at least as many openings
+as pairs.
+
+Results are kept per pair (the pentanomial counts of 0, 1/2, 1, 3/2 or
+2 points for the first engine). Pairs are what the games really sample
+and their variance is the smaller, truer one. After every pair the
+sequential probability ratio test asks whether the first engine is
+elo1 stronger or elo0 stronger (normal approximation to the
+generalised SPRT), and the match stops as soon as either bound is hit.
+
+**/
+
+namespace luchess{
+
+struct SprtBounds
+{
+	// The null and alternative hypotheses in logistic Elo
+	double elo0 = 0.;
+	double elo1 = 5.;
+	// False positive and false negative rates
+	double alpha = 0.05;
+	double beta = 0.05;
+
+	double lower() const;
+	double upper() const;
+};
+
+enum class SprtDecision : uint
+{
+	Continue,
+	// elo0 holds, the change is no better
+	AcceptH0,
+	// elo1 holds, the change is an improvement
+	AcceptH1,
+};
+
+// From the first engine's point of view
+struct TournamentStats
+{
+	uint64_t games() const { return wins + losses + draws; }
+	uint64_t pairs() const;
+	// Mean points per game
+	double score() const;
+	double elo() const;
+	// Half width of the 95% confidence interval
+	double eloError() const;
+	// Log likelihood ratio of elo1 against elo0
+	double llr(SprtBounds const& bounds) const;
+	SprtDecision decision(SprtBounds const& bounds) const;
+
+	// Results of the pair's games, the first engine has white in the first
+	void addPair(GameResult withWhite, GameResult withBlack);
+
+	uint64_t wins = 0;
+	uint64_t losses = 0;
+	uint64_t draws = 0;
+	// Pairs by points scored over both games, in half points
+	std::array<uint64_t, 5> pentanomial{};
+};
+
+struct TournamentOptions
+{
+	// Pairs to play at most, each from openings[pair % openings.size()]
+	uint pairs = 0;
+	// Longer games are adjudicated a draw
+	uint maxPlies = 400;
+	SprtBounds sprt;
+	// Tasks on sharedThreadPool(), its size when 0
+	uint threads = 0;
+};
+
+struct TournamentSummary
+{
+	double gamesPerMinute() const;
+
+	TournamentStats stats;
+	SprtDecision decision = SprtDecision::Continue;
+	std::chrono::microseconds elapsed{0};
+};
+
+// Plays engines[0] against engines[1] as described above. 'onPair' is
+// called with the running totals after every finished pair, one call
+// at a time. Setting 'stop' ends the match early; pairs in progress are
+// dropped.
+TournamentSummary runTournament(std::array<SearchLimits, 2> const& engines,
+	std::span<ChessBoard const> openings, TournamentOptions const& options,
+	std::atomic<bool> const& stop,
+	std::function<void(TournamentStats const&)> const& onPair = {});
+
+}
+
+#endif // LUCHESS_CORE_TOURNAMENT_H_
@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "luchess/core/transposition.h"
+#include "luchess/core/chess.h"
+#include "luchess/core/eval.h"
+#include "luchess/core/fen.h"
+#include "luchess/core/search.h"
+#include "luchess/core/zobrist.h"
+
+namespace luchess{
+
+// ========================Table======================================
+
+TranspositionTable::TranspositionTable(std::size_t megabytes)
+{
+	_allocate(clustersFor(megabytes));
+}
+
+std::size_t TranspositionTable::clustersFor(std::size_t megabytes)
+{
+	return std::bit_floor(std::max((megabytes << 20) / sizeof(TTCluster), kPageClusters));
+}
+
+TranspositionTable::TranspositionTable(TranspositionTable&& other) noexcept :
+	_table(std::exchange(other._table, nullptr)),
+	_clusterMask(other._clusterMask),
+	_generation(other._generation),
+	_pageChecksums(std::move(other._pageChecksums)),
+	_checkedPages(std::move(other._checkedPages))
+{
+}
+
+TranspositionTable& TranspositionTable::operator=(TranspositionTable&& other) noexcept
+{
+	if (this != &other)
+	{
+		_release();
+		_table = std::exchange(other._table, nullptr);
+		_clusterMask = other._clusterMask;
+		_generation = other._generation;
+		_pageChecksums = std::move(other._pageChecksums);
+		_checkedPages = std::move(other._checkedPages);
+	}
+	return *this;
+}
+
+TranspositionTable::~TranspositionTable()
+{
+	_release();
+}
+
+void TranspositionTable::_release()
+{
+	if (_table)
+		munmap(_table, bytes());
+	_table = nullptr;
+	_pageChecksums.clear();
+	_checkedPages.clear();
+}
+
+// Anonymous memory reads as zeros, every entry empty, and is only
+// committed as it is touched
+void TranspositionTable::_allocate(std::size_t clusters)
+{
+	void* memory = mmap(nullptr, clusters * sizeof(TTCluster), PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED)
+		throw std::bad_alloc();
+	_table = static_cast<TTCluster*>(memory);
+	_clusterMask = clusters - 1;
+}
+
+void TranspositionTable::clear()
+{
+	std::size_t count = clusters();
+	_release();
+	_allocate(count);
+	_generation = 0;
+}
+
+TTCluster& TranspositionTable::_cluster(uint64_t key)
+{
+	std::size_t index = key & _clusterMask;
+	if (!_pageChecksums.empty())
+	{
+		std::size_t page = index / kPageClusters;
+		if (!(_checkedPages[page / 64] >> (page % 64) & 1))
+			_checkPage(page);
+	}
+	return _table[index];
+}
+
+static bool isMateScore(int score)
+{
+	return std::abs(score) > kMateScore - int(kMaxPly);
+}
+
+std::optional<TTEntry> TranspositionTable::probe(uint64_t key, uint ply)
+{
+	for (TTEntry const& entry : _cluster(key).entries)
+	{
+		if (entry.key != key || entry.bound() == TTBound::None)
+			continue;
+		TTEntry found = entry;
+		if (isMateScore(found.score))
+			found.score = int16_t(found.score > 0 ? found.score - int(ply) : found.score + int(ply));
+		return found;
+	}
+	return std::nullopt;
+}
+
+void TranspositionTable::store(uint64_t key, uint depth, int score, TTBound bound,
+	std::optional<BoardMove> move, uint ply)
+{
+	TTCluster& cluster = _cluster(key);
+	// Same key, else empty, else shallowest counting 8 plies per search
+	// of age
+	TTEntry* replaced = &cluster.entries[0];
+	int lowest = INT32_MAX;
+	for (TTEntry& entry : cluster.entries)
+	{
+		if (entry.key == key || entry.bound() == TTBound::None)
+		{
+			replaced = &entry;
+			break;
+		}
+		int value = int(entry.depth) - 8 * ((_generation - entry.generation()) & 63);
+		if (value < lowest)
+		{
+			lowest = value;
+			replaced = &entry;
+		}
+	}
+
+	if (isMateScore(score))
+		score = score > 0 ? score + int(ply) : score - int(ply);
+	uint16_t packed = move ? packMove(*move) : 0;
+	// A search that found no better move keeps the one stored before
+	if (!packed && replaced->key == key)
+		packed = replaced->move;
+	*replaced = TTEntry{key, packed, int16_t(score), uint8_t(std::min(depth, 255u)),
+		uint8_t(uint(bound) | _generation << 2), 0};
+}
+
+// ========================Snapshots==================================
+
+static constexpr uint32_t kTableFileVersion = 1;
+// Entries start on a boundary any page size mmap needs divides
+static constexpr std::size_t kEntryAlignment = 1 << 16;
+
+struct TableFileHeader
+{
+	std::array<char, 8> magic;
+	uint32_t version;
+	uint32_t pageBytes;
+	uint64_t build;
+	uint64_t clusters;
+	// Over the header with this field 0, then the page checksums
+	uint64_t checksum;
+};
+static constexpr std::array<char, 8> kTableFileMagic = {'L', 'U', 'C', 'H', 'E', 'S', 'S', 'T'};
+
+static uint64_t mixWords(uint64_t hash, uint64_t const* words, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; i++)
+	{
+		hash = (hash ^ words[i]) * 0x9E3779B97F4A7C15ull;
+		hash ^= hash >> 32;
+	}
+	return hash;
+}
+
+static uint64_t pageChecksum(TTCluster const* page)
+{
+	return mixWords(0x6c75636865737374ull, reinterpret_cast<uint64_t const*>(page),
+		TranspositionTable::kPageBytes / sizeof(uint64_t));
+}
+
+static uint64_t headerChecksum(TableFileHeader header, std::vector<uint64_t> const& pages)
+{
+	header.checksum = 0;
+	uint64_t words[sizeof(header) / sizeof(uint64_t)];
+	std::memcpy(words, &header, sizeof(header));
+	return mixWords(mixWords(0, words, std::size(words)), pages.data(), pages.size());
+}
+
+// What a table depends on besides its own layout: the zobrist keys it is
+// indexed by and, as far as one position shows, the evaluation behind
+// its scores
+static uint64_t buildSignature()
+{
+	static uint64_t const signature = []
+	{
+		ChessBoard start;
+		populateDefaultLayout(start);
+		ChessBoard kiwipete = *parseFen(
+			"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+		uint64_t words[] = {
+			sizeof(TTEntry), kClusterEntries, uint64_t(kMateScore), kMaxPly,
+			zobristKey(start), zobristKey(kiwipete), uint64_t(int64_t(evaluate(kiwipete)))};
+		return mixWords(0, words, std::size(words));
+	}();
+	return signature;
+}
+
+static std::size_t entryOffset(std::size_t pages)
+{
+	std::size_t head = sizeof(TableFileHeader) + pages * sizeof(uint64_t);
+	return (head + kEntryAlignment - 1) / kEntryAlignment * kEntryAlignment;
+}
+
+void TranspositionTable::_checkPage(std::size_t page)
+{
+	TTCluster* first = _table + page * kPageClusters;
+	if (pageChecksum(first) != _pageChecksums[page])
+		std::memset(static_cast<void*>(first), 0, kPageBytes);
+	_checkedPages[page / 64] |= uint64_t(1) << (page % 64);
+}
+
+std::size_t TranspositionTable::uncheckedPages() const
+{
+	if (_pageChecksums.empty())
+		return 0;
+	std::size_t checked = 0;
+	for (uint64_t word : _checkedPages)
+		checked += std::popcount(word);
+	return _pageChecksums.size() - checked;
+}
+
+void TranspositionTable::save(std::string const& path)
+{
+	std::size_t pages = clusters() / kPageClusters;
+	// A page that never passed its check must not get a fresh checksum
+	for (std::size_t page = 0; page < _pageChecksums.size(); page++)
+	{
+		if (!(_checkedPages[page / 64] >> (page % 64) & 1))
+			_checkPage(page);
+	}
+	std::vector<uint64_t> checksums(pages);
+	for (std::size_t page = 0; page < pages; page++)
+		checksums[page] = pageChecksum(_table + page * kPageClusters);
+
+	TableFileHeader header{kTableFileMagic, kTableFileVersion, uint32_t(kPageBytes),
+		buildSignature(), clusters(), 0};
+	header.checksum = headerChecksum(header, checksums);
+
+	std::string temporary = path + ".tmp";
+	std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(
+		std::fopen(temporary.c_str(), "wb"), &std::fclose);
+	std::vector<char> padding(entryOffset(pages) - sizeof(header) - pages * sizeof(uint64_t));
+	bool written = file &&
+		std::fwrite(&header, sizeof(header), 1, file.get()) == 1 &&
+		std::fwrite(checksums.data(), sizeof(uint64_t), pages, file.get()) == pages &&
+		std::fwrite(padding.data(), 1, padding.size(), file.get()) == padding.size() &&
+		std::fwrite(_table, sizeof(TTCluster), clusters(), file.get()) == clusters() &&
+		std::fflush(file.get()) == 0 && fsync(fileno(file.get())) == 0;
+	written = std::fclose(file.release()) == 0 && written;
+	if (!written || std::rename(temporary.c_str(), path.c_str()) != 0)
+	{
+		std::remove(temporary.c_str());
+		throw std::runtime_error("transposition table: cannot write " + path);
+	}
+}
+
+TranspositionTable TranspositionTable::load(std::string const& path)
+{
+	auto fail = [&](std::string const& why)
+	{
+		return std::runtime_error("transposition table: " + path + " " + why);
+	};
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		throw fail(std::string("cannot be opened: ") + std::strerror(errno));
+	std::unique_ptr<int, void (*)(int*)> closer(&fd, [](int* open) { ::close(*open); });
+
+	TableFileHeader header;
+	struct stat status;
+	if (pread(fd, &header, sizeof(header), 0) != ssize_t(sizeof(header)) ||
+		header.magic != kTableFileMagic)
+		throw fail("is not a transposition table");
+	if (header.version != kTableFileVersion)
+		throw fail("has format version " + std::to_string(header.version) + ", this build reads " +
+			std::to_string(kTableFileVersion));
+	if (header.build != buildSignature() || header.pageBytes != kPageBytes)
+		throw fail("was written by an incompatible build");
+	if (header.clusters < kPageClusters || !std::has_single_bit(header.clusters))
+		throw fail("has a bad size");
+	std::size_t pages = header.clusters / kPageClusters;
+	std::size_t bytes = header.clusters * sizeof(TTCluster);
+	if (fstat(fd, &status) != 0 || std::size_t(status.st_size) != entryOffset(pages) + bytes)
+		throw fail("is truncated");
+
+	std::vector<uint64_t> checksums(pages);
+	if (pread(fd, checksums.data(), pages * sizeof(uint64_t), sizeof(header)) !=
+			ssize_t(pages * sizeof(uint64_t)) ||
+		headerChecksum(header, checksums) != header.checksum)
+		throw fail("has a bad header checksum");
+
+	// Copy on write: probes and stores touch private copies of the pages
+	void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+		off_t(entryOffset(pages)));
+	if (memory == MAP_FAILED)
+		throw fail(std::string("cannot be mapped: ") + std::strerror(errno));
+
+	TranspositionTable table(0);
+	table._release();
+	table._table = static_cast<TTCluster*>(memory);
+	table._clusterMask = header.clusters - 1;
+	table._pageChecksums = std::move(checksums);
+	table._checkedPages.assign((pages + 63) / 64, 0);
+	return table;
+}
+
+}
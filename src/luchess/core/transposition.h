@@ -0,0 +1,131 @@
+#ifndef LUCHESS_CORE_TRANSPOSITION_H_
+#define LUCHESS_CORE_TRANSPOSITION_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "luchess/core/board.h"
+#include "luchess/core/types.h"
+
+/**
+
+Transposition table: search results by zobrist key.
+
+Entries sit four to a 64 byte cluster, the cluster picked by the low
+bits of the key. A store replaces the entry of the same key, else an
+empty one, else the one from the oldest search with the least depth.
+Mate scores are stored relative to the node, so they stay right when
+the position turns up at another ply.
+
+A table can be saved to a file and loaded back for a warm restart. The
+file starts with a versioned header carrying a build signature (entry
+layout, zobrist keys and evaluation of a fixed position) and a checksum
+over the header and one checksum per 4 KB page of entries; load rejects
+a file whose version, signature, size or header checksum does not
+match. The entries are then mapped copy on write, not read: the kernel
+brings a page in on first touch, and that first touch also checks the
+page against its checksum and clears it when it does not match. Startup
+costs the header and the page checksums, eight bytes per page, however
+large the table.
+
+A table is not safe to share between threads.
+
+**/
+
+namespace luchess{
+
+enum class TTBound : uint8_t
+{
+	None,
+	// The score is at most the stored one, it failed low
+	Upper,
+	// The score is at least the stored one, it failed high
+	Lower,
+	Exact,
+};
+
+struct TTEntry
+{
+	TTBound bound() const { return static_cast<TTBound>(flags & 3); }
+	uint8_t generation() const { return flags >> 2; }
+
+	uint64_t key;
+	// See packMove, 0 when there is none
+	uint16_t move;
+	// Relative to the node for mates, see TranspositionTable::probe
+	int16_t score;
+	uint8_t depth;
+	// TTBound in the low two bits, the search generation above
+	uint8_t flags;
+	uint16_t reserved;
+};
+static_assert(sizeof(TTEntry) == 16);
+static_assert(std::is_trivially_copyable_v<TTEntry>);
+
+static constexpr uint kClusterEntries = 4;
+
+struct alignas(64) TTCluster
+{
+	std::array<TTEntry, kClusterEntries> entries;
+};
+
+struct TranspositionTable
+{
+	static constexpr std::size_t kPageBytes = 4096;
+	static constexpr std::size_t kPageClusters = kPageBytes / sizeof(TTCluster);
+
+	// At most 'megabytes', rounded down to a power of two clusters
+	explicit TranspositionTable(std::size_t megabytes = 16);
+	static std::size_t clustersFor(std::size_t megabytes);
+	TranspositionTable(TranspositionTable&& other) noexcept;
+	TranspositionTable& operator=(TranspositionTable&& other) noexcept;
+	TranspositionTable(TranspositionTable const&) = delete;
+	TranspositionTable& operator=(TranspositionTable const&) = delete;
+	~TranspositionTable();
+
+	// Maps the table saved at 'path'. Throws std::runtime_error saying
+	// why when the file cannot be used.
+	static TranspositionTable load(std::string const& path);
+	// Writes the table to 'path' through a temporary file renamed over
+	// it. Throws std::runtime_error when it cannot be written.
+	void save(std::string const& path);
+
+	// Forgets every entry, keeping the size
+	void clear();
+	// Call before each search, older entries are replaced first
+	void newSearch() { _generation = (_generation + 1) & 63; }
+
+	// The entry for 'key', with a mate score made relative to the root
+	// again with 'ply'
+	std::optional<TTEntry> probe(uint64_t key, uint ply);
+	void store(uint64_t key, uint depth, int score, TTBound bound,
+		std::optional<BoardMove> move, uint ply);
+
+	std::size_t clusters() const { return _clusterMask + 1; }
+	std::size_t bytes() const { return clusters() * sizeof(TTCluster); }
+	// Pages of a loaded table whose checksum has not been checked yet
+	std::size_t uncheckedPages() const;
+
+	void _allocate(std::size_t clusters);
+	TTCluster& _cluster(uint64_t key);
+	// Checks a loaded page against its checksum on first touch
+	void _checkPage(std::size_t page);
+	void _release();
+
+	TTCluster* _table = nullptr;
+	std::size_t _clusterMask = 0;
+	uint8_t _generation = 0;
+	// Empty unless loaded: the saved checksum of every page, and a bit
+	// per page once it has been checked
+	std::vector<uint64_t> _pageChecksums;
+	std::vector<uint64_t> _checkedPages;
+};
+
+}
+
+#endif // LUCHESS_CORE_TRANSPOSITION_H_
@@ -1,58 +1,34 @@
 #include <ostream>
-#include <sstream>
 
 #include "luchess/core/util.h"
+#include "luchess/core/format.h"
 
 namespace luchess{
 
 std::ostream &operator<<(std::ostream &os, PieceType const& p) {
-	std::string_view result;
-	switch(p)
-	{
-		case Pawn:
-			result = {STR(Pawn)};
-			break;
-		case Bishop:
-			result = {STR(Bishop)};
-			break;
-		case Knight:
-			result = {STR(Knight)};
-			break;
-		case Rook:
-			result = {STR(Rook)};
-			break;
-		case Queen:
-			result = {STR(Queen)};
-			break;
-		case King:
-			result = {STR(King)};
-			break;
-	}
-  	return std::operator<<(os, result);
+	return std::operator<<(os, pieceTypeNames[p]);
 }
 
 
 // ========================PieceColor===========================
 
 std::ostream &operator<<(std::ostream &os, PieceColor const& p) {
-	std::string_view result;
-	switch(p)
-	{
-		case Black:
-			result = {STR(Black)};
-			break;
-		case White:
-			result = {STR(White)};
-			break;
-	}
-  	return std::operator<<(os, result);
+	return std::operator<<(os, pieceColorNames[p]);
 }
 
 std::ostream &operator<<(std::ostream &os, BoardPosition const& bp)
 {
-	std::stringstream result;
-	result<<"{ c:"<<bp.column<<", r:"<<bp.row<<" }";
-  	return std::operator<<(os, result.str());
+	// "{ c:" and ", r:" and " }" around two ints of at most 11 chars
+	char result[32];
+	return std::operator<<(os,
+		std::string_view(result, formatBoardPosition(result, bp)));
+}
+
+std::ostream &operator<<(std::ostream &os, ChessBoard const& board)
+{
+	char result[kDiagramChars];
+	return std::operator<<(os,
+		std::string_view(result, formatDiagram(result, board)));
 }
 
 }
@@ -1,6 +1,7 @@
 #ifndef LUCHESS_CORE_UTIL_H_
 #define LUCHESS_CORE_UTIL_H_
 
+#include <iostream>
 #include <ostream>
 
 #include "luchess/core/pieces.h"
@@ -35,6 +36,8 @@ std::ostream &operator<<(std::ostream &os, PieceColor const& p);
 
 std::ostream &operator<<(std::ostream &os, BoardPosition const& bp);
 
+std::ostream &operator<<(std::ostream &os, ChessBoard const& board);
+
 }
 
 #endif // LUCHESS_CORE_UTIL_H_
\ No newline at end of file
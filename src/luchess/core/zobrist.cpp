@@ -0,0 +1,165 @@
+#include <array>
+
+#include "luchess/core/zobrist.h"
+#include "luchess/core/util.h"
+
+namespace luchess{
+
+struct ZobristTable
+{
+	std::array<std::array<uint64_t, ChessBoard::boardSize>, 12> pieces;
+	std::array<uint64_t, 16> castleRights;
+	std::array<uint64_t, 8> enPassantFile;
+	uint64_t blackToMove;
+};
+
+// splitmix64, fixed seed so keys are the same on every run
+static constexpr uint64_t nextRandom(uint64_t& seed)
+{
+	uint64_t z = (seed += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+static constexpr ZobristTable makeZobristTable()
+{
+	ZobristTable table{};
+	uint64_t seed = 0x4c754368657373ull;
+	for (auto& square : table.pieces)
+		for (auto& key : square)
+			key = nextRandom(seed);
+	// No rights hashes to zero so a bare board keys to zero
+	for (uint i = 1; i < table.castleRights.size(); i++)
+		table.castleRights[i] = nextRandom(seed);
+	for (auto& key : table.enPassantFile)
+		key = nextRandom(seed);
+	table.blackToMove = nextRandom(seed);
+	return table;
+}
+
+static constexpr ZobristTable zobristTable = makeZobristTable();
+
+static uint64_t pieceKey(BoardSquare const& square, uint index)
+{
+	if (square == EMPTY_SQUARE)
+		return 0;
+	return zobristTable.pieces[square->type * 2 + square->color][index];
+}
+
+// Side to move, castling and capturable en passant. 'squareAt' gives the
+// piece on a board index, so the position before a move can be looked at
+// without rebuilding it.
+template <typename SquareAt>
+static uint64_t stateKey(GameState const& state, SquareAt const& squareAt)
+{
+	uint64_t key = zobristTable.castleRights[state.castleRights()];
+	PieceColor side = state.sideToMove();
+	if (side == Black)
+		key ^= zobristTable.blackToMove;
+
+	int file = state.enPassantFile();
+	if (file == GameState::kNoEnPassant)
+		return key;
+	// Takers stand beside the pawn that double steped
+	int row = side == White ? 4 : 3;
+	for (int column : {file - 1, file + 1})
+	{
+		if (column < int(kMinColumn) || column > int(kMaxColumn))
+			continue;
+		if (squareAt(ChessBoard::getIndex({column, row})) == Piece(Pawn, side))
+			return key ^ zobristTable.enPassantFile[file];
+	}
+	return key;
+}
+
+uint64_t zobristKey(ChessBoard const& board)
+{
+	uint64_t key = stateKey(board.state, [&](uint index) -> BoardSquare
+	{
+		return board.layout[index];
+	});
+	for (uint index = 0; index < ChessBoard::boardSize; index++)
+		key ^= pieceKey(board.layout[index], index);
+	return key;
+}
+
+// Where the captured piece stood, beside the target for en passant
+static uint capturedIndex(BoardMove const& move, ChessBoard::UndoRecord const& undo)
+{
+	Piece piece = *undo.moved;
+	int enPassantRow = piece.color == White ? 5 : 2;
+	if (piece.type == Pawn && move.targetPos.column != move.originPos.column &&
+		move.targetPos.row == enPassantRow &&
+		undo.state.enPassantFile() == move.targetPos.column)
+	{
+		return ChessBoard::getIndex({move.targetPos.column, move.originPos.row});
+	}
+	return ChessBoard::getIndex(move.targetPos);
+}
+
+uint64_t updateZobristKey(uint64_t key, ChessBoard const& board,
+	BoardMove const& move, ChessBoard::UndoRecord const& undo)
+{
+	uint origin = ChessBoard::getIndex(move.originPos);
+	uint target = ChessBoard::getIndex(move.targetPos);
+	Piece piece = *undo.moved;
+	auto posDiff = move.targetPos - move.originPos;
+
+	key ^= pieceKey(undo.moved, origin);
+	key ^= pieceKey(board.layout[target], target);
+
+	uint captureIndex = capturedIndex(move, undo);
+	key ^= pieceKey(undo.captured, captureIndex);
+
+	if (piece.type == King && abs(posDiff.column) == 2)
+	{
+		int rookColumn = posDiff.column > 0 ? kMaxColumn : kMinColumn;
+		uint crossed = ChessBoard::getIndex(
+			{move.originPos.column + sgn(posDiff.column), move.originPos.row});
+		key ^= pieceKey(board.layout[crossed], crossed);
+		key ^= pieceKey(board.layout[crossed], ChessBoard::getIndex({rookColumn, move.originPos.row}));
+	}
+
+	key ^= stateKey(undo.state, [&](uint index) -> BoardSquare
+	{
+		if (index == origin)
+			return undo.moved;
+		if (index == captureIndex)
+			return undo.captured;
+		if (index == target)
+			return EMPTY_SQUARE;
+		return board.layout[index];
+	});
+	key ^= stateKey(board.state, [&](uint index) -> BoardSquare
+	{
+		return board.layout[index];
+	});
+	return key;
+}
+
+static uint64_t pawnPieceKey(BoardSquare const& square, uint index)
+{
+	return square && square->type == Pawn ? pieceKey(square, index) : 0;
+}
+
+uint64_t pawnKey(ChessBoard const& board)
+{
+	uint64_t key = 0;
+	for (uint index = 0; index < ChessBoard::boardSize; index++)
+		key ^= pawnPieceKey(board.layout[index], index);
+	return key;
+}
+
+uint64_t updatePawnKey(uint64_t key, ChessBoard const& board,
+	BoardMove const& move, ChessBoard::UndoRecord const& undo)
+{
+	uint target = ChessBoard::getIndex(move.targetPos);
+	key ^= pawnPieceKey(undo.moved, ChessBoard::getIndex(move.originPos));
+	// Nothing when the pawn promoted
+	key ^= pawnPieceKey(board.layout[target], target);
+	key ^= pawnPieceKey(undo.captured, capturedIndex(move, undo));
+	return key;
+}
+
+}
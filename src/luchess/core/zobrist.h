@@ -0,0 +1,40 @@
+#ifndef LUCHESS_CORE_ZOBRIST_H_
+#define LUCHESS_CORE_ZOBRIST_H_
+
+#include <cstdint>
+
+#include "luchess/core/board.h"
+
+/**
+
+Zobrist position keys.
+
+A key covers the pieces, the side to move, the castling rights and the
+en passant file, the file only when a pawn can actually take on it so
+positions that play the same compare equal. Check flags and the
+halfmove clock are not part of a position.
+
+The pawn key covers the pawns alone, for caches of pawn structure. It
+is the pawns' share of the position key.
+
+**/
+
+namespace luchess{
+
+uint64_t zobristKey(ChessBoard const& board);
+
+// Key after 'move' from the key before it. 'board' is the position after
+// the move and 'undo' the record makeMove returned for it.
+uint64_t updateZobristKey(uint64_t key, ChessBoard const& board,
+	BoardMove const& move, ChessBoard::UndoRecord const& undo);
+
+uint64_t pawnKey(ChessBoard const& board);
+
+// Pawn key after 'move', arguments as for updateZobristKey. Unchanged
+// unless the move moves, promotes or takes a pawn.
+uint64_t updatePawnKey(uint64_t key, ChessBoard const& board,
+	BoardMove const& move, ChessBoard::UndoRecord const& undo);
+
+}
+
+#endif // LUCHESS_CORE_ZOBRIST_H_
@@ -0,0 +1,126 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "allocations.h"
+
+namespace luchess{
+
+// ========================Counters===================================
+
+namespace{
+
+thread_local AllocationCounts threadCounts;
+std::atomic<uint64_t> processAllocationCount = 0;
+std::atomic<uint64_t> processDeallocationCount = 0;
+std::atomic<uint64_t> processBytes = 0;
+
+void countAllocation(std::size_t size)
+{
+	threadCounts.allocations++;
+	threadCounts.bytes += size;
+	processAllocationCount.fetch_add(1, std::memory_order_relaxed);
+	processBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void countDeallocation()
+{
+	threadCounts.deallocations++;
+	processDeallocationCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+}
+
+AllocationCounts threadAllocations()
+{
+	return threadCounts;
+}
+
+AllocationCounts processAllocations()
+{
+	return {processAllocationCount.load(std::memory_order_relaxed),
+		processDeallocationCount.load(std::memory_order_relaxed),
+		processBytes.load(std::memory_order_relaxed)};
+}
+
+}
+
+// ========================Replacements===============================
+
+namespace{
+
+void* allocate(std::size_t size, std::size_t alignment, bool nothrow)
+{
+	luchess::countAllocation(size);
+	if (size == 0)
+		size = 1;
+	void* memory = alignment <= alignof(std::max_align_t) ? std::malloc(size) :
+		std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+	if (!memory && !nothrow)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void deallocate(void* memory)
+{
+	if (!memory)
+		return;
+	luchess::countDeallocation();
+	std::free(memory);
+}
+
+}
+
+void* operator new(std::size_t size)
+{
+	return allocate(size, 0, false);
+}
+
+void* operator new[](std::size_t size)
+{
+	return allocate(size, 0, false);
+}
+
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept
+{
+	return allocate(size, 0, true);
+}
+
+void* operator new[](std::size_t size, std::nothrow_t const&) noexcept
+{
+	return allocate(size, 0, true);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return allocate(size, std::size_t(alignment), false);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return allocate(size, std::size_t(alignment), false);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept
+{
+	return allocate(size, std::size_t(alignment), true);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept
+{
+	return allocate(size, std::size_t(alignment), true);
+}
+
+void operator delete(void* memory) noexcept { deallocate(memory); }
+void operator delete[](void* memory) noexcept { deallocate(memory); }
+void operator delete(void* memory, std::size_t) noexcept { deallocate(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { deallocate(memory); }
+void operator delete(void* memory, std::nothrow_t const&) noexcept { deallocate(memory); }
+void operator delete[](void* memory, std::nothrow_t const&) noexcept { deallocate(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { deallocate(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { deallocate(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { deallocate(memory); }
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept { deallocate(memory); }
+void operator delete(void* memory, std::align_val_t, std::nothrow_t const&) noexcept { deallocate(memory); }
+void operator delete[](void* memory, std::align_val_t, std::nothrow_t const&) noexcept { deallocate(memory); }
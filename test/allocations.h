@@ -0,0 +1,66 @@
+#ifndef LUCHESS_TEST_ALLOCATIONS_H_
+#define LUCHESS_TEST_ALLOCATIONS_H_
+
+#include <cstdint>
+
+/**
+
+Allocation audit for the tests and benchmarks.
+
+allocations.cpp replaces the global operator new and delete of the
+program it is linked into. Every form (array, nothrow, aligned, sized)
+counts towards the calling thread's totals and the whole process's,
+then goes to malloc and free.
+
+AllocationScope counts what the calling thread allocates while it
+lives, and EXPECT_NO_ALLOCATIONS fails a test when a statement
+allocates at all, so paths that are meant to stay off the heap stay
+there.
+
+**/
+
+namespace luchess{
+
+struct AllocationCounts
+{
+	uint64_t allocations = 0;
+	uint64_t deallocations = 0;
+	uint64_t bytes = 0;
+};
+
+// Since the program started, by the calling thread and by all threads
+AllocationCounts threadAllocations();
+AllocationCounts processAllocations();
+
+struct AllocationScope
+{
+	AllocationScope() : _start(threadAllocations()) {}
+
+	// Made by the calling thread since the scope began
+	AllocationCounts counts() const
+	{
+		AllocationCounts now = threadAllocations();
+		return {now.allocations - _start.allocations,
+			now.deallocations - _start.deallocations,
+			now.bytes - _start.bytes};
+	}
+
+	uint64_t allocations() const { return counts().allocations; }
+
+	AllocationCounts _start;
+};
+
+}
+
+// Needs gtest. Runs 'statement' and fails the test when the calling
+// thread allocated during it.
+#define EXPECT_NO_ALLOCATIONS(statement) \
+	do \
+	{ \
+		luchess::AllocationScope _allocationScope; \
+		statement; \
+		uint64_t _allocated = _allocationScope.allocations(); \
+		EXPECT_EQ(_allocated, 0u) << "allocated: " #statement; \
+	} while (0)
+
+#endif // LUCHESS_TEST_ALLOCATIONS_H_
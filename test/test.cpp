@@ -1,9 +1,54 @@
 #include "luchess/core/chess.h"
+#include "luchess/core/stats.h"
+#include "luchess/core/format.h"
+#include "luchess/core/movegen.h"
+#include "luchess/core/replay.h"
+#include "luchess/core/history.h"
+#include "luchess/core/repetition.h"
+#include "luchess/core/zobrist.h"
+#include "luchess/core/movepick.h"
+#include "luchess/core/search.h"
+#include "luchess/core/see.h"
+#include "luchess/core/batch.h"
+#include "luchess/core/fen.h"
+#include "luchess/core/suite.h"
+#include "luchess/core/selfplay.h"
+#include "luchess/core/tournament.h"
+#include "luchess/core/dedup.h"
+#include "luchess/core/channel.h"
+#include "luchess/core/gamelog.h"
+#include "luchess/core/transposition.h"
+#include "luchess/core/eval.h"
+#include "luchess/core/threadpool.h"
+#include "luchess/core/analysis.h"
+#include "allocations.h"
 #include "gtest/gtest.h"
+#include <coroutine>
+#include <functional>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <set>
+#include <thread>
+#include <unordered_set>
+#include <ranges>
+#include <iterator>
 #include <sstream>
 #include <vector>
 #include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
+namespace chess = luchess;
+
+// Scratch file in the temp directory, per process so test runs side by
+// side do not share it
+static std::string tempPath(std::string const& name)
+{
+    return (std::filesystem::temp_directory_path() /
+        (name + "_" + std::to_string(getpid()) + ".bin")).string();
+}
 
 TEST(testChess, BoardPosition)
 {
@@ -188,7 +233,7 @@ TEST(testChess, ChessBoard)
 {
 
     chess::ChessBoard chessBoard;
-    std::array<chess::Piece*, 64> pieceAddr;
+    std::array<chess::BoardSquare*, 64> pieceAddr;
     for (int i=0 ; i<chessBoard.layout.size() ; i++)
     {
         pieceAddr[i] = &chessBoard.layout[i];
@@ -198,10 +243,9 @@ TEST(testChess, ChessBoard)
     {
         for (int col=chess::kMinColumn ; col<chess::kMaxColumn ; col++)
         {
-            chess::Piece& piece = chessBoard.getAt(
+            chess::BoardSquare& square = chessBoard.getAt(
                 chess::BoardPosition(col, row));
-            EXPECT_EQ(piece.type, chess::Empty);
-            EXPECT_EQ(piece.color, chess::Black);
+            EXPECT_EQ(square, EMPTY_SQUARE);
         }
     }
     
@@ -217,14 +261,13 @@ TEST(testChess, ChessBoard)
         }
         EXPECT_TRUE(found);
     }
-    EXPECT_EQ(chessBoard.nextGo, chess::White);
+    EXPECT_EQ(chessBoard.nextGo(), chess::White);
 }
 
 TEST(testChess, ChessBoard_pawnDoubleSteped_indexChecker)
 {
-    chess::ChessBoard chessBoard;
-    auto& isValidPosition = chessBoard.pawnDoubleSteped.isValidPosition;
-    auto& getIndex = chessBoard.pawnDoubleSteped.getIndex;
+    auto isValidPosition = chess::PawnDoubleStepedState::isValidPosition;
+    auto getIndex = chess::PawnDoubleStepedState::getIndex;
     
     std::array<bool, 16> duplicateCache;
     duplicateCache.fill(false);
@@ -254,9 +297,8 @@ TEST(testChess, ChessBoard_pawnDoubleSteped_indexChecker)
 
 TEST(testChess, ChessBoard_rookCastleable_indexChecker)
 {
-    chess::ChessBoard chessBoard;
-    auto& isValidPosition = chessBoard.rookCastleable.isValidPosition;
-    auto& getIndex = chessBoard.rookCastleable.getIndex;
+    auto isValidPosition = chess::RookCastleState::isValidPosition;
+    auto getIndex = chess::RookCastleState::getIndex;
 
     EXPECT_TRUE(isValidPosition({0, 0}));
     EXPECT_EQ(getIndex({0, 0}), 0);
@@ -300,9 +342,9 @@ TEST(testChess, populateDefaultLayout)
 TEST(testChess, doesMoveCollide)
 {
     chess::ChessBoard chessBoard;
-    chess::Piece& piece = chessBoard.getAt({4, 4});
-    piece.type = chess::Pawn;
-    chess::Move move;
+    chessBoard.getAt({4, 4}) = chess::Piece(chess::Pawn, chess::White);
+    chessBoard.indexPieces();
+    chess::BoardMove move;
 
     move.originPos = {2, 2};
     move.targetPos = {5, 5};
@@ -356,7 +398,7 @@ namespace luchess
 TEST(testChess, populateDefaultLayout)
 {
     auto chessBoard = executeMoveSetup();
-    EXPECT_EQ(chessBoard.nextGo, White);
+    EXPECT_EQ(chessBoard.nextGo(), White);
 
     // Check white's back row
     EXPECT_EQ(chessBoard.getAt({0,0}), Piece(Rook, White));
@@ -374,7 +416,7 @@ TEST(testChess, populateDefaultLayout)
         EXPECT_EQ(chessBoard.getAt({col, 1}), Piece(Pawn, White));
         // Check middle rows are empty
         for(int row=2 ; row<5 ; row++)
-            EXPECT_EQ(chessBoard.getAt({col, row}), Piece(Empty, Black));
+            EXPECT_EQ(chessBoard.getAt({col, row}), EMPTY_SQUARE);
         // Check black's front row
         EXPECT_EQ(chessBoard.getAt({col, 6}), Piece(Pawn, Black));
     }
@@ -411,14 +453,16 @@ TEST(testChess, executePawnMoves)
         chess::BoardPosition const& dest,
         chess::PieceColor expectedCurrentPiece)
     {
-        EXPECT_EQ(chessBoard.nextGo, expectedCurrentPiece);
-        EXPECT_FALSE(chessBoard.pawnDoubleSteped.getAt(origin));
-        bool success = executeMove(
-            chessBoard, {origin, dest}
-        );
+        EXPECT_EQ(chessBoard.nextGo(), expectedCurrentPiece);
+        EXPECT_FALSE(chessBoard.pawnDoubleSteped().getAt(origin));
+        bool success = chessBoard.executeMove(
+            {origin, dest}
+        ).validMove;
         EXPECT_TRUE(success);
-        EXPECT_EQ(chessBoard.nextGo, !expectedCurrentPiece);
-        EXPECT_FALSE(chessBoard.pawnDoubleSteped.getAt(origin));
+        EXPECT_EQ(chessBoard.nextGo(), !expectedCurrentPiece);
+        // Only a double step leaves the pawn takeable en passant
+        EXPECT_EQ(chessBoard.pawnDoubleSteped().getAt(origin),
+            chess::abs(dest.row - origin.row) == 2);
     };
     executePawnDoubleStep({6, 1}, {6, 2}, chess::White);
     executePawnDoubleStep({6, 6}, {6, 5}, chess::Black);
@@ -428,6 +472,2184 @@ TEST(testChess, executePawnMoves)
 }
 
 
+TEST(testChess, GameState_packing)
+{
+    chess::GameState state;
+    EXPECT_EQ(sizeof(state), 4);
+    EXPECT_EQ(state.sideToMove(), chess::White);
+    EXPECT_EQ(state.enPassantFile(), chess::GameState::kNoEnPassant);
+    EXPECT_EQ(state.castleRights(), 0);
+    EXPECT_EQ(state.halfmoveClock(), 0);
+
+    state.setCastleRights(0b1010);
+    state.setEnPassantFile(7);
+    state.setSideToMove(chess::Black);
+    state.setKingInCheck(chess::White, true);
+    state.setHalfmoveClock(99);
+
+    EXPECT_EQ(state.castleRights(), 0b1010);
+    EXPECT_FALSE(state.castleRight(0));
+    EXPECT_TRUE(state.castleRight(1));
+    EXPECT_EQ(state.enPassantFile(), 7);
+    EXPECT_EQ(state.sideToMove(), chess::Black);
+    EXPECT_TRUE(state.kingInCheck(chess::White));
+    EXPECT_FALSE(state.kingInCheck(chess::Black));
+    EXPECT_EQ(state.halfmoveClock(), 99);
+
+    state.setHalfmoveClock(255);
+    state.incrementHalfmoveClock();
+    EXPECT_EQ(state.halfmoveClock(), 255);
+    EXPECT_EQ(state.enPassantFile(), 7);
+
+    chess::GameState copy = state;
+    EXPECT_EQ(copy, state);
+    EXPECT_EQ(std::hash<chess::GameState>{}(copy),
+        std::hash<chess::GameState>{}(state));
+    copy.flipSideToMove();
+    EXPECT_NE(copy, state);
+}
+
+TEST(testChess, executeMove_gameState)
+{
+    chess::ChessBoard chessBoard = executeMoveSetup();
+    EXPECT_EQ(chessBoard.state.castleRights(), 0b1111);
+
+    // Knight moves tick the halfmove clock
+    EXPECT_TRUE(chessBoard.executeMove({{6, 0}, {5, 2}}).validMove);
+    EXPECT_EQ(chessBoard.state.halfmoveClock(), 1);
+    EXPECT_TRUE(chessBoard.executeMove({{6, 7}, {5, 5}}).validMove);
+    EXPECT_EQ(chessBoard.state.halfmoveClock(), 2);
+
+    // Pawn double step resets it and records the file
+    EXPECT_TRUE(chessBoard.executeMove({{4, 1}, {4, 3}}).validMove);
+    EXPECT_EQ(chessBoard.state.halfmoveClock(), 0);
+    EXPECT_EQ(chessBoard.state.enPassantFile(), 4);
+    EXPECT_TRUE(chessBoard.pawnDoubleSteped().getAt({4, 1}));
+
+    // Any other move clears the en passant file
+    EXPECT_TRUE(chessBoard.executeMove({{5, 5}, {6, 7}}).validMove);
+    EXPECT_EQ(chessBoard.state.enPassantFile(), chess::GameState::kNoEnPassant);
+
+    // Moving a corner rook drops only its castling right
+    EXPECT_TRUE(chessBoard.executeMove({{7, 0}, {6, 0}}).validMove);
+    EXPECT_FALSE(chessBoard.rookCastleable().getAt({7, 0}));
+    EXPECT_TRUE(chessBoard.rookCastleable().getAt({0, 0}));
+    EXPECT_EQ(chessBoard.state.castleRights(), 0b1011);
+}
+
+TEST(testChess, executeMove_enPassant)
+{
+    chess::ChessBoard chessBoard = executeMoveSetup();
+    EXPECT_TRUE(chessBoard.executeMove({{4, 1}, {4, 3}}).validMove);
+    EXPECT_TRUE(chessBoard.executeMove({{0, 6}, {0, 5}}).validMove);
+    EXPECT_TRUE(chessBoard.executeMove({{4, 3}, {4, 4}}).validMove);
+    EXPECT_TRUE(chessBoard.executeMove({{3, 6}, {3, 4}}).validMove);
+    EXPECT_EQ(chessBoard.state.enPassantFile(), 3);
+
+    EXPECT_TRUE(chessBoard.executeMove({{4, 4}, {3, 5}}).validMove);
+    EXPECT_EQ(chessBoard.getAt({3, 5}), chess::Piece(chess::Pawn, chess::White));
+    EXPECT_EQ(chessBoard.getAt({3, 4}), EMPTY_SQUARE);
+    EXPECT_EQ(chessBoard.getAt({4, 4}), EMPTY_SQUARE);
+    EXPECT_EQ(chessBoard.nextGo(), chess::Black);
+}
+
+
+TEST(testChess, stats_snapshot)
+{
+    auto before = chess::snapshotStats();
+    chess::ChessBoard chessBoard = executeMoveSetup();
+    // Wrong side, own piece, blocked line, bad geometry, then a valid move
+    chessBoard.executeMove({{4, 6}, {4, 4}});
+    chessBoard.executeMove({{0, 0}, {0, 1}});
+    chessBoard.executeMove({{2, 0}, {4, 2}});
+    chessBoard.executeMove({{6, 0}, {6, 2}});
+    chessBoard.executeMove({{6, 0}, {5, 2}});
+    auto delta = chess::snapshotStats() - before;
+
+#ifdef LUCHESS_STATS_BUILD
+    EXPECT_EQ(delta.counter(chess::StatCounter::MovesValidated), 5);
+    EXPECT_EQ(delta.counter(chess::StatCounter::MovesAccepted), 1);
+    EXPECT_EQ(delta.counter(chess::StatCounter::RejectedWrongSide), 1);
+    EXPECT_EQ(delta.counter(chess::StatCounter::RejectedOwnPiece), 1);
+    EXPECT_EQ(delta.counter(chess::StatCounter::RejectedBlockedLine), 1);
+    EXPECT_EQ(delta.counter(chess::StatCounter::RejectedBadGeometry), 1);
+    EXPECT_EQ(delta.counter(chess::StatCounter::CollisionChecks), 1);
+#else
+    for (auto value : delta.counters)
+        EXPECT_EQ(value, 0);
+#endif
+
+    std::stringstream text;
+    chess::writeStatsText(text, delta);
+    EXPECT_NE(text.str().find("rejected_wrong_side: "), std::string::npos);
+    EXPECT_NE(text.str().find("quiescence_nodes: "), std::string::npos);
+
+    std::stringstream json;
+    chess::writeStatsJson(json, delta);
+    EXPECT_EQ(json.str().front(), '{');
+    EXPECT_EQ(json.str().back(), '}');
+    EXPECT_NE(json.str().find("\"collision_squares\":["), std::string::npos);
+    EXPECT_NE(json.str().find("\"quiescence_nodes\":"), std::string::npos);
+}
+
+
+TEST(testChess, formatSquare)
+{
+    for (uint index = 0; index < 64; index++)
+    {
+        char buffer[chess::kMaxSquareChars];
+        char* end = chess::formatSquare(buffer, index);
+        EXPECT_EQ(std::string(buffer, end), chess::encryptPosition(index));
+    }
+}
+
+TEST(testChess, formatMatchesStreamOperators)
+{
+    for (auto pos : std::vector<chess::BoardPosition>{{0, 0}, {5, 6}, {-3, 12}})
+    {
+        std::stringstream expected;
+        expected << "{ c:" << pos.column << ", r:" << pos.row << " }";
+        std::string formatted;
+        chess::formatBoardPosition(std::back_inserter(formatted), pos);
+        EXPECT_EQ(formatted, expected.str());
+
+        std::stringstream streamed;
+        chess::operator<<(streamed, pos);
+        EXPECT_EQ(streamed.str(), expected.str());
+    }
+
+    std::stringstream streamed;
+    chess::operator<<(streamed, chess::Knight);
+    chess::operator<<(streamed, chess::White);
+    EXPECT_EQ(streamed.str(), "KnightWhite");
+}
+
+TEST(testChess, formatUciAndPv)
+{
+    std::vector<chess::BoardMove> pv = {
+        {{4, 1}, {4, 3}},
+        {{4, 6}, {4, 4}},
+        {{6, 6}, {6, 7}, chess::Queen},
+    };
+    char buffer[3 * (chess::kMaxUciChars + 1)];
+    char* end = chess::formatUci(buffer, pv[0]);
+    EXPECT_EQ(std::string(buffer, end), "e2e4");
+
+    end = chess::formatPv(buffer, std::span<chess::BoardMove const>(pv));
+    EXPECT_EQ(std::string(buffer, end), "e2e4 e7e5 g7g8q");
+}
+
+TEST(testChess, formatSan)
+{
+    using namespace luchess;
+    auto san = [](ChessBoard const& board, BoardMove const& move)
+    {
+        std::string result;
+        formatSan(std::back_inserter(result), board, move);
+        return result;
+    };
+
+    ChessBoard chessBoard = executeMoveSetup();
+    EXPECT_EQ(san(chessBoard, {{4, 1}, {4, 3}}), "e4");
+    EXPECT_EQ(san(chessBoard, {{6, 0}, {5, 2}}), "Nf3");
+
+    // Knights on c3 and d4 can both reach e2
+    ChessBoard knights;
+    knights.getAt({2, 2}) = Piece(Knight, White);
+    knights.getAt({3, 3}) = Piece(Knight, White);
+    knights.getAt({4, 6}) = Piece(Pawn, Black);
+    knights.indexPieces();
+    EXPECT_EQ(san(knights, {{3, 3}, {4, 1}}), "Nde2");
+    // Same file needs the rank instead
+    knights.getAt({2, 2}) = EMPTY_SQUARE;
+    knights.getAt({3, 7}) = Piece(Knight, White);
+    knights.indexPieces();
+    EXPECT_EQ(san(knights, {{3, 3}, {4, 5}}), "N4e6");
+    EXPECT_EQ(san(knights, {{3, 7}, {4, 5}}), "N8e6");
+
+    // Captures, checks and promotion
+    ChessBoard tactics;
+    tactics.getAt({4, 7}) = Piece(King, Black);
+    tactics.getAt({3, 6}) = Piece(Bishop, Black);
+    tactics.getAt({1, 4}) = Piece(Bishop, White);
+    tactics.getAt({1, 1}) = Piece(Pawn, Black);
+    tactics.getAt({0, 0}) = Piece(Rook, White);
+    tactics.indexPieces();
+    EXPECT_EQ(san(tactics, {{1, 4}, {3, 6}}), "Bxd7+");
+    EXPECT_EQ(san(tactics, {{1, 1}, {1, 0}}), "b1=Q");
+    EXPECT_EQ(san(tactics, {{1, 1}, {0, 0}, Knight}), "bxa1=N");
+
+    ChessBoard castle;
+    castle.getAt({4, 0}) = Piece(King, White);
+    castle.getAt({7, 0}) = Piece(Rook, White);
+    castle.getAt({0, 0}) = Piece(Rook, White);
+    castle.getAt({5, 7}) = Piece(King, Black);
+    castle.indexPieces();
+    EXPECT_EQ(san(castle, {{4, 0}, {6, 0}}), "O-O+");
+    EXPECT_EQ(san(castle, {{4, 0}, {2, 0}}), "O-O-O");
+
+    // Mate takes '#' instead of '+'
+    ChessBoard backRank = *parseFen("6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1");
+    EXPECT_EQ(san(backRank, {{0, 0}, {0, 7}}), "Ra8#");
+    EXPECT_EQ(san(backRank, {{0, 0}, {0, 6}}), "Ra7");
+}
+
+TEST(testChess, formatDiagram)
+{
+    chess::ChessBoard chessBoard = executeMoveSetup();
+    char buffer[chess::kDiagramChars];
+    char* end = chess::formatDiagram(buffer, chessBoard);
+    EXPECT_EQ(end - buffer, chess::kDiagramChars);
+    EXPECT_EQ(std::string(buffer, end),
+        "8 r n b q k b n r\n"
+        "7 p p p p p p p p\n"
+        "6 . . . . . . . .\n"
+        "5 . . . . . . . .\n"
+        "4 . . . . . . . .\n"
+        "3 . . . . . . . .\n"
+        "2 P P P P P P P P\n"
+        "1 R N B Q K B N R\n"
+        "  a b c d e f g h\n");
+
+    std::stringstream streamed;
+    chess::operator<<(streamed, chessBoard);
+    EXPECT_EQ(streamed.str(), std::string(buffer, end));
+}
+
+
+// Builds a board from 8 rank strings, rank 8 first, '.' for empty
+static chess::ChessBoard boardFromRanks(std::array<const char*, 8> ranks,
+    chess::PieceColor sideToMove, uint castleRights)
+{
+    using namespace luchess;
+    ChessBoard board;
+    for (int rank = 0; rank < 8; rank++)
+    {
+        for (int col = 0; col < 8; col++)
+        {
+            char letter = ranks[rank][col];
+            if (letter == '.')
+                continue;
+            PieceColor color = std::isupper(letter) ? White : Black;
+            std::string_view letters = "pbnrqk";
+            auto type = static_cast<PieceType>(
+                letters.find(std::tolower(letter)));
+            board.getAt({col, 7 - rank}) = Piece(type, color);
+        }
+    }
+    board.indexPieces();
+    board.state.setSideToMove(sideToMove);
+    board.state.setCastleRights(castleRights);
+    return board;
+}
+
+TEST(testChess, perft)
+{
+    chess::ChessBoard chessBoard = executeMoveSetup();
+    EXPECT_EQ(chess::perft(chessBoard, 1), 20u);
+    EXPECT_EQ(chess::perft(chessBoard, 2), 400u);
+    EXPECT_EQ(chess::perft(chessBoard, 3), 8902u);
+    // make/unmake leaves the board untouched
+    EXPECT_EQ(chessBoard.layout, executeMoveSetup().layout);
+    EXPECT_EQ(chessBoard.state, executeMoveSetup().state);
+
+    // "Kiwipete", castling, en passant and promotions all at once
+    auto kiwipete = boardFromRanks({
+        "r...k..r",
+        "p.ppqpb.",
+        "bn..pnp.",
+        "...PN...",
+        ".p..P...",
+        "..N..Q.p",
+        "PPPBBPPP",
+        "R...K..R"}, chess::White, 0b1111);
+    EXPECT_EQ(chess::perft(kiwipete, 1), 48u);
+    EXPECT_EQ(chess::perft(kiwipete, 2), 2039u);
+
+    auto endgame = boardFromRanks({
+        "........",
+        "..p.....",
+        "...p....",
+        "KP.....r",
+        ".R...p.k",
+        "........",
+        "....P.P.",
+        "........"}, chess::White, 0);
+    EXPECT_EQ(chess::perft(endgame, 3), 2812u);
+}
+
+TEST(testChess, executeMove_pieces)
+{
+    using namespace luchess;
+    ChessBoard chessBoard = executeMoveSetup();
+    for (BoardMove move : std::initializer_list<BoardMove>{
+        {{4, 1}, {4, 3}}, {{4, 6}, {4, 4}},
+        {{3, 0}, {7, 4}}, {{1, 7}, {2, 5}},
+        {{5, 0}, {2, 3}}, {{6, 7}, {5, 5}}})
+    {
+        EXPECT_TRUE(chessBoard.executeMove(move).validMove);
+    }
+    // Qxf7 is mate
+    auto result = chessBoard.executeMove({{7, 4}, {5, 6}});
+    EXPECT_TRUE(result.validMove);
+    EXPECT_TRUE(result.finished);
+    EXPECT_EQ(result.winner, std::optional<bool>(White));
+    EXPECT_TRUE(chessBoard.blackKingInCheck());
+
+    auto castle = boardFromRanks({
+        "r...k..r",
+        ".....p..",
+        "........",
+        "........",
+        "........",
+        "........",
+        "........",
+        "R...K..R"}, White, 0b1111);
+    EXPECT_TRUE(castle.executeMove({{4, 0}, {6, 0}}).validMove);
+    EXPECT_EQ(castle.getAt({5, 0}), Piece(Rook, White));
+    EXPECT_EQ(castle.getAt({7, 0}), EMPTY_SQUARE);
+    // Castling through the attacked d8 square is illegal
+    castle.getAt({3, 0}) = Piece(Rook, White);
+    castle.indexPieces();
+    EXPECT_FALSE(castle.executeMove({{4, 7}, {2, 7}}).validMove);
+    EXPECT_TRUE(castle.executeMove({{4, 7}, {6, 7}}).validMove);
+    EXPECT_EQ(castle.getAt({5, 7}), Piece(Rook, Black));
+    // A king can not walk into check
+    castle.getAt({2, 4}) = Piece(Bishop, Black);
+    castle.indexPieces();
+    EXPECT_FALSE(castle.executeMove({{6, 0}, {5, 1}}).validMove);
+    EXPECT_EQ(castle.getAt({6, 0}), Piece(King, White));
+}
+
+TEST(testChess, decryptMove)
+{
+    using namespace luchess;
+    ChessBoard chessBoard = executeMoveSetup();
+    EXPECT_EQ(decryptMove(chessBoard, "e4"), (BoardMove{{4, 1}, {4, 3}}));
+    EXPECT_EQ(decryptMove(chessBoard, "Nf3"), (BoardMove{{6, 0}, {5, 2}}));
+    EXPECT_EQ(decryptMove(chessBoard, "e5"), std::nullopt);
+    EXPECT_EQ(decryptMove(chessBoard, "Ke2"), std::nullopt);
+    EXPECT_EQ(decryptMove(chessBoard, "xyz"), std::nullopt);
+    // Promotion suffixes only on a pawn reaching the last rank
+    EXPECT_EQ(decryptMove(chessBoard, "Nf3=Q"), std::nullopt);
+    EXPECT_EQ(decryptMove(chessBoard, "e4=Q"), std::nullopt);
+
+    // Both knights reach d2
+    auto knights = boardFromRanks({
+        "....k...",
+        "........",
+        "........",
+        "........",
+        "........",
+        ".....N..",
+        "......P.",
+        ".N..K..."}, White, 0);
+    EXPECT_EQ(decryptMove(knights, "Nd2"), std::nullopt);
+    EXPECT_EQ(decryptMove(knights, "Nbd2"), (BoardMove{{1, 0}, {3, 1}}));
+    EXPECT_EQ(decryptMove(knights, "Nfd2+"), (BoardMove{{5, 2}, {3, 1}}));
+
+    auto promote = boardFromRanks({
+        "..r.k...",
+        ".P......",
+        "........",
+        "........",
+        "........",
+        "........",
+        "........",
+        "....K..R"}, White, 0b0100);
+    EXPECT_EQ(decryptMove(promote, "bxc8=N"), (BoardMove{{1, 6}, {2, 7}, Knight}));
+    EXPECT_EQ(decryptMove(promote, "b8=Q"), (BoardMove{{1, 6}, {1, 7}, Queen}));
+    EXPECT_EQ(decryptMove(promote, "O-O"), (BoardMove{{4, 0}, {6, 0}}));
+    EXPECT_EQ(decryptMove(promote, "O-O-O"), std::nullopt);
+
+    EXPECT_EQ(parseUciMove(promote, "b7c8n"), (BoardMove{{1, 6}, {2, 7}, Knight}));
+    EXPECT_EQ(parseUciMove(promote, "e1g1"), (BoardMove{{4, 0}, {6, 0}}));
+    // UCI promotions always name the piece
+    EXPECT_EQ(parseUciMove(promote, "b7b8"), std::nullopt);
+    EXPECT_EQ(parseUciMove(chessBoard, "e2e4"), (BoardMove{{4, 1}, {4, 3}}));
+    EXPECT_EQ(parseUciMove(chessBoard, "e2e5"), std::nullopt);
+}
+
+TEST(testChess, GameReplayer)
+{
+    using namespace luchess;
+    std::ifstream file(LUCHESS_RESOURCES_DIR
+        "/kasparov-vs-the-world-chessnotations.txt");
+    std::string kasparov(std::istreambuf_iterator<char>(file), {});
+    ASSERT_FALSE(kasparov.empty());
+
+    GameReplayer replayer;
+    ReplayResult result = replayer.replay(kasparov);
+    EXPECT_EQ(result.illegalPly, std::nullopt);
+    EXPECT_EQ(result.plies, 123u);
+    EXPECT_EQ(result.result, GameResult::WhiteWins);
+    EXPECT_EQ(result.finalLayout[ChessBoard::getIndex({5, 5})], Piece(King, White));
+    EXPECT_EQ(result.finalLayout[ChessBoard::getIndex({6, 6})], Piece(Pawn, White));
+
+    result = replayer.replay("1. e4 e5 2. Ke3");
+    EXPECT_EQ(result.illegalPly, 2u);
+    EXPECT_EQ(result.plies, 2u);
+
+    // Fool's mate is detected without a result token
+    result = replayer.replay("1. f3 e5 2. g4 Qh4#");
+    EXPECT_EQ(result.illegalPly, std::nullopt);
+    EXPECT_EQ(result.result, GameResult::BlackWins);
+    EXPECT_TRUE(result.finalState.kingInCheck(White));
+
+    std::vector<std::string_view> games = {
+        kasparov, "1. f3 e5 2. g4 Qh4#", "e4 e5 Ke3", "d4 d5 1/2-1/2"};
+    auto results = replayGames(games, 3);
+    ASSERT_EQ(results.size(), games.size());
+    EXPECT_EQ(results[0].plies, 123u);
+    EXPECT_EQ(results[1].result, GameResult::BlackWins);
+    EXPECT_EQ(results[2].illegalPly, 2u);
+    EXPECT_EQ(results[3].result, GameResult::Draw);
+    EXPECT_EQ(results[3].plies, 2u);
+}
+
+
+TEST(testChess, GameHistory)
+{
+    using namespace luchess;
+    std::ifstream file(LUCHESS_RESOURCES_DIR
+        "/kasparov-vs-the-world-chessnotations.txt");
+    std::vector<std::pair<std::array<BoardSquare, 64>, GameState>> positions;
+    GameHistory history;
+    positions.push_back({history.board.layout, history.board.state});
+    for (std::string token; file >> token;)
+    {
+        auto move = decryptMove(history.board, token);
+        if (!move)
+            break;
+        ASSERT_TRUE(history.play(*move).validMove);
+        positions.push_back({history.board.layout, history.board.state});
+    }
+    ASSERT_EQ(history.plies(), 123u);
+
+    auto expectPosition = [&](ChessBoard const& board, uint ply)
+    {
+        EXPECT_EQ(board.layout, positions[ply].first) << "ply " << ply;
+        EXPECT_EQ(board.state, positions[ply].second) << "ply " << ply;
+    };
+
+    for (uint ply : {0u, 1u, 31u, 32u, 33u, 64u, 100u, 5u, 123u, 122u, 70u})
+    {
+        history.seek(ply);
+        EXPECT_EQ(history.ply(), ply);
+        expectPosition(history.board, ply);
+    }
+    EXPECT_TRUE(history.undo());
+    expectPosition(history.board, 69);
+    EXPECT_TRUE(history.redo());
+    EXPECT_TRUE(history.redo());
+    expectPosition(history.board, 71);
+
+    // A snapshot keeps its view while the history branches off
+    HistorySnapshot snapshot = history.snapshot();
+    history.seek(2);
+    EXPECT_TRUE(history.play({{6, 0}, {5, 2}}).validMove);
+    EXPECT_EQ(history.plies(), 3u);
+    EXPECT_FALSE(history.redo());
+    EXPECT_FALSE(history.play({{6, 0}, {5, 2}}).validMove);
+
+    EXPECT_EQ(snapshot.plies(), 123u);
+    ChessBoard board;
+    for (uint ply : {0u, 3u, 40u, 96u, 123u})
+    {
+        snapshot.positionAt(ply, board);
+        expectPosition(board, ply);
+    }
+    EXPECT_EQ(snapshot.moveAt(0), (BoardMove{{4, 1}, {4, 3}}));
+    EXPECT_EQ(snapshot.moveAt(2), (BoardMove{{6, 0}, {5, 2}}));
+
+    // Underpromotion survives the round trip through a delta
+    auto promote = boardFromRanks({
+        "....k...",
+        ".P......",
+        "........",
+        "........",
+        "........",
+        "........",
+        "........",
+        "....K..."}, White, 0);
+    GameHistory promotion(std::move(promote));
+    EXPECT_TRUE(promotion.play({{1, 6}, {1, 7}, Knight}).validMove);
+    EXPECT_TRUE(promotion.undo());
+    EXPECT_EQ(promotion.board.getAt({1, 6}), Piece(Pawn, White));
+    EXPECT_TRUE(promotion.redo());
+    EXPECT_EQ(promotion.board.getAt({1, 7}), Piece(Knight, White));
+}
+
+TEST(testChess, zobristKey)
+{
+    using namespace luchess;
+    // Incremental keys match a full recompute two plies deep from
+    // Kiwipete, which has castling, captures and promotions
+    auto kiwipete = boardFromRanks({
+        "r...k..r",
+        "p.ppqpb.",
+        "bn..pnp.",
+        "...PN...",
+        ".p..P...",
+        "..N..Q.p",
+        "PPPBBPPP",
+        "R...K..R"}, White, 0b1111);
+    uint64_t rootKey = zobristKey(kiwipete);
+    MoveList moves;
+    generateLegalMoves(kiwipete, moves);
+    for (auto const& move : moves)
+    {
+        auto undo = kiwipete.makeMove(move);
+        uint64_t key = updateZobristKey(rootKey, kiwipete, move, undo);
+        EXPECT_EQ(key, zobristKey(kiwipete));
+        MoveList replies;
+        generateLegalMoves(kiwipete, replies);
+        for (auto const& reply : replies)
+        {
+            auto replyUndo = kiwipete.makeMove(reply);
+            EXPECT_EQ(updateZobristKey(key, kiwipete, reply, replyUndo),
+                zobristKey(kiwipete));
+            kiwipete.unmakeMove(reply, replyUndo);
+        }
+        kiwipete.unmakeMove(move, undo);
+    }
+    EXPECT_EQ(zobristKey(kiwipete), rootKey);
+
+    // En passant only counts when a pawn can take
+    GameHistory history;
+    for (auto san : {"e4", "Nf6", "e5", "d5"})
+        ASSERT_TRUE(history.play(*decryptMove(history.board, san)).validMove);
+    uint64_t withEnPassant = zobristKey(history.board);
+    history.board.state.clearEnPassant();
+    EXPECT_NE(withEnPassant, zobristKey(history.board));
+
+    ChessBoard opening = executeMoveSetup();
+    auto undo = opening.makeMove({{4, 1}, {4, 3}});
+    uint64_t key = updateZobristKey(zobristKey(executeMoveSetup()), opening,
+        {{4, 1}, {4, 3}}, undo);
+    opening.state.clearEnPassant();
+    EXPECT_EQ(key, zobristKey(opening));
+}
+
+TEST(testChess, RepetitionTracker)
+{
+    using namespace luchess;
+    RepetitionTracker tracker;
+    tracker.reset(1);
+    for (uint64_t key : {2, 3, 4, 1, 2, 3, 4})
+        tracker.push(key, 1);
+    EXPECT_EQ(tracker.repetitions(), 2u);
+    EXPECT_FALSE(tracker.isDraw());
+    tracker.push(1, 1);
+    EXPECT_EQ(tracker.repetitions(), 3u);
+    EXPECT_TRUE(tracker.isThreefold());
+    EXPECT_TRUE(tracker.pop());
+    EXPECT_EQ(tracker.repetitions(), 2u);
+
+    // An irreversible move starts a new window
+    tracker.push(1, 0);
+    EXPECT_EQ(tracker.repetitions(), 1u);
+    EXPECT_TRUE(tracker.pop());
+    EXPECT_EQ(tracker.repetitions(), 2u);
+
+    tracker.reset(0);
+    for (uint ply = 1; ply < kFiftyMovePlies; ply++)
+        tracker.push(ply, ply);
+    EXPECT_FALSE(tracker.isFiftyMoveDraw());
+    tracker.push(kFiftyMovePlies, kFiftyMovePlies);
+    EXPECT_TRUE(tracker.isFiftyMoveDraw());
+    EXPECT_TRUE(tracker.isDraw());
+
+    // The ring only reaches back kRepetitionPlies
+    for (uint ply = kFiftyMovePlies + 1; ply < 400; ply++)
+        tracker.push(ply % 7, 0);
+    for (uint ply = 1; ply < kRepetitionPlies; ply++)
+        EXPECT_TRUE(tracker.pop());
+    EXPECT_FALSE(tracker.pop());
+}
+
+TEST(testChess, repetitionDraws)
+{
+    using namespace luchess;
+    GameReplayer replayer;
+    auto shuffle = "Nf3 Nf6 Ng1 Ng8 Nf3 Nf6 Ng1 Ng8";
+    EXPECT_EQ(replayer.replay(shuffle).result, GameResult::Draw);
+    EXPECT_EQ(replayer.replay("Nf3 Nf6 Ng1 Ng8 Nf3 Nf6 Ng1").result,
+        GameResult::Unknown);
+
+    GameHistory history;
+    ChessBoard::MoveResult result{};
+    for (auto san : {"Nf3", "Nf6", "Ng1", "Ng8", "Nf3", "Nf6", "Ng1", "Ng8"})
+    {
+        EXPECT_FALSE(result.finished);
+        result = history.play(*decryptMove(history.board, san));
+    }
+    EXPECT_TRUE(result.finished);
+    EXPECT_EQ(result.winner, std::nullopt);
+    EXPECT_TRUE(history.repetitions.isThreefold());
+
+    history.undo();
+    EXPECT_EQ(history.repetitions.repetitions(), 2u);
+    history.seek(0);
+    EXPECT_EQ(history.repetitions.repetitions(), 1u);
+    history.seek(8);
+    EXPECT_EQ(history.repetitions.repetitions(), 3u);
+    history.seek(4);
+    EXPECT_EQ(history.repetitions.repetitions(), 2u);
+}
+
+static chess::ChessBoard backRankMateSetup()
+{
+    return boardFromRanks({
+        "......k.",
+        ".....ppp",
+        "........",
+        "........",
+        "........",
+        "........",
+        ".....PPP",
+        "R.....K."}, chess::White, 0);
+}
+
+TEST(testChess, MovePicker)
+{
+    using namespace luchess;
+    auto kiwipete = boardFromRanks({
+        "r...k..r",
+        "p.ppqpb.",
+        "bn..pnp.",
+        "...PN...",
+        ".p..P...",
+        "..N..Q.p",
+        "PPPBBPPP",
+        "R...K..R"}, White, 0b1111);
+    MoveList all;
+    generatePseudoLegalMoves(kiwipete, all);
+
+    KillerMoves killers = {packMove({{0, 1}, {0, 3}}), packMove({{6, 1}, {6, 2}})};
+    HistoryTable history;
+    BoardMove hashMove{{3, 4}, {3, 5}};
+    static_assert(std::ranges::input_range<MovePicker>);
+    auto pickAll = [](MovePicker& picker)
+    {
+        std::vector<BoardMove> moves;
+        for (BoardMove const& move : picker)
+            moves.push_back(move);
+        return moves;
+    };
+    MovePicker picker(kiwipete, hashMove, killers, history);
+    std::vector<BoardMove> picked = pickAll(picker);
+
+    // Every move exactly once, the hash move first
+    ASSERT_EQ(picked.size(), all.size());
+    for (auto const& move : all)
+        EXPECT_EQ(std::count(picked.begin(), picked.end(), move), 1);
+    EXPECT_EQ(picked[0], hashMove);
+
+    // Captures that do not lose material ahead of quiets, the queen
+    // takes the most valuable victim first, losing captures come last
+    MoveList captures;
+    generatePseudoLegalMoves(kiwipete, captures, MoveKind::Captures);
+    uint good = 0;
+    for (auto const& move : captures)
+        good += see(kiwipete, move) >= 0;
+    EXPECT_LT(good, captures.size());
+    for (uint i = 1; i <= good; i++)
+        EXPECT_GE(see(kiwipete, picked[i]), 0);
+    EXPECT_EQ(picked[1].targetPos, (BoardPosition{0, 5}));
+    EXPECT_EQ(picked[good + 1], (BoardMove{{0, 1}, {0, 3}}));
+    EXPECT_EQ(picked[good + 2], (BoardMove{{6, 1}, {6, 2}}));
+    for (uint i = picked.size() - (captures.size() - good); i < picked.size(); i++)
+        EXPECT_LT(see(kiwipete, picked[i]), 0);
+
+    // History orders the remaining quiets
+    history.reward(Piece(Knight, White), {1, 4}, 4);
+    MovePicker quietPicker(kiwipete, std::nullopt, KillerMoves{}, history);
+    std::vector<BoardMove> quietFirst = pickAll(quietPicker);
+    EXPECT_EQ(quietFirst[good], (BoardMove{{2, 2}, {1, 4}}));
+
+    // Quiescence only sees the captures that do not lose material
+    MovePicker capturePicker(kiwipete);
+    EXPECT_EQ(pickAll(capturePicker), std::vector<BoardMove>(picked.begin() + 1,
+        picked.begin() + 1 + good));
+
+    // A hash move that is not playable here is dropped
+    MovePicker stale(kiwipete, BoardMove{{0, 0}, {0, 7}}, killers, history);
+    std::vector<BoardMove> stalePicked = pickAll(stale);
+    EXPECT_EQ(stalePicked.size(), all.size());
+    EXPECT_NE(stalePicked[0], (BoardMove{{0, 0}, {0, 7}}));
+
+    // Killers that are not quiet moves here are skipped, a playable one
+    // still comes straight after the captures
+    KillerMoves staleKillers = {packMove({{0, 0}, {0, 7}}), packMove({{6, 1}, {6, 2}})};
+    MovePicker killerPicker(kiwipete, std::nullopt, staleKillers, history);
+    std::vector<BoardMove> killerPicked = pickAll(killerPicker);
+    EXPECT_EQ(killerPicked.size(), all.size());
+    EXPECT_EQ(killerPicked[good], (BoardMove{{6, 1}, {6, 2}}));
+    for (auto const& move : all)
+        EXPECT_EQ(std::count(killerPicked.begin(), killerPicked.end(), move), 1);
+}
+
+TEST(testChess, search)
+{
+    using namespace luchess;
+    auto info = search(backRankMateSetup(), {3});
+    EXPECT_EQ(info.depth, 3u);
+    EXPECT_EQ(info.bestMove(), (BoardMove{{0, 0}, {0, 7}}));
+    EXPECT_EQ(info.score, kMateScore - 1);
+
+    ChessBoard chessBoard = executeMoveSetup();
+    info = search(chessBoard, {3});
+    EXPECT_EQ(info.pv.size(), 3u);
+    EXPECT_GT(info.nodes, 0u);
+    // The search works on a copy
+    EXPECT_EQ(chessBoard.layout, executeMoveSetup().layout);
+
+    // A node limit keeps the last finished depth
+    info = search(chessBoard, {10, 500});
+    EXPECT_LT(info.depth, 10u);
+    EXPECT_GT(info.depth, 0u);
+}
+
+TEST(testChess, see)
+{
+    using namespace luchess;
+    auto pawnTakesQueen = boardFromRanks({
+        "......k.",
+        "........",
+        "........",
+        "...q....",
+        "....P...",
+        "........",
+        "........",
+        "......K."}, White, 0);
+    EXPECT_EQ(see(pawnTakesQueen, {{4, 3}, {3, 4}}), 900);
+
+    auto defendedPawn = boardFromRanks({
+        "......k.",
+        "........",
+        "....p...",
+        "...p....",
+        "........",
+        "....N...",
+        "........",
+        "...Q..K."}, White, 0);
+    // The knight and the queen both come back for the pawn
+    EXPECT_EQ(see(defendedPawn, {{3, 0}, {3, 4}}), 100 - 900 + 100);
+    EXPECT_EQ(see(defendedPawn, {{4, 2}, {3, 4}}), 100 - 320 + 100);
+    defendedPawn.getAt({3, 0}) = EMPTY_SQUARE;
+    defendedPawn.indexPieces();
+    EXPECT_EQ(see(defendedPawn, {{4, 2}, {3, 4}}), 100 - 320);
+
+    // The rook behind joins in once the front one has taken
+    auto battery = boardFromRanks({
+        "...r..k.",
+        "........",
+        "........",
+        "...p....",
+        "........",
+        "........",
+        "...R....",
+        "...R..K."}, White, 0);
+    EXPECT_EQ(see(battery, {{3, 1}, {3, 4}}), 100);
+    battery.getAt({3, 0}) = EMPTY_SQUARE;
+    battery.indexPieces();
+    EXPECT_EQ(see(battery, {{3, 1}, {3, 4}}), -400);
+
+    // A king never takes on a covered square
+    auto kingTakes = boardFromRanks({
+        "......k.",
+        "........",
+        "........",
+        "........",
+        "........",
+        "...r....",
+        "...p....",
+        "....K..."}, White, 0);
+    EXPECT_EQ(see(kingTakes, {{4, 0}, {3, 1}}), -19900);
+    kingTakes.getAt({3, 2}) = EMPTY_SQUARE;
+    kingTakes.indexPieces();
+    EXPECT_EQ(see(kingTakes, {{4, 0}, {3, 1}}), 100);
+
+    auto promotion = boardFromRanks({
+        "r.....k.",
+        ".P......",
+        "........",
+        "........",
+        "........",
+        "........",
+        "........",
+        "......K."}, White, 0);
+    EXPECT_EQ(see(promotion, {{1, 6}, {1, 7}}), -100);
+    EXPECT_EQ(see(promotion, {{1, 6}, {0, 7}, Queen}), 1300);
+}
+
+TEST(testChess, quiescence_tactics)
+{
+    using namespace luchess;
+    struct Tactic
+    {
+        ChessBoard board;
+        BoardMove move;
+        // Whether 'move' is the one to find or the one to avoid
+        bool best;
+    };
+    std::vector<Tactic> tactics = {
+        // Knight fork of king and rook
+        {boardFromRanks({
+            "r...k...",
+            ".....ppp",
+            "........",
+            ".N......",
+            "........",
+            "........",
+            ".....PPP",
+            "......K."}, White, 0), {{1, 4}, {2, 6}}, true},
+        // The queen must not take a pawn defended by a pawn
+        {boardFromRanks({
+            "......k.",
+            ".....ppp",
+            "....p...",
+            "...p....",
+            "........",
+            "........",
+            ".....PPP",
+            "...Q..K."}, White, 0), {{3, 0}, {3, 4}}, false},
+        // Two rooks against one win the knight
+        {boardFromRanks({
+            "...r..k.",
+            ".....ppp",
+            "........",
+            "...n....",
+            "........",
+            "........",
+            "...R.PPP",
+            "...R..K."}, White, 0), {{3, 1}, {3, 4}}, true},
+        {boardFromRanks({
+            "...q..k.",
+            ".....ppp",
+            "........",
+            "........",
+            "...N....",
+            "..P.....",
+            ".....PPP",
+            "......K."}, Black, 0), {{3, 7}, {3, 3}}, false},
+        {boardFromRanks({
+            "....rk..",
+            ".....ppp",
+            "........",
+            "........",
+            "..B.....",
+            "........",
+            ".....PPP",
+            "......K."}, White, 0), {{2, 3}, {5, 6}}, false},
+        {boardFromRanks({
+            "rn....k.",
+            ".P...ppp",
+            "........",
+            "........",
+            "........",
+            "........",
+            ".....PPP",
+            "......K."}, White, 0), {{1, 6}, {0, 7}, Queen}, true},
+        // Five captures on d5 come out a knight up
+        {boardFromRanks({
+            "...r..k.",
+            "...r.ppp",
+            "........",
+            "...n....",
+            "........",
+            "...R....",
+            "...R.PPP",
+            "...Q..K."}, White, 0), {{3, 2}, {3, 4}}, true},
+    };
+
+    // Same node budget with and without resolving captures at the leaves
+    auto solved = [&](bool quiescence)
+    {
+        uint count = 0;
+        for (auto const& tactic : tactics)
+        {
+            SearchLimits limits{kMaxPly - 1, 2000};
+            limits.quiescence = quiescence;
+            auto bestMove = search(tactic.board, limits).bestMove();
+            count += bestMove && (*bestMove == tactic.move) == tactic.best;
+        }
+        return count;
+    };
+    uint withQuiescence = solved(true);
+    EXPECT_EQ(withQuiescence, tactics.size());
+    EXPECT_LT(solved(false), withQuiescence);
+}
+
+// Fire and forget coroutine collecting the depths an analysis publishes
+struct UpdateWatcher
+{
+    struct promise_type
+    {
+        UpdateWatcher get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+static UpdateWatcher watchUpdates(chess::Analysis& analysis, std::vector<uint>& depths)
+{
+    while (auto update = co_await analysis.nextUpdate())
+        depths.push_back(update->depth);
+    depths.push_back(0);
+}
+
+TEST(testChess, AnalysisScheduler_thousandAnalyses)
+{
+    using namespace luchess;
+    std::vector<ChessBoard> boards;
+    boards.push_back(executeMoveSetup());
+    boards.push_back(backRankMateSetup());
+    boards.push_back(boardFromRanks({
+        "r...k..r",
+        "p.ppqpb.",
+        "bn..pnp.",
+        "...PN...",
+        ".p..P...",
+        "..N..Q.p",
+        "PPPBBPPP",
+        "R...K..R"}, White, 0b1111));
+
+    SearchLimits limits{2, 0, 16};
+    std::vector<SearchInfo> expected;
+    for (auto const& board : boards)
+        expected.push_back(search(board, limits));
+
+    AnalysisScheduler scheduler;
+    for (uint i = 0; i < 1000; i++)
+        scheduler.add(boards[i % boards.size()], limits);
+    std::vector<std::vector<uint>> depths(10);
+    for (uint i = 0; i < depths.size(); i++)
+        watchUpdates(scheduler[i], depths[i]);
+
+    uint slices = 0;
+    while (scheduler.runSlice())
+        slices++;
+    // Every analysis was sliced, not run through in one go
+    EXPECT_GT(slices, 2u);
+
+    for (uint i = 0; i < 1000; i++)
+    {
+        SearchInfo const& info = scheduler[i].info();
+        SearchInfo const& want = expected[i % boards.size()];
+        ASSERT_TRUE(scheduler[i].done());
+        EXPECT_EQ(info.depth, want.depth);
+        EXPECT_EQ(info.score, want.score);
+        EXPECT_EQ(info.pv, want.pv);
+    }
+    for (auto const& watched : depths)
+        EXPECT_EQ(watched, (std::vector<uint>{1, 2, 0}));
+}
+
+TEST(testChess, AnalysisScheduler_cancelAndPriority)
+{
+    using namespace luchess;
+    AnalysisScheduler scheduler;
+    uint background = scheduler.add(executeMoveSetup(), {8, 0, 64});
+    uint urgent = scheduler.add(backRankMateSetup(), {2, 0, 64}, 1);
+
+    // Only the higher priority analysis runs until it is done
+    while (!scheduler[urgent].done())
+        EXPECT_TRUE(scheduler.runSlice());
+    EXPECT_EQ(scheduler[background].nodes(), 0u);
+    EXPECT_EQ(scheduler[urgent].info().bestMove(), (BoardMove{{0, 0}, {0, 7}}));
+
+    for (uint i = 0; i < 200; i++)
+        scheduler.runSlice();
+    uint64_t nodes = scheduler[background].nodes();
+    EXPECT_GT(nodes, 0u);
+    uint finishedDepth = scheduler[background].info().depth;
+
+    scheduler.cancel(background);
+    scheduler.run();
+    EXPECT_TRUE(scheduler[background].done());
+    EXPECT_LE(scheduler[background].nodes(), nodes + 1);
+    EXPECT_EQ(scheduler[background].info().depth, finishedDepth);
+    EXPECT_LT(finishedDepth, 8u);
+
+    // Reprioritising takes effect on the next slice
+    uint first = scheduler.add(executeMoveSetup(), {3, 0, 64});
+    uint second = scheduler.add(executeMoveSetup(), {3, 0, 64});
+    scheduler.setPriority(second, 5);
+    scheduler.runSlice();
+    EXPECT_EQ(scheduler[first].nodes(), 0u);
+    EXPECT_GT(scheduler[second].nodes(), 0u);
+
+    // An analysis dropped mid search frees its suspended nodes
+    Analysis dropped = analyse(executeMoveSetup(), {4, 0, 8});
+    EXPECT_TRUE(dropped.step());
+    EXPECT_TRUE(dropped.step());
+}
+
+TEST(testChess, fen)
+{
+    using namespace luchess;
+    auto start = parseFen(kStartFen);
+    ASSERT_TRUE(start);
+    EXPECT_EQ(start->layout, executeMoveSetup().layout);
+    EXPECT_EQ(start->state.castleRights(), 0b1111u);
+
+    std::string kiwipeteFen =
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+    auto kiwipete = parseFen(kiwipeteFen);
+    ASSERT_TRUE(kiwipete);
+    EXPECT_EQ(chess::perft(*kiwipete, 2), 2039u);
+    std::string formatted;
+    formatFen(std::back_inserter(formatted), *kiwipete);
+    EXPECT_EQ(formatted, kiwipeteFen);
+
+    // En passant, clocks and partial castling rights survive a round trip
+    std::string enPassantFen = "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w Kq f6 4 1";
+    auto enPassant = parseFen(enPassantFen);
+    ASSERT_TRUE(enPassant);
+    EXPECT_EQ(enPassant->state.enPassantFile(), 5);
+    EXPECT_EQ(enPassant->state.halfmoveClock(), 4u);
+    EXPECT_TRUE(isPseudoLegalMove(*enPassant, {{4, 4}, {5, 5}}));
+    formatted.clear();
+    formatFen(std::back_inserter(formatted), *enPassant);
+    EXPECT_EQ(formatted, enPassantFen);
+
+    EXPECT_TRUE(parseFen("8/8/8/8/8/8/8/K6k b - -"));
+    EXPECT_FALSE(parseFen("8/8/8/8/8/8/8/K6k x - -"));
+    EXPECT_FALSE(parseFen("8/8/8/8/8/8/8/K7 w - -"));
+    EXPECT_FALSE(parseFen("8/8/8/8/8/8/K6k w - -"));
+    EXPECT_FALSE(parseFen("9/8/8/8/8/8/8/K6k w - -"));
+    EXPECT_FALSE(parseFen("8/8/8/8/8/8/8/K6k w - e4"));
+    // An en passant square no double step could have left is dropped, so
+    // no capture onto it is generated
+    auto bogus = parseFen("4k3/8/8/3P4/8/8/8/4K3 w - e6 0 1");
+    ASSERT_TRUE(bogus);
+    EXPECT_EQ(bogus->state.enPassantFile(), -1);
+    EXPECT_FALSE(isPseudoLegalMove(*bogus, {{3, 4}, {4, 5}}));
+    ChessBoard withoutEnPassant = *parseFen("4k3/8/8/3P4/8/8/8/4K3 w - - 0 1");
+    EXPECT_EQ(chess::perft(*bogus, 2), chess::perft(withoutEnPassant, 2));
+    auto blocked = parseFen("4k3/4n3/8/3Pp3/8/8/8/4K3 w - e6 0 1");
+    ASSERT_TRUE(blocked);
+    EXPECT_EQ(blocked->state.enPassantFile(), -1);
+    // Pawns never stand on the first or last rank
+    EXPECT_FALSE(parseFen("P3k3/8/8/8/8/8/8/4K3 w - - 0 1"));
+    EXPECT_FALSE(parseFen("4k3/8/8/8/8/8/8/p3K3 w - - 0 1"));
+    // The side not to move cannot be in check
+    EXPECT_FALSE(parseFen("8/8/8/8/8/8/8/Kq5k b - -"));
+
+    auto record = parseEpd(
+        "2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - bm Qg6; id \"WAC.001\";");
+    ASSERT_TRUE(record);
+    EXPECT_EQ(record->id, "WAC.001");
+    EXPECT_EQ(record->bestMoves, (std::vector<BoardMove>{{{6, 2}, {6, 5}}}));
+    EXPECT_TRUE(record->avoidMoves.empty());
+    EXPECT_TRUE(parseEpd(kiwipeteFen));
+    EXPECT_FALSE(parseEpd("8/8/8/8/8/8/8/K6k w - - bm Qg6;"));
+}
+
+TEST(testChess, searchLines)
+{
+    using namespace luchess;
+    auto lines = searchLines(executeMoveSetup(), {3}, 3);
+    ASSERT_EQ(lines.size(), 3u);
+    EXPECT_NE(lines[0].bestMove(), lines[1].bestMove());
+    EXPECT_NE(lines[1].bestMove(), lines[2].bestMove());
+    EXPECT_NE(lines[0].bestMove(), lines[2].bestMove());
+    EXPECT_GE(lines[0].score, lines[1].score);
+    EXPECT_EQ(lines[0].pv, search(executeMoveSetup(), {3}).pv);
+
+    // Only as many lines as there are legal moves
+    auto cornered = boardFromRanks({
+        "k.......",
+        "........",
+        "........",
+        "........",
+        "........",
+        "........",
+        "........",
+        ".R....K."}, Black, 0);
+    EXPECT_EQ(searchLines(cornered, {3}, 4).size(), 1u);
+
+    // A time budget stops an otherwise endless search
+    SearchLimits timed{kMaxPly - 1};
+    timed.time = std::chrono::milliseconds(20);
+    auto start = std::chrono::steady_clock::now();
+    auto info = search(executeMoveSetup(), timed);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    EXPECT_TRUE(info.bestMove());
+    EXPECT_LT(info.depth, kMaxPly - 1);
+
+    // Quiescence nodes count towards the clock reads too
+    SearchLimits brief{1};
+    brief.time = std::chrono::milliseconds(1);
+    SearchContext capturing(*parseFen("4k3/8/3p4/4P3/8/8/8/4K3 w - - 0 1"), brief);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    capturing.nodes = capturing.nextTimeCheck - 1;
+    quiescence(capturing, 0, -kInfinity, kInfinity);
+    EXPECT_TRUE(capturing.outOfTime);
+}
+
+TEST(testChess, runSuite)
+{
+    using namespace luchess;
+    std::vector<EpdRecord> positions;
+    for (auto line : {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - bm Ra8#; id \"back rank\";",
+        "6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - am Ra8#;",
+        "k7/8/8/8/8/8/8/1R4K1 b - -"})
+        positions.push_back(*parseEpd(line));
+
+    SuiteOptions options;
+    options.limits = {3};
+    options.lines = 2;
+    options.threads = 2;
+    std::stringstream results, checkpoint;
+    // The first position was finished by an earlier run
+    SuiteSummary summary = runSuite(positions, options, results, &checkpoint,
+        {true, false, false, false});
+    EXPECT_EQ(summary.searched, 3u);
+    EXPECT_EQ(summary.skipped, 1u);
+    EXPECT_GT(summary.nodes, 0u);
+    EXPECT_LE(summary.p50, summary.max);
+
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(results, line);)
+        lines.push_back(line);
+    ASSERT_EQ(lines.size(), 3u);
+    std::ranges::sort(lines);
+    EXPECT_EQ(lines[0], "{\"index\":1,\"id\":\"back rank\","
+        "\"fen\":\"6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1\",\"bestmove\":\"a1a8\","
+        "\"score\":{\"mate\":1},\"depth\":3,\"nodes\":" +
+        lines[0].substr(lines[0].find("\"nodes\":") + 8));
+    EXPECT_NE(lines[0].find("\"solved\":true"), std::string::npos);
+    EXPECT_NE(lines[1].find("\"solved\":false"), std::string::npos);
+    // Two lines asked for, the cornered king has a single move
+    EXPECT_NE(lines[0].find("},{\"depth\""), std::string::npos);
+    EXPECT_EQ(lines[2].find("},{\"depth\""), std::string::npos);
+
+    // Resuming from the checkpoint leaves nothing to do
+    std::vector<bool> finished = readCheckpoint(checkpoint, positions.size());
+    finished[0] = true;
+    EXPECT_EQ(finished, std::vector<bool>(4, true));
+    std::stringstream rerun;
+    summary = runSuite(positions, options, rerun, nullptr, finished);
+    EXPECT_EQ(summary.searched, 0u);
+    EXPECT_TRUE(rerun.str().empty());
+}
+
+TEST(testChess, selfPlay)
+{
+    using namespace luchess;
+    ChessBoard board =
+        *parseFen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R b KQkq - 7 1");
+    TrainingRecord record = TrainingRecord::encode(board, -40000, 123, 9);
+    EXPECT_EQ(record.score, INT16_MIN);
+    ChessBoard decoded;
+    record.decode(decoded);
+    EXPECT_EQ(decoded.layout, board.layout);
+    EXPECT_EQ(decoded.state.word, board.state.word);
+
+    std::string path = tempPath("luchess_selfplay");
+    std::filesystem::remove(path);
+    SelfPlayOptions options;
+    options.games = 3;
+    options.nodes = 300;
+    options.maxPlies = 60;
+    options.threads = 2;
+    options.bufferRecords = 16;
+    std::atomic<bool> stop = false;
+    SelfPlayProgress progress;
+    SelfPlaySummary summary = runSelfPlay(path, options, stop, &progress);
+    EXPECT_EQ(summary.games, 3u);
+    EXPECT_EQ(progress.positions, summary.positions);
+
+    std::vector<TrainingRecord> records = readTrainingRecords(path);
+    ASSERT_EQ(records.size(), summary.positions);
+    ASSERT_FALSE(records.empty());
+    EXPECT_TRUE(records.back().flags & TrainingRecord::kGameEnd);
+    std::set<uint> ended;
+    for (TrainingRecord const& record : records)
+    {
+        if (record.flags & TrainingRecord::kGameEnd)
+        {
+            EXPECT_TRUE(ended.insert(record.game).second);
+        }
+        EXPECT_LT(record.game, 3u);
+        EXPECT_GE(record.ply, options.openingPlies);
+        EXPECT_NE(record.result, uint8_t(GameResult::Unknown));
+        record.decode(decoded);
+        EXPECT_FALSE(decoded._isKingExposed(decoded.nextGo()));
+    }
+
+    // A torn append, here part of game 3 and half a record, is cut off and
+    // the finished games are not played again
+    {
+        TrainingRecord partial = records.front();
+        partial.game = 3;
+        partial.flags = 0;
+        std::ofstream torn(path, std::ios::binary | std::ios::app);
+        torn.write(reinterpret_cast<char const*>(&partial), sizeof(partial));
+        torn.write("torn", 4);
+    }
+    options.games = 4;
+    summary = runSelfPlay(path, options, stop, nullptr);
+    EXPECT_EQ(summary.skipped, 3u);
+    EXPECT_EQ(summary.games, 1u);
+    std::vector<TrainingRecord> resumed = readTrainingRecords(path);
+    EXPECT_EQ(std::filesystem::file_size(path), resumed.size() * sizeof(TrainingRecord));
+    EXPECT_EQ(resumed.size(), records.size() + summary.positions);
+
+    // Same seed, same games
+    std::string replayPath = path + ".replay";
+    std::filesystem::remove(replayPath);
+    options.threads = 1;
+    runSelfPlay(replayPath, options, stop, nullptr);
+    auto sameGames = [](std::vector<TrainingRecord> records)
+    {
+        std::ranges::stable_sort(records, {}, &TrainingRecord::game);
+        std::vector<std::pair<uint, int>> scores;
+        for (TrainingRecord const& record : records)
+            scores.emplace_back(record.ply, record.score);
+        return scores;
+    };
+    EXPECT_EQ(sameGames(resumed), sameGames(readTrainingRecords(replayPath)));
+
+    // Stopped before it starts, nothing is written
+    stop = true;
+    std::filesystem::remove(replayPath);
+    summary = runSelfPlay(replayPath, options, stop, nullptr);
+    EXPECT_EQ(summary.games, 0u);
+    EXPECT_TRUE(readTrainingRecords(replayPath).empty());
+    std::filesystem::remove(path);
+    std::filesystem::remove(replayPath);
+}
+
+TEST(testChess, tournamentStats)
+{
+    using namespace luchess;
+    TournamentStats stats;
+    EXPECT_EQ(stats.llr({}), 0.);
+    stats.addPair(GameResult::WhiteWins, GameResult::BlackWins);
+    stats.addPair(GameResult::WhiteWins, GameResult::Draw);
+    stats.addPair(GameResult::Draw, GameResult::WhiteWins);
+    stats.addPair(GameResult::BlackWins, GameResult::Draw);
+    EXPECT_EQ(stats.wins, 3u);
+    EXPECT_EQ(stats.losses, 2u);
+    EXPECT_EQ(stats.draws, 3u);
+    EXPECT_EQ(stats.pentanomial, (std::array<uint64_t, 5>{0, 2, 0, 1, 1}));
+    EXPECT_EQ(stats.pairs(), 4u);
+    EXPECT_DOUBLE_EQ(stats.score(), 4.5 / 8);
+    EXPECT_NEAR(stats.elo(), 43.66, 0.01);
+    EXPECT_GT(stats.eloError(), 0.);
+
+    // Even results support elo0, a steady lead elo1
+    SprtBounds bounds{0., 20., 0.05, 0.05};
+    EXPECT_NEAR(bounds.upper(), 2.944, 0.001);
+    EXPECT_NEAR(bounds.lower(), -2.944, 0.001);
+    TournamentStats even, ahead;
+    for (int i = 0; i < 600; i++)
+    {
+        even.addPair(GameResult::Draw, i % 2 ? GameResult::WhiteWins : GameResult::BlackWins);
+        ahead.addPair(GameResult::WhiteWins, i % 2 ? GameResult::WhiteWins : GameResult::Draw);
+    }
+    EXPECT_LT(even.llr(bounds), 0.);
+    EXPECT_EQ(even.decision(bounds), SprtDecision::AcceptH0);
+    EXPECT_EQ(ahead.decision(bounds), SprtDecision::AcceptH1);
+}
+
+TEST(testChess, runTournament)
+{
+    using namespace luchess;
+    std::vector<ChessBoard> openings;
+    for (auto fen : {
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+        "rnbqkbnr/pppp1ppp/8/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2",
+        "r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R b KQkq - 3 3"})
+        openings.push_back(*parseFen(fen));
+
+    // A deeper search against a one ply one must be clearly stronger
+    std::array<SearchLimits, 2> engines = {SearchLimits{3}, SearchLimits{1}};
+    TournamentOptions options;
+    options.pairs = 60;
+    options.maxPlies = 120;
+    options.threads = 2;
+    options.sprt = {0., 100., 0.1, 0.1};
+    std::atomic<bool> stop = false;
+    uint64_t reported = 0;
+    TournamentSummary summary = runTournament(engines, openings, options, stop,
+        [&](TournamentStats const& stats)
+        {
+            EXPECT_EQ(stats.pairs(), ++reported);
+        });
+    EXPECT_EQ(summary.decision, SprtDecision::AcceptH1);
+    EXPECT_LT(summary.stats.pairs(), options.pairs);
+    EXPECT_EQ(summary.stats.pairs(), reported);
+    EXPECT_EQ(summary.stats.games(), 2 * reported);
+    EXPECT_GT(summary.stats.elo(), 100.);
+    EXPECT_GT(summary.gamesPerMinute(), 0.);
+
+    // Stopped before it starts
+    stop = true;
+    summary = runTournament(engines, openings, options, stop);
+    EXPECT_EQ(summary.stats.games(), 0u);
+    EXPECT_EQ(summary.decision, SprtDecision::Continue);
+}
+
+TEST(testChess, PositionSet)
+{
+    using namespace luchess;
+    // Half the inserts repeat an earlier key
+    std::mt19937_64 random(7);
+    std::vector<uint64_t> keys;
+    for (int i = 0; i < 200000; i++)
+        keys.push_back(i % 2 && i > 1 ? keys[random() % keys.size()] : random());
+    keys.push_back(0);
+    keys.push_back(0);
+    std::unordered_set<uint64_t> expected(keys.begin(), keys.end());
+
+    // Keys that differ only in the top bits the shards index by still
+    // spread over the filter, unseen ones are rarely taken for seen
+    BloomFilter filter(4096, 8);
+    for (uint64_t i = 0; i < 4096; i++)
+        filter.add(i << 48 | 7);
+    uint falsePositives = 0;
+    for (uint64_t i = 4096; i < 8192; i++)
+        falsePositives += filter.mayContain(i << 48 | 7);
+    EXPECT_LT(falsePositives, 4096u / 10);
+
+    // Tiny shards and memory limit, so shards spill and merge their runs
+    DedupOptions options;
+    options.expectedPositions = keys.size();
+    options.memoryLimit = 64 << 10;
+    options.shards = 4;
+    std::filesystem::path spillDirectory;
+    {
+        PositionSet set(options);
+        uint64_t fresh = 0;
+        for (uint64_t key : keys)
+            fresh += set.insert(key);
+        EXPECT_EQ(fresh, expected.size());
+        EXPECT_EQ(set.unique(), expected.size());
+        EXPECT_EQ(set.total(), keys.size());
+        EXPECT_GT(set.spilled(), expected.size() / 2);
+        for (uint64_t key : expected)
+            EXPECT_TRUE(set.contains(key));
+        EXPECT_FALSE(set.contains(random()));
+        spillDirectory = options.spillDirectory;
+    }
+    // Runs go with the set
+    for (auto const& entry : std::filesystem::directory_iterator(spillDirectory))
+        EXPECT_EQ(entry.path().filename().string().find("luchess-dedup-"), std::string::npos);
+
+    // Ingest threads racing on the same keys still count each once
+    options.memoryLimit = 0;
+    options.shards = 64;
+    PositionSet set(options);
+    std::atomic<uint64_t> fresh = 0;
+    {
+        std::vector<std::jthread> threads;
+        for (int t = 0; t < 4; t++)
+            threads.emplace_back([&]()
+            {
+                for (uint64_t key : keys)
+                    fresh += set.insert(key);
+            });
+    }
+    EXPECT_EQ(fresh, expected.size());
+    EXPECT_EQ(set.unique(), expected.size());
+    EXPECT_EQ(set.total(), 4 * keys.size());
+    EXPECT_LT(double(set.memoryBytes()) / set.unique(), 16.);
+
+    ChessBoard board;
+    populateDefaultLayout(board);
+    EXPECT_TRUE(set.insert(board));
+    EXPECT_FALSE(set.insert(board));
+    EXPECT_TRUE(set.contains(zobristKey(board)));
+}
+
+TEST(testChess, dedupTrainingRecords)
+{
+    using namespace luchess;
+    std::string in = tempPath("luchess_dedup_in");
+    std::string out = tempPath("luchess_dedup_out");
+    std::filesystem::remove(out);
+    std::vector<TrainingRecord> records;
+    // Every position reached in two plies, each written three times
+    ChessBoard board;
+    populateDefaultLayout(board);
+    MoveList first;
+    generateLegalMoves(board, first);
+    std::unordered_set<uint64_t> distinct;
+    for (int copy = 0; copy < 3; copy++)
+    {
+        for (BoardMove const& move : first)
+        {
+            auto undo = board.makeMove(move);
+            MoveList second;
+            generateLegalMoves(board, second);
+            for (BoardMove const& reply : second)
+            {
+                auto replyUndo = board.makeMove(reply);
+                records.push_back(TrainingRecord::encode(board, copy, 2, 0));
+                distinct.insert(zobristKey(board));
+                board.unmakeMove(reply, replyUndo);
+            }
+            board.unmakeMove(move, undo);
+        }
+    }
+    {
+        std::ofstream file(in, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<char const*>(records.data()),
+            std::streamsize(records.size() * sizeof(TrainingRecord)));
+    }
+
+    DedupOptions options;
+    options.expectedPositions = records.size();
+    DedupSummary summary = dedupTrainingRecords(in, out, options, 2);
+    EXPECT_EQ(summary.total, 1200u);
+    EXPECT_EQ(summary.unique, 400u);
+    std::vector<TrainingRecord> unique = readTrainingRecords(out);
+    ASSERT_EQ(unique.size(), distinct.size());
+    std::unordered_set<uint64_t> written;
+    for (TrainingRecord const& record : unique)
+    {
+        ChessBoard decoded;
+        record.decode(decoded);
+        EXPECT_TRUE(written.insert(zobristKey(decoded)).second);
+    }
+    EXPECT_EQ(written, distinct);
+    std::filesystem::remove(in);
+    std::filesystem::remove(out);
+}
+
+TEST(testChess, BoardBatch)
+{
+    using namespace luchess;
+    // Positions from random games, unfinished lanes of a batch stay empty
+    std::mt19937_64 random(3);
+    std::vector<ChessBoard> boards;
+    for (auto fen : {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"})
+    {
+        for (int game = 0; game < 20; game++)
+        {
+            ChessBoard board = *parseFen(fen);
+            for (int ply = 0; ply < 80; ply++)
+            {
+                MoveList moves;
+                generateLegalMoves(board, moves);
+                if (moves.empty())
+                    break;
+                board.makeMove(moves[random() % moves.size()]);
+                boards.push_back(board);
+            }
+        }
+    }
+    boards.resize(boards.size() - boards.size() % kBatchBoards + 3);
+
+    uint checks = 0;
+    for (BatchKernel kernel : {BatchKernel::Scalar, BatchKernel::Avx2})
+    {
+        if (!isBatchKernelAvailable(kernel))
+            continue;
+        for (std::size_t first = 0; first < boards.size(); first += kBatchBoards)
+        {
+            BoardBatch batch;
+            std::size_t lanes = std::min<std::size_t>(kBatchBoards, boards.size() - first);
+            for (uint lane = 0; lane < lanes; lane++)
+                batch.set(lane, boards[first + lane]);
+            BatchAttacks attacks;
+            computeAttacks(batch, attacks, kernel);
+            for (uint lane = 0; lane < kBatchBoards; lane++)
+            {
+                if (lane >= lanes)
+                {
+                    EXPECT_EQ(attacks.lane(lane), AttackSummary{});
+                    continue;
+                }
+                ChessBoard& board = boards[first + lane];
+                AttackSummary expected = summarizeAttacks(BoardBitboards(board));
+                ASSERT_EQ(attacks.lane(lane), expected) << "board " << first + lane;
+                for (PieceColor color : {Black, White})
+                {
+                    EXPECT_EQ(expected.inCheck[color], board._isKingExposed(color));
+                    checks += expected.inCheck[color];
+                }
+            }
+        }
+    }
+    EXPECT_GT(checks, 0u);
+
+    // Start position: 20 squares reachable, pawns and knights cover rank 3
+    ChessBoard start = *parseFen(kStartFen);
+    AttackSummary summary = summarizeAttacks(BoardBitboards(start));
+    EXPECT_EQ(summary.attacked[White] & 0xff0000, 0xff0000u);
+    EXPECT_EQ(summary.mobility[White], 8u);
+    EXPECT_EQ(summary.mobility[Black], 8u);
+    EXPECT_FALSE(summary.inCheck[White]);
+}
+
+TEST(testChess, ShmChannel)
+{
+    using namespace luchess;
+    ChessBoard board = *parseFen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+
+    // Every message kind survives the trip through its 128 bytes
+    BoardMove promotion{{1, 6}, {1, 7}, Knight};
+    EXPECT_EQ(ChannelMessage::encodeMove(promotion).decodeMove(), promotion);
+    ChessBoard::MoveResult result{true, false, true, true};
+    ChessBoard::MoveResult decoded = ChannelMessage::encodeResult(result).decodeResult();
+    EXPECT_TRUE(decoded.validMove && decoded.finished && !decoded.nextPlayerColour);
+    EXPECT_EQ(decoded.winner, std::optional<bool>(true));
+    result.winner.reset();
+    EXPECT_FALSE(ChannelMessage::encodeResult(result).decodeResult().winner);
+    ChessBoard copy;
+    ChannelMessage::encodeBoard(board).decodeBoard(copy);
+    EXPECT_EQ(copy.layout, board.layout);
+    EXPECT_EQ(copy.state.word, board.state.word);
+    SearchInfo info{7, -kMateScore + 5, 123456, {}};
+    for (uint i = 0; i < kChannelPvMoves + 3; i++)
+        info.pv.push_back(BoardMove{{int(i % 8), 1}, {int(i % 8), 3}});
+    SearchInfo analysis = ChannelMessage::encodeAnalysis(info).decodeAnalysis();
+    EXPECT_EQ(analysis.depth, 7u);
+    EXPECT_EQ(analysis.score, info.score);
+    EXPECT_EQ(analysis.nodes, 123456u);
+    info.pv.resize(kChannelPvMoves);
+    EXPECT_EQ(analysis.pv, info.pv);
+
+    std::string name = "luchess_test_" + std::to_string(getpid());
+    ShmChannel server = ShmChannel::create(name, 3);
+    EXPECT_EQ(server.capacity(), 4u);
+    EXPECT_THROW(ShmChannel::create(name), std::system_error);
+
+    // Failures carry the errno of the call that failed, a segment too
+    // small for a channel is no system error
+    try
+    {
+        ShmChannel::open(name + "_missing");
+        ADD_FAILURE();
+    }
+    catch (std::system_error const& error)
+    {
+        EXPECT_EQ(error.code(), std::errc::no_such_file_or_directory);
+    }
+    std::string small = "/" + name + "_small";
+    int fd = shm_open(small.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(ftruncate(fd, 16), 0);
+    close(fd);
+    try
+    {
+        ShmChannel::open(small);
+        ADD_FAILURE();
+    }
+    catch (std::system_error const&)
+    {
+        ADD_FAILURE();
+    }
+    catch (std::runtime_error const&)
+    {
+    }
+    shm_unlink(small.c_str());
+
+    // The client echoes back far more messages than the rings hold, so
+    // both ends block on full and empty rings
+    constexpr uint kMessages = 5000;
+    std::jthread client([name]
+    {
+        ShmChannel channel = ShmChannel::open(name);
+        channel.spins = 0;
+        ChannelMessage message;
+        while (channel.receive(message))
+        {
+            if (!channel.send(message))
+                break;
+        }
+    });
+    std::jthread sender([&]
+    {
+        for (uint i = 0; i < kMessages; i++)
+        {
+            ChannelMessage message = ChannelMessage::encodeBoard(board);
+            message.sequence = i;
+            ASSERT_TRUE(server.send(message));
+        }
+    });
+    ChannelMessage message;
+    for (uint i = 0; i < kMessages; i++)
+    {
+        ASSERT_TRUE(server.receive(message));
+        ASSERT_EQ(message.sequence, i);
+        ASSERT_EQ(message.kind, ChannelMessageKind::Board);
+    }
+    sender.join();
+    EXPECT_FALSE(server.tryReceive(message));
+
+    // Closing wakes the client blocked in receive, after that nothing
+    // goes through
+    server.close();
+    client.join();
+    EXPECT_FALSE(server.send(message));
+}
+
+TEST(testChess, GameLog)
+{
+    using namespace luchess;
+    EXPECT_FALSE(LogRecord{}.valid());
+    LogRecord record = LogRecord::make(LogRecordKind::Move, 7, 3, 0x1234);
+    EXPECT_TRUE(record.valid());
+    record.ply ^= 1;
+    EXPECT_FALSE(record.valid());
+
+    std::string path = tempPath("luchess_gamelog");
+    std::filesystem::remove(path);
+    GameLogOptions options;
+    options.checkpointPlies = 8;
+
+    // Two threads play ten games each, the odd ones are finished
+    struct Expected { uint ply; ChessBoard board; bool live; };
+    std::vector<Expected> expected(20);
+    {
+        GameLog log(path, options);
+        auto play = [&](uint first)
+        {
+            std::mt19937_64 random(first);
+            for (uint game = first; game < 20; game += 2)
+            {
+                ChessBoard board;
+                populateDefaultLayout(board);
+                uint64_t sequence = log.startGame(game, board);
+                uint ply = 0;
+                bool live = true;
+                for (uint plies = uint(random() % 30); ply < plies && live; )
+                {
+                    MoveList moves;
+                    generateLegalMoves(board, moves);
+                    if (moves.empty())
+                        break;
+                    BoardMove move = moves[random() % moves.size()];
+                    live = !board.executeMove(move).finished;
+                    sequence = log.logMove(game, ++ply, move, board);
+                }
+                if (game % 2)
+                {
+                    sequence = log.finishGame(game, ply);
+                    live = false;
+                }
+                log.sync(sequence);
+                expected[game] = {ply, board, live};
+            }
+        };
+        std::jthread other(play, 1);
+        play(0);
+    }
+
+    auto check = [&](GameLogRecovery const& recovery)
+    {
+        std::size_t live = 0;
+        for (Expected const& game : expected)
+            live += game.live;
+        ASSERT_EQ(recovery.games.size(), live);
+        for (RecoveredGame const& game : recovery.games)
+        {
+            ASSERT_TRUE(expected[game.game].live) << "game " << game.game;
+            EXPECT_EQ(game.ply, expected[game.game].ply) << "game " << game.game;
+            EXPECT_EQ(game.board.layout, expected[game.game].board.layout) << "game " << game.game;
+            EXPECT_EQ(game.board.state.word, expected[game.game].board.state.word) << "game " << game.game;
+        }
+    };
+    GameLogRecovery recovery = recoverGameLog(path, 3);
+    check(recovery);
+    EXPECT_EQ(recovery.records, std::filesystem::file_size(path) / sizeof(LogRecord));
+    EXPECT_LT(recovery.replayed, recovery.records);
+
+    // A torn tail is ignored, then cut off before the log grows again
+    uint64_t records = recovery.records;
+    {
+        std::ofstream tail(path, std::ios::binary | std::ios::app);
+        LogRecord torn = LogRecord::make(LogRecordKind::Move, 0, 99, 0);
+        torn.checksum ^= 1;
+        tail.write(reinterpret_cast<char const*>(&torn), sizeof(torn));
+        tail.write("partial", 7);
+    }
+    check(recoverGameLog(path, 1));
+    ASSERT_FALSE(recovery.games.empty());
+    {
+        uint game = recovery.games.front().game;
+        ChessBoard& board = expected[game].board;
+        MoveList moves;
+        generateLegalMoves(board, moves);
+        ASSERT_FALSE(moves.empty());
+        board.executeMove(moves[0]);
+        GameLog log(path, options);
+        log.sync(log.logMove(game, ++expected[game].ply, moves[0], board));
+    }
+    recovery = recoverGameLog(path, 2);
+    check(recovery);
+    EXPECT_EQ(recovery.records, records + 1);
+    std::filesystem::remove(path);
+}
+
+TEST(testChess, PawnCache)
+{
+    using namespace luchess;
+    // Incremental pawn keys and cached evaluations match a fresh
+    // computation three plies deep, through promotions and en passant
+    PawnCache cache;
+    std::function<void(ChessBoard&, uint64_t, uint)> walk =
+        [&](ChessBoard& board, uint64_t key, uint depth)
+    {
+        ASSERT_EQ(key, pawnKey(board));
+        EXPECT_EQ(evaluate(board, cache, key), evaluate(board));
+        if (depth == 0)
+            return;
+        MoveList moves;
+        generateLegalMoves(board, moves);
+        for (auto const& move : moves)
+        {
+            auto undo = board.makeMove(move);
+            walk(board, updatePawnKey(key, board, move, undo), depth - 1);
+            board.unmakeMove(move, undo);
+        }
+    };
+    for (std::string_view fen : {
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"})
+    {
+        ChessBoard board = *parseFen(fen);
+        walk(board, pawnKey(board), 3);
+    }
+    EXPECT_GT(cache.hits, cache.probes / 2);
+
+    // Only pawns change the pawn key
+    ChessBoard start;
+    populateDefaultLayout(start);
+    auto undo = start.makeMove({{6, 0}, {5, 2}});
+    EXPECT_EQ(updatePawnKey(pawnKey(start), start, {{6, 0}, {5, 2}}, undo), pawnKey(start));
+
+    auto bit = [](int column, int row) { return squareBit(uint(column + 8 * row)); };
+    // Doubled, both isolated, both passed
+    EXPECT_EQ(evaluatePawns(bit(0, 1) | bit(0, 2), 0).score, -12 - 2 * 15 + 5 + 10);
+    // d4 passed, e3 backward as f5 covers e4; f5 isolated
+    PawnEntry pawns = evaluatePawns(bit(3, 3) | bit(4, 2), bit(5, 4));
+    EXPECT_EQ(pawns.score, 20 - 8 + 15);
+    EXPECT_EQ(pawns.passed[White], bit(3, 3));
+    EXPECT_EQ(pawns.passed[Black], 0u);
+    PawnEntry mirrored = evaluatePawns(bit(5, 3), bit(3, 4) | bit(4, 5));
+    EXPECT_EQ(mirrored.score, -pawns.score);
+    EXPECT_EQ(mirrored.passed[Black], bit(3, 4));
+
+    // A passed pawn gains as the enemy king stands further from its stop
+    // square, b8 and g8 score the same for the king itself
+    int nearKing = evaluate(*parseFen("1k6/8/3P4/8/8/8/8/4K3 w - - 0 1"));
+    int farKing = evaluate(*parseFen("6k1/8/3P4/8/8/8/8/4K3 w - - 0 1"));
+    EXPECT_EQ(farKing - nearKing, 8);
+
+    // Searches on a thread share its cache rather than building their own
+    PawnCache& shared = threadPawnCache();
+    uint64_t probes = shared.probes;
+    search(*parseFen("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"), {3});
+    EXPECT_GT(shared.probes, probes);
+    EXPECT_EQ(&threadPawnCache(), &shared);
+}
+
+TEST(testChess, TranspositionTable)
+{
+    using namespace luchess;
+    TranspositionTable table(1);
+    EXPECT_EQ(table.bytes(), 1u << 20);
+    EXPECT_FALSE(table.probe(42, 0));
+
+    // Mates are kept relative to the node
+    BoardMove move{{4, 1}, {4, 3}};
+    table.store(42, 5, kMateScore - 10, TTBound::Exact, move, 4);
+    std::optional<TTEntry> entry = table.probe(42, 6);
+    ASSERT_TRUE(entry);
+    EXPECT_EQ(entry->score, kMateScore - 12);
+    EXPECT_EQ(entry->depth, 5);
+    EXPECT_EQ(entry->bound(), TTBound::Exact);
+    EXPECT_EQ(unpackMove(entry->move), move);
+    // A store without a move keeps the one before
+    table.store(42, 6, 15, TTBound::Lower, std::nullopt, 0);
+    entry = table.probe(42, 0);
+    EXPECT_EQ(entry->score, 15);
+    EXPECT_EQ(unpackMove(entry->move), move);
+    table.clear();
+    EXPECT_FALSE(table.probe(42, 0));
+
+    // Searching again with the table of the first search is cheaper
+    ChessBoard board = *parseFen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    SearchLimits limits;
+    limits.depth = 4;
+    SearchInfo cold = search(board, limits, &table);
+    ASSERT_TRUE(cold.bestMove());
+
+    std::string path = tempPath("luchess_table");
+    table.save(path);
+    uint64_t key = zobristKey(board);
+    std::optional<TTEntry> root = table.probe(key, 0);
+    ASSERT_TRUE(root);
+    {
+        TranspositionTable loaded = TranspositionTable::load(path);
+        EXPECT_EQ(loaded.clusters(), table.clusters());
+        EXPECT_EQ(loaded.uncheckedPages(), loaded.clusters() / TranspositionTable::kPageClusters);
+        entry = loaded.probe(key, 0);
+        ASSERT_TRUE(entry);
+        EXPECT_EQ(entry->score, root->score);
+        EXPECT_EQ(entry->move, root->move);
+        EXPECT_EQ(loaded.uncheckedPages() + 1, loaded.clusters() / TranspositionTable::kPageClusters);
+        SearchInfo warm = search(board, limits, &loaded);
+        EXPECT_LT(warm.nodes, cold.nodes);
+    }
+
+    // A damaged page is cleared on first touch, the others survive
+    std::size_t entries = std::filesystem::file_size(path) - table.bytes();
+    std::size_t page = (key & (table.clusters() - 1)) / TranspositionTable::kPageClusters;
+    auto patch = [&](std::size_t offset, char byte)
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(std::streamoff(offset));
+        file.put(byte);
+    };
+    patch(entries + page * TranspositionTable::kPageBytes + 100, 0x5a);
+    {
+        TranspositionTable loaded = TranspositionTable::load(path);
+        EXPECT_FALSE(loaded.probe(key, 0));
+        std::size_t survivors = 0;
+        for (uint64_t other = 0; other < table.clusters(); other++)
+        {
+            std::size_t index = other / TranspositionTable::kPageClusters;
+            if (index == page)
+                continue;
+            for (TTEntry const& stored : table._table[other].entries)
+                survivors += stored.bound() != TTBound::None &&
+                    loaded.probe(stored.key, 0).has_value();
+        }
+        EXPECT_GT(survivors, 0u);
+    }
+
+    // Files from another version or build, or damaged ahead of the
+    // entries, are rejected
+    auto rejects = [&](std::string const& why)
+    {
+        try
+        {
+            TranspositionTable::load(path);
+            ADD_FAILURE() << "loaded, expected " << why;
+        }
+        catch (std::runtime_error const& failure)
+        {
+            EXPECT_NE(std::string(failure.what()).find(why), std::string::npos) << failure.what();
+        }
+    };
+    table.save(path);
+    patch(8, 9);
+    rejects("version");
+    table.save(path);
+    patch(16, 0);
+    rejects("incompatible build");
+    table.save(path);
+    patch(40, 1);
+    rejects("checksum");
+    table.save(path);
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 64);
+    rejects("truncated");
+    patch(0, 'X');
+    rejects("not a transposition table");
+    std::filesystem::remove(path);
+    rejects("cannot be opened");
+}
+
+TEST(testChess, ThreadPool)
+{
+    using namespace luchess;
+    ThreadPool pool(ThreadPoolOptions{.threads = 3});
+    ASSERT_EQ(pool.size(), 3u);
+
+    std::atomic<uint> count = 0;
+    {
+        TaskGroup group(pool);
+        for (uint i = 0; i < 1000; i++)
+            group.run([&] { count++; });
+        group.wait();
+    }
+    EXPECT_EQ(count, 1000u);
+
+    // Tasks fork and wait on groups of their own
+    std::function<uint64_t(uint)> fibonacci = [&](uint n) -> uint64_t
+    {
+        if (n < 2)
+            return n;
+        uint64_t a = 0, b = 0;
+        TaskGroup group(pool);
+        group.run([&] { a = fibonacci(n - 1); });
+        b = fibonacci(n - 2);
+        group.wait();
+        return a + b;
+    };
+    EXPECT_EQ(fibonacci(18), 2584u);
+
+    TaskGroup failing(pool);
+    failing.run([] { throw std::runtime_error("task failed"); });
+    failing.run([&] { count++; });
+    EXPECT_THROW(failing.wait(), std::runtime_error);
+    EXPECT_EQ(count, 1001u);
+
+    ChessBoard kiwipete = *parseFen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    EXPECT_EQ(perft(kiwipete, 3, pool), 97862u);
+
+    // runTasks hands out every index once, task 0 to the caller
+    std::vector<std::atomic<uint>> runs(16);
+    std::thread::id first;
+    runTasks(pool, 16, [&](uint index)
+    {
+        runs[index]++;
+        if (index == 0)
+            first = std::this_thread::get_id();
+    });
+    for (auto const& count : runs)
+        EXPECT_EQ(count, 1u);
+    EXPECT_EQ(first, std::this_thread::get_id());
+
+    ThreadPoolStats stats = pool.stats();
+    EXPECT_EQ(stats.workers, 3u);
+    EXPECT_GE(stats.executed, 1000u);
+    EXPECT_GE(stats.utilisation, 0.0);
+    EXPECT_LE(stats.utilisation, 1.0);
+
+    // Interactive tasks queued behind a busy worker go before Background ones
+    ThreadPool single(ThreadPoolOptions{.threads = 1, .pinned = true});
+    EXPECT_GE(single.workerCpu(0), 0);
+    std::atomic<bool> started = false, gate = false;
+    std::atomic<uint> done = 0;
+    std::vector<TaskPriority> order;
+    single.submit([&]
+    {
+        started = true;
+        while (!gate)
+            std::this_thread::yield();
+    });
+    while (!started)
+        std::this_thread::yield();
+    // A task still running counts as busy time before it finishes
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_GT(single.stats().utilisation, 0.5);
+    for (uint i = 0; i < 4; i++)
+    {
+        for (TaskPriority priority : {TaskPriority::Background, TaskPriority::Interactive})
+            single.submit([&, priority] { order.push_back(priority); done++; }, priority);
+    }
+    gate = true;
+    while (done < 8)
+        std::this_thread::yield();
+    ASSERT_EQ(order.size(), 8u);
+    EXPECT_TRUE(std::is_partitioned(order.begin(), order.end(),
+        [](TaskPriority priority) { return priority == TaskPriority::Interactive; }));
+}
+
+TEST(testChess, PieceLists)
+{
+    using namespace luchess;
+    ChessBoard start;
+    populateDefaultLayout(start);
+    EXPECT_EQ(start.pieces.count(White, Pawn), 8u);
+    EXPECT_EQ(start.pieces.count(Black, Knight), 2u);
+    ASSERT_EQ(start.pieces.squares(Black, King).size(), 1u);
+    EXPECT_EQ(start.pieces.squares(Black, King)[0], 60u);
+
+    // The lists follow make and unmake through captures, castling, en
+    // passant and promotions
+    std::function<void(ChessBoard&, uint)> walk = [&](ChessBoard& board, uint depth)
+    {
+        ASSERT_TRUE(board._piecesMatchLayout());
+        if (depth == 0)
+            return;
+        MoveList moves;
+        generateLegalMoves(board, moves);
+        for (auto const& move : moves)
+        {
+            auto undo = board.makeMove(move);
+            walk(board, depth - 1);
+            board.unmakeMove(move, undo);
+            ASSERT_TRUE(board._piecesMatchLayout());
+        }
+    };
+    for (std::string_view fen : {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"})
+    {
+        ChessBoard board = *parseFen(fen);
+        walk(board, 3);
+    }
+
+    // So does executeMove, and a rejected move leaves them alone
+    ChessBoard board = start;
+    EXPECT_FALSE(board.executeMove({{4, 0}, {4, 1}}).validMove);
+    EXPECT_TRUE(board.executeMove({{6, 0}, {5, 2}}).validMove);
+    EXPECT_TRUE(board._piecesMatchLayout());
+    EXPECT_EQ(board.pieces.count(White, Knight), 2u);
+
+    // An endgame lists its few pieces only
+    ChessBoard ending = *parseFen("8/8/8/4k3/8/8/8/R3K3 w - - 0 1");
+    EXPECT_EQ(ending.pieces.count(White, Rook), 1u);
+    EXPECT_EQ(ending.pieces.count(White, Pawn), 0u);
+
+    // Writing to the layout directly needs indexPieces
+    ending.getAt({3, 3}) = Piece(Queen, Black);
+    EXPECT_FALSE(ending._piecesMatchLayout());
+    ending.indexPieces();
+    EXPECT_TRUE(ending._piecesMatchLayout());
+    ChessBoard knights;
+    knights.layout.fill(Piece(Knight, White));
+    EXPECT_THROW(knights.indexPieces(), std::invalid_argument);
+    EXPECT_FALSE(parseFen("NNNNNNNN/NNN5/8/8/8/8/8/K6k w - - 0 1"));
+    // Only as many extra pieces as pawns have gone to promote
+    EXPECT_FALSE(parseFen("7k/2P3p1/8/8/8/8/QQQQQ3/QQQQQ2K w - - 0 1"));
+    EXPECT_FALSE(parseFen("7k/8/8/8/8/8/PPPPPPPP/QQ5K w - - 0 1"));
+    EXPECT_FALSE(parseFen("7k/8/8/8/8/PPPPPPPP/P7/K7 w - - 0 1"));
+    EXPECT_FALSE(parseFen("7k/8/8/8/8/8/PPPPPPPP/KNNN4 w - - 0 1"));
+    auto promoted = parseFen("7k/6pp/8/8/8/8/QQQQQQQQ/QRRBBNNK w - - 0 1");
+    ASSERT_TRUE(promoted);
+    EXPECT_EQ(promoted->pieces.count(White, Queen), 9u);
+    EXPECT_TRUE(parseFen("7k/8/8/8/8/8/PPPPPPP1/QQ2BBNK w - - 0 1"));
+
+#ifndef NDEBUG
+    // Builds with asserts check the lists after every make and unmake,
+    // so the walks above ran with the check on
+    ChessBoard stale = start;
+    stale.getAt({3, 3}) = Piece(Queen, White);
+    EXPECT_DEATH(stale.makeMove({{6, 0}, {5, 2}}), "_piecesMatchLayout");
+    EXPECT_DEATH(stale.executeMove({{6, 0}, {5, 2}}), "_piecesMatchLayout");
+    PieceLists full;
+    for (uint square = 0; square < PieceLists::kCapacity; square++)
+        full.add(Piece(Queen, White), square);
+    EXPECT_DEATH(full.add(Piece(Queen, White), 10), "kCapacity");
+#endif
+}
+
+TEST(testChess, LegalTargets)
+{
+    using namespace luchess;
+    // Every origin and target pair agrees with a speculative executeMove
+    for (std::string_view fen : {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3"})
+    {
+        ChessBoard board = *parseFen(fen);
+        LegalTargets targets(board);
+        MoveList moves;
+        generateLegalMoves(board, moves);
+        uint pairs = 0;
+        for (uint from = 0; from < 64; from++)
+        {
+            for (uint to = 0; to < 64; to++)
+            {
+                BoardMove move{{int(from % 8), int(from / 8)}, {int(to % 8), int(to / 8)}};
+                // executeMove throws on a move onto a king
+                if (board.layout[to] && board.layout[to]->type == King)
+                {
+                    EXPECT_FALSE(targets.isLegal(move));
+                    continue;
+                }
+                ChessBoard copy = board;
+                bool valid = copy.executeMove(move).validMove;
+                EXPECT_EQ(targets.isLegal(move), valid) << fen << " " << from << "-" << to;
+                pairs += valid;
+            }
+        }
+        EXPECT_EQ(targets.size(), pairs);
+        for (auto const& move : moves)
+            EXPECT_TRUE(targets.isLegal(move));
+    }
+
+    // Promotions want a real piece
+    ChessBoard promotion = *parseFen("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8");
+    LegalTargets targets(promotion);
+    EXPECT_TRUE(targets.promotes({3, 6}));
+    EXPECT_FALSE(targets.promotes({1, 1}));
+    EXPECT_EQ(targets.targets({3, 6}), squareBit(58));
+    EXPECT_TRUE(targets.isLegal({{3, 6}, {2, 7}, Knight}));
+    EXPECT_FALSE(targets.isLegal({{3, 6}, {2, 7}, King}));
+    EXPECT_FALSE(targets.isLegal({{3, 6}, {3, 8}}));
+    // Castling
+    EXPECT_TRUE(targets.castles({{4, 0}, {6, 0}}));
+    EXPECT_FALSE(targets.castles({{4, 0}, {5, 0}}));
+    EXPECT_TRUE(targets.origins() & squareBit(4));
+
+    // A history keeps them for the position at its cursor
+    GameHistory history;
+    EXPECT_EQ(history.legalTargets().size(), 20u);
+    EXPECT_EQ(history.legalTargets().targets({6, 0}), squareBit(21) | squareBit(23));
+    EXPECT_FALSE(history.play({{6, 0}, {6, 2}}).validMove);
+    EXPECT_TRUE(history.play({{4, 1}, {4, 3}}).validMove);
+    EXPECT_EQ(history.legalTargets().targets({4, 6}), squareBit(44) | squareBit(36));
+    EXPECT_TRUE(history.play({{4, 6}, {4, 4}}).validMove);
+    EXPECT_EQ(history.legalTargets().size(), 29u);
+    history.undo();
+    EXPECT_EQ(history.legalTargets().targets({4, 6}), squareBit(44) | squareBit(36));
+    history.seek(0);
+    EXPECT_EQ(history.legalTargets().size(), 20u);
+}
+
+TEST(testChess, AllocationFree)
+{
+    using namespace luchess;
+    // The audit sees allocations
+    {
+        AllocationScope scope;
+        auto match = isNotationValid("Nxf7");
+        EXPECT_GT(scope.allocations(), 0u);
+        std::unique_ptr<int> value = std::make_unique<int>(1);
+        EXPECT_GE(scope.counts().bytes, sizeof(int));
+    }
+
+    ChessBoard board = *parseFen(
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    MoveList moves;
+    EXPECT_NO_ALLOCATIONS(generatePseudoLegalMoves(board, moves));
+    moves.clear();
+    EXPECT_NO_ALLOCATIONS(generateLegalMoves(board, moves));
+    EXPECT_NO_ALLOCATIONS(
+        for (auto const& move : moves)
+        {
+            auto undo = board.makeMove(move);
+            board.unmakeMove(move, undo);
+        });
+    EXPECT_NO_ALLOCATIONS(perft(board, 3));
+    EXPECT_NO_ALLOCATIONS(evaluate(board));
+    EXPECT_NO_ALLOCATIONS(LegalTargets targets(board));
+
+    ChessBoard copy = board;
+    ChessBoard::UndoRecord undo;
+    EXPECT_NO_ALLOCATIONS(copy.executeMove(moves[0], &undo));
+    EXPECT_NO_ALLOCATIONS(copy.unmakeMove(moves[0], undo));
+
+    // SAN in and out
+    char san[16];
+    EXPECT_NO_ALLOCATIONS(decryptMove(board, "Nxf7"));
+    EXPECT_NO_ALLOCATIONS(decryptMove(board, "O-O-O"));
+    EXPECT_NO_ALLOCATIONS(parseUciMove(board, "e1g1"));
+    EXPECT_NO_ALLOCATIONS(formatSan(san, board, moves[0]));
+
+    // The replay loop, once the replayer is warm
+    std::ifstream file(LUCHESS_RESOURCES_DIR
+        "/kasparov-vs-the-world-chessnotations.txt");
+    std::string game(std::istreambuf_iterator<char>(file), {});
+    GameReplayer replayer;
+    replayer.replay(game);
+    ReplayResult result;
+    EXPECT_NO_ALLOCATIONS(result = replayer.replay(game));
+    EXPECT_GT(result.plies, 100u);
+}
+
 int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);